@@ -0,0 +1,1561 @@
+// GestureBench replays a crowd – captured or synthetic – through the three
+// gesture detectors as fast as the CPU allows, with virtual timestamps so the
+// detectors see the same timing they would live. It mirrors ofApp's
+// per-frame glue (drain packets, prune, per-voice rules, crowd rules) but
+// links no window, GL or GLFW, so it runs anywhere a compiler does.
+//
+// It answers two questions:
+//  - how fast? samples/sec, ns per detector call, heap allocations per frame;
+//  - did anything change? --events writes every gesture in order, so two
+//    builds can be compared with a plain diff.
+//
+// Capture files are plain text, one sample per line, timestamps in ms:
+//   v <t> <voiceId> <x> <y> <z> <size> <motion> <energy>
+//   d <t> <voiceId>
+//   z <t> <camId> <cols> <rows> <cols*rows values, row-major>
+//   g <t> <globalMotion>
+//   t <t>                    (a detection tick, as the host ran it)
+// Lines starting with '#' are ignored. --write-capture saves a synthetic
+// session in the same format.
+//
+// --capture also takes a binary .crowdlog recorded by the host (see
+// SessionLog.h). Logs and captures with 't' lines tick exactly where the live
+// run did instead of every --tick-ms, so the event log matches what the host
+// sent that night. --write-log saves the synthetic session as a .crowdlog.
+// The bench's virtual clock counts whole milliseconds, so a log's µs stamps
+// are rounded down on the way in and written back as ms * 1000.
+
+#include "DetectorSnapshot.h"
+#include "EnsembleGestureDetector.h"
+#include "FrameDiffGrid.h"
+#include "FrameDiffKernels.h"
+#include "GestureHistory.h"
+#include "GlobalGestureDetector.h"
+#include "IngestPacket.h"
+#include "LatencyStats.h"
+#include "SessionLog.h"
+#include "SourceClock.h"
+#include "StageProfiler.h"
+#include "VoiceGestureDetector.h"
+#include "VoiceSlotTable.h"
+#include "ZoneGestureDetector.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(GESTURE_BENCH_OPENCV)
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#endif
+
+namespace bench {
+bool logEnabled = false;
+} // namespace bench
+
+// ---------------------------------------------------------------------------
+// Every heap allocation in the process goes through here so we can report
+// allocations per frame. Counting is a relaxed atomic add; nothing else changes.
+
+namespace {
+std::atomic<uint64_t> allocationCount{0};
+
+void* countedAlloc(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Session: a time-ordered list of samples. Zone grids live in one shared
+// float pool so a record stays small.
+
+struct Record {
+    enum class Kind : uint8_t { Voice, Disconnect, Zones, Global, Tick };
+    Kind kind = Kind::Voice;
+    uint64_t t = 0;
+    int id = 0;
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    float size = 0.0f, motion = 0.0f, energy = 0.0f;
+    float global = 0.0f;
+    int cols = 0, rows = 0;
+    std::size_t cellOffset = 0;
+};
+
+struct Session {
+    std::vector<Record> records;
+    std::vector<float> cells;
+    bool recordedTicks = false;   ///< tick on Tick records instead of every --tick-ms.
+    bool inlineDetection = false; ///< judge each voice as its sample lands (detect_on_receive_thread).
+};
+
+struct Options {
+    std::string capturePath;
+    std::string writeCapturePath;
+    std::string writeLogPath;
+    std::string eventsPath;
+    std::string tracePath; ///< Chrome trace of the profiled replay.
+    int voices = 40;
+    int cameras = 3;
+    int cols = 4;
+    int rows = 4;
+    int seconds = 60;
+    unsigned seed = 1;
+    int trackerHz = 30;
+    uint64_t tickMs = 16;
+    uint64_t staleMs = 2500;
+    std::size_t historyFrames = 60;
+    uint64_t warmupMs = 2000;
+    bool coalesce = false; ///< voice_coalescing "latest_per_frame".
+    bool predictive = false; ///< voice_detector predictive_onset.
+    VoiceGestureDetector::RuleSet rules = VoiceGestureDetector::RuleSet::Full; ///< voice_detector rules.
+    uint64_t globalHistoryMs = 0; ///< GlobalGestureDetector::Config::historyMs; 0 = its default.
+    int frameWidth = 1920; ///< Webcam frame for the motion-grid timings; 0 skips them.
+    int frameHeight = 1080;
+};
+
+bool isSessionLog(const std::string& path) {
+    char magic[sizeof(SessionLogHeader::magic)] = {};
+    std::ifstream in(path, std::ios::binary);
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, SessionLogHeader().magic, sizeof(magic)) == 0;
+}
+
+bool loadSessionLog(const std::string& path, Session& session) {
+    SessionLogReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "could not open session log %s\n", path.c_str());
+        return false;
+    }
+    session.recordedTicks = true;
+    session.inlineDetection = reader.isInlineDetection();
+    session.records.reserve(static_cast<std::size_t>(reader.getRecordCount()));
+
+    // Kept in file order: the host logs samples and ticks as it handled them.
+    SessionSample sample;
+    while (reader.next(sample)) {
+        Record record;
+        record.t = sample.timestampMicros / 1000;
+        record.id = sample.id;
+        switch (sample.kind) {
+        case SessionRecordKind::Voice:
+            record.kind = Record::Kind::Voice;
+            record.x = sample.values[0];
+            record.y = sample.values[1];
+            record.z = sample.values[2];
+            record.size = sample.values[3];
+            record.motion = sample.values[4];
+            record.energy = sample.values[5];
+            break;
+        case SessionRecordKind::Disconnect:
+            record.kind = Record::Kind::Disconnect;
+            break;
+        case SessionRecordKind::Zones:
+            if (sample.cols > kMaxZoneLanes || sample.rows > kMaxZoneLanes || sample.cols * sample.rows > kMaxZoneCells) {
+                continue;
+            }
+            record.kind = Record::Kind::Zones;
+            record.cols = sample.cols;
+            record.rows = sample.rows;
+            record.cellOffset = session.cells.size();
+            session.cells.insert(session.cells.end(), sample.cells, sample.cells + sample.cols * sample.rows);
+            break;
+        case SessionRecordKind::Global:
+            record.kind = Record::Kind::Global;
+            record.global = sample.values[0];
+            break;
+        case SessionRecordKind::Tick:
+            record.kind = Record::Kind::Tick;
+            break;
+        }
+        session.records.push_back(record);
+    }
+    return true;
+}
+
+bool loadCapture(const std::string& path, Session& session) {
+    if (isSessionLog(path)) {
+        return loadSessionLog(path, session);
+    }
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "could not open capture %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        char kind = 0;
+        Record record;
+        fields >> kind >> record.t;
+        bool ok = true;
+        switch (kind) {
+        case 'v':
+            record.kind = Record::Kind::Voice;
+            ok = static_cast<bool>(fields >> record.id >> record.x >> record.y >> record.z >> record.size >> record.motion >> record.energy);
+            break;
+        case 'd':
+            record.kind = Record::Kind::Disconnect;
+            ok = static_cast<bool>(fields >> record.id);
+            break;
+        case 'z': {
+            record.kind = Record::Kind::Zones;
+            ok = static_cast<bool>(fields >> record.id >> record.cols >> record.rows);
+            ok = ok && record.cols > 0 && record.rows > 0 && record.cols * record.rows <= kMaxZoneCells;
+            record.cellOffset = session.cells.size();
+            for (int i = 0; ok && i < record.cols * record.rows; ++i) {
+                float value = 0.0f;
+                ok = static_cast<bool>(fields >> value);
+                session.cells.push_back(value);
+            }
+            break;
+        }
+        case 'g':
+            record.kind = Record::Kind::Global;
+            ok = static_cast<bool>(fields >> record.global);
+            break;
+        case 't':
+            record.kind = Record::Kind::Tick;
+            session.recordedTicks = true;
+            break;
+        default:
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "%s:%zu: skipping malformed line\n", path.c_str(), lineNumber);
+            continue;
+        }
+        session.records.push_back(record);
+    }
+    // With recorded ticks the file order *is* the live order; leave it alone.
+    if (!session.recordedTicks) {
+        std::stable_sort(session.records.begin(), session.records.end(),
+                         [](const Record& a, const Record& b) { return a.t < b.t; });
+    }
+    return true;
+}
+
+bool writeCapture(const std::string& path, const Session& session) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "could not write capture %s\n", path.c_str());
+        return false;
+    }
+    std::fprintf(out, "# crowd-organ capture: v/d/z/g records, timestamps in ms\n");
+    for (const Record& r : session.records) {
+        switch (r.kind) {
+        case Record::Kind::Voice:
+            std::fprintf(out, "v %llu %d %.9g %.9g %.9g %.9g %.9g %.9g\n", static_cast<unsigned long long>(r.t), r.id, r.x, r.y, r.z,
+                         r.size, r.motion, r.energy);
+            break;
+        case Record::Kind::Disconnect:
+            std::fprintf(out, "d %llu %d\n", static_cast<unsigned long long>(r.t), r.id);
+            break;
+        case Record::Kind::Zones:
+            std::fprintf(out, "z %llu %d %d %d", static_cast<unsigned long long>(r.t), r.id, r.cols, r.rows);
+            for (int i = 0; i < r.cols * r.rows; ++i) {
+                std::fprintf(out, " %.9g", session.cells[r.cellOffset + i]);
+            }
+            std::fprintf(out, "\n");
+            break;
+        case Record::Kind::Global:
+            std::fprintf(out, "g %llu %.9g\n", static_cast<unsigned long long>(r.t), r.global);
+            break;
+        case Record::Kind::Tick:
+            std::fprintf(out, "t %llu\n", static_cast<unsigned long long>(r.t));
+            break;
+        }
+    }
+    std::fclose(out);
+    return true;
+}
+
+bool writeSessionLog(const std::string& path, const Session& session, uint64_t tickMs) {
+    SessionLogWriter writer;
+    if (!writer.open(path, session.inlineDetection ? SessionLogHeader::kFlagInlineDetection : 0)) {
+        std::fprintf(stderr, "could not write session log %s\n", path.c_str());
+        return false;
+    }
+    // Without recorded ticks, log the ones Replay::run() would make up.
+    uint64_t nextTick = session.records.empty() ? 0 : session.records.front().t + tickMs;
+    for (const Record& r : session.records) {
+        while (!session.recordedTicks && r.t >= nextTick) {
+            writer.appendTick(nextTick * 1000);
+            nextTick += tickMs;
+        }
+        switch (r.kind) {
+        case Record::Kind::Voice:
+            writer.appendVoice(r.t * 1000, r.id, r.x, r.y, r.z, r.size, r.motion, r.energy);
+            break;
+        case Record::Kind::Disconnect:
+            writer.appendDisconnect(r.t * 1000, r.id);
+            break;
+        case Record::Kind::Zones:
+            writer.appendZones(r.t * 1000, r.id, r.cols, r.rows, session.cells.data() + r.cellOffset);
+            break;
+        case Record::Kind::Global:
+            writer.appendGlobal(r.t * 1000, r.global);
+            break;
+        case Record::Kind::Tick:
+            writer.appendTick(r.t * 1000);
+            break;
+        }
+    }
+    if (!session.recordedTicks && !session.records.empty()) {
+        writer.appendTick(nextTick * 1000);
+    }
+    writer.close();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic crowd: dancers wander and now and then perform one of the
+// vocabulary gestures; cameras see noise plus the odd sweep or pulse; the
+// room's global motion flips between calm and wild.
+
+struct SyntheticVoice {
+    enum class Move { Wander, Raise, Lower, SwipeLeft, SwipeRight, Shake, Hold, Away };
+    Move move = Move::Wander;
+    uint64_t moveStart = 0;
+    uint64_t moveEnd = 0;
+    float x = 0.5f, y = 0.5f, z = 2.0f;
+    float anchorX = 0.5f, anchorY = 0.5f;
+};
+
+void generateSession(const Options& options, Session& session) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<SyntheticVoice> voices(static_cast<std::size_t>(options.voices));
+    for (auto& voice : voices) {
+        voice.x = voice.anchorX = 0.1f + 0.8f * unit(rng);
+        voice.y = voice.anchorY = 0.2f + 0.6f * unit(rng);
+    }
+
+    const int cells = options.cols * options.rows;
+    std::vector<int> sweepStep(static_cast<std::size_t>(options.cameras), -1);
+    std::vector<int> sweepKind(static_cast<std::size_t>(options.cameras), 0);
+    float globalLevel = 0.1f;
+
+    const uint64_t frameMs = static_cast<uint64_t>(1000 / std::max(1, options.trackerHz));
+    const uint64_t endMs = static_cast<uint64_t>(options.seconds) * 1000;
+    for (uint64_t base = frameMs; base <= endMs; base += frameMs) {
+        for (std::size_t id = 0; id < voices.size(); ++id) {
+            SyntheticVoice& voice = voices[id];
+            // Trackers report each blob at its own phase inside the frame.
+            const uint64_t t = base + (id * 7) % frameMs;
+
+            if (t >= voice.moveEnd) {
+                if (voice.move == SyntheticVoice::Move::Away) {
+                    voice.move = SyntheticVoice::Move::Wander;
+                } else if (unit(rng) < 0.01f) {
+                    Record leave;
+                    leave.kind = Record::Kind::Disconnect;
+                    leave.t = t;
+                    leave.id = static_cast<int>(id);
+                    session.records.push_back(leave);
+                    voice.move = SyntheticVoice::Move::Away;
+                } else {
+                    voice.move = static_cast<SyntheticVoice::Move>(rng() % 7);
+                }
+                voice.moveStart = t;
+                voice.moveEnd = t + 600 + rng() % 1400;
+                voice.anchorX = voice.x;
+                voice.anchorY = voice.y;
+            }
+            if (voice.move == SyntheticVoice::Move::Away) {
+                continue;
+            }
+
+            const float phase = static_cast<float>(t - voice.moveStart) / static_cast<float>(voice.moveEnd - voice.moveStart);
+            float motion = 0.1f + 0.1f * unit(rng);
+            switch (voice.move) {
+            case SyntheticVoice::Move::Wander:
+                voice.x += 0.01f * (unit(rng) - 0.5f);
+                voice.y += 0.01f * (unit(rng) - 0.5f);
+                break;
+            case SyntheticVoice::Move::Raise:
+                voice.y = voice.anchorY - 0.35f * phase;
+                motion = 0.4f;
+                break;
+            case SyntheticVoice::Move::Lower:
+                voice.y = voice.anchorY + 0.35f * phase;
+                motion = 0.4f;
+                break;
+            case SyntheticVoice::Move::SwipeLeft:
+                voice.x = voice.anchorX - 0.45f * phase;
+                motion = 0.5f;
+                break;
+            case SyntheticVoice::Move::SwipeRight:
+                voice.x = voice.anchorX + 0.45f * phase;
+                motion = 0.5f;
+                break;
+            case SyntheticVoice::Move::Shake:
+                voice.x = voice.anchorX + 0.05f * std::sin(phase * 40.0f);
+                motion = 0.3f;
+                break;
+            case SyntheticVoice::Move::Hold:
+                motion = 0.01f;
+                break;
+            case SyntheticVoice::Move::Away:
+                break;
+            }
+            voice.x = std::min(1.0f, std::max(0.0f, voice.x));
+            voice.y = std::min(1.0f, std::max(0.0f, voice.y));
+
+            Record record;
+            record.kind = Record::Kind::Voice;
+            record.t = t;
+            record.id = static_cast<int>(id);
+            record.x = voice.x;
+            record.y = voice.y;
+            record.z = voice.z;
+            record.size = 0.2f;
+            record.motion = motion;
+            record.energy = 0.5f * motion;
+            session.records.push_back(record);
+        }
+
+        for (int cam = 0; cam < options.cameras; ++cam) {
+            Record record;
+            record.kind = Record::Kind::Zones;
+            record.t = base + 3 + static_cast<uint64_t>(cam);
+            record.id = cam;
+            record.cols = options.cols;
+            record.rows = options.rows;
+            record.cellOffset = session.cells.size();
+            for (int i = 0; i < cells; ++i) {
+                session.cells.push_back(0.2f * unit(rng));
+            }
+            float* grid = session.cells.data() + record.cellOffset;
+
+            int& step = sweepStep[static_cast<std::size_t>(cam)];
+            int& kind = sweepKind[static_cast<std::size_t>(cam)];
+            if (step < 0 && rng() % 40 == 0) {
+                step = 0;
+                kind = static_cast<int>(rng() % 4);
+            }
+            if (step >= 0) {
+                const int length = (kind < 2) ? options.cols : options.rows;
+                const int across = (kind < 2) ? options.rows : options.cols;
+                const int index = (kind & 1) ? length - 1 - step : step;
+                for (int lane = 0; lane < across; ++lane) {
+                    int cell = (kind < 2) ? lane * options.cols + index : index * options.cols + lane;
+                    grid[cell] = 0.6f + 0.4f * unit(rng);
+                }
+                step = (step + 1 < length) ? step + 1 : -1;
+            }
+            if (rng() % 30 == 0) {
+                grid[rng() % static_cast<unsigned>(cells)] = 0.9f;
+            }
+            session.records.push_back(record);
+        }
+
+        if (rng() % 300 == 0) {
+            globalLevel = unit(rng) < 0.5f ? 0.05f : 0.95f;
+        }
+        Record global;
+        global.kind = Record::Kind::Global;
+        global.t = base + 5;
+        global.global = globalLevel + 0.05f * unit(rng);
+        session.records.push_back(global);
+    }
+    std::stable_sort(session.records.begin(), session.records.end(),
+                     [](const Record& a, const Record& b) { return a.t < b.t; });
+}
+
+// ---------------------------------------------------------------------------
+// Replay: the same steps ofApp::update() takes, with a virtual clock.
+
+uint64_t nowNanos() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+struct CallTimer {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+
+    void add(uint64_t ns) {
+        ++calls;
+        totalNs += ns;
+        maxNs = std::max(maxNs, ns);
+    }
+    void print(const char* name) const {
+        std::printf("%-12s %10llu calls %9.0f ns avg %9llu ns max\n", name, static_cast<unsigned long long>(calls),
+                    calls ? static_cast<double>(totalNs) / static_cast<double>(calls) : 0.0, static_cast<unsigned long long>(maxNs));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// OSC decode: every sample encoded the way a tracker would send it – voice
+// states and zones with their capture time as a trailing int64 – then run
+// through the receive thread's fast-path decoder and checked field by field.
+
+void appendOscString(std::vector<char>& out, const char* text) {
+    const std::size_t length = std::strlen(text);
+    out.insert(out.end(), text, text + length);
+    out.resize(out.size() + 4 - (length & 3), '\0');
+}
+
+void appendOscWord(std::vector<char>& out, uint32_t word) {
+    const char bytes[4] = {static_cast<char>(word >> 24), static_cast<char>(word >> 16), static_cast<char>(word >> 8),
+                           static_cast<char>(word)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void appendOscFloat(std::vector<char>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendOscWord(out, bits);
+}
+
+void appendOscInt64(std::vector<char>& out, uint64_t value) {
+    appendOscWord(out, static_cast<uint32_t>(value >> 32));
+    appendOscWord(out, static_cast<uint32_t>(value));
+}
+
+bool encodeOsc(const Record& r, const Session& session, std::vector<char>& out) {
+    switch (r.kind) {
+    case Record::Kind::Voice:
+        appendOscString(out, "/room/voice/state");
+        appendOscString(out, ",iffffffh");
+        appendOscWord(out, static_cast<uint32_t>(r.id));
+        for (float value : {r.x, r.y, r.z, r.size, r.motion, r.energy}) {
+            appendOscFloat(out, value);
+        }
+        appendOscInt64(out, r.t * 1000);
+        return true;
+    case Record::Kind::Disconnect:
+        appendOscString(out, "/room/voice/disconnect");
+        appendOscString(out, ",i");
+        appendOscWord(out, static_cast<uint32_t>(r.id));
+        return true;
+    case Record::Kind::Zones: {
+        appendOscString(out, "/room/camera/zones");
+        std::string tags = ",iii" + std::string(static_cast<std::size_t>(r.cols * r.rows), 'f') + "h";
+        appendOscString(out, tags.c_str());
+        appendOscWord(out, static_cast<uint32_t>(r.id));
+        appendOscWord(out, static_cast<uint32_t>(r.cols));
+        appendOscWord(out, static_cast<uint32_t>(r.rows));
+        for (int i = 0; i < r.cols * r.rows; ++i) {
+            appendOscFloat(out, session.cells[r.cellOffset + i]);
+        }
+        appendOscInt64(out, r.t * 1000);
+        return true;
+    }
+    case Record::Kind::Global:
+        appendOscString(out, "/room/global/motion");
+        appendOscString(out, ",f");
+        appendOscFloat(out, r.global);
+        return true;
+    case Record::Kind::Tick:
+        break;
+    }
+    return false;
+}
+
+bool decodedMatches(const IngestPacket& p, const Record& r, const Session& session) {
+    const bool stamped = p.hasTrackerTime && p.trackerMicros == static_cast<int64_t>(r.t * 1000);
+    switch (r.kind) {
+    case Record::Kind::Voice:
+        return p.kind == IngestPacket::Kind::VoiceState && stamped && p.id == r.id && p.position.x == r.x && p.position.y == r.y
+               && p.position.z == r.z && p.size == r.size && p.motion == r.motion && p.energy == r.energy;
+    case Record::Kind::Disconnect:
+        return p.kind == IngestPacket::Kind::VoiceDisconnect && p.id == r.id;
+    case Record::Kind::Zones:
+        return p.kind == IngestPacket::Kind::CameraZones && stamped && p.id == r.id && p.cols == r.cols && p.rows == r.rows
+               && std::memcmp(p.zones.data(), session.cells.data() + r.cellOffset, sizeof(float) * r.cols * r.rows) == 0;
+    case Record::Kind::Global:
+        return p.kind == IngestPacket::Kind::GlobalMotion && p.globalMotion == r.global;
+    case Record::Kind::Tick:
+        break;
+    }
+    return false;
+}
+
+void benchDecode(const Session& session) {
+    std::vector<char> wire;
+    std::vector<std::size_t> offsets;
+    std::vector<const Record*> sources;
+    for (const Record& record : session.records) {
+        const std::size_t offset = wire.size();
+        if (encodeOsc(record, session, wire)) {
+            offsets.push_back(offset);
+            sources.push_back(&record);
+        }
+    }
+    offsets.push_back(wire.size());
+
+    // Decode everything once for timing, then again to check the results,
+    // so the comparison doesn't pollute the numbers.
+    IngestPacket packet;
+    uint64_t decoded = 0;
+    const std::size_t messages = sources.size();
+    const uint64_t start = nowNanos();
+    for (std::size_t i = 0; i < messages; ++i) {
+        decoded += decodeIngestPacket(wire.data() + offsets[i], offsets[i + 1] - offsets[i], packet) ? 1 : 0;
+    }
+    const uint64_t elapsed = nowNanos() - start;
+
+    uint64_t mismatched = 0;
+    for (std::size_t i = 0; i < messages; ++i) {
+        if (!decodeIngestPacket(wire.data() + offsets[i], offsets[i + 1] - offsets[i], packet)
+            || !decodedMatches(packet, *sources[i], session)) {
+            ++mismatched;
+        }
+    }
+    std::printf("%-12s %10llu calls %9.0f ns avg %9llu mismatched\n", "oscDecode", static_cast<unsigned long long>(decoded),
+                messages ? static_cast<double>(elapsed) / static_cast<double>(messages) : 0.0,
+                static_cast<unsigned long long>(mismatched));
+}
+
+// ---------------------------------------------------------------------------
+// Source timestamps: one voice swaying at 60 Hz, delivered over a jittery
+// network with a stall now and then that lets the backlog land in a burst.
+// Its velocity is derived twice – from arrival stamps and from the tracker's
+// own stamps mapped through a SourceClock – and compared with the truth.
+
+void benchSourceClock() {
+    const uint64_t periodMicros = 16667;
+    const int64_t hostMinusSource = 5000000000LL; // the two clocks share no epoch.
+    const float omega = 2.0f * 3.14159265f * 0.8f;
+    std::mt19937 rng(7);
+    std::exponential_distribution<double> jitter(1.0 / 4000.0);
+
+    GestureHistory history;
+    const GestureHistory::Handle byArrival = history.acquire();
+    const GestureHistory::Handle bySource = history.acquire();
+    SourceClock clock;
+    double arrivalError = 0.0, sourceError = 0.0, mappingError = 0.0;
+    int measured = 0;
+    uint64_t lastArrival = 0;
+    for (int frame = 1; frame <= 600; ++frame) {
+        const int64_t sourceMicros = static_cast<int64_t>(frame * periodMicros);
+        const uint64_t sentMicros = static_cast<uint64_t>(sourceMicros + hostMinusSource);
+        uint64_t arrivalMicros = sentMicros + 1000 + static_cast<uint64_t>(jitter(rng));
+        if (frame % 45 == 0) {
+            arrivalMicros += 40000; // a stall: the frames behind it queue up
+        }
+        arrivalMicros = std::max(arrivalMicros, lastArrival); // one socket, delivered in order
+        lastArrival = arrivalMicros;
+
+        const float seconds = static_cast<float>(sourceMicros) / 1e6f;
+        const glm::vec3 position(0.5f * std::sin(omega * seconds), 0.5f, 0.5f);
+        const uint64_t mapped = clock.map(sourceMicros, arrivalMicros);
+        history.addSample(byArrival, position, 0.0f, 0.0f, arrivalMicros);
+        history.addSample(bySource, position, 0.0f, 0.0f, mapped);
+        if (frame > 60) { // give the clock a second to settle
+            // Finite differences lag half a period behind the true derivative.
+            const float truth = 0.5f * omega * std::cos(omega * (seconds - 0.5f * static_cast<float>(periodMicros) / 1e6f));
+            const float arrivalV = history.getHistory(byArrival).back().velocity.x - truth;
+            const float sourceV = history.getHistory(bySource).back().velocity.x - truth;
+            arrivalError += static_cast<double>(arrivalV) * arrivalV;
+            sourceError += static_cast<double>(sourceV) * sourceV;
+            mappingError += std::abs(static_cast<double>(static_cast<int64_t>(mapped) - static_cast<int64_t>(sentMicros)));
+            ++measured;
+        }
+    }
+    std::printf("%-12s velocity rms error %.4f by arrival, %.4f by source stamp, mapped %.0f µs after send\n", "sourceClock",
+                std::sqrt(arrivalError / measured), std::sqrt(sourceError / measured), mappingError / measured);
+}
+
+// ---------------------------------------------------------------------------
+// Webcam motion grid: two synthetic gray frames (sensor noise plus a bright
+// block that moves between them) reduced to a zone grid three ways – the
+// fused kernel, its scalar reference, and the same two steps an absdiff +
+// area-resize pipeline takes (a full difference image, then per-cell sums),
+// as plain loops. Those loops only show what skipping the difference image
+// saves; built with `make OPENCV=1` the bench also times the real
+// cv::absdiff + cv::resize(INTER_AREA). Then FrameDiffGrid end to end on gray
+// and RGB input.
+
+void makeFrame(int width, int height, int blockX, std::mt19937& rng, std::vector<uint8_t>& out) {
+    std::uniform_int_distribution<int> noise(60, 68);
+    out.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const bool inBlock = x >= blockX && x < blockX + width / 5 && y >= height / 3 && y < height / 3 + height / 4;
+            out[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + x] = static_cast<uint8_t>(inBlock ? 220 : noise(rng));
+        }
+    }
+}
+
+void absdiffThenArea(const uint8_t* current, const uint8_t* previous, int width, int height, int cols, int rows,
+                     std::vector<uint8_t>& diff, uint32_t* cellSums) {
+    const std::size_t pixels = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    for (std::size_t i = 0; i < pixels; ++i) {
+        diff[i] = static_cast<uint8_t>(std::abs(current[i] - previous[i]));
+    }
+    std::fill(cellSums, cellSums + cols * rows, 0u);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* line = diff.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+        uint32_t* sums = cellSums + (y * rows / height) * cols;
+        for (int x = 0; x < width; ++x) {
+            sums[x * cols / width] += line[x];
+        }
+    }
+}
+
+void benchFrameDiff(const Options& options) {
+    const int width = options.frameWidth;
+    const int height = options.frameHeight;
+    if (width < options.cols || height < options.rows) {
+        return;
+    }
+    constexpr int kFrames = 60;
+    std::mt19937 rng(options.seed);
+    std::vector<uint8_t> frames[2];
+    makeFrame(width, height, width / 5, rng, frames[0]);
+    makeFrame(width, height, width / 2, rng, frames[1]);
+    std::vector<uint8_t> rgb(frames[0].size() * 3);
+    for (std::size_t i = 0; i < frames[0].size(); ++i) {
+        rgb[3 * i] = rgb[3 * i + 1] = rgb[3 * i + 2] = frames[0][i];
+    }
+
+    const int cells = options.cols * options.rows;
+    std::vector<uint32_t> fused(cells), reference(cells), twoPass(cells);
+    std::vector<uint8_t> diff(frames[0].size());
+    CallTimer fusedTimer;
+    CallTimer scalarTimer;
+    CallTimer twoPassTimer;
+    uint64_t mismatched = 0;
+    for (int i = 0; i < kFrames; ++i) {
+        const uint8_t* current = frames[i & 1].data();
+        const uint8_t* previous = frames[(i + 1) & 1].data();
+        uint64_t start = nowNanos();
+        accumulateFrameDiff(current, width, previous, width, width, height, options.cols, options.rows, fused.data());
+        fusedTimer.add(nowNanos() - start);
+        start = nowNanos();
+        accumulateFrameDiffScalar(current, width, previous, width, width, height, options.cols, options.rows, reference.data());
+        scalarTimer.add(nowNanos() - start);
+        start = nowNanos();
+        absdiffThenArea(current, previous, width, height, options.cols, options.rows, diff, twoPass.data());
+        twoPassTimer.add(nowNanos() - start);
+        mismatched += (fused != reference || fused != twoPass) ? 1 : 0;
+    }
+
+#if defined(GESTURE_BENCH_OPENCV)
+    // INTER_AREA hands back per-cell means weighted by partial pixel
+    // coverage, not sums, so it is timed here but not counted as a mismatch.
+    cv::Mat cvFrames[2] = {cv::Mat(height, width, CV_8UC1, frames[0].data()),
+                           cv::Mat(height, width, CV_8UC1, frames[1].data())};
+    cv::Mat cvDiff;
+    cv::Mat cvGrid;
+    CallTimer opencvTimer;
+    for (int i = 0; i < kFrames; ++i) {
+        const uint64_t start = nowNanos();
+        cv::absdiff(cvFrames[i & 1], cvFrames[(i + 1) & 1], cvDiff);
+        cv::resize(cvDiff, cvGrid, cv::Size(options.cols, options.rows), 0, 0, cv::INTER_AREA);
+        opencvTimer.add(nowNanos() - start);
+    }
+#endif
+
+    std::vector<uint8_t> halved(static_cast<std::size_t>(width / 2) * static_cast<std::size_t>(height / 2));
+    std::vector<uint8_t> halvedReference(halved.size());
+    CallTimer halveTimer;
+    for (int i = 0; i < kFrames; ++i) {
+        const uint64_t start = nowNanos();
+        halveGray(frames[i & 1].data(), width, width / 2, height / 2, halved.data());
+        halveTimer.add(nowNanos() - start);
+    }
+    halveGrayScalar(frames[1].data(), width, width / 2, height / 2, halvedReference.data());
+    mismatched += halved != halvedReference ? 1 : 0;
+
+    // End to end, as a webcam thread runs it: gray at full size, gray
+    // halved, RGB halved (the plain-loop shrink).
+    struct Route {
+        const char* name;
+        int downsample;
+        bool colour;
+    };
+    const Route routes[] = {{"gridGray", 1, false}, {"gridGrayHalf", 2, false}, {"gridRgbHalf", 2, true}};
+    std::vector<float> zones(cells);
+    std::printf("frame diff: %dx%d into %dx%d cells, %s\n", width, height, options.cols, options.rows,
+#if defined(CROWD_ORGAN_DIFF_AVX2)
+                "AVX2"
+#elif defined(CROWD_ORGAN_ZONE_SSE2)
+                "SSE2"
+#elif defined(CROWD_ORGAN_ZONE_NEON)
+                "NEON"
+#else
+                "scalar"
+#endif
+    );
+    fusedTimer.print("diffFused");
+    scalarTimer.print("diffScalar");
+    twoPassTimer.print("diffTwoLoops");
+#if defined(GESTURE_BENCH_OPENCV)
+    opencvTimer.print("diffOpenCV");
+#endif
+    halveTimer.print("halveGray");
+    for (const Route& route : routes) {
+        FrameDiffGrid grid;
+        FrameDiffGrid::Settings settings;
+        settings.cols = options.cols;
+        settings.rows = options.rows;
+        settings.downsample = route.downsample;
+        grid.setup(settings);
+        CallTimer timer;
+        for (int i = 0; i <= kFrames; ++i) {
+            // The colour route reuses one frame: the shrink is what it measures.
+            const uint8_t* pixels = route.colour ? rgb.data() : frames[i & 1].data();
+            const uint64_t start = nowNanos();
+            const bool ready = grid.process(pixels, width, height, route.colour ? 3 : 1, route.colour ? width * 3 : width, zones.data());
+            if (ready) {
+                timer.add(nowNanos() - start);
+            }
+        }
+        timer.print(route.name);
+    }
+    std::printf("frameDiff    %10llu mismatched against the scalar reference\n", static_cast<unsigned long long>(mismatched));
+}
+
+class Replay {
+public:
+    Replay(const Options& opts, std::FILE* eventsOut) : options(opts), events(eventsOut) {
+        history.setCapacity(options.historyFrames);
+        voices.reserve(static_cast<std::size_t>(std::max(64, options.voices)));
+        dirtyVoices.reserve(static_cast<std::size_t>(std::max(64, options.voices)));
+        // Gesture log lines format on the detection path, and without an
+        // AsyncLogger running they go straight to stderr, so like a show with
+        // log_gestures off they are skipped unless --log asks for them.
+        VoiceGestureDetector::Config voiceConfig = voiceDetector.getConfig();
+        voiceConfig.logGestures = bench::logEnabled;
+        voiceConfig.predictiveOnset = options.predictive;
+        voiceConfig.rules = options.rules;
+        voiceDetector.setConfig(voiceConfig);
+        ZoneGestureDetector::Config zoneConfig = zoneDetector.getConfig();
+        zoneConfig.logGestures = bench::logEnabled;
+        zoneDetector.setConfig(zoneConfig);
+        GlobalGestureDetector::Config globalConfig = globalDetector.getConfig();
+        globalConfig.logGestures = bench::logEnabled;
+        if (options.globalHistoryMs > 0) {
+            globalConfig.historyMs = options.globalHistoryMs;
+        }
+        globalDetector.setConfig(globalConfig);
+        EnsembleGestureDetector::Config ensembleConfig = ensembleDetector.getConfig();
+        ensembleConfig.logGestures = bench::logEnabled;
+        ensembleDetector.setConfig(ensembleConfig);
+        voiceEvents.reserve(64);
+        zoneEvents.reserve(64);
+        globalEvents.reserve(8);
+        ensembleEvents.reserve(static_cast<std::size_t>(std::max(64, options.voices)));
+    }
+
+    void run(const Session& session) {
+        if (session.records.empty()) {
+            return;
+        }
+        inlineDetection = session.inlineDetection;
+        const uint64_t first = session.records.front().t;
+        uint64_t nextTick = first + options.tickMs;
+        warmupEnd = first + options.warmupMs;
+
+        const uint64_t wallStart = nowNanos();
+        allocationsAtStart = allocationCount.load();
+        for (const Record& record : session.records) {
+            while (!session.recordedTicks && record.t >= nextTick) {
+                timedTick(nextTick);
+                nextTick += options.tickMs;
+            }
+            if (record.kind == Record::Kind::Tick) {
+                timedTick(record.t);
+            } else {
+                apply(record, session);
+            }
+        }
+        if (!session.recordedTicks) {
+            timedTick(nextTick);
+        }
+        wallNs = nowNanos() - wallStart;
+        allocationsAtEnd = allocationCount.load();
+        if (!warm) {
+            allocationsAtWarm = allocationsAtStart;
+            ticksAtWarm = 0;
+        }
+        virtualMs = lastTick > first ? lastTick - first : 0;
+    }
+
+    /**
+     * Halfway through run(), at the first tick at or after `t`: snapshot the
+     * detectors to `path` through the host's writer, read it back and load it
+     * over them, as a restart would. Ticks have emptied the dirty set by then,
+     * so nothing in flight is lost that a real restart would keep.
+     */
+    void restartAt(uint64_t t, const std::string& path, bool midOnset = false) {
+        restartMs = t;
+        snapshotPath = path;
+        restartMidOnset = midOnset;
+    }
+    uint64_t getRestoredOnsets() const { return restoredOnsets; }
+    uint64_t getRestartTick() const { return restartTick; }
+    uint64_t getWallNs() const { return wallNs; }
+
+    /// Time the stages into `sink`, the way ofApp does with profile_enabled.
+    void profileWith(StageProfiler* sink) { profiler = sink; }
+
+    void reportRestart(std::size_t matching, std::size_t total) const {
+        std::printf("snapshot     %llu bytes for %llu voices, save %.2f ms, load %.2f ms, %llu of %llu later events match%s\n",
+                    static_cast<unsigned long long>(snapshotBytes), static_cast<unsigned long long>(restoredVoices),
+                    static_cast<double>(saveNs) / 1e6, static_cast<double>(loadNs) / 1e6, static_cast<unsigned long long>(matching),
+                    static_cast<unsigned long long>(total), restoreOk ? "" : " (load failed)");
+    }
+
+    void reportRules() const {
+        std::printf("rules %-12s %9.0f ns avg per updateVoice, %llu voice events\n", VoiceGestureDetector::ruleSetName(options.rules),
+                    voiceTimer.calls ? static_cast<double>(voiceTimer.totalNs) / static_cast<double>(voiceTimer.calls) : 0.0,
+                    static_cast<unsigned long long>(voiceEventCount));
+    }
+
+    void report() const {
+        const double wallSec = static_cast<double>(wallNs) / 1e9;
+        const uint64_t samples = voiceSamples + zoneSamples + globalSamples;
+        std::printf("replayed %llu samples (voice %llu, zone %llu, global %llu) over %.1f s virtual in %.3f s wall\n",
+                    static_cast<unsigned long long>(samples), static_cast<unsigned long long>(voiceSamples),
+                    static_cast<unsigned long long>(zoneSamples), static_cast<unsigned long long>(globalSamples),
+                    static_cast<double>(virtualMs) / 1000.0, wallSec);
+        std::printf("throughput   %.0f samples/s (%.1fx real time)\n", wallSec > 0 ? static_cast<double>(samples) / wallSec : 0.0,
+                    wallSec > 0 ? static_cast<double>(virtualMs) / 1000.0 / wallSec : 0.0);
+        voiceTimer.print("updateVoice");
+        zoneTimer.print("updateCamera");
+        globalTimer.print("update");
+        ensembleTimer.print("ensemble");
+        const uint64_t steadyTicks = ticks - ticksAtWarm;
+        std::printf("allocations  %llu total, %.2f per frame over %llu frames after %llu ms warm-up\n",
+                    static_cast<unsigned long long>(allocationsAtEnd - allocationsAtStart),
+                    steadyTicks ? static_cast<double>(allocationsAtEnd - allocationsAtWarm) / static_cast<double>(steadyTicks) : 0.0,
+                    static_cast<unsigned long long>(steadyTicks), static_cast<unsigned long long>(options.warmupMs));
+        std::printf("events       %llu voice, %llu zone, %llu global, %llu ensemble\n", static_cast<unsigned long long>(voiceEventCount),
+                    static_cast<unsigned long long>(zoneEventCount), static_cast<unsigned long long>(globalEventCount),
+                    static_cast<unsigned long long>(ensembleEventCount));
+        if (options.predictive) {
+            // Lead: how long before the full rule each confirmed begin went out.
+            std::printf("onsets       %llu begin, %llu confirm, %llu cancel, %.0f ms mean lead\n", static_cast<unsigned long long>(onsetBegins),
+                        static_cast<unsigned long long>(onsetConfirms), static_cast<unsigned long long>(onsetCancels),
+                        onsetConfirms ? 1000.0 * onsetLeadSec / static_cast<double>(onsetConfirms) : 0.0);
+        }
+    }
+
+private:
+    void timedTick(uint64_t now) {
+        tick(now);
+        lastTick = now;
+        if (restartMs && !restartTick && now >= restartMs && (!restartMidOnset || anyOnsetPending())) {
+            restart(now);
+        }
+        if (!warm && now + options.tickMs >= warmupEnd) {
+            warm = true;
+            allocationsAtWarm = allocationCount.load();
+            ticksAtWarm = ticks;
+        }
+    }
+
+    bool anyOnsetPending() const {
+        for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+            const VoiceSlot& slot = voices.slot(voiceId);
+            if (slot.live && slot.track.onset.pending) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void restart(uint64_t now) {
+        restartTick = now;
+        const DetectorState state{voices, history, zoneDetector, globalDetector, ensembleDetector};
+        DetectorSnapshotWriter writer;
+        if (!writer.start(snapshotPath)) {
+            return;
+        }
+        uint64_t start = nowNanos();
+        SnapshotBuffer* buffer = writer.beginSnapshot();
+        saveDetectorState(state, *buffer);
+        saveNs = nowNanos() - start;
+        snapshotBytes = buffer->size();
+        writer.commitSnapshot(monotonicMicros());
+        writer.stop();
+
+        start = nowNanos();
+        std::vector<char> payload;
+        int64_t offsetMicros = 0;
+        uint64_t ageMs = 0;
+        if (readDetectorSnapshot(snapshotPath, 10000, payload, offsetMicros, ageMs) == SnapshotLoad::Loaded) {
+            // The replay runs on the log's virtual clock, not monotonicMicros(),
+            // so there is no clock shift to apply.
+            SnapshotCursor cursor(payload.data(), payload.size());
+            restoreOk = loadDetectorState(state, cursor);
+        }
+        loadNs = nowNanos() - start;
+        // Like ofApp::restoreSnapshot(): restored begins are cancelled.
+        for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+            VoiceSlot& slot = voices.slot(voiceId);
+            VoiceGestureEvent cancel;
+            if (slot.live && VoiceGestureDetector::cancelOnset(slot.track, voiceId, now, cancel)) {
+                ++restoredOnsets;
+                logOnsetEvent(cancel, now);
+            }
+        }
+        restoredVoices = voices.size();
+        std::remove(snapshotPath.c_str());
+    }
+
+    void apply(const Record& record, const Session& session) {
+        switch (record.kind) {
+        case Record::Kind::Voice: {
+            ++voiceSamples;
+            bool claimed = false;
+            VoiceSlot* slot = voices.claim(record.id, claimed);
+            if (!slot) {
+                break;
+            }
+            if (claimed) {
+                slot->history = history.acquire();
+            }
+            slot->position = glm::vec3(record.x, record.y, record.z);
+            slot->energy = record.energy;
+            slot->lastUpdateMicros = record.t * 1000;
+            if (options.coalesce && !inlineDetection) {
+                slot->pendingMotion += record.motion;
+                ++slot->pendingSamples;
+            } else {
+                history.addSample(slot->history, slot->position, record.motion, record.energy, slot->lastUpdateMicros);
+            }
+            if (inlineDetection) {
+                // Receive-thread mode: the host judged this voice on arrival.
+                voiceEvents.clear();
+                detectVoice(record.id);
+                logVoiceEvents(record.t);
+            } else {
+                voices.markDirty(record.id);
+            }
+            break;
+        }
+        case Record::Kind::Disconnect:
+            dropVoice(record.id, record.t);
+            break;
+        case Record::Kind::Zones: {
+            ScopedProfile stageTiming(profiler, ProfileStage::ZoneDetector);
+            ++zoneSamples;
+            zoneEvents.clear();
+            uint64_t start = nowNanos();
+            zoneDetector.updateCamera(record.id, record.rows, record.cols, session.cells.data() + record.cellOffset, record.t, zoneEvents);
+            zoneTimer.add(nowNanos() - start);
+            for (const auto& event : zoneEvents) {
+                ++zoneEventCount;
+                if (events) {
+                    std::fprintf(events, "%llu zone %d %s %.4f %d\n", static_cast<unsigned long long>(record.t), event.camId,
+                                 gestureTypeName(event), event.strength, event.hasZoneIndex ? event.zoneIndex : -1);
+                }
+            }
+            break;
+        }
+        case Record::Kind::Global:
+            ++globalSamples;
+            lastGlobalMotion = record.global;
+            break;
+        case Record::Kind::Tick:
+            break;
+        }
+    }
+
+    void detectVoice(int voiceId) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        GestureHistory::View view = history.getHistory(slot.history);
+        if (view.size() < 2) {
+            return;
+        }
+        ScopedProfile stageTiming(profiler, ProfileStage::VoiceDetector);
+        uint64_t start = nowNanos();
+        voiceDetector.updateVoice(slot.track, voiceId, view, voiceEvents);
+        voiceTimer.add(nowNanos() - start);
+    }
+
+    void logVoiceEvents(uint64_t now) {
+        for (const auto& event : voiceEvents) {
+            logVoiceEvent(event, now);
+        }
+    }
+
+    void logVoiceEvent(const VoiceGestureEvent& event, uint64_t now) {
+        if (event.phase != VoiceGesturePhase::Complete) {
+            logOnsetEvent(event, now);
+            return;
+        }
+        ++voiceEventCount;
+        if (const VoiceSlot* slot = voices.find(event.voiceId)) {
+            ensembleDetector.noteVoiceGesture(event, slot->lastUpdateMicros / 1000);
+        }
+        if (events) {
+            std::fprintf(events, "%llu voice %d %s %.4f %.4f\n", static_cast<unsigned long long>(now), event.voiceId,
+                         gestureTypeName(event.type), event.strength, event.extra);
+        }
+    }
+
+    void logOnsetEvent(const VoiceGestureEvent& event, uint64_t now) {
+        const char* phase = "begin";
+        if (event.phase == VoiceGesturePhase::Begin) {
+            ++onsetBegins;
+        } else if (event.phase == VoiceGesturePhase::Confirm) {
+            ++onsetConfirms;
+            onsetLeadSec += event.extra;
+            phase = "confirm";
+        } else {
+            ++onsetCancels;
+            phase = "cancel";
+        }
+        if (events) {
+            std::fprintf(events, "%llu onset %d %s %s %.4f %.4f\n", static_cast<unsigned long long>(now), event.voiceId,
+                         gestureTypeName(event.type), phase, event.strength, event.extra);
+        }
+    }
+
+    void dropVoice(int voiceId, uint64_t now) {
+        if (VoiceSlot* slot = voices.find(voiceId)) {
+            // Like ofApp::releaseVoice(): a begin still waiting gets its cancel.
+            VoiceGestureEvent cancel;
+            if (VoiceGestureDetector::cancelOnset(slot->track, voiceId, now, cancel)) {
+                logOnsetEvent(cancel, now);
+            }
+            history.release(slot->history);
+            voices.release(voiceId);
+        }
+    }
+
+    void tick(uint64_t now) {
+        ScopedProfile tickTiming(profiler, ProfileStage::DetectionTick);
+        ++ticks;
+
+        // Prune stale voices exactly like ofApp::pruneVoices().
+        {
+            ScopedProfile stageTiming(profiler, ProfileStage::Prune);
+            for (int voiceId = voices.span() - 1; voiceId >= 0; --voiceId) {
+                const VoiceSlot& slot = voices.slot(voiceId);
+                const uint64_t lastUpdate = slot.lastUpdateMicros / 1000;
+                if (slot.live && now > lastUpdate && now - lastUpdate > options.staleMs) {
+                    dropVoice(voiceId, now);
+                }
+            }
+        }
+
+        // Judge only voices with fresh samples, in id order, like
+        // ofApp::updateVoiceGestures().
+        if (!inlineDetection) {
+            ScopedProfile stageTiming(profiler, ProfileStage::VoiceGestures);
+            voices.takeDirty(dirtyVoices);
+            voiceEvents.clear();
+            for (int voiceId : dirtyVoices) {
+                VoiceSlot& slot = voices.slot(voiceId);
+                if (slot.pendingSamples > 0) {
+                    history.addSample(slot.history, slot.position, slot.pendingMotion / static_cast<float>(slot.pendingSamples),
+                                      slot.energy, slot.lastUpdateMicros);
+                    slot.pendingSamples = 0;
+                    slot.pendingMotion = 0.0f;
+                }
+                detectVoice(voiceId);
+            }
+            logVoiceEvents(now);
+        }
+        // Begins whose voice went quiet, like ofApp::expireOnsets().
+        for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+            VoiceSlot& slot = voices.slot(voiceId);
+            VoiceGestureEvent cancel;
+            if (slot.live && voiceDetector.cancelTimedOutOnset(slot.track, voiceId, now, cancel)) {
+                logOnsetEvent(cancel, now);
+            }
+        }
+
+        globalEvents.clear();
+        uint64_t start = nowNanos();
+        {
+            ScopedProfile stageTiming(profiler, ProfileStage::GlobalGestures);
+            globalDetector.update(lastGlobalMotion, static_cast<int>(voices.size()), now, globalEvents);
+        }
+        globalTimer.add(nowNanos() - start);
+        for (const auto& event : globalEvents) {
+            ++globalEventCount;
+            if (events) {
+                std::fprintf(events, "%llu global %s %.4f\n", static_cast<unsigned long long>(now), gestureTypeName(event.type), event.strength);
+            }
+        }
+
+        // Neighbours acting together, over every live voice like
+        // ofApp::updateEnsembleGestures().
+        ensembleEvents.clear();
+        start = nowNanos();
+        {
+            ScopedProfile stageTiming(profiler, ProfileStage::EnsembleGestures);
+            ensembleDetector.beginFrame();
+            for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+                const VoiceSlot& slot = voices.slot(voiceId);
+                if (slot.live) {
+                    ensembleDetector.addVoice(voiceId, slot.position, 0);
+                }
+            }
+            ensembleDetector.update(now, ensembleEvents);
+        }
+        ensembleTimer.add(nowNanos() - start);
+        for (const auto& event : ensembleEvents) {
+            ++ensembleEventCount;
+            if (events) {
+                std::fprintf(events, "%llu ensemble %s %.4f %d %.3f %.3f %.3f\n", static_cast<unsigned long long>(now), gestureTypeName(event),
+                             event.strength, event.voiceCount, event.x, event.z, event.radius);
+            }
+        }
+    }
+
+    const Options& options;
+    std::FILE* events;
+    StageProfiler* profiler = nullptr;
+
+    GestureHistory history;
+    VoiceGestureDetector voiceDetector;
+    ZoneGestureDetector zoneDetector;
+    GlobalGestureDetector globalDetector;
+    EnsembleGestureDetector ensembleDetector;
+
+    VoiceSlotTable voices;
+    std::vector<int> dirtyVoices;
+    bool inlineDetection = false;
+    float lastGlobalMotion = 0.0f;
+
+    std::vector<VoiceGestureEvent> voiceEvents;
+    std::vector<ZoneGestureEvent> zoneEvents;
+    std::vector<GlobalGestureEvent> globalEvents;
+    std::vector<EnsembleGestureEvent> ensembleEvents;
+
+    CallTimer voiceTimer;
+    CallTimer zoneTimer;
+    CallTimer globalTimer;
+    CallTimer ensembleTimer;
+    uint64_t voiceSamples = 0, zoneSamples = 0, globalSamples = 0;
+    uint64_t voiceEventCount = 0, zoneEventCount = 0, globalEventCount = 0, ensembleEventCount = 0;
+    uint64_t onsetBegins = 0, onsetConfirms = 0, onsetCancels = 0;
+    double onsetLeadSec = 0.0;
+    uint64_t ticks = 0, ticksAtWarm = 0, lastTick = 0, warmupEnd = 0;
+    bool warm = false;
+    uint64_t allocationsAtStart = 0, allocationsAtWarm = 0, allocationsAtEnd = 0;
+    uint64_t wallNs = 0, virtualMs = 0;
+    uint64_t restartMs = 0, restartTick = 0, restoredOnsets = 0;
+    bool restartMidOnset = false; ///< wait for a tick with a begin in the air.
+    std::string snapshotPath;
+    uint64_t snapshotBytes = 0, restoredVoices = 0, saveNs = 0, loadNs = 0;
+    bool restoreOk = false;
+};
+
+/// Event lines stamped after `t`, in order.
+std::vector<std::string> eventsAfter(std::FILE* file, uint64_t t) {
+    std::vector<std::string> lines;
+    std::rewind(file);
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strtoull(line, nullptr, 10) > t) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+/**
+ * Walk the onset lines in `file` as a listener would: a confirm or cancel
+ * with no begin before it is stray; begins still open at the end are counted
+ * in `open`.
+ */
+std::size_t strayOnsetResolutions(std::FILE* file, std::size_t& open) {
+    std::rewind(file);
+    std::vector<std::string> begun;
+    std::size_t stray = 0;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        int voiceId = 0;
+        char type[32] = {};
+        char phase[16] = {};
+        if (std::sscanf(line, "%*s onset %d %31s %15s", &voiceId, type, phase) != 3) {
+            continue;
+        }
+        const std::string key = std::to_string(voiceId) + " " + type;
+        auto found = std::find(begun.begin(), begun.end(), key);
+        if (std::strcmp(phase, "begin") == 0) {
+            if (found == begun.end()) {
+                begun.push_back(key);
+            }
+        } else if (found == begun.end()) {
+            ++stray;
+        } else {
+            begun.erase(found);
+        }
+    }
+    open = begun.size();
+    return stray;
+}
+
+void benchRuleSets(const Options& options, const Session& session) {
+    // What each preset costs per voice: smaller vocabularies skip the rules
+    // and the window statistics they leave out.
+    const VoiceGestureDetector::RuleSet presets[] = {VoiceGestureDetector::RuleSet::Full, VoiceGestureDetector::RuleSet::Directional,
+                                                     VoiceGestureDetector::RuleSet::Energy, VoiceGestureDetector::RuleSet::RaiseHold};
+    for (VoiceGestureDetector::RuleSet rules : presets) {
+        Options presetOptions = options;
+        presetOptions.rules = rules;
+        Replay replay(presetOptions, nullptr);
+        replay.run(session);
+        replay.reportRules();
+    }
+}
+
+void benchSnapshot(const Options& options, const Session& session) {
+    // The same session twice: straight through, and with a snapshot/restore
+    // halfway. A warm restart should be invisible, so every gesture after
+    // the restart should come out the same in both.
+    if (session.records.empty()) {
+        return;
+    }
+    std::FILE* straightEvents = std::tmpfile();
+    std::FILE* restartedEvents = std::tmpfile();
+    if (!straightEvents || !restartedEvents) {
+        return;
+    }
+    const uint64_t first = session.records.front().t;
+    const uint64_t middle = first + (session.records.back().t - first) / 2;
+    Replay straight(options, straightEvents);
+    straight.run(session);
+    Replay restarted(options, restartedEvents);
+    restarted.restartAt(middle, "gesture_bench.crowdsnap");
+    restarted.run(session);
+
+    const std::vector<std::string> expected = eventsAfter(straightEvents, restarted.getRestartTick());
+    const std::vector<std::string> actual = eventsAfter(restartedEvents, restarted.getRestartTick());
+    std::size_t matching = 0;
+    for (std::size_t i = 0; i < std::min(expected.size(), actual.size()); ++i) {
+        matching += expected[i] == actual[i] ? 1 : 0;
+    }
+    restarted.reportRestart(matching, std::max(expected.size(), actual.size()));
+    std::fclose(straightEvents);
+    std::fclose(restartedEvents);
+
+    // Again with predictive onsets, restarting on a tick with a begin in the
+    // air: every begin must still end in exactly one confirm or cancel.
+    Options predictiveOptions = options;
+    predictiveOptions.predictive = true;
+    std::FILE* straightOnsets = std::tmpfile();
+    std::FILE* restartedOnsets = std::tmpfile();
+    if (!straightOnsets || !restartedOnsets) {
+        return;
+    }
+    Replay straightPredictive(predictiveOptions, straightOnsets);
+    straightPredictive.run(session);
+    Replay midOnset(predictiveOptions, restartedOnsets);
+    midOnset.restartAt(middle, "gesture_bench.crowdsnap", true);
+    midOnset.run(session);
+    std::size_t openStraight = 0;
+    std::size_t openRestarted = 0;
+    strayOnsetResolutions(straightOnsets, openStraight);
+    const std::size_t stray = strayOnsetResolutions(restartedOnsets, openRestarted);
+    std::printf("snapshot     mid-onset restart at %llu ms: %llu begin(s) cancelled, %llu stray resolution(s), "
+                "%llu open at the end (%llu without the restart)\n",
+                static_cast<unsigned long long>(midOnset.getRestartTick()), static_cast<unsigned long long>(midOnset.getRestoredOnsets()),
+                static_cast<unsigned long long>(stray), static_cast<unsigned long long>(openRestarted),
+                static_cast<unsigned long long>(openStraight));
+    std::fclose(straightOnsets);
+    std::fclose(restartedOnsets);
+}
+
+void benchProfile(const Options& options, const Session& session) {
+    // The same replay with and without stage zones: the difference is what
+    // profile_enabled costs, spread over the zones it recorded. With --trace
+    // the profiled run is also captured, as the 't' key would.
+    Replay plain(options, nullptr);
+    plain.run(session);
+    StageProfiler profiler;
+    StageProfiler::nameThisThread("replay");
+    const bool tracing = !options.tracePath.empty() && profiler.startTrace(options.tracePath, 24 * 3600 * 1000);
+    Replay profiled(options, nullptr);
+    profiled.profileWith(&profiler);
+    profiled.run(session);
+    profiler.stopTrace();
+
+    std::array<ProfileSummary, kProfileStageCount> stages;
+    profiler.drain(stages);
+    const uint64_t tickNanos = stages[static_cast<std::size_t>(ProfileStage::DetectionTick)].totalNanos;
+    uint64_t zones = 0;
+    for (const ProfileSummary& stage : stages) {
+        zones += stage.calls;
+        if (stage.calls > 0 && &stage != &stages[static_cast<std::size_t>(ProfileStage::DetectionTick)]) {
+            std::printf("stage %-22s %9llu calls %8.0f ns avg, %5.1f%% of ticks\n", stage.name, static_cast<unsigned long long>(stage.calls),
+                        static_cast<double>(stage.totalNanos) / static_cast<double>(stage.calls),
+                        tickNanos ? 100.0 * static_cast<double>(stage.totalNanos) / static_cast<double>(tickNanos) : 0.0);
+        }
+    }
+    const double extraNs = static_cast<double>(profiled.getWallNs()) - static_cast<double>(plain.getWallNs());
+    std::printf("profile      %llu zones, ~%.0f ns each%s%s%s\n", static_cast<unsigned long long>(zones),
+                zones ? std::max(0.0, extraNs) / static_cast<double>(zones) : 0.0, tracing ? ", traced into " : "",
+                tracing ? options.tracePath.c_str() : "", tracing && profiler.getTraceDropped() ? " (buffer full, some dropped)" : "");
+}
+
+void printUsage() {
+    std::printf(
+        "usage: gesture_bench [options]\n"
+        "  --capture FILE        replay a text capture or .crowdlog (default: synthetic crowd)\n"
+        "  --write-capture FILE  save the session as a text capture and keep going\n"
+        "  --write-log FILE      save the session as a binary .crowdlog and keep going\n"
+        "  --events FILE         write every emitted gesture, one per line, for diffing\n"
+        "  --trace FILE          write a Chrome trace of the profiled replay (chrome://tracing, ui.perfetto.dev)\n"
+        "  --voices N            synthetic voices (default 40)\n"
+        "  --cameras N           synthetic cameras (default 3)\n"
+        "  --grid COLSxROWS      synthetic camera grid (default 4x4)\n"
+        "  --seconds N           synthetic session length (default 60)\n"
+        "  --seed N              synthetic random seed (default 1)\n"
+        "  --tick-ms N           virtual frame length (default 16)\n"
+        "  --history N           per-voice history frames (default 60)\n"
+        "  --coalesce            fold each voice's samples into one row per frame\n"
+        "  --predictive          turn on predictive onsets (begin/confirm/cancel) for the voice rules\n"
+        "  --rules NAME          voice rule preset: full, directional, energy or raise_hold (default full)\n"
+        "  --global-history MS   crowd-wide detector history (default 5000)\n"
+        "  --frame WxH           webcam frame for the motion-grid timings (default 1920x1080, 0x0 skips)\n"
+        "  --log                 let detector ofLog output through to stderr\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--log") {
+            bench::logEnabled = true;
+        } else if (arg == "--coalesce") {
+            options.coalesce = true;
+        } else if (arg == "--predictive") {
+            options.predictive = true;
+        } else if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (!hasValue) {
+            std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        } else if (arg == "--capture") {
+            options.capturePath = argv[++i];
+        } else if (arg == "--write-capture") {
+            options.writeCapturePath = argv[++i];
+        } else if (arg == "--write-log") {
+            options.writeLogPath = argv[++i];
+        } else if (arg == "--rules") {
+            if (!VoiceGestureDetector::parseRuleSet(argv[++i], options.rules)) {
+                std::fprintf(stderr, "unknown rule preset %s\n", argv[i]);
+                return false;
+            }
+        } else if (arg == "--events") {
+            options.eventsPath = argv[++i];
+        } else if (arg == "--trace") {
+            options.tracePath = argv[++i];
+        } else if (arg == "--voices") {
+            options.voices = std::atoi(argv[++i]);
+        } else if (arg == "--cameras") {
+            options.cameras = std::atoi(argv[++i]);
+        } else if (arg == "--grid") {
+            if (std::sscanf(argv[++i], "%dx%d", &options.cols, &options.rows) != 2) {
+                std::fprintf(stderr, "--grid wants COLSxROWS, e.g. 16x9\n");
+                return false;
+            }
+        } else if (arg == "--frame") {
+            if (std::sscanf(argv[++i], "%dx%d", &options.frameWidth, &options.frameHeight) != 2) {
+                std::fprintf(stderr, "--frame wants WIDTHxHEIGHT, e.g. 1280x720\n");
+                return false;
+            }
+        } else if (arg == "--seconds") {
+            options.seconds = std::atoi(argv[++i]);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--tick-ms") {
+            options.tickMs = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--global-history") {
+            options.globalHistoryMs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--history") {
+            options.historyFrames = std::max<std::size_t>(2, std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (options.cols < 1 || options.rows < 1 || options.cols > kMaxZoneLanes || options.rows > kMaxZoneLanes
+        || options.cols * options.rows > kMaxZoneCells) {
+        std::fprintf(stderr, "grid must be at most %d per side and %d cells\n", kMaxZoneLanes, kMaxZoneCells);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    Session session;
+    if (!options.capturePath.empty()) {
+        if (!loadCapture(options.capturePath, session)) {
+            return 1;
+        }
+    } else {
+        generateSession(options, session);
+        std::printf("synthetic crowd: %d voices, %d cameras at %dx%d, %d s, seed %u\n", options.voices, options.cameras,
+                    options.cols, options.rows, options.seconds, options.seed);
+    }
+    if (!options.writeCapturePath.empty() && !writeCapture(options.writeCapturePath, session)) {
+        return 1;
+    }
+    if (!options.writeLogPath.empty() && !writeSessionLog(options.writeLogPath, session, options.tickMs)) {
+        return 1;
+    }
+
+    std::FILE* events = nullptr;
+    if (!options.eventsPath.empty()) {
+        events = std::fopen(options.eventsPath.c_str(), "w");
+        if (!events) {
+            std::fprintf(stderr, "could not write events %s\n", options.eventsPath.c_str());
+            return 1;
+        }
+    }
+
+    Replay replay(options, events);
+    replay.run(session);
+    replay.report();
+    benchDecode(session);
+    benchSourceClock();
+    benchFrameDiff(options);
+    benchRuleSets(options, session);
+    benchSnapshot(options, session);
+    benchProfile(options, session);
+
+    if (events) {
+        std::fclose(events);
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Headless stand-in for ofLog. Detector logging is off by default so console
+// I/O doesn't swamp the timings; the bench's --log flag flips it on and the
+// messages go to stderr, one line per statement like the real thing.
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace bench {
+extern bool logEnabled;
+} // namespace bench
+
+class ofLogStreamCompat {
+public:
+    ofLogStreamCompat(const char* level, const std::string& module) {
+        if (bench::logEnabled) {
+            line.reset(new std::ostringstream());
+            *line << "[" << level << "] " << (module.empty() ? "" : module + ": ");
+        }
+    }
+    ~ofLogStreamCompat() {
+        if (line) {
+            std::cerr << line->str() << std::endl;
+        }
+    }
+
+    template <typename T>
+    ofLogStreamCompat& operator<<(const T& value) {
+        if (line) {
+            *line << value;
+        }
+        return *this;
+    }
+
+private:
+    std::unique_ptr<std::ostringstream> line;
+};
+
+struct ofLogNotice : ofLogStreamCompat {
+    explicit ofLogNotice(const std::string& module = "") : ofLogStreamCompat("notice", module) {}
+};
+
+struct ofLogWarning : ofLogStreamCompat {
+    explicit ofLogWarning(const std::string& module = "") : ofLogStreamCompat("warning", module) {}
+};
+
+struct ofLogError : ofLogStreamCompat {
+    explicit ofLogError(const std::string& module = "") : ofLogStreamCompat("error", module) {}
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Headless stand-in for openFrameworks' umbrella header, used only by the
+// detector benchmark. The detectors need nothing from OF beyond glm vectors,
+// ofClamp and the ofLog streams, so that is all we provide – no window, GL
+// or GLFW gets linked. glm itself comes straight from OF's libs/glm.
+
+#include <glm/glm.hpp>
+
+#include "ofLog.h"
+
+// The real ofMain.h drags in most of the standard library; a few headers
+// lean on that, so pull in the usual suspects too.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+inline float ofClamp(float value, float min, float max) {
+    return value < min ? min : (value > max ? max : value);
+}
@@ -0,0 +1,165 @@
+#include "AsyncLogger.h"
+
+#include "ofLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+constexpr std::size_t AsyncLogger::kLineBytes;
+
+namespace {
+// How long a line may sit in the ring before the writer picks it up.
+constexpr std::chrono::milliseconds kWriterInterval{10};
+} // namespace
+
+AsyncLogger& AsyncLogger::shared() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+void AsyncLogger::start(std::size_t capacity) {
+    stop();
+    std::size_t rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    cells.reset(new Cell[rounded]);
+    mask = rounded - 1;
+    for (std::size_t i = 0; i < rounded; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+    dropped.store(0);
+    reportedDropped = 0;
+    stopping = false;
+    running.store(true, std::memory_order_release);
+    thread = std::thread([this]() { run(); });
+}
+
+void AsyncLogger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    // The ring stays allocated: a producer that saw us running a moment ago
+    // may still be finishing its line.
+}
+
+bool AsyncLogger::push(const char* module, const char* text, std::size_t length) {
+    if (!running.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+        cell = &cells[pos & mask];
+        const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (turn == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (turn < 0) {
+            // Full: the writer is behind. Losing a log line beats stalling detection.
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->module = module;
+    cell->length = std::min(length, kLineBytes - 1);
+    std::memcpy(cell->text, text, cell->length);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogger::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
+        drain();
+        lock.lock();
+        wake.wait_for(lock, kWriterInterval, [this]() { return stopping; });
+    }
+    lock.unlock();
+    drain();
+}
+
+void AsyncLogger::drain() {
+    for (;;) {
+        Cell& cell = cells[dequeuePos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            break;
+        }
+        ofLogNotice(cell.module) << std::string(cell.text, cell.length);
+        cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        ++dequeuePos;
+    }
+    const uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+    if (droppedNow != reportedDropped) {
+        ofLogWarning("AsyncLogger") << (droppedNow - reportedDropped) << " log line(s) dropped, the console could not keep up";
+        reportedDropped = droppedNow;
+    }
+}
+
+AsyncLogNotice::~AsyncLogNotice() {
+    if (!AsyncLogger::shared().push(module, text, length)) {
+        ofLogNotice(module) << std::string(text, length);
+    }
+}
+
+AsyncLogNotice& AsyncLogNotice::operator<<(const char* value) {
+    append(value, std::strlen(value));
+    return *this;
+}
+
+AsyncLogNotice& AsyncLogNotice::operator<<(const std::string& value) {
+    append(value.data(), value.size());
+    return *this;
+}
+
+AsyncLogNotice& AsyncLogNotice::operator<<(char value) {
+    append(&value, 1);
+    return *this;
+}
+
+AsyncLogNotice& AsyncLogNotice::operator<<(double value) {
+    char digits[32];
+    const int count = std::snprintf(digits, sizeof(digits), "%g", value);
+    append(digits, count > 0 ? static_cast<std::size_t>(count) : 0);
+    return *this;
+}
+
+AsyncLogNotice& AsyncLogNotice::appendSigned(long long value) {
+    char digits[24];
+    const int count = std::snprintf(digits, sizeof(digits), "%lld", value);
+    append(digits, count > 0 ? static_cast<std::size_t>(count) : 0);
+    return *this;
+}
+
+AsyncLogNotice& AsyncLogNotice::appendUnsigned(unsigned long long value) {
+    char digits[24];
+    const int count = std::snprintf(digits, sizeof(digits), "%llu", value);
+    append(digits, count > 0 ? static_cast<std::size_t>(count) : 0);
+    return *this;
+}
+
+void AsyncLogNotice::append(const char* value, std::size_t count) {
+    const std::size_t room = AsyncLogger::kLineBytes - 1 - length;
+    count = std::min(count, room);
+    std::memcpy(text + length, value, count);
+    length += count;
+}
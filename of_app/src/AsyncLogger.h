@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+/**
+ * AsyncLogger moves console logging off the detection path. Detectors
+ * format a line into a fixed buffer on the stack (AsyncLogNotice below) and
+ * drop it into a bounded ring; a writer thread wakes every few milliseconds
+ * and hands whatever piled up to ofLog. Pushing is a compare-exchange and a
+ * memcpy – no lock, no allocation, no stdout – and a full ring drops the
+ * line (counted, and reported by the writer) rather than waiting.
+ *
+ * The ring takes any number of producers, since detection workers log from
+ * their own threads. It is a Vyukov-style bounded queue: every cell carries
+ * a sequence number that says whose turn it is, so producers only contend
+ * on the enqueue counter and the single consumer never writes theirs.
+ *
+ * Until start() is called (the bench, or anything else without a host)
+ * lines go straight to ofLog as before.
+ */
+class AsyncLogger {
+public:
+    /// Longest line kept, terminator included; longer ones are cut short.
+    static constexpr std::size_t kLineBytes = 192;
+
+    /// The one logger the detectors write to.
+    static AsyncLogger& shared();
+
+    AsyncLogger() = default;
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    /// Allocate `capacity` lines (rounded up to a power of two) and start the writer thread.
+    void start(std::size_t capacity = 1024);
+    /// Write out what is queued, then join the writer.
+    void stop();
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    /**
+     * Queue a line for `module` (a string literal: only the pointer is kept).
+     * False if the logger isn't running, in which case nothing was queued.
+     */
+    bool push(const char* module, const char* text, std::size_t length);
+
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        const char* module = "";
+        std::size_t length = 0;
+        char text[kLineBytes];
+    };
+
+    void run();
+    void drain();
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask = 0;
+    std::atomic<std::size_t> enqueuePos{0};
+    std::size_t dequeuePos = 0;         // writer thread only.
+    std::atomic<uint64_t> dropped{0};
+    uint64_t reportedDropped = 0;       // writer thread only.
+
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
+/**
+ * A stand-in for ofLogNotice on the detection path: stream into it the same
+ * way, and the finished line goes to AsyncLogger::shared() when it goes out
+ * of scope. Numbers are formatted like an ostream with default settings.
+ *
+ *   AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " strength " << strength;
+ */
+class AsyncLogNotice {
+public:
+    explicit AsyncLogNotice(const char* module = "") : module(module) {}
+    ~AsyncLogNotice();
+
+    AsyncLogNotice(const AsyncLogNotice&) = delete;
+    AsyncLogNotice& operator=(const AsyncLogNotice&) = delete;
+
+    AsyncLogNotice& operator<<(const char* value);
+    AsyncLogNotice& operator<<(const std::string& value);
+    AsyncLogNotice& operator<<(char value);
+    AsyncLogNotice& operator<<(double value);
+    AsyncLogNotice& operator<<(float value) { return *this << static_cast<double>(value); }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, AsyncLogNotice&>::type operator<<(T value) {
+        return appendSigned(static_cast<long long>(value));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, AsyncLogNotice&>::type operator<<(T value) {
+        return appendUnsigned(static_cast<unsigned long long>(value));
+    }
+
+private:
+    AsyncLogNotice& appendSigned(long long value);
+    AsyncLogNotice& appendUnsigned(unsigned long long value);
+    void append(const char* value, std::size_t count);
+
+    const char* module;
+    std::size_t length = 0;
+    char text[AsyncLogger::kLineBytes];
+};
@@ -0,0 +1,79 @@
+#include "BlobVoiceTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void BlobVoiceTracker::setup(const Settings& newSettings) {
+    settings = newSettings;
+    settings.maxVoices = std::max(1, std::min(settings.maxVoices, kMaxCaptureVoices));
+    tracks.fill(Track());
+}
+
+int BlobVoiceTracker::update(const glm::vec3* positions, const float* sizes, int count, CaptureVoice* out) {
+    for (Track& track : tracks) {
+        track.seen = false;
+    }
+
+    for (int blob = 0; blob < count; ++blob) {
+        // Nearest live voice not already claimed this frame.
+        int best = -1;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (int index = 0; index < settings.maxVoices; ++index) {
+            const Track& track = tracks[index];
+            if (!track.active || track.seen) {
+                continue;
+            }
+            const glm::vec3 offset = track.position - positions[blob];
+            const float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+            if (distance <= settings.maxJump && distance < bestDistance) {
+                best = index;
+                bestDistance = distance;
+            }
+        }
+
+        float moved = 0.0f;
+        if (best < 0) {
+            // Somebody new: take the first free slot, if there is one.
+            for (int index = 0; index < settings.maxVoices && best < 0; ++index) {
+                if (!tracks[index].active) {
+                    best = index;
+                }
+            }
+            if (best < 0) {
+                continue; // full house; the smallest blobs wait their turn
+            }
+            tracks[best] = Track();
+            tracks[best].active = true;
+        } else {
+            moved = bestDistance;
+        }
+
+        Track& track = tracks[best];
+        track.seen = true;
+        track.missing = 0;
+        track.position = positions[blob];
+        track.size = sizes[blob];
+        track.motion = ofClamp(moved * settings.motionGain, 0.0f, 1.0f);
+        track.energy += settings.energySmoothing * (track.motion - track.energy);
+    }
+
+    int written = 0;
+    for (int index = 0; index < settings.maxVoices; ++index) {
+        Track& track = tracks[index];
+        if (track.active && !track.seen && ++track.missing > settings.missingFrames) {
+            track.active = false;
+        }
+        if (!track.active) {
+            continue;
+        }
+        CaptureVoice& voice = out[written++];
+        voice.voiceId = settings.voiceIdBase + index;
+        voice.position = track.position;
+        voice.size = track.size;
+        voice.motion = track.motion;
+        voice.energy = track.energy;
+        voice.seen = track.seen;
+    }
+    return written;
+}
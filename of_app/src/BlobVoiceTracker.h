@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <array>
+#include <cstdint>
+
+/// One tracked performer, already in /room/voice/state units.
+struct CaptureVoice {
+    int voiceId = -1;
+    glm::vec3 position = glm::vec3(0.0f); ///< x -1..1, y 0..1 (up), z 0..1 (near..far).
+    float size = 0.0f;
+    float motion = 0.0f;
+    float energy = 0.0f;
+    bool seen = false; ///< False while the voice is held through a short gap: no new sample.
+};
+
+/// Upper bound on voices one capture device tracks at once.
+constexpr int kMaxCaptureVoices = 32;
+
+/**
+ * BlobVoiceTracker gives blobs a memory: this frame's blob near where voice
+ * 3 was last frame *is* voice 3. Each frame the largest blob gets first pick
+ * of the nearest voice within maxJump, the next largest the nearest of what
+ * is left, and so on; a blob nobody claims starts a new voice. A voice whose
+ * blob has been missing for `missingFrames` frames is let go – a person
+ * ducking behind someone else for a moment keeps their pipe.
+ *
+ * Motion is how far the voice moved since its last frame; energy is that
+ * motion smoothed, the same "loudness" proxy the OSC trackers send.
+ */
+class BlobVoiceTracker {
+public:
+    struct Settings {
+        int voiceIdBase = 0;      ///< First voiceId handed out (keeps several Kinects apart).
+        int maxVoices = 16;       ///< Voices this tracker may hold at once (<= kMaxCaptureVoices).
+        float maxJump = 0.25f;    ///< Largest per-frame move that still counts as the same voice.
+        int missingFrames = 10;   ///< Frames a voice may go unseen before it is released.
+        float motionGain = 8.0f;  ///< Per-frame distance → 0..1 motion.
+        float energySmoothing = 0.2f; ///< EMA weight of the newest motion in energy.
+    };
+
+    void setup(const Settings& settings);
+
+    /**
+     * Match this frame's `positions`/`sizes` (largest first) to voices and
+     * write every voice still held – seen this frame or not – into `out`
+     * (room for kMaxCaptureVoices). Returns how many. A voice missing from
+     * the list that was there last time has been released.
+     */
+    int update(const glm::vec3* positions, const float* sizes, int count, CaptureVoice* out);
+
+private:
+    struct Track {
+        bool active = false;
+        bool seen = false;
+        int missing = 0;
+        glm::vec3 position = glm::vec3(0.0f);
+        float size = 0.0f;
+        float motion = 0.0f;
+        float energy = 0.0f;
+    };
+
+    Settings settings;
+    std::array<Track, kMaxCaptureVoices> tracks{};
+};
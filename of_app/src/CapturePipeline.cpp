@@ -0,0 +1,319 @@
+#include "CapturePipeline.h"
+
+#include "ofLog.h"
+
+#include "LatencyStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace {
+// Devices deliver 30–60 frames a second; checking every millisecond keeps
+// the added latency negligible without spinning a core per camera.
+constexpr auto kIdleSleep = std::chrono::milliseconds(1);
+
+template <typename T>
+void readKey(const ofJson& block, const char* key, T& value) {
+    if (block.contains(key)) {
+        value = block[key].get<T>();
+    }
+}
+} // namespace
+
+void CaptureDevice::start() {
+    stop();
+    running.store(true);
+    thread = std::thread([this]() { run(); });
+}
+
+void CaptureDevice::stop() {
+    // The thread may already have given up on its own (device failed to
+    // open), so join whenever there is one.
+    running.store(false);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void CaptureDevice::stamp(CaptureResult& result) {
+    result.arrivalMicros = monotonicMicros();
+}
+
+void CaptureDevice::run() {
+    if (!open()) {
+        ofLogError("CapturePipeline") << name << ": could not open device";
+        running.store(false);
+        return;
+    }
+    opened.store(true);
+    ofLogNotice("CapturePipeline") << name << " capturing";
+    while (running.load(std::memory_order_relaxed)) {
+        if (grab(results.writeSlot())) {
+            results.publish();
+            frames.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::this_thread::sleep_for(kIdleSleep);
+        }
+    }
+    close();
+    opened.store(false);
+}
+
+KinectCapture::KinectCapture(const Settings& newSettings)
+    : CaptureDevice("kinect " + ofToString(newSettings.deviceIndex)), settings(newSettings) {
+    finder.setup(settings.blobs);
+    tracker.setup(settings.tracker);
+}
+
+KinectCapture::~KinectCapture() {
+    stop();
+}
+
+bool KinectCapture::open() {
+    // Depth only, no textures: update() then never touches GL, so it is
+    // safe on this thread.
+    kinect.setRegistration(false);
+    kinect.init(false, false, false);
+    return kinect.open(settings.deviceIndex);
+}
+
+bool KinectCapture::grab(CaptureResult& result) {
+    kinect.update();
+    if (!kinect.isFrameNew()) {
+        return false;
+    }
+    stamp(result);
+    const ofShortPixels& depth = kinect.getRawDepthPixels();
+    const int found = finder.find(depth.getData(), static_cast<int>(depth.getWidth()), static_cast<int>(depth.getHeight()),
+                                  blobs.data(), kMaxCaptureVoices);
+
+    // Image space → /room/voice/state space: x across (-1..1), y up (0..1),
+    // z into the room between the near and far planes (0..1).
+    const float nearMm = static_cast<float>(settings.blobs.nearMm);
+    const float range = std::max(1.0f, static_cast<float>(settings.blobs.farMm) - nearMm);
+    for (int i = 0; i < found; ++i) {
+        const DepthBlob& blob = blobs[i];
+        positions[i] = glm::vec3(blob.u * 2.0f - 1.0f, 1.0f - blob.v, ofClamp((blob.depthMm - nearMm) / range, 0.0f, 1.0f));
+        sizes[i] = ofClamp(std::sqrt(blob.area), 0.0f, 1.0f);
+    }
+    result.kind = CaptureResult::Kind::Voices;
+    result.voiceCount = tracker.update(positions.data(), sizes.data(), found, result.voices.data());
+    return true;
+}
+
+void KinectCapture::close() {
+    kinect.close();
+}
+
+WebcamCapture::WebcamCapture(const Settings& newSettings)
+    : CaptureDevice("webcam " + ofToString(newSettings.deviceId)), settings(newSettings) {
+    grid.setup(settings.grid);
+}
+
+WebcamCapture::~WebcamCapture() {
+    stop();
+}
+
+bool WebcamCapture::open() {
+    grabber.setDeviceID(settings.deviceId);
+    grabber.setDesiredFrameRate(settings.fps);
+    grabber.setUseTexture(false);
+    // Gray frames skip the colour conversion and take FrameDiffGrid's vector
+    // path; backends that can't deliver gray simply keep handing us RGB.
+    grabber.setPixelFormat(OF_PIXELS_GRAY);
+    return grabber.setup(settings.width, settings.height);
+}
+
+bool WebcamCapture::grab(CaptureResult& result) {
+    grabber.update();
+    if (!grabber.isFrameNew()) {
+        return false;
+    }
+    stamp(result);
+    const ofPixels& pixels = grabber.getPixels();
+    if (!grid.process(pixels.getData(), static_cast<int>(pixels.getWidth()), static_cast<int>(pixels.getHeight()),
+                      static_cast<int>(pixels.getNumChannels()), static_cast<int>(pixels.getBytesStride()), result.zones.data())) {
+        return false; // first frame: nothing to compare against yet
+    }
+    const FrameDiffGrid::Settings& cells = grid.getSettings();
+    result.kind = CaptureResult::Kind::Zones;
+    result.camId = settings.camId;
+    result.cols = cells.cols;
+    result.rows = cells.rows;
+    return true;
+}
+
+void WebcamCapture::close() {
+    grabber.close();
+}
+
+CapturePipeline::~CapturePipeline() {
+    stop();
+}
+
+void CapturePipeline::start(const Settings& newSettings, PacketHandler onPacket) {
+    stop();
+    settings = newSettings;
+    handler = std::move(onPacket);
+    for (const auto& kinect : settings.kinects) {
+        devices.emplace_back(new KinectCapture(kinect));
+        states.emplace_back();
+    }
+    for (const auto& webcam : settings.webcams) {
+        devices.emplace_back(new WebcamCapture(webcam));
+        states.emplace_back();
+        states.back().webcam = true;
+    }
+    for (auto& device : devices) {
+        device->start();
+    }
+}
+
+void CapturePipeline::stop() {
+    // Destroying a device joins its thread, which closes the device there.
+    devices.clear();
+    states.clear();
+    globalMotion = 0.0f;
+}
+
+void CapturePipeline::drain() {
+    bool webcamUpdated = false;
+    uint64_t newestMicros = 0;
+    for (std::size_t i = 0; i < devices.size(); ++i) {
+        const CaptureResult* result = devices[i]->consume();
+        if (!result) {
+            continue;
+        }
+        if (result->kind == CaptureResult::Kind::Voices) {
+            drainVoices(*result, states[i]);
+        } else {
+            drainZones(*result, states[i]);
+            webcamUpdated = true;
+            newestMicros = std::max(newestMicros, result->arrivalMicros);
+        }
+    }
+    if (!webcamUpdated) {
+        return;
+    }
+
+    // Global motion: the webcams' latest means, averaged and smoothed.
+    float sum = 0.0f;
+    int cameras = 0;
+    for (const DeviceState& state : states) {
+        if (state.webcam && state.hasMotion) {
+            sum += state.motion;
+            ++cameras;
+        }
+    }
+    globalMotion += settings.globalSmoothing * (sum / static_cast<float>(std::max(1, cameras)) - globalMotion);
+    scratch.kind = IngestPacket::Kind::GlobalMotion;
+    scratch.timestampMicros = newestMicros;
+    scratch.arrivalMicros = newestMicros;
+    scratch.globalMotion = globalMotion;
+    handler(scratch);
+}
+
+void CapturePipeline::drainVoices(const CaptureResult& result, DeviceState& state) {
+    // Stamped the moment the frame came off the device, so the frame's own
+    // time is its arrival.
+    scratch.timestampMicros = result.arrivalMicros;
+    scratch.arrivalMicros = result.arrivalMicros;
+
+    // Anyone held last time but gone now was released by the tracker. (This
+    // also covers results that were overwritten before we saw them.)
+    scratch.kind = IngestPacket::Kind::VoiceDisconnect;
+    for (int i = 0; i < state.heldCount; ++i) {
+        const int voiceId = state.held[i];
+        bool stillHeld = false;
+        for (int j = 0; j < result.voiceCount && !stillHeld; ++j) {
+            stillHeld = result.voices[j].voiceId == voiceId;
+        }
+        if (!stillHeld) {
+            scratch.id = voiceId;
+            handler(scratch);
+        }
+    }
+
+    scratch.kind = IngestPacket::Kind::VoiceState;
+    state.heldCount = result.voiceCount;
+    for (int i = 0; i < result.voiceCount; ++i) {
+        const CaptureVoice& voice = result.voices[i];
+        state.held[i] = voice.voiceId;
+        if (!voice.seen) {
+            continue; // held through a gap: no new sample to add
+        }
+        scratch.id = voice.voiceId;
+        scratch.position = voice.position;
+        scratch.size = voice.size;
+        scratch.motion = voice.motion;
+        scratch.energy = voice.energy;
+        handler(scratch);
+    }
+}
+
+void CapturePipeline::drainZones(const CaptureResult& result, DeviceState& state) {
+    const int cells = result.rows * result.cols;
+    scratch.kind = IngestPacket::Kind::CameraZones;
+    scratch.timestampMicros = result.arrivalMicros;
+    scratch.arrivalMicros = result.arrivalMicros;
+    scratch.id = result.camId;
+    scratch.rows = result.rows;
+    scratch.cols = result.cols;
+    std::copy(result.zones.begin(), result.zones.begin() + cells, scratch.zones.begin());
+    handler(scratch);
+
+    float sum = 0.0f;
+    for (int i = 0; i < cells; ++i) {
+        sum += result.zones[i];
+    }
+    state.motion = sum / static_cast<float>(std::max(1, cells));
+    state.hasMotion = true;
+}
+
+std::string CapturePipeline::describe() const {
+    std::stringstream ss;
+    for (const auto& device : devices) {
+        ss << "capture: " << device->getName() << (device->isOpen() ? "" : " (not open)") << ", " << device->getFrameCount()
+           << " frames, skipped " << device->getSkippedCount() << std::endl;
+    }
+    return ss.str();
+}
+
+void readCaptureSettings(const ofJson& json, CapturePipeline::Settings& settings) {
+    readKey(json, "global_smoothing", settings.globalSmoothing);
+    if (json.contains("kinects")) {
+        for (const auto& entry : json["kinects"]) {
+            KinectCapture::Settings kinect;
+            readKey(entry, "device", kinect.deviceIndex);
+            readKey(entry, "near_mm", kinect.blobs.nearMm);
+            readKey(entry, "far_mm", kinect.blobs.farMm);
+            readKey(entry, "downsample", kinect.blobs.downsample);
+            readKey(entry, "min_cells", kinect.blobs.minCells);
+            readKey(entry, "voice_id_base", kinect.tracker.voiceIdBase);
+            readKey(entry, "max_voices", kinect.tracker.maxVoices);
+            readKey(entry, "max_jump", kinect.tracker.maxJump);
+            readKey(entry, "missing_frames", kinect.tracker.missingFrames);
+            readKey(entry, "motion_gain", kinect.tracker.motionGain);
+            readKey(entry, "energy_smoothing", kinect.tracker.energySmoothing);
+            settings.kinects.push_back(kinect);
+        }
+    }
+    if (json.contains("webcams")) {
+        for (const auto& entry : json["webcams"]) {
+            WebcamCapture::Settings webcam;
+            readKey(entry, "device", webcam.deviceId);
+            readKey(entry, "cam_id", webcam.camId);
+            readKey(entry, "width", webcam.width);
+            readKey(entry, "height", webcam.height);
+            readKey(entry, "fps", webcam.fps);
+            readKey(entry, "cols", webcam.grid.cols);
+            readKey(entry, "rows", webcam.grid.rows);
+            readKey(entry, "downsample", webcam.grid.downsample);
+            readKey(entry, "gain", webcam.grid.gain);
+            readKey(entry, "smoothing", webcam.grid.smoothing);
+            settings.webcams.push_back(webcam);
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofJson.h"
+#include "ofxKinect.h"
+
+#include "BlobVoiceTracker.h"
+#include "DepthBlobFinder.h"
+#include "FrameDiffGrid.h"
+#include "GestureTypes.h"
+#include "IngestPacket.h"
+#include "TripleBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// What one device made of its newest frame; only the fields matching `kind` mean anything.
+struct CaptureResult {
+    enum class Kind : uint8_t { Voices, Zones };
+    Kind kind = Kind::Voices;
+    uint64_t arrivalMicros = 0; ///< Frame arrival on monotonicMicros(), the ingest thread's clock.
+    int voiceCount = 0;         ///< Every voice the tracker still holds.
+    std::array<CaptureVoice, kMaxCaptureVoices> voices{};
+    int camId = -1;
+    int rows = 0;
+    int cols = 0;
+    std::array<float, kMaxZoneCells> zones{};
+};
+
+/**
+ * One camera or depth sensor with a thread of its own. The thread opens the
+ * device, then loops: grab a frame, boil it down to a CaptureResult right
+ * there, and publish it through a TripleBuffer. The detection thread only
+ * ever picks up the newest result – a slow frame never queues work, and the
+ * capture side never waits for detection.
+ *
+ * Every device call (open, update, close) happens on that one thread, with
+ * textures switched off, so no GL context is needed – headless hosts included.
+ */
+class CaptureDevice {
+public:
+    explicit CaptureDevice(const std::string& name) : name(name) {}
+    virtual ~CaptureDevice() = default;
+
+    CaptureDevice(const CaptureDevice&) = delete;
+    CaptureDevice& operator=(const CaptureDevice&) = delete;
+
+    void start();
+    /// Subclasses call this from their destructor, while grab() still exists.
+    void stop();
+
+    /// Detection thread only: the newest result since the last call, or null.
+    const CaptureResult* consume() { return results.consume(); }
+
+    const std::string& getName() const { return name; }
+    bool isOpen() const { return opened.load(std::memory_order_relaxed); }
+    uint64_t getFrameCount() const { return frames.load(std::memory_order_relaxed); }
+    /// Results replaced before detection picked them up.
+    uint64_t getSkippedCount() const { return results.getOverwrittenCount(); }
+
+protected:
+    virtual bool open() = 0;
+    /// Fill `result` from a new frame if there is one; false = nothing new yet.
+    virtual bool grab(CaptureResult& result) = 0;
+    virtual void close() = 0;
+
+    static void stamp(CaptureResult& result);
+
+private:
+    void run();
+
+    std::string name;
+    TripleBuffer<CaptureResult> results;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> opened{false};
+    std::atomic<uint64_t> frames{0};
+};
+
+/// A Kinect's depth stream → tracked voices.
+class KinectCapture : public CaptureDevice {
+public:
+    struct Settings {
+        int deviceIndex = 0;
+        DepthBlobFinder::Settings blobs;
+        BlobVoiceTracker::Settings tracker;
+    };
+
+    explicit KinectCapture(const Settings& settings);
+    ~KinectCapture() override;
+
+protected:
+    bool open() override;
+    bool grab(CaptureResult& result) override;
+    void close() override;
+
+private:
+    Settings settings;
+    ofxKinect kinect;
+    DepthBlobFinder finder;
+    BlobVoiceTracker tracker;
+    std::array<DepthBlob, kMaxCaptureVoices> blobs{};
+    std::array<glm::vec3, kMaxCaptureVoices> positions{};
+    std::array<float, kMaxCaptureVoices> sizes{};
+};
+
+/// A webcam → one motion grid per frame.
+class WebcamCapture : public CaptureDevice {
+public:
+    struct Settings {
+        int deviceId = 0;
+        int camId = 0;     ///< The camId its zones are reported under.
+        int width = 640;
+        int height = 480;
+        int fps = 30;
+        FrameDiffGrid::Settings grid;
+    };
+
+    explicit WebcamCapture(const Settings& settings);
+    ~WebcamCapture() override;
+
+protected:
+    bool open() override;
+    bool grab(CaptureResult& result) override;
+    void close() override;
+
+private:
+    Settings settings;
+    ofVideoGrabber grabber;
+    FrameDiffGrid grid;
+};
+
+/**
+ * CapturePipeline is the in-process replacement for a separate tracker
+ * process sending /room/voice/state and /room/camera/zones over loopback:
+ * same numbers, minus a serialize → UDP → parse hop and a frame of latency.
+ *
+ * Each configured device captures on its own thread. Whichever thread runs
+ * detection calls drain() once per tick; the newest result of every device
+ * is turned into the very IngestPackets the OSC ingest path produces
+ * (voice state, voice disconnect, camera zones and a smoothed global motion
+ * across the webcams) and handed to the same handler, so recording,
+ * latency stats and every detector see no difference.
+ */
+class CapturePipeline {
+public:
+    struct Settings {
+        std::vector<KinectCapture::Settings> kinects;
+        std::vector<WebcamCapture::Settings> webcams;
+        float globalSmoothing = 0.2f; ///< EMA weight of the newest webcam mean in global motion.
+
+        bool empty() const { return kinects.empty() && webcams.empty(); }
+    };
+
+    using PacketHandler = std::function<void(const IngestPacket&)>;
+
+    CapturePipeline() = default;
+    ~CapturePipeline();
+
+    CapturePipeline(const CapturePipeline&) = delete;
+    CapturePipeline& operator=(const CapturePipeline&) = delete;
+
+    void start(const Settings& settings, PacketHandler onPacket);
+    void stop();
+    bool isActive() const { return !devices.empty(); }
+
+    /// Detection thread only: hand every device's newest result to the handler.
+    void drain();
+
+    /// One line per device for the HUD.
+    std::string describe() const;
+
+private:
+    /// What drain() remembers per device between results.
+    struct DeviceState {
+        bool webcam = false;
+        int heldCount = 0;
+        std::array<int, kMaxCaptureVoices> held{}; // voice ids in the last result.
+        float motion = 0.0f;                       // webcam: mean of the last grid.
+        bool hasMotion = false;
+    };
+
+    void drainVoices(const CaptureResult& result, DeviceState& state);
+    void drainZones(const CaptureResult& result, DeviceState& state);
+
+    Settings settings;
+    PacketHandler handler;
+    std::vector<std::unique_ptr<CaptureDevice>> devices;
+    std::vector<DeviceState> states;
+    IngestPacket scratch;
+    float globalMotion = 0.0f;
+};
+
+/**
+ * Read a `capture` settings block (`kinects` and `webcams` lists plus
+ * `global_smoothing`) onto `settings`; missing keys keep their defaults.
+ */
+void readCaptureSettings(const ofJson& json, CapturePipeline::Settings& settings);
@@ -0,0 +1,470 @@
+#include "ClusterNode.h"
+
+#include "ofLog.h"
+
+#include "LatencyStats.h"
+#include "VoiceSlotTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+constexpr std::size_t ClusterMessage::kMaxVoicesPerMessage;
+constexpr std::size_t ClusterMessage::kMaxHandoffRows;
+
+namespace {
+// Large enough for either full-size message kind with room to spare.
+constexpr std::size_t kBufferBytes = 1536;
+// Ownership notes are repeated this often, so a lost one is healed quickly.
+constexpr uint64_t kAnnounceIntervalMicros = 1000000;
+
+template <typename T>
+void readKey(const ofJson& block, const char* key, T& value) {
+    if (block.contains(key)) {
+        value = block[key].get<T>();
+    }
+}
+} // namespace
+
+ClusterNode::~ClusterNode() {
+    stop();
+}
+
+bool ClusterNode::start(const Settings& newSettings, int maxVoices, std::size_t queueCapacity) {
+    stop();
+    settings = newSettings;
+    settings.handoffRows = std::max(1, std::min(settings.handoffRows, static_cast<int>(ClusterMessage::kMaxHandoffRows)));
+    if (!settings.isActive()) {
+        return false;
+    }
+    map.setup(settings.shards, settings.handoffMargin, maxVoices);
+    // Tables grow past max_voices for stray ids, but never past the id ceiling.
+    voiceLimit = std::max(maxVoices, VoiceSlotTable::kMaxVoices);
+
+    int listenPort = settings.aggregatorPort;
+    if (settings.role == Role::Edge) {
+        const int own = map.indexOf(settings.shard);
+        if (own < 0) {
+            ofLogError("ClusterNode") << "shard " << settings.shard << " is not in the cluster's shard list";
+            return false;
+        }
+        listenPort = settings.shards[own].port;
+    }
+
+    peers.clear();
+    peers.resize(settings.shards.size());
+    try {
+        for (std::size_t i = 0; i < settings.shards.size(); ++i) {
+            const ShardMap::Shard& shard = settings.shards[i];
+            peers[i].shard = shard.shard;
+            // Edges talk to each other (handoffs, ownership); the aggregator
+            // only listens.
+            if (settings.role == Role::Edge && shard.shard != settings.shard) {
+                peers[i].socket.reset(new UdpTransmitSocket(IpEndpointName(shard.host.c_str(), shard.port)));
+            }
+        }
+        if (settings.role == Role::Edge) {
+            aggregator.reset(new UdpTransmitSocket(IpEndpointName(settings.aggregatorHost.c_str(), settings.aggregatorPort)));
+        }
+        socket.reset(new UdpReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, listenPort)));
+    } catch (const std::exception& e) {
+        ofLogError("ClusterNode") << "could not open the cluster sockets (port " << listenPort << "): " << e.what();
+        peers.clear();
+        aggregator.reset();
+        socket.reset();
+        return false;
+    }
+
+    buffer.assign(kBufferBytes, 0);
+    stream.reset(new osc::OutboundPacketStream(buffer.data(), buffer.size()));
+    queue.reset(queueCapacity);
+    ignored.store(0);
+    dropped.store(0);
+    nextSummaryMicros = 0;
+    nextAnnounceMicros = 0;
+    lastSummaryArrival = 0;
+
+    multiplexer.reset(new SocketReceiveMultiplexer());
+    multiplexer->AttachSocketListener(socket.get(), this);
+    running.store(true);
+    thread = std::thread([this]() {
+        // As on the ingest thread, nothing a peer sends may end the loop.
+        while (running.load()) {
+            try {
+                multiplexer->Run();
+            } catch (const std::exception& e) {
+                ofLogWarning("ClusterNode") << "receive loop: " << e.what();
+            }
+        }
+    });
+
+    ofLogNotice("ClusterNode") << (settings.role == Role::Edge ? "edge shard " + ofToString(settings.shard) : std::string("aggregator"))
+                               << " of " << settings.shards.size() << ", listening on port " << listenPort;
+    return true;
+}
+
+void ClusterNode::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    multiplexer->AsynchronousBreak();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    multiplexer->DetachSocketListener(socket.get(), this);
+    multiplexer.reset();
+    socket.reset();
+    aggregator.reset();
+    peers.clear();
+}
+
+bool ClusterNode::ownsCamera(int camId) const {
+    if (!isEdge()) {
+        return true;
+    }
+    const int owner = map.cameraOwner(camId);
+    return owner < 0 || owner == settings.shard;
+}
+
+void ClusterNode::poll(const MessageHandler& onMessage) {
+    while (const ClusterMessage* message = queue.front()) {
+        apply(*message);
+        if (message->kind == ClusterMessage::Kind::Gesture || message->kind == ClusterMessage::Kind::Handoff) {
+            onMessage(*message);
+        }
+        queue.popFront();
+    }
+}
+
+void ClusterNode::apply(const ClusterMessage& message) {
+    const int index = map.indexOf(message.shard);
+    Peer& peer = peers[index]; // parseMessage() only lets known shards through.
+    peer.lastMicros = message.arrivalMicros;
+
+    switch (message.kind) {
+    case ClusterMessage::Kind::Summary:
+        peer.activeVoices = message.activeVoices;
+        peer.motion = message.motion;
+        peer.hasMotion = message.hasMotion;
+        lastSummaryArrival = message.arrivalMicros;
+        break;
+    case ClusterMessage::Kind::Voices: {
+        // A list arrives in order, chunk by chunk; the first chunk starts it
+        // over. A lost chunk just leaves this shard short until the next one.
+        const std::size_t end = static_cast<std::size_t>(message.offset + message.count);
+        if (message.offset == 0) {
+            peer.voiceCount = 0;
+            if (peer.voices.size() < static_cast<std::size_t>(message.total)) {
+                peer.voices.resize(message.total);
+            }
+        }
+        if (static_cast<std::size_t>(message.offset) != peer.voiceCount) {
+            break;
+        }
+        if (peer.voices.size() < end) {
+            peer.voices.resize(end);
+        }
+        std::copy(message.voices.begin(), message.voices.begin() + message.count, peer.voices.begin() + message.offset);
+        peer.voiceCount = end;
+        peer.voicesArrival = message.arrivalMicros;
+        break;
+    }
+    case ClusterMessage::Kind::Handoff:
+        // Whoever a voice is handed to owns it from now on.
+        map.setOwner(message.voiceId, settings.shard);
+        break;
+    case ClusterMessage::Kind::Owner:
+        map.setOwner(message.voiceId, message.owner);
+        break;
+    case ClusterMessage::Kind::Gesture:
+        break;
+    }
+}
+
+bool ClusterNode::isFresh(const Peer& peer, uint64_t nowMicros) const {
+    return peer.lastMicros > 0 && nowMicros < peer.lastMicros + static_cast<uint64_t>(settings.shardTimeoutMs) * 1000;
+}
+
+bool ClusterNode::summaryDue(uint64_t nowMicros) const {
+    return isEdge() && nowMicros >= nextSummaryMicros;
+}
+
+void ClusterNode::sendSummary(uint64_t nowMicros, int activeVoices, float motion, bool hasMotion, const ClusterVoice* voices,
+                              std::size_t voiceCount) {
+    nextSummaryMicros = nowMicros + static_cast<uint64_t>(1e6f / std::max(1.0f, settings.summaryHz));
+
+    beginMessage("/cluster/summary", nowMicros);
+    *stream << static_cast<osc::int32>(activeVoices) << motion << static_cast<osc::int32>(hasMotion ? 1 : 0) << osc::EndMessage;
+    sendTo(aggregator.get());
+
+    // Always at least one (possibly empty) list, so an edge whose last voice
+    // left clears its share of the room.
+    std::size_t offset = 0;
+    do {
+        const std::size_t count = std::min(voiceCount - offset, ClusterMessage::kMaxVoicesPerMessage);
+        beginMessage("/cluster/voices", nowMicros);
+        *stream << static_cast<osc::int32>(voiceCount) << static_cast<osc::int32>(offset);
+        for (std::size_t i = offset; i < offset + count; ++i) {
+            *stream << static_cast<osc::int32>(voices[i].id) << voices[i].x << voices[i].z;
+        }
+        *stream << osc::EndMessage;
+        sendTo(aggregator.get());
+        offset += count;
+    } while (offset < voiceCount);
+}
+
+void ClusterNode::sendGesture(const VoiceGestureEvent& event, uint64_t sampleMicros) {
+    beginMessage("/cluster/gesture", sampleMicros);
+    *stream << static_cast<osc::int32>(event.voiceId) << static_cast<osc::int32>(event.type) << event.strength << event.extra
+            << osc::EndMessage;
+    sendTo(aggregator.get());
+}
+
+void ClusterNode::sendHandoff(int toShard, int voiceId, const GestureHistory::View& history, const int32_t* sinceTriggerMs) {
+    const int index = map.indexOf(toShard);
+    if (index < 0 || !peers[index].socket) {
+        return;
+    }
+    map.setOwner(voiceId, toShard);
+
+    // The newest rows, aged against the newest one: the receiver lays them
+    // back down on its own clock without ever comparing ours to theirs.
+    const std::size_t rowCount = std::min(history.size(), static_cast<std::size_t>(settings.handoffRows));
+    const std::size_t first = history.size() - rowCount;
+    const uint64_t* times = history.timestampsMicros();
+    const uint64_t newest = rowCount > 0 ? times[history.size() - 1] : monotonicMicros();
+
+    beginMessage("/cluster/handoff", newest);
+    *stream << static_cast<osc::int32>(voiceId);
+    for (std::size_t i = 0; i < kVoiceGestureTypeCount; ++i) {
+        *stream << static_cast<osc::int32>(sinceTriggerMs[i]);
+    }
+    *stream << static_cast<osc::int32>(rowCount);
+    for (std::size_t i = first; i < history.size(); ++i) {
+        *stream << static_cast<osc::int32>(newest - times[i]) << history.x()[i] << history.y()[i] << history.z()[i]
+                << history.motion()[i] << history.energy()[i];
+    }
+    *stream << osc::EndMessage;
+    sendTo(peers[index].socket.get());
+
+    sendOwner(voiceId, toShard);
+}
+
+void ClusterNode::announceOwnership(uint64_t nowMicros) {
+    if (!isEdge() || nowMicros < nextAnnounceMicros) {
+        return;
+    }
+    nextAnnounceMicros = nowMicros + kAnnounceIntervalMicros;
+    for (int voiceId = 0; voiceId < map.capacity(); ++voiceId) {
+        if (map.isOverridden(voiceId) && map.ownerOf(voiceId) == settings.shard) {
+            sendOwner(voiceId, settings.shard);
+        }
+    }
+}
+
+void ClusterNode::sendOwner(int voiceId, int owner) {
+    beginMessage("/cluster/owner", monotonicMicros());
+    *stream << static_cast<osc::int32>(voiceId) << static_cast<osc::int32>(owner) << osc::EndMessage;
+    for (const Peer& peer : peers) {
+        sendTo(peer.socket.get());
+    }
+    sendTo(aggregator.get());
+}
+
+int ClusterNode::getActiveVoices(uint64_t nowMicros) const {
+    int total = 0;
+    for (const Peer& peer : peers) {
+        if (isFresh(peer, nowMicros)) {
+            total += peer.activeVoices;
+        }
+    }
+    return total;
+}
+
+bool ClusterNode::getMotion(uint64_t nowMicros, float& motion) const {
+    float sum = 0.0f;
+    int shards = 0;
+    for (const Peer& peer : peers) {
+        if (isFresh(peer, nowMicros) && peer.hasMotion) {
+            sum += peer.motion;
+            ++shards;
+        }
+    }
+    if (shards == 0) {
+        return false;
+    }
+    motion = sum / static_cast<float>(shards);
+    return true;
+}
+
+void ClusterNode::beginMessage(const char* address, uint64_t stampMicros) {
+    stream->Clear();
+    *stream << osc::BeginMessage(address) << static_cast<osc::int32>(settings.shard) << static_cast<osc::int64>(stampMicros);
+}
+
+void ClusterNode::sendTo(UdpTransmitSocket* target) {
+    if (!target) {
+        return;
+    }
+    try {
+        target->Send(stream->Data(), stream->Size());
+    } catch (const std::exception& e) {
+        // A peer that is down must not take detection with it.
+        ofLogVerbose("ClusterNode") << "send failed: " << e.what();
+    }
+}
+
+void ClusterNode::ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) {
+    try {
+        osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+    } catch (const osc::Exception&) {
+        // oscpack throws on a malformed datagram before ProcessMessage() runs.
+        ignored.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ClusterNode::ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName&) {
+    ClusterMessage* slot = queue.prepare();
+    if (!slot) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    try {
+        if (!parseMessage(message, *slot)) {
+            ignored.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } catch (const osc::Exception&) {
+        // Wrong types or too few arguments: somebody else's packet, or a bug.
+        ignored.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    queue.commit();
+}
+
+bool ClusterNode::parseMessage(const osc::ReceivedMessage& message, ClusterMessage& out) {
+    const char* address = message.AddressPattern();
+    auto arg = message.ArgumentsBegin();
+    if (std::strncmp(address, "/cluster/", 9) != 0 || message.ArgumentCount() < 2) {
+        return false;
+    }
+    out.shard = (arg++)->AsInt32();
+    const int index = map.indexOf(out.shard);
+    if (index < 0 || out.shard == settings.shard) {
+        return false;
+    }
+    const int64_t sentMicros = (arg++)->AsInt64();
+    out.arrivalMicros = monotonicMicros();
+    out.timestampMicros = peers[index].clock.map(sentMicros, out.arrivalMicros);
+    const char* kind = address + 9;
+
+    if (std::strcmp(kind, "summary") == 0) {
+        out.kind = ClusterMessage::Kind::Summary;
+        out.activeVoices = (arg++)->AsInt32();
+        out.motion = (arg++)->AsFloat();
+        out.hasMotion = (arg++)->AsInt32() != 0;
+        return true;
+    }
+    if (std::strcmp(kind, "voices") == 0) {
+        out.kind = ClusterMessage::Kind::Voices;
+        out.total = (arg++)->AsInt32();
+        out.offset = (arg++)->AsInt32();
+        const uint32_t entries = (message.ArgumentCount() - 4) / 3;
+        if (out.total < 0 || out.total > voiceLimit || out.offset < 0 || entries > ClusterMessage::kMaxVoicesPerMessage
+            || out.offset + static_cast<int>(entries) > out.total) {
+            return false;
+        }
+        out.count = static_cast<int>(entries);
+        for (uint32_t i = 0; i < entries; ++i) {
+            ClusterVoice& voice = out.voices[i];
+            voice.id = (arg++)->AsInt32();
+            voice.x = (arg++)->AsFloat();
+            voice.z = (arg++)->AsFloat();
+        }
+        return true;
+    }
+    if (std::strcmp(kind, "gesture") == 0) {
+        out.kind = ClusterMessage::Kind::Gesture;
+        out.gesture = VoiceGestureEvent();
+        out.gesture.voiceId = (arg++)->AsInt32();
+        const int type = (arg++)->AsInt32();
+        if (type < 0 || type >= static_cast<int>(kVoiceGestureTypeCount)) {
+            return false;
+        }
+        out.gesture.type = static_cast<VoiceGestureType>(type);
+        out.gesture.strength = (arg++)->AsFloat();
+        out.gesture.extra = (arg++)->AsFloat();
+        out.gesture.sourceMicros = out.arrivalMicros;
+        return true;
+    }
+    if (std::strcmp(kind, "handoff") == 0) {
+        out.kind = ClusterMessage::Kind::Handoff;
+        out.voiceId = (arg++)->AsInt32();
+        for (std::size_t i = 0; i < kVoiceGestureTypeCount; ++i) {
+            out.sinceTriggerMs[i] = (arg++)->AsInt32();
+        }
+        out.rowCount = (arg++)->AsInt32();
+        if (out.rowCount < 0 || out.rowCount > static_cast<int>(ClusterMessage::kMaxHandoffRows)) {
+            return false;
+        }
+        for (int i = 0; i < out.rowCount; ++i) {
+            ClusterHistoryRow& row = out.rows[i];
+            row.ageMicros = (arg++)->AsInt32();
+            row.x = (arg++)->AsFloat();
+            row.y = (arg++)->AsFloat();
+            row.z = (arg++)->AsFloat();
+            row.motion = (arg++)->AsFloat();
+            row.energy = (arg++)->AsFloat();
+        }
+        return true;
+    }
+    if (std::strcmp(kind, "owner") == 0) {
+        out.kind = ClusterMessage::Kind::Owner;
+        out.voiceId = (arg++)->AsInt32();
+        out.owner = (arg++)->AsInt32();
+        return true;
+    }
+    return false;
+}
+
+void readClusterSettings(const ofJson& json, ClusterNode::Settings& settings) {
+    if (json.contains("role")) {
+        const std::string role = json["role"].get<std::string>();
+        if (role == "edge") {
+            settings.role = ClusterNode::Role::Edge;
+        } else if (role == "aggregator") {
+            settings.role = ClusterNode::Role::Aggregator;
+        } else if (role == "standalone") {
+            settings.role = ClusterNode::Role::Standalone;
+        } else {
+            ofLogWarning("ClusterNode") << "unknown cluster role \"" << role << "\", staying standalone";
+        }
+    }
+    readKey(json, "shard", settings.shard);
+    readKey(json, "aggregator_host", settings.aggregatorHost);
+    readKey(json, "aggregator_port", settings.aggregatorPort);
+    readKey(json, "summary_hz", settings.summaryHz);
+    readKey(json, "handoff_rows", settings.handoffRows);
+    readKey(json, "handoff_margin", settings.handoffMargin);
+    readKey(json, "shard_timeout_ms", settings.shardTimeoutMs);
+    if (json.contains("shards")) {
+        for (const auto& entry : json["shards"]) {
+            ShardMap::Shard shard;
+            shard.shard = static_cast<int>(settings.shards.size());
+            readKey(entry, "shard", shard.shard);
+            readKey(entry, "host", shard.host);
+            readKey(entry, "port", shard.port);
+            readKey(entry, "cameras", shard.cameras);
+            if (entry.contains("voice_ids")) {
+                // [first, last], inclusive.
+                shard.firstVoiceId = entry["voice_ids"].at(0).get<int>();
+                shard.lastVoiceId = entry["voice_ids"].at(1).get<int>();
+            }
+            if (entry.contains("region_x")) {
+                shard.minX = entry["region_x"].at(0).get<float>();
+                shard.maxX = entry["region_x"].at(1).get<float>();
+            }
+            settings.shards.push_back(shard);
+        }
+    }
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofJson.h"
+
+#include "OscOutboundPacketStream.h"
+#include "OscPacketListener.h"
+#include "UdpSocket.h"
+
+#include "GestureEvents.h"
+#include "GestureHistory.h"
+#include "ShardMap.h"
+#include "SourceClock.h"
+#include "SpscQueue.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// One voice as the aggregator sees it: who, and where on the floor.
+struct ClusterVoice {
+    int id = -1;
+    float x = 0.0f;
+    float z = 0.0f;
+};
+
+/// One history row in a handoff, aged relative to the newest row.
+struct ClusterHistoryRow {
+    int32_t ageMicros = 0;
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float motion = 0.0f;
+    float energy = 0.0f;
+};
+
+/**
+ * A decoded /cluster/... message. Fixed size, like IngestPacket, so the ring
+ * between the cluster socket and the detection thread never allocates; only
+ * the fields of its kind are meaningful.
+ */
+struct ClusterMessage {
+    /// Voices per /cluster/voices message; keeps a datagram under a 1472 byte MTU.
+    static constexpr std::size_t kMaxVoicesPerMessage = 80;
+    /// History rows per /cluster/handoff; same reason.
+    static constexpr std::size_t kMaxHandoffRows = 40;
+
+    enum class Kind { Summary, Voices, Gesture, Handoff, Owner };
+
+    Kind kind = Kind::Summary;
+    int shard = -1;                ///< Who sent it.
+    uint64_t timestampMicros = 0;  ///< The sender's stamp carried onto our monotonicMicros() timeline.
+    uint64_t arrivalMicros = 0;
+
+    // Summary
+    int activeVoices = 0;
+    float motion = 0.0f;
+    bool hasMotion = false;        ///< The sender heard global motion lately.
+
+    // Voices: entry `offset` onward of the sender's `total` live voices.
+    int total = 0;
+    int offset = 0;
+    int count = 0;
+    std::array<ClusterVoice, kMaxVoicesPerMessage> voices{};
+
+    // Gesture
+    VoiceGestureEvent gesture;
+
+    // Handoff / Owner
+    int voiceId = -1;
+    int owner = -1;
+    std::array<int32_t, kVoiceGestureTypeCount> sinceTriggerMs{};
+    int rowCount = 0;
+    std::array<ClusterHistoryRow, kMaxHandoffRows> rows{};
+};
+
+/**
+ * ClusterNode lets one room run on several hosts. Each *edge* hears every
+ * tracker but judges only the voices and cameras its shard owns (see
+ * ShardMap), so the per-voice and per-zone rules – the expensive part –
+ * split across machines. A single *aggregator* runs what needs the whole
+ * room: the global crowd rules and the ensemble rules that look for
+ * neighbours acting together, even when those neighbours live on different
+ * edges. Standalone (the default) is the old single-host setup and touches
+ * none of this.
+ *
+ * Edges stream compact partials to the aggregator a few dozen times a
+ * second – a summary (voice count, global motion) and the floor position of
+ * every voice they own – plus each gesture they fire, which ensemble sync
+ * needs. When a performer walks out of an edge's floor band the edge hands
+ * the voice over: the newest stretch of its history and its cooldowns go to
+ * the shard it walked into, and an ownership note goes to everybody so every
+ * edge and the aggregator agree on who has it.
+ *
+ * Like OscIngestThread, the cluster socket has its own receive thread that
+ * decodes straight into a fixed-size ring; poll() drains it on whichever
+ * thread runs detection. Sends happen inline on that same thread. Every
+ * sender's clock is mapped onto ours with a SourceClock, so rows and
+ * gestures keep their real timing across machines.
+ */
+class ClusterNode : private osc::OscPacketListener {
+public:
+    enum class Role { Standalone, Edge, Aggregator };
+
+    struct Settings {
+        Role role = Role::Standalone;
+        int shard = 0;                          ///< This edge's shard id.
+        std::string aggregatorHost = "127.0.0.1";
+        int aggregatorPort = 9100;              ///< The aggregator listens here; edges on their shard's port.
+        float summaryHz = 30.0f;                ///< How often an edge streams its partials.
+        int handoffRows = 30;                   ///< Newest history rows sent with a voice (max kMaxHandoffRows).
+        float handoffMargin = 0.05f;            ///< How far past its band a voice must go before it moves.
+        int shardTimeoutMs = 1000;              ///< An edge silent this long drops out of the aggregate.
+        std::vector<ShardMap::Shard> shards;
+
+        bool isActive() const { return role != Role::Standalone; }
+    };
+
+    using MessageHandler = std::function<void(const ClusterMessage&)>;
+
+    ClusterNode() = default;
+    ~ClusterNode();
+
+    ClusterNode(const ClusterNode&) = delete;
+    ClusterNode& operator=(const ClusterNode&) = delete;
+
+    /// Bind the cluster port and open a socket to each peer. False if that fails.
+    bool start(const Settings& settings, int maxVoices, std::size_t queueCapacity = 256);
+    void stop();
+
+    bool isEdge() const { return running.load() && settings.role == Role::Edge; }
+    bool isAggregator() const { return running.load() && settings.role == Role::Aggregator; }
+    const Settings& getSettings() const { return settings; }
+    const ShardMap& getMap() const { return map; }
+
+    /// Is this voice ours to judge? Always true on a standalone host.
+    bool ownsVoice(int voiceId) const { return !isEdge() || map.ownerOf(voiceId) == settings.shard; }
+    /// Cameras nobody lists are judged everywhere.
+    bool ownsCamera(int camId) const;
+    /// The tracker said goodbye (every node hears it): the voice goes home.
+    void voiceLeft(int voiceId) { map.clearOwner(voiceId); }
+    /// Edge: the shard a voice we own standing at `x` should move to, or our own.
+    int handoffTarget(float x) const { return map.regionOwner(settings.shard, x); }
+
+    /**
+     * Drain decoded messages. Summaries, voice lists and ownership notes are
+     * folded into the node's own state; gestures and handoffs are passed to
+     * `onMessage` for the host to act on. Detection thread only.
+     */
+    void poll(const MessageHandler& onMessage);
+
+    // Edge → aggregator. All sends are detection-thread only.
+    bool summaryDue(uint64_t nowMicros) const;
+    void sendSummary(uint64_t nowMicros, int activeVoices, float motion, bool hasMotion, const ClusterVoice* voices,
+                     std::size_t voiceCount);
+    /// Forward a gesture whose newest sample was taken at `sampleMicros`.
+    void sendGesture(const VoiceGestureEvent& event, uint64_t sampleMicros);
+    /**
+     * Move a voice to `toShard`: its newest history rows and cooldowns go to
+     * that edge, and everybody hears who owns it now.
+     */
+    void sendHandoff(int toShard, int voiceId, const GestureHistory::View& history, const int32_t* sinceTriggerMs);
+    /// Repeat ownership notes for voices handed to us, in case one was lost.
+    void announceOwnership(uint64_t nowMicros);
+
+    // Aggregator view of the room, counting only shards heard from lately.
+    int getActiveVoices(uint64_t nowMicros) const;
+    /// Mean global motion over the shards that have some; false if none do.
+    bool getMotion(uint64_t nowMicros, float& motion) const;
+    /// Arrival of the newest summary, for latency stamps.
+    uint64_t getLastSummaryArrival() const { return lastSummaryArrival; }
+    /// Every voice in the room once, as listed by the shard that owns it.
+    template <typename Fn>
+    void forEachVoice(uint64_t nowMicros, Fn&& fn) const {
+        for (std::size_t i = 0; i < peers.size(); ++i) {
+            const Peer& peer = peers[i];
+            if (!isFresh(peer, nowMicros)) {
+                continue;
+            }
+            for (std::size_t v = 0; v < peer.voiceCount; ++v) {
+                const ClusterVoice& voice = peer.voices[v];
+                if (map.ownerOf(voice.id) == peer.shard) {
+                    fn(voice, peer.voicesArrival);
+                }
+            }
+        }
+    }
+
+    uint64_t getIgnoredCount() const { return ignored.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    /// What we know about (and how we reach) one shard.
+    struct Peer {
+        int shard = -1;
+        std::unique_ptr<UdpTransmitSocket> socket; // null for ourselves.
+        SourceClock clock;                         // receive thread only.
+        // Aggregator state, detection thread only.
+        uint64_t lastMicros = 0;
+        int activeVoices = 0;
+        float motion = 0.0f;
+        bool hasMotion = false;
+        std::vector<ClusterVoice> voices; // grown, never shrunk.
+        std::size_t voiceCount = 0;
+        uint64_t voicesArrival = 0;
+    };
+
+    void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override;
+    void ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) override;
+    bool parseMessage(const osc::ReceivedMessage& message, ClusterMessage& out);
+    void apply(const ClusterMessage& message);
+    bool isFresh(const Peer& peer, uint64_t nowMicros) const;
+
+    void beginMessage(const char* address, uint64_t stampMicros);
+    void sendTo(UdpTransmitSocket* socket);
+    void sendOwner(int voiceId, int owner);
+
+    Settings settings;
+    int voiceLimit = 0; ///< Most live voices a shard can report: a longer list is not ours.
+    ShardMap map;
+    std::vector<Peer> peers; // same order as settings.shards.
+    std::unique_ptr<UdpTransmitSocket> aggregator;
+
+    SpscQueue<ClusterMessage> queue{2}; // sized in start(); messages are ~2 KB each.
+    std::unique_ptr<UdpReceiveSocket> socket;
+    std::unique_ptr<SocketReceiveMultiplexer> multiplexer;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> ignored{0};
+    std::atomic<uint64_t> dropped{0};
+
+    std::vector<char> buffer;
+    std::unique_ptr<osc::OutboundPacketStream> stream;
+    uint64_t nextSummaryMicros = 0;
+    uint64_t nextAnnounceMicros = 0;
+    uint64_t lastSummaryArrival = 0;
+};
+
+/// Parse the "cluster" block of gesture_settings.json.
+void readClusterSettings(const ofJson& json, ClusterNode::Settings& settings);
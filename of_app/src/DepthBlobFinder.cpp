@@ -0,0 +1,110 @@
+#include "DepthBlobFinder.h"
+
+#include <algorithm>
+
+void DepthBlobFinder::setup(const Settings& newSettings) {
+    settings = newSettings;
+    settings.downsample = std::max(1, settings.downsample);
+    settings.minCells = std::max(1, settings.minCells);
+    cols = 0;
+    rows = 0;
+}
+
+int DepthBlobFinder::find(const uint16_t* depth, int width, int height, DepthBlob* out, int capacity) {
+    const int step = settings.downsample;
+    const int newCols = width / step;
+    const int newRows = height / step;
+    if (newCols <= 0 || newRows <= 0 || capacity <= 0) {
+        return 0;
+    }
+    if (newCols != cols || newRows != rows) {
+        cols = newCols;
+        rows = newRows;
+        mask.assign(static_cast<std::size_t>(cols * rows), 0);
+        cellDepth.assign(mask.size(), 0.0f);
+        stack.reserve(mask.size());
+        found.reserve(mask.size() / static_cast<std::size_t>(settings.minCells) + 1);
+    }
+
+    // Pass 1: threshold each block into one cell. Majority vote rather than
+    // a single sample keeps the edges of a person from flickering.
+    const int needed = (step * step + 1) / 2;
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            int inRange = 0;
+            uint32_t sum = 0;
+            for (int y = row * step; y < (row + 1) * step; ++y) {
+                const uint16_t* line = depth + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+                for (int x = col * step; x < (col + 1) * step; ++x) {
+                    const uint16_t mm = line[x];
+                    if (mm >= settings.nearMm && mm <= settings.farMm) {
+                        ++inRange;
+                        sum += mm;
+                    }
+                }
+            }
+            const std::size_t cell = static_cast<std::size_t>(row * cols + col);
+            mask[cell] = inRange >= needed ? 1 : 0;
+            cellDepth[cell] = inRange > 0 ? static_cast<float>(sum) / static_cast<float>(inRange) : 0.0f;
+        }
+    }
+
+    // Pass 2: flood-fill 4-connected foreground cells into blobs.
+    found.clear();
+    const float cellCount = static_cast<float>(cols * rows);
+    for (std::size_t seed = 0; seed < mask.size(); ++seed) {
+        if (!mask[seed]) {
+            continue;
+        }
+        mask[seed] = 0;
+        stack.clear();
+        stack.push_back(static_cast<uint32_t>(seed));
+        int cells = 0;
+        float sumCol = 0.0f;
+        float sumRow = 0.0f;
+        float sumDepth = 0.0f;
+        while (!stack.empty()) {
+            const uint32_t cell = stack.back();
+            stack.pop_back();
+            const int col = static_cast<int>(cell) % cols;
+            const int row = static_cast<int>(cell) / cols;
+            ++cells;
+            sumCol += static_cast<float>(col);
+            sumRow += static_cast<float>(row);
+            sumDepth += cellDepth[cell];
+            const uint32_t stride = static_cast<uint32_t>(cols);
+            if (col > 0 && mask[cell - 1]) {
+                mask[cell - 1] = 0;
+                stack.push_back(cell - 1);
+            }
+            if (col + 1 < cols && mask[cell + 1]) {
+                mask[cell + 1] = 0;
+                stack.push_back(cell + 1);
+            }
+            if (row > 0 && mask[cell - stride]) {
+                mask[cell - stride] = 0;
+                stack.push_back(cell - stride);
+            }
+            if (row + 1 < rows && mask[cell + stride]) {
+                mask[cell + stride] = 0;
+                stack.push_back(cell + stride);
+            }
+        }
+        if (cells < settings.minCells) {
+            continue;
+        }
+        DepthBlob blob;
+        const float n = static_cast<float>(cells);
+        // +0.5: a cell's centre, not its corner.
+        blob.u = (sumCol / n + 0.5f) / static_cast<float>(cols);
+        blob.v = (sumRow / n + 0.5f) / static_cast<float>(rows);
+        blob.depthMm = sumDepth / n;
+        blob.area = n / cellCount;
+        found.push_back(blob);
+    }
+
+    std::sort(found.begin(), found.end(), [](const DepthBlob& a, const DepthBlob& b) { return a.area > b.area; });
+    const int count = std::min(capacity, static_cast<int>(found.size()));
+    std::copy(found.begin(), found.begin() + count, out);
+    return count;
+}
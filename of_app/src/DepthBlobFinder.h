@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// One foreground blob in a depth frame, in normalized image coordinates.
+struct DepthBlob {
+    float u = 0.0f;       ///< Centroid, 0 (left) .. 1 (right).
+    float v = 0.0f;       ///< Centroid, 0 (top) .. 1 (bottom).
+    float depthMm = 0.0f; ///< Mean depth of the blob's cells.
+    float area = 0.0f;    ///< Fraction of the frame the blob covers, 0..1.
+};
+
+/**
+ * DepthBlobFinder turns a raw depth frame into a short list of people. It is
+ * the "downsample, threshold, find blobs" step from docs/ARCHITECTURE.md,
+ * written as two tight passes over reused buffers instead of a round trip
+ * through OpenCV images:
+ *
+ *  1. every `downsample`×`downsample` block of depth pixels becomes one cell,
+ *     foreground when at least half its pixels sit between nearMm and farMm;
+ *  2. a flood fill over the cell mask gathers 4-connected cells into blobs,
+ *     keeping their centroid, mean depth and area.
+ *
+ * A 640×480 Kinect frame at the default downsample of 4 is a 160×120 mask,
+ * so the contour pass is tiny; nothing allocates once the first frame has
+ * sized the buffers.
+ */
+class DepthBlobFinder {
+public:
+    struct Settings {
+        int downsample = 4;      ///< Depth pixels per cell side.
+        uint16_t nearMm = 500;   ///< Closer than this is the ceiling rig / noise.
+        uint16_t farMm = 4000;   ///< Further than this is the back wall.
+        int minCells = 12;       ///< Smaller blobs are hands poking in or sensor speckle.
+    };
+
+    void setup(const Settings& settings);
+    const Settings& getSettings() const { return settings; }
+
+    /**
+     * Find blobs in `depth` (millimetres, row-major, 0 = no reading) and write
+     * up to `capacity` of them, largest first, into `out`. Returns how many.
+     */
+    int find(const uint16_t* depth, int width, int height, DepthBlob* out, int capacity);
+
+private:
+    Settings settings;
+    int cols = 0;
+    int rows = 0;
+    std::vector<uint8_t> mask;         // 1 = foreground, cleared as the fill claims it.
+    std::vector<float> cellDepth;      // mean in-range depth per cell.
+    std::vector<uint32_t> stack;       // flood-fill frontier.
+    std::vector<DepthBlob> found;      // every blob this frame, before sorting.
+};
@@ -0,0 +1,100 @@
+#include "DetectionWorkerPool.h"
+
+#include "StageProfiler.h"
+
+#include <algorithm>
+
+DetectionWorkerPool::~DetectionWorkerPool() {
+    stop();
+}
+
+void DetectionWorkerPool::start(std::size_t requested) {
+    stop();
+    if (requested == 0) {
+        requested = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    workerCount = requested;
+    stopping = false;
+    // generation carries on from an earlier start(); helpers begin level with
+    // it, here rather than on their own thread, so the first parallelFor
+    // cannot slip past one that hasn't run yet.
+    const uint64_t current = generation;
+    for (std::size_t worker = 1; worker < workerCount; ++worker) {
+        helpers.emplace_back([this, worker, current]() { run(worker, current); });
+    }
+}
+
+void DetectionWorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+    helpers.clear();
+    workerCount = 1;
+}
+
+void DetectionWorkerPool::parallelFor(std::size_t itemCount, const Job& job) {
+    if (helpers.empty() || itemCount < 2) {
+        job(0, 0, itemCount);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentJob = &job;
+        currentItems = itemCount;
+        outstanding = helpers.size();
+        ++generation;
+    }
+    workReady.notify_all();
+
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    chunk(0, begin, end);
+    job(0, begin, end);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this]() { return outstanding == 0; });
+    currentJob = nullptr;
+}
+
+void DetectionWorkerPool::run(std::size_t worker, uint64_t seen) {
+    StageProfiler::nameThisThread("detection worker");
+    for (;;) {
+        const Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            job = currentJob;
+        }
+
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        chunk(worker, begin, end);
+        if (begin < end) {
+            (*job)(worker, begin, end);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --outstanding;
+        }
+        workDone.notify_one();
+    }
+}
+
+void DetectionWorkerPool::chunk(std::size_t worker, std::size_t& begin, std::size_t& end) const {
+    // Spread the remainder over the first chunks so sizes differ by at most one.
+    const std::size_t base = currentItems / workerCount;
+    const std::size_t extra = currentItems % workerCount;
+    begin = worker * base + std::min(worker, extra);
+    end = begin + base + (worker < extra ? 1 : 0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A small fixed pool of helper threads for splitting per-frame detection
+ * work. parallelFor() cuts a range into one contiguous chunk per worker –
+ * chunk 0 runs on the calling thread, the rest on the helpers – and returns
+ * once every chunk is done. Because chunk k always belongs to worker k,
+ * callers can keep one output buffer per worker and stitch them back together
+ * in worker order to get a deterministic result.
+ *
+ * With one worker there are no helper threads and parallelFor() just calls
+ * the job inline, so the serial path costs nothing extra.
+ */
+class DetectionWorkerPool {
+public:
+    /// job(worker, begin, end) handles items [begin, end).
+    using Job = std::function<void(std::size_t worker, std::size_t begin, std::size_t end)>;
+
+    DetectionWorkerPool() = default;
+    ~DetectionWorkerPool();
+
+    DetectionWorkerPool(const DetectionWorkerPool&) = delete;
+    DetectionWorkerPool& operator=(const DetectionWorkerPool&) = delete;
+
+    /// 0 picks one worker per hardware thread.
+    void start(std::size_t workerCount);
+    void stop();
+
+    std::size_t getWorkerCount() const { return workerCount; }
+
+    void parallelFor(std::size_t itemCount, const Job& job);
+
+private:
+    /// `seen` is the generation already handled when the helper was spawned.
+    void run(std::size_t worker, uint64_t seen);
+    void chunk(std::size_t worker, std::size_t& begin, std::size_t& end) const;
+
+    std::size_t workerCount = 1;
+    std::vector<std::thread> helpers;
+
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    const Job* currentJob = nullptr;
+    std::size_t currentItems = 0;
+    uint64_t generation = 0;     // bumped per parallelFor so helpers see new work.
+    std::size_t outstanding = 0; // helpers still busy with this generation.
+    bool stopping = false;
+};
@@ -0,0 +1,224 @@
+#include "DetectorConfig.h"
+
+#include "ofLog.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+
+namespace {
+template <typename T>
+void readKey(const ofJson& block, const char* key, T& value) {
+    if (block.contains(key)) {
+        value = block[key].get<T>();
+    }
+}
+
+/// Modification time in nanoseconds where the platform has it, so two saves within a second still register.
+bool statFile(const std::string& path, int64_t& modified, int64_t& size) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+#if defined(__APPLE__)
+    modified = static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    modified = static_cast<int64_t>(info.st_mtime) * 1000000000;
+#else
+    modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    size = static_cast<int64_t>(info.st_size);
+    return true;
+}
+} // namespace
+
+void readDetectorConfigs(const ofJson& json, DetectorConfigs& configs) {
+    if (json.contains("log_gestures")) {
+        const bool logGestures = json["log_gestures"].get<bool>();
+        configs.voice.logGestures = logGestures;
+        configs.zone.logGestures = logGestures;
+        configs.global.logGestures = logGestures;
+        configs.ensemble.logGestures = logGestures;
+    }
+    if (json.contains("voice_detector")) {
+        const ofJson& block = json["voice_detector"];
+        VoiceGestureDetector::Config& voice = configs.voice;
+        if (block.contains("rules")) {
+            const std::string rules = block["rules"].get<std::string>();
+            if (!VoiceGestureDetector::parseRuleSet(rules, voice.rules)) {
+                ofLogWarning("DetectorConfig") << "unknown voice rule set \"" << rules << "\", keeping "
+                                               << VoiceGestureDetector::ruleSetName(voice.rules);
+            }
+        }
+        readKey(block, "raise_delta_y", voice.raiseDeltaY);
+        readKey(block, "lower_delta_y", voice.lowerDeltaY);
+        readKey(block, "swipe_delta_x", voice.swipeDeltaX);
+        readKey(block, "swipe_orthogonality", voice.swipeOrthogonality);
+        readKey(block, "raise_horizontal_limit", voice.raiseHorizontalLimit);
+        readKey(block, "swipe_vertical_limit", voice.swipeVerticalLimit);
+        readKey(block, "shake_radius", voice.shakeRadius);
+        readKey(block, "shake_min_sign_flips", voice.shakeMinSignFlips);
+        readKey(block, "shake_min_motion", voice.shakeMinMotion);
+        readKey(block, "burst_speed_threshold", voice.burstSpeedThreshold);
+        readKey(block, "burst_max_speed", voice.burstMaxSpeed);
+        readKey(block, "hold_motion_threshold", voice.holdMotionThreshold);
+        readKey(block, "hold_duration_ms", voice.holdDurationMs);
+        readKey(block, "min_window_ms", voice.minWindowMs);
+        readKey(block, "max_window_ms", voice.maxWindowMs);
+        readKey(block, "gesture_cooldown_ms", voice.gestureCooldownMs);
+        readKey(block, "burst_cooldown_ms", voice.burstCooldownMs);
+        readKey(block, "hold_cooldown_ms", voice.holdCooldownMs);
+        readKey(block, "predictive_onset", voice.predictiveOnset);
+        readKey(block, "onset_min_speed", voice.onsetMinSpeed);
+        readKey(block, "onset_confidence", voice.onsetConfidence);
+        readKey(block, "onset_min_progress", voice.onsetMinProgress);
+        readKey(block, "onset_lookback_ms", voice.onsetLookbackMs);
+        readKey(block, "onset_horizon_ms", voice.onsetHorizonMs);
+        readKey(block, "onset_timeout_ms", voice.onsetTimeoutMs);
+    }
+    if (json.contains("zone_detector")) {
+        const ofJson& block = json["zone_detector"];
+        ZoneGestureDetector::Config& zone = configs.zone;
+        readKey(block, "history_ms", zone.historyMs);
+        readKey(block, "sweep_window_ms", zone.sweepWindowMs);
+        readKey(block, "sweep_min_steps", zone.sweepMinSteps);
+        readKey(block, "sweep_min_strength", zone.sweepMinStrength);
+        readKey(block, "sweep_min_travel", zone.sweepMinTravel);
+        readKey(block, "sweep_cooldown_ms", zone.sweepCooldownMs);
+        readKey(block, "pulse_threshold", zone.pulseThreshold);
+        readKey(block, "pulse_slope_threshold", zone.pulseSlopeThreshold);
+        readKey(block, "pulse_cooldown_ms", zone.pulseCooldownMs);
+    }
+    if (json.contains("global_detector")) {
+        const ofJson& block = json["global_detector"];
+        GlobalGestureDetector::Config& global = configs.global;
+        readKey(block, "history_ms", global.historyMs);
+        readKey(block, "eruption_low", global.eruptionLow);
+        readKey(block, "eruption_high", global.eruptionHigh);
+        readKey(block, "eruption_cooldown_ms", global.eruptionCooldownMs);
+        readKey(block, "eruption_window_ms", global.eruptionWindowMs);
+        readKey(block, "stillness_motion_threshold", global.stillnessMotionThreshold);
+        readKey(block, "stillness_duration_ms", global.stillnessDurationMs);
+        readKey(block, "stillness_min_voices", global.stillnessMinVoices);
+        readKey(block, "stillness_cooldown_ms", global.stillnessCooldownMs);
+    }
+    if (json.contains("ensemble_detector")) {
+        const ofJson& block = json["ensemble_detector"];
+        EnsembleGestureDetector::Config& ensemble = configs.ensemble;
+        readKey(block, "enabled", ensemble.enabled);
+        readKey(block, "neighbor_radius", ensemble.neighborRadius);
+        readKey(block, "sync_window_ms", ensemble.syncWindowMs);
+        readKey(block, "sync_min_voices", ensemble.syncMinVoices);
+        readKey(block, "sync_cooldown_ms", ensemble.syncCooldownMs);
+        readKey(block, "cluster_min_voices", ensemble.clusterMinVoices);
+        readKey(block, "cluster_cooldown_ms", ensemble.clusterCooldownMs);
+        readKey(block, "ring_min_voices", ensemble.ringMinVoices);
+        readKey(block, "ring_tolerance", ensemble.ringTolerance);
+        readKey(block, "ring_cooldown_ms", ensemble.ringCooldownMs);
+    }
+}
+
+DetectorConfigWatcher::~DetectorConfigWatcher() {
+    stop();
+}
+
+void DetectorConfigWatcher::start(const std::string& settingsPath, const DetectorConfigs& initial, int intervalMs) {
+    stop();
+    path = settingsPath;
+    pollMs = std::max(50, intervalMs);
+    if (!statFile(path, fileModified, fileSize)) {
+        fileModified = 0;
+        fileSize = -1;
+    }
+    publish(initial);
+    // The detectors already run with `initial`; nothing new to hand over.
+    seenVersion = current.load(std::memory_order_relaxed)->version;
+    readerVersion.store(seenVersion, std::memory_order_relaxed);
+
+    running = true;
+    thread = std::thread([this]() { run(); });
+}
+
+void DetectorConfigWatcher::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool DetectorConfigWatcher::poll(DetectorConfigs& out) {
+    const Snapshot* snapshot = current.load(std::memory_order_acquire);
+    if (!snapshot || snapshot->version == seenVersion) {
+        return false;
+    }
+    out = snapshot->configs;
+    seenVersion = snapshot->version;
+    // Done with it: anything older may now be freed by the watcher.
+    readerVersion.store(seenVersion, std::memory_order_release);
+    return true;
+}
+
+void DetectorConfigWatcher::run() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(pollMs), [this]() { return !running; });
+        }
+        if (running) {
+            reloadIfChanged();
+        }
+    }
+}
+
+void DetectorConfigWatcher::reloadIfChanged() {
+    int64_t modified = 0;
+    int64_t size = 0;
+    if (!statFile(path, modified, size) || (modified == fileModified && size == fileSize)) {
+        return;
+    }
+    fileModified = modified;
+    fileSize = size;
+
+    // Start from the defaults so deleting a key puts it back, exactly like a
+    // fresh launch would read the file.
+    DetectorConfigs configs;
+    try {
+        std::ifstream in(path);
+        const ofJson json = ofJson::parse(in);
+        readDetectorConfigs(json, configs);
+    } catch (const std::exception& e) {
+        // Most often an editor caught mid-save; the next save triggers another try.
+        ofLogWarning("DetectorConfigWatcher") << "keeping current thresholds, could not read " << path << ": " << e.what();
+        return;
+    }
+    publish(configs);
+    reloads.fetch_add(1, std::memory_order_relaxed);
+    ofLogNotice("DetectorConfigWatcher") << "detector thresholds reloaded from " << path;
+}
+
+void DetectorConfigWatcher::publish(const DetectorConfigs& configs) {
+    std::unique_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->configs = configs;
+    snapshot->version = nextVersion++;
+    current.store(snapshot.get(), std::memory_order_release);
+    snapshots.push_back(std::move(snapshot));
+
+    // Free what the detection thread can no longer be reading: everything
+    // older than the newest version it has copied, minus the live one.
+    const uint64_t safeBelow = readerVersion.load(std::memory_order_acquire);
+    const Snapshot* live = current.load(std::memory_order_relaxed);
+    snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(),
+                                   [safeBelow, live](const std::unique_ptr<Snapshot>& old) {
+                                       return old.get() != live && old->version < safeBelow;
+                                   }),
+                    snapshots.end());
+}
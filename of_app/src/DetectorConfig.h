@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ofJson.h"
+
+#include "EnsembleGestureDetector.h"
+#include "GlobalGestureDetector.h"
+#include "VoiceGestureDetector.h"
+#include "ZoneGestureDetector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Every detector threshold the host knows about, as one snapshot.
+struct DetectorConfigs {
+    VoiceGestureDetector::Config voice;
+    ZoneGestureDetector::Config zone;
+    GlobalGestureDetector::Config global;
+    EnsembleGestureDetector::Config ensemble;
+};
+
+/**
+ * Copy whatever the `voice_detector`, `zone_detector`, `global_detector` and
+ * `ensemble_detector` blocks (plus the shared `log_gestures` switch) of a
+ * settings json spell out onto `configs`; missing keys keep their current
+ * value. Throws
+ * (nlohmann's type_error) on a wrongly typed value.
+ */
+void readDetectorConfigs(const ofJson& json, DetectorConfigs& configs);
+
+/**
+ * Lets you retune detector thresholds mid-soundcheck without a restart (and
+ * without losing every voice history and cooldown). A background thread
+ * checks gesture_settings.json every few hundred milliseconds; when the file
+ * changes it parses the detector blocks there, builds a fresh snapshot and
+ * publishes it by swapping an atomic pointer.
+ *
+ * Whichever thread runs detection calls poll() once per tick. When nothing
+ * changed that is a single atomic load – no lock, no JSON. Old snapshots are
+ * only freed once the detection thread has reported it moved past them, so a
+ * reload can never pull a config out from under it.
+ */
+class DetectorConfigWatcher {
+public:
+    DetectorConfigWatcher() = default;
+    ~DetectorConfigWatcher();
+
+    DetectorConfigWatcher(const DetectorConfigWatcher&) = delete;
+    DetectorConfigWatcher& operator=(const DetectorConfigWatcher&) = delete;
+
+    /// Publish `initial` and watch the settings file at `path` (absolute) every `pollMs`.
+    void start(const std::string& path, const DetectorConfigs& initial, int pollMs);
+    void stop();
+
+    /**
+     * Detection thread only. If a newer snapshot was published since the last
+     * call, copy it into `out` and return true.
+     */
+    bool poll(DetectorConfigs& out);
+
+    uint64_t getReloadCount() const { return reloads.load(std::memory_order_relaxed); }
+
+private:
+    struct Snapshot {
+        DetectorConfigs configs;
+        uint64_t version = 0;
+    };
+
+    void run();
+    void reloadIfChanged();
+    void publish(const DetectorConfigs& configs);
+
+    std::string path;
+    int pollMs = 500;
+
+    std::atomic<Snapshot*> current{nullptr};
+    std::atomic<uint64_t> readerVersion{0}; // newest version the detection thread has copied.
+    uint64_t seenVersion = 0;               // detection thread only.
+
+    // Watcher thread only (and start/stop): every snapshot still alive.
+    std::vector<std::unique_ptr<Snapshot>> snapshots;
+    uint64_t nextVersion = 1;
+    int64_t fileModified = 0;
+    int64_t fileSize = -1;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> reloads{0};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+};
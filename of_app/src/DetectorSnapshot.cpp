@@ -0,0 +1,345 @@
+#include "DetectorSnapshot.h"
+
+#include "LatencyStats.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// Section tags, so a reader that gets lost fails loudly instead of loading
+// one detector's bytes into another.
+constexpr uint32_t kSectionVoices = 0x53434F56;   // "VOCS"
+constexpr uint32_t kSectionZones = 0x534E4F5A;    // "ZONS"
+constexpr uint32_t kSectionGlobal = 0x424F4C47;   // "GLOB"
+constexpr uint32_t kSectionEnsemble = 0x4D534E45; // "ENSM"
+
+/// One live voice, ahead of its history rows.
+struct VoiceRecord {
+    int32_t id = -1;
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float size = 0.0f;
+    float motion = 0.0f;
+    float energy = 0.0f;
+    uint32_t rowCount = 0;
+    uint64_t lastUpdateMicros = 0;
+    uint64_t arrivalMicros = 0;
+    uint64_t lastTrigger[kVoiceGestureTypeCount] = {};
+    uint64_t onsetBeganMs = 0;
+    uint8_t onsetPending = 0;
+    uint8_t onsetType = 0;
+    uint8_t reserved[6] = {};
+};
+
+uint64_t unixMicros() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+uint64_t checksumOf(const char* data, std::size_t size) {
+    uint64_t hash = 1469598103934665603ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void saveVoices(const VoiceSlotTable& voices, const GestureHistory& history, SnapshotBuffer& out) {
+    out.put(static_cast<uint32_t>(voices.size()));
+    for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+        const VoiceSlot& slot = voices.slot(voiceId);
+        if (!slot.live) {
+            continue;
+        }
+        const GestureHistory::View rows = history.getHistory(slot.history);
+        VoiceRecord record;
+        record.id = voiceId;
+        record.x = slot.position.x;
+        record.y = slot.position.y;
+        record.z = slot.position.z;
+        record.size = slot.size;
+        record.motion = slot.motion;
+        record.energy = slot.energy;
+        record.rowCount = static_cast<uint32_t>(rows.size());
+        record.lastUpdateMicros = slot.lastUpdateMicros;
+        record.arrivalMicros = slot.arrivalMicros;
+        std::memcpy(record.lastTrigger, slot.track.lastTrigger.data(), sizeof(record.lastTrigger));
+        record.onsetPending = slot.track.onset.pending ? 1 : 0;
+        record.onsetType = static_cast<uint8_t>(slot.track.onset.type);
+        record.onsetBeganMs = slot.track.onset.beganMs;
+        out.put(record);
+        // Lane by lane, the way the ring already lays them out.
+        out.putArray(rows.timestampsMicros(), rows.size());
+        out.putArray(rows.x(), rows.size());
+        out.putArray(rows.y(), rows.size());
+        out.putArray(rows.z(), rows.size());
+        out.putArray(rows.vx(), rows.size());
+        out.putArray(rows.vy(), rows.size());
+        out.putArray(rows.vz(), rows.size());
+        out.putArray(rows.motion(), rows.size());
+        out.putArray(rows.energy(), rows.size());
+    }
+}
+
+bool loadVoices(SnapshotCursor& in, VoiceSlotTable& voices, GestureHistory& history) {
+    for (int voiceId = voices.span() - 1; voiceId >= 0; --voiceId) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        if (slot.live) {
+            history.release(slot.history);
+            voices.release(voiceId);
+        }
+    }
+
+    uint32_t count = 0;
+    if (!in.get(count) || !in.fits(count, sizeof(VoiceRecord))) {
+        return false;
+    }
+    // Reused across voices; only as big as the longest history in the file.
+    std::vector<uint64_t> stamps;
+    std::vector<float> lanes;
+    constexpr std::size_t kFloatLanes = 8;
+    for (uint32_t i = 0; i < count; ++i) {
+        VoiceRecord record;
+        if (!in.get(record) || record.id < 0 || record.id >= VoiceSlotTable::kMaxVoices ||
+            record.onsetType >= kVoiceGestureTypeCount ||
+            !in.fits(record.rowCount, sizeof(uint64_t) + kFloatLanes * sizeof(float))) {
+            return false;
+        }
+        const std::size_t rowCount = record.rowCount;
+        stamps.resize(rowCount);
+        lanes.resize(rowCount * kFloatLanes);
+        in.getArray(stamps.data(), rowCount);
+        in.getArray(lanes.data(), lanes.size());
+        if (!in.ok()) {
+            return false;
+        }
+
+        bool claimed = false;
+        VoiceSlot* slot = voices.claim(record.id, claimed);
+        if (!slot || !claimed) {
+            continue; // the same id twice: keep the first.
+        }
+        slot->history = history.acquire();
+        slot->position = glm::vec3(record.x, record.y, record.z);
+        slot->size = record.size;
+        slot->motion = record.motion;
+        slot->energy = record.energy;
+        slot->lastUpdateMicros = in.rebaseMicros(record.lastUpdateMicros);
+        slot->arrivalMicros = in.rebaseMicros(record.arrivalMicros);
+        for (std::size_t g = 0; g < kVoiceGestureTypeCount; ++g) {
+            slot->track.lastTrigger[g] = in.rebaseMs(record.lastTrigger[g]);
+        }
+        slot->track.onset.pending = record.onsetPending != 0;
+        slot->track.onset.type = static_cast<VoiceGestureType>(record.onsetType);
+        slot->track.onset.beganMs = in.rebaseMs(record.onsetBeganMs);
+
+        // Rows go back with their stored velocities; the feature window is
+        // rebuilt from them the first time the voice is judged.
+        GestureHistory::Sample sample;
+        for (std::size_t r = 0; r < rowCount; ++r) {
+            sample.timestampMicros = in.rebaseMicros(stamps[r]);
+            sample.position = glm::vec3(lanes[r], lanes[rowCount + r], lanes[2 * rowCount + r]);
+            sample.velocity = glm::vec3(lanes[3 * rowCount + r], lanes[4 * rowCount + r], lanes[5 * rowCount + r]);
+            sample.motion = lanes[6 * rowCount + r];
+            sample.energy = lanes[7 * rowCount + r];
+            history.restoreSample(slot->history, sample);
+        }
+    }
+    return true;
+}
+
+bool expectSection(SnapshotCursor& in, uint32_t tag) {
+    uint32_t found = 0;
+    return in.get(found) && found == tag;
+}
+} // namespace
+
+void saveDetectorState(const DetectorState& state, SnapshotBuffer& out) {
+    out.clear();
+    out.put(kSectionVoices);
+    saveVoices(state.voices, state.history, out);
+    out.put(kSectionZones);
+    state.zones.saveState(out);
+    out.put(kSectionGlobal);
+    state.global.saveState(out);
+    out.put(kSectionEnsemble);
+    state.ensemble.saveState(out);
+}
+
+bool loadDetectorState(const DetectorState& state, SnapshotCursor& in) {
+    // Sections come back in order; once one is damaged we can't find the
+    // start of the next, so the rest keep their current state.
+    if (!expectSection(in, kSectionVoices) || !loadVoices(in, state.voices, state.history)) {
+        return false;
+    }
+    if (!expectSection(in, kSectionZones) || !state.zones.loadState(in)) {
+        return false;
+    }
+    if (!expectSection(in, kSectionGlobal) || !state.global.loadState(in)) {
+        return false;
+    }
+    if (!expectSection(in, kSectionEnsemble) || !state.ensemble.loadState(in)) {
+        return false;
+    }
+    return in.atEnd();
+}
+
+SnapshotLoad readDetectorSnapshot(const std::string& path, uint64_t maxAgeMs, std::vector<char>& payload, int64_t& offsetMicros,
+                                  uint64_t& ageMs) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return SnapshotLoad::Missing;
+    }
+    // The header's payload length is only believed if the file really is
+    // that long, so a damaged one can't ask for an absurd allocation.
+    long fileBytes = -1;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        fileBytes = std::ftell(file);
+    }
+    std::rewind(file);
+    DetectorSnapshotHeader header;
+    const DetectorSnapshotHeader expected;
+    bool valid = fileBytes >= static_cast<long>(sizeof(header)) && std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+                 header.version == expected.version && header.byteOrder == expected.byteOrder &&
+                 header.voiceGestureTypes == expected.voiceGestureTypes && header.zoneLanes == expected.zoneLanes &&
+                 header.payloadBytes == static_cast<uint64_t>(fileBytes) - sizeof(header);
+    if (valid) {
+        payload.resize(static_cast<std::size_t>(header.payloadBytes));
+        valid = std::fread(payload.data(), 1, payload.size(), file) == payload.size() &&
+                checksumOf(payload.data(), payload.size()) == header.checksum;
+    }
+    std::fclose(file);
+    if (!valid) {
+        return SnapshotLoad::Corrupt;
+    }
+
+    // The wall clock says how long we were down – the monotonic one restarts
+    // with the machine – and the gap between the two carries every stored
+    // time onto our timeline.
+    const uint64_t nowUnix = unixMicros();
+    const uint64_t nowMonotonic = monotonicMicros();
+    const int64_t downMicros = static_cast<int64_t>(nowUnix - header.takenUnixMicros);
+    ageMs = downMicros > 0 ? static_cast<uint64_t>(downMicros) / 1000 : 0;
+    if (downMicros < 0 || ageMs > maxAgeMs) {
+        return SnapshotLoad::Stale;
+    }
+    offsetMicros = static_cast<int64_t>(nowMonotonic) - downMicros - static_cast<int64_t>(header.takenMonotonicMicros);
+    return SnapshotLoad::Loaded;
+}
+
+DetectorSnapshotWriter::~DetectorSnapshotWriter() {
+    stop();
+}
+
+bool DetectorSnapshotWriter::start(const std::string& snapshotPath) {
+    stop();
+    path = snapshotPath;
+    tempPath = snapshotPath + ".tmp";
+    // Fail now, on the main thread, if the folder isn't writable.
+    std::FILE* probe = std::fopen(tempPath.c_str(), "wb");
+    if (!probe) {
+        return false;
+    }
+    std::fclose(probe);
+    std::remove(tempPath.c_str());
+
+    filling = 0;
+    pending = -1;
+    writing = -1;
+    stopping = false;
+    thread = std::thread(&DetectorSnapshotWriter::run, this);
+    return true;
+}
+
+void DetectorSnapshotWriter::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void DetectorSnapshotWriter::waitUntilIdle() {
+    if (!thread.joinable()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending < 0 && writing < 0; });
+}
+
+SnapshotBuffer* DetectorSnapshotWriter::beginSnapshot() {
+    if (!thread.joinable()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending >= 0 || writing == filling) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &buffers[filling];
+}
+
+void DetectorSnapshotWriter::commitSnapshot(uint64_t takenMonotonicMicros) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = filling;
+        pendingMonotonicMicros = takenMonotonicMicros;
+        pendingUnixMicros = unixMicros() - (monotonicMicros() - takenMonotonicMicros);
+    }
+    filling ^= 1;
+    wake.notify_one();
+}
+
+void DetectorSnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return pending >= 0 || stopping; });
+        if (pending < 0) {
+            return; // stopping with nothing left to write.
+        }
+        writing = pending;
+        pending = -1;
+        const uint64_t takenMonotonic = pendingMonotonicMicros;
+        const uint64_t takenUnix = pendingUnixMicros;
+        lock.unlock();
+        (writeFile(buffers[writing], takenMonotonic, takenUnix) ? written : failed).fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+        writing = -1;
+        if (pending < 0) {
+            idle.notify_all();
+        }
+    }
+}
+
+bool DetectorSnapshotWriter::writeFile(const SnapshotBuffer& buffer, uint64_t takenMonotonicMicros, uint64_t takenUnixMicros) {
+    DetectorSnapshotHeader header;
+    header.takenUnixMicros = takenUnixMicros;
+    header.takenMonotonicMicros = takenMonotonicMicros;
+    header.payloadBytes = buffer.size();
+    header.checksum = checksumOf(buffer.data(), buffer.size());
+
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+#if defined(_WIN32)
+    // rename() won't replace an existing file on Windows.
+    std::remove(path.c_str());
+#endif
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "EnsembleGestureDetector.h"
+#include "GestureHistory.h"
+#include "GlobalGestureDetector.h"
+#include "SnapshotBuffer.h"
+#include "VoiceSlotTable.h"
+#include "ZoneGestureDetector.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A detector snapshot is everything the host would otherwise have to
+ * re-learn after a restart: every live voice with its history rows,
+ * cooldowns and pending onset, the zone detector's frames and pulse
+ * trackers, the global detector's motion history and stillness clock, and
+ * the ensemble cooldowns and hysteresis. Restored at startup, detection picks
+ * up where it left off instead of spending seconds misfiring while the
+ * windows refill.
+ *
+ * Layout (host byte order):
+ *
+ *   DetectorSnapshotHeader   64 bytes: magic, when it was taken, payload size + checksum
+ *   payload                  one tagged section per detector, see saveDetectorState()
+ *
+ * Times inside are on the writer's monotonic timeline. The header records
+ * that clock and the wall clock side by side, so the reader can tell how old
+ * the snapshot is and shift every time onto its own clock (see
+ * SnapshotCursor), which also covers a reboot in between.
+ */
+struct DetectorSnapshotHeader {
+    static constexpr uint32_t kVersion = 1;
+
+    char magic[8] = {'C', 'R', 'W', 'D', 'S', 'N', 'A', 'P'};
+    uint32_t version = kVersion;
+    uint32_t byteOrder = 0x01020304;
+    uint64_t takenUnixMicros = 0;      ///< wall clock when the state was captured.
+    uint64_t takenMonotonicMicros = 0; ///< monotonicMicros() at the same moment.
+    uint64_t payloadBytes = 0;
+    uint64_t checksum = 0;             ///< FNV-1a over the payload.
+    uint32_t voiceGestureTypes = kVoiceGestureTypeCount; ///< array sizes the payload was written with.
+    uint32_t zoneLanes = kMaxZoneLanes;
+    uint8_t reserved[8] = {};
+};
+static_assert(sizeof(DetectorSnapshotHeader) == 64, "snapshot header must stay 64 bytes");
+
+/// The host state a snapshot covers.
+struct DetectorState {
+    VoiceSlotTable& voices;
+    GestureHistory& history;
+    ZoneGestureDetector& zones;
+    GlobalGestureDetector& global;
+    EnsembleGestureDetector& ensemble;
+};
+
+/// Append every section to `out` (cleared first). Call from the thread that owns detection.
+void saveDetectorState(const DetectorState& state, SnapshotBuffer& out);
+/**
+ * Replace the detectors' state with a snapshot's. Live voices are released
+ * first. A detector whose section doesn't parse keeps what it had; the
+ * return value says whether everything came back.
+ */
+bool loadDetectorState(const DetectorState& state, SnapshotCursor& in);
+
+enum class SnapshotLoad { Loaded, Missing, Stale, Corrupt };
+
+/**
+ * Read and verify a snapshot file. On Loaded, `payload` holds the sections
+ * and `offsetMicros` the shift from the writer's clock to ours, ready for a
+ * SnapshotCursor. Snapshots older than `maxAgeMs` by the wall clock are Stale.
+ */
+SnapshotLoad readDetectorSnapshot(const std::string& path, uint64_t maxAgeMs, std::vector<char>& payload, int64_t& offsetMicros,
+                                  uint64_t& ageMs);
+
+/**
+ * Writes snapshots to disk on its own thread, so detection only pays for the
+ * memcpy into a buffer. Two buffers take turns: detection fills one while the
+ * thread writes the other out (to a temporary file, renamed over the old
+ * snapshot so a crash mid-write never leaves a torn one). If the disk is
+ * still busy with the last snapshot when the next is due, that one is
+ * skipped rather than waited for.
+ */
+class DetectorSnapshotWriter {
+public:
+    DetectorSnapshotWriter() = default;
+    ~DetectorSnapshotWriter();
+
+    DetectorSnapshotWriter(const DetectorSnapshotWriter&) = delete;
+    DetectorSnapshotWriter& operator=(const DetectorSnapshotWriter&) = delete;
+
+    bool start(const std::string& path);
+    /// Waits for a snapshot still being written, then joins the thread.
+    void stop();
+    bool isRunning() const { return thread.joinable(); }
+    /// Block until nothing is queued or being written, so the next beginSnapshot() succeeds.
+    void waitUntilIdle();
+
+    /// The buffer to fill next, or null while the writer still holds it (skip this snapshot).
+    SnapshotBuffer* beginSnapshot();
+    /// Hand the buffer from beginSnapshot() to the writer thread.
+    void commitSnapshot(uint64_t takenMonotonicMicros);
+
+    uint64_t getWrittenCount() const { return written.load(std::memory_order_relaxed); }
+    uint64_t getSkippedCount() const { return skipped.load(std::memory_order_relaxed); }
+    uint64_t getFailedCount() const { return failed.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    bool writeFile(const SnapshotBuffer& buffer, uint64_t takenMonotonicMicros, uint64_t takenUnixMicros);
+
+    std::string path;
+    std::string tempPath;
+    std::array<SnapshotBuffer, 2> buffers;
+    int filling = 0;        // detection thread only.
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle; // signalled when the thread has nothing left to write.
+    int pending = -1;       // buffer waiting for the thread, or -1.
+    int writing = -1;       // buffer the thread is writing, or -1.
+    uint64_t pendingMonotonicMicros = 0;
+    uint64_t pendingUnixMicros = 0;
+    bool stopping = false;
+    std::thread thread;
+
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> failed{0};
+};
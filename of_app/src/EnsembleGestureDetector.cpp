@@ -0,0 +1,388 @@
+#include "EnsembleGestureDetector.h"
+
+#include "AsyncLogger.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr uint64_t EnsembleGestureDetector::kNeverTriggered;
+
+namespace {
+float clamp01(float value) {
+    return ofClamp(value, 0.0f, 1.0f);
+}
+
+// A ring has to wrap most of the way round its middle, not just bow.
+constexpr int kRingSectors = 8;
+constexpr int kRingMinSectors = 6;
+constexpr float kPi = 3.14159265358979f;
+} // namespace
+
+EnsembleGestureDetector::EnsembleGestureDetector() {
+    lastSync.fill(kNeverTriggered);
+}
+
+void EnsembleGestureDetector::setConfig(const Config& newConfig) {
+    config = newConfig;
+}
+
+void EnsembleGestureDetector::beginFrame() {
+    for (int voiceId : voiceIds) {
+        indexOfVoice[voiceId] = -1;
+    }
+    voiceIds.clear();
+    xs.clear();
+    zs.clear();
+    arrivals.clear();
+}
+
+void EnsembleGestureDetector::addVoice(int voiceId, const glm::vec3& position, uint64_t arrivalMicros) {
+    if (voiceId < 0) {
+        return;
+    }
+    if (static_cast<std::size_t>(voiceId) >= indexOfVoice.size()) {
+        indexOfVoice.resize(static_cast<std::size_t>(voiceId) + 1, -1);
+    }
+    indexOfVoice[voiceId] = static_cast<int>(voiceIds.size());
+    voiceIds.push_back(voiceId);
+    // The floor plane: x across the room, z into it. Height plays no part in
+    // who is standing next to whom.
+    xs.push_back(position.x);
+    zs.push_back(position.z);
+    arrivals.push_back(arrivalMicros);
+}
+
+void EnsembleGestureDetector::noteVoiceGesture(const VoiceGestureEvent& event, uint64_t timestampMs) {
+    // Predictive onsets are previews; only the gesture itself counts towards a sync.
+    if (!config.enabled || event.phase != VoiceGesturePhase::Complete) {
+        return;
+    }
+    RecentGesture gesture;
+    gesture.voiceId = event.voiceId;
+    gesture.type = event.type;
+    gesture.strength = event.strength;
+    gesture.timestamp = timestampMs;
+    recent.push_back(gesture);
+}
+
+void EnsembleGestureDetector::update(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents) {
+    if (!config.enabled) {
+        recent.clear();
+        return;
+    }
+
+    // Gestures older than the sync window can no longer be "together" with anything new.
+    const uint64_t oldest = (timestampMs > config.syncWindowMs) ? timestampMs - config.syncWindowMs : 0;
+    recent.erase(std::remove_if(recent.begin(), recent.end(), [oldest](const RecentGesture& gesture) { return gesture.timestamp < oldest; }),
+                 recent.end());
+
+    const std::size_t count = voiceIds.size();
+    if (count == 0) {
+        clusterActive = false;
+        ringActive = false;
+        return;
+    }
+    grid.build(xs.data(), zs.data(), count, config.neighborRadius);
+    member.assign(count, 0);
+    visited.assign(count, 0);
+    memberStrength.assign(count, 0.0f);
+
+    detectSync(timestampMs, outEvents);
+    detectCluster(timestampMs, outEvents);
+    detectRing(timestampMs, outEvents);
+}
+
+void EnsembleGestureDetector::reset() {
+    beginFrame();
+    recent.clear();
+    lastSync.fill(kNeverTriggered);
+    lastCluster = kNeverTriggered;
+    lastRing = kNeverTriggered;
+    clusterActive = false;
+    ringActive = false;
+}
+
+void EnsembleGestureDetector::saveState(SnapshotBuffer& out) const {
+    out.put(lastSync);
+    out.put(lastCluster);
+    out.put(lastRing);
+    out.put(static_cast<uint8_t>(clusterActive));
+    out.put(static_cast<uint8_t>(ringActive));
+    out.put(static_cast<uint64_t>(recent.size()));
+    out.putArray(recent.data(), recent.size());
+}
+
+bool EnsembleGestureDetector::loadState(SnapshotCursor& in) {
+    std::array<uint64_t, kVoiceGestureTypeCount> savedSync;
+    uint64_t savedCluster = 0;
+    uint64_t savedRing = 0;
+    uint8_t savedClusterActive = 0;
+    uint8_t savedRingActive = 0;
+    uint64_t recentCount = 0;
+    in.get(savedSync);
+    in.get(savedCluster);
+    in.get(savedRing);
+    in.get(savedClusterActive);
+    in.get(savedRingActive);
+    in.get(recentCount);
+    if (!in.ok() || !in.fits(recentCount, sizeof(RecentGesture))) {
+        return false;
+    }
+    std::vector<RecentGesture> savedRecent(static_cast<std::size_t>(recentCount));
+    if (!in.getArray(savedRecent.data(), savedRecent.size())) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < kVoiceGestureTypeCount; ++i) {
+        lastSync[i] = in.rebaseMs(savedSync[i]);
+    }
+    lastCluster = in.rebaseMs(savedCluster);
+    lastRing = in.rebaseMs(savedRing);
+    clusterActive = savedClusterActive != 0;
+    ringActive = savedRingActive != 0;
+    recent.clear();
+    for (RecentGesture& gesture : savedRecent) {
+        gesture.timestamp = in.rebaseMs(gesture.timestamp);
+        recent.push_back(gesture);
+    }
+    return true;
+}
+
+void EnsembleGestureDetector::detectSync(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents) {
+    const std::size_t minVoices = static_cast<std::size_t>(std::max(2, config.syncMinVoices));
+    if (recent.size() < minVoices) {
+        return;
+    }
+    const std::size_t count = voiceIds.size();
+
+    for (std::size_t t = 0; t < kVoiceGestureTypeCount; ++t) {
+        const VoiceGestureType type = static_cast<VoiceGestureType>(t);
+        if (!canTrigger(lastSync[t], timestampMs, config.syncCooldownMs)) {
+            continue;
+        }
+
+        // Mark every voice that did this gesture recently and hasn't already
+        // been counted in a sync.
+        std::fill(member.begin(), member.end(), 0);
+        std::size_t marked = 0;
+        for (const RecentGesture& gesture : recent) {
+            if (gesture.fused || gesture.type != type || gesture.voiceId < 0
+                || static_cast<std::size_t>(gesture.voiceId) >= indexOfVoice.size()) {
+                continue;
+            }
+            const int index = indexOfVoice[gesture.voiceId];
+            if (index >= 0 && !member[index]) {
+                member[index] = 1;
+                memberStrength[index] = gesture.strength;
+                ++marked;
+            }
+        }
+        if (marked < minVoices) {
+            continue;
+        }
+
+        // Each neighbourhood of marked voices is one candidate group.
+        std::fill(visited.begin(), visited.end(), 0);
+        bool fired = false;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!member[i] || visited[i]) {
+                continue;
+            }
+            collectGroup(i);
+            if (group.size() < minVoices) {
+                continue;
+            }
+            EnsembleGestureEvent event;
+            event.type = EnsembleGestureType::Sync;
+            event.voiceType = type;
+            summarize(event);
+            float strength = 0.0f;
+            for (uint32_t index : group) {
+                strength += memberStrength[index];
+                member[index] = 2; // fused into this event
+            }
+            event.strength = clamp01(strength / static_cast<float>(group.size()));
+            outEvents.push_back(event);
+            fired = true;
+            if (config.logGestures) {
+                AsyncLogNotice("EnsembleGestureDetector") << gestureTypeName(event) << " x" << event.voiceCount << " strength " << event.strength;
+            }
+        }
+        if (!fired) {
+            continue;
+        }
+        lastSync[t] = timestampMs;
+        for (RecentGesture& gesture : recent) {
+            if (!gesture.fused && gesture.type == type && static_cast<std::size_t>(gesture.voiceId) < indexOfVoice.size()) {
+                const int index = indexOfVoice[gesture.voiceId];
+                gesture.fused = index >= 0 && member[index] == 2;
+            }
+        }
+    }
+}
+
+void EnsembleGestureDetector::detectCluster(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents) {
+    const std::size_t count = voiceIds.size();
+    const int minVoices = std::max(2, config.clusterMinVoices);
+    if (count < static_cast<std::size_t>(minVoices)) {
+        clusterActive = false;
+        return;
+    }
+
+    // The densest spot in the room: the voice with the most neighbours.
+    int densest = 0;
+    std::size_t center = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        int neighbours = 0;
+        grid.forEachNeighbor(xs[i], zs[i], config.neighborRadius, [&neighbours](std::size_t) { ++neighbours; });
+        if (neighbours > densest) {
+            densest = neighbours;
+            center = i;
+        }
+    }
+
+    if (densest < minVoices) {
+        clusterActive = false;
+        return;
+    }
+    // Fire once as the knot forms (or as soon as the cooldown allows), then
+    // stay quiet until it breaks up again.
+    if (clusterActive || !canTrigger(lastCluster, timestampMs, config.clusterCooldownMs)) {
+        return;
+    }
+    group.clear();
+    grid.forEachNeighbor(xs[center], zs[center], config.neighborRadius,
+                         [this](std::size_t index) { group.push_back(static_cast<uint32_t>(index)); });
+    EnsembleGestureEvent event;
+    event.type = EnsembleGestureType::Cluster;
+    summarize(event);
+    event.strength = clamp01(static_cast<float>(densest) / static_cast<float>(2 * minVoices));
+    outEvents.push_back(event);
+    lastCluster = timestampMs;
+    clusterActive = true;
+    if (config.logGestures) {
+        AsyncLogNotice("EnsembleGestureDetector") << "cluster x" << event.voiceCount << " strength " << event.strength;
+    }
+}
+
+void EnsembleGestureDetector::detectRing(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents) {
+    const std::size_t count = voiceIds.size();
+    const std::size_t minVoices = static_cast<std::size_t>(std::max(3, config.ringMinVoices));
+    if (count < minVoices) {
+        ringActive = false;
+        return;
+    }
+
+    // Every chain of neighbours is a candidate; a ring is one whose members
+    // all sit about the same distance from its middle, with nobody in it and
+    // people on most sides.
+    std::fill(member.begin(), member.end(), 1);
+    std::fill(visited.begin(), visited.end(), 0);
+    bool found = false;
+    EnsembleGestureEvent best;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (visited[i]) {
+            continue;
+        }
+        collectGroup(i);
+        if (group.size() < minVoices) {
+            continue;
+        }
+        EnsembleGestureEvent event;
+        event.type = EnsembleGestureType::Ring;
+        const float spread = summarize(event);
+        if (event.radius < 0.5f * config.neighborRadius) {
+            continue; // a huddle, not a ring
+        }
+        const float variation = spread / event.radius;
+        if (variation > config.ringTolerance) {
+            continue;
+        }
+        bool hollow = true;
+        unsigned sectors = 0;
+        for (uint32_t index : group) {
+            const float dx = xs[index] - event.x;
+            const float dz = zs[index] - event.z;
+            hollow = hollow && std::sqrt(dx * dx + dz * dz) >= 0.5f * event.radius;
+            const float angle = std::atan2(dz, dx) + kPi;
+            const int sector = static_cast<int>(angle / (2.0f * kPi) * kRingSectors);
+            sectors |= 1u << std::min(std::max(sector, 0), kRingSectors - 1);
+        }
+        int covered = 0;
+        for (int s = 0; s < kRingSectors; ++s) {
+            covered += (sectors >> s) & 1u;
+        }
+        if (!hollow || covered < kRingMinSectors) {
+            continue;
+        }
+        event.strength = clamp01(1.0f - variation / std::max(0.01f, config.ringTolerance));
+        if (!found || event.strength > best.strength) {
+            best = event;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ringActive = false;
+        return;
+    }
+    if (ringActive || !canTrigger(lastRing, timestampMs, config.ringCooldownMs)) {
+        return;
+    }
+    outEvents.push_back(best);
+    lastRing = timestampMs;
+    ringActive = true;
+    if (config.logGestures) {
+        AsyncLogNotice("EnsembleGestureDetector") << "ring x" << best.voiceCount << " radius " << best.radius << " strength " << best.strength;
+    }
+}
+
+void EnsembleGestureDetector::collectGroup(std::size_t seed) {
+    group.clear();
+    stack.clear();
+    stack.push_back(static_cast<uint32_t>(seed));
+    visited[seed] = 1;
+    while (!stack.empty()) {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+        group.push_back(index);
+        grid.forEachNeighbor(xs[index], zs[index], config.neighborRadius, [this](std::size_t neighbour) {
+            if (member[neighbour] && !visited[neighbour]) {
+                visited[neighbour] = 1;
+                stack.push_back(static_cast<uint32_t>(neighbour));
+            }
+        });
+    }
+}
+
+float EnsembleGestureDetector::summarize(EnsembleGestureEvent& event) const {
+    float sumX = 0.0f;
+    float sumZ = 0.0f;
+    uint64_t newest = 0;
+    for (uint32_t index : group) {
+        sumX += xs[index];
+        sumZ += zs[index];
+        newest = std::max(newest, arrivals[index]);
+    }
+    const float n = static_cast<float>(group.size());
+    event.voiceCount = static_cast<int>(group.size());
+    event.x = sumX / n;
+    event.z = sumZ / n;
+    event.sourceMicros = newest;
+
+    float sumDistance = 0.0f;
+    float sumDistanceSq = 0.0f;
+    for (uint32_t index : group) {
+        const float dx = xs[index] - event.x;
+        const float dz = zs[index] - event.z;
+        const float distanceSq = dx * dx + dz * dz;
+        sumDistance += std::sqrt(distanceSq);
+        sumDistanceSq += distanceSq;
+    }
+    event.radius = sumDistance / n;
+    return std::sqrt(std::max(0.0f, sumDistanceSq / n - event.radius * event.radius));
+}
+
+bool EnsembleGestureDetector::canTrigger(uint64_t last, uint64_t timestamp, uint64_t cooldownMs) {
+    return last == kNeverTriggered || timestamp >= last + cooldownMs;
+}
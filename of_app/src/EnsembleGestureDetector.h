@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "GestureEvents.h"
+#include "SnapshotBuffer.h"
+#include "SpatialGrid.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * EnsembleGestureDetector looks at voices together instead of one at a time:
+ * a knot of people raising their arms in the same breath, a dense cluster
+ * forming, a ring opening up around an empty middle. Each frame it drops
+ * every live voice's floor position (x, z) into a SpatialGrid, so "who is
+ * near whom" is a 3×3-cell lookup rather than an all-pairs pass – the whole
+ * thing stays linear in the crowd, which is what lets it keep up with a
+ * festival field of 100+ voices.
+ *
+ * Voice gestures reach it through noteVoiceGesture() as they are sent; the
+ * ones close enough in time and space are fused into a single sync event.
+ */
+class EnsembleGestureDetector {
+public:
+    struct Config {
+        bool enabled = true;
+        float neighborRadius = 0.3f;  ///< Floor distance (x/z units) at which two voices count as together.
+        uint64_t syncWindowMs = 400;  ///< Same gesture from neighbours within this long counts as one.
+        int syncMinVoices = 3;
+        uint64_t syncCooldownMs = 1500;
+        int clusterMinVoices = 5;     ///< Voices within neighborRadius of one spot, that spot included.
+        uint64_t clusterCooldownMs = 4000;
+        int ringMinVoices = 6;
+        float ringTolerance = 0.3f;   ///< Allowed spread of member distances, relative to the ring radius.
+        uint64_t ringCooldownMs = 5000;
+        bool logGestures = true; ///< Log each gesture (through AsyncLogger).
+    };
+
+    EnsembleGestureDetector();
+
+    void setConfig(const Config& config);
+    const Config& getConfig() const { return config; }
+
+    /// Start a frame's crowd snapshot; follow with addVoice() for every live voice.
+    void beginFrame();
+    void addVoice(int voiceId, const glm::vec3& position, uint64_t arrivalMicros);
+
+    /// Remember a voice gesture so neighbours doing the same thing can be fused with it.
+    void noteVoiceGesture(const VoiceGestureEvent& event, uint64_t timestampMs);
+
+    /// Judge the snapshot built since beginFrame().
+    void update(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents);
+    void reset();
+
+    /// Append the cooldowns, the cluster/ring hysteresis and the recent voice gestures to a snapshot.
+    void saveState(SnapshotBuffer& out) const;
+    /// Replace them with a snapshot's. False, leaving ours alone, if it doesn't parse.
+    bool loadState(SnapshotCursor& in);
+
+private:
+    static constexpr uint64_t kNeverTriggered = std::numeric_limits<uint64_t>::max();
+
+    struct RecentGesture {
+        int voiceId = -1;
+        VoiceGestureType type = VoiceGestureType::Raise;
+        float strength = 0.0f;
+        uint64_t timestamp = 0;
+        bool fused = false;
+    };
+
+    /// Flood-fill from `seed` through neighbours with `member` set, into `group`.
+    void collectGroup(std::size_t seed);
+    /// Centroid, mean radius and newest arrival of `group`; returns the spread of member distances.
+    float summarize(EnsembleGestureEvent& event) const;
+    void detectSync(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents);
+    void detectCluster(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents);
+    void detectRing(uint64_t timestampMs, std::vector<EnsembleGestureEvent>& outEvents);
+    static bool canTrigger(uint64_t last, uint64_t timestamp, uint64_t cooldownMs);
+
+    Config config;
+    SpatialGrid grid;
+
+    // This frame's crowd, in the order addVoice() saw it.
+    std::vector<int> voiceIds;
+    std::vector<float> xs;
+    std::vector<float> zs;
+    std::vector<uint64_t> arrivals;
+    std::vector<int> indexOfVoice; // voiceId -> index above, or -1.
+
+    std::vector<RecentGesture> recent;
+
+    // Scratch, kept between frames so detection never allocates.
+    std::vector<uint8_t> member;
+    std::vector<uint8_t> visited;
+    std::vector<float> memberStrength;
+    std::vector<uint32_t> group;
+    std::vector<uint32_t> stack;
+
+    std::array<uint64_t, kVoiceGestureTypeCount> lastSync;
+    uint64_t lastCluster = kNeverTriggered;
+    uint64_t lastRing = kNeverTriggered;
+    bool clusterActive = false;
+    bool ringActive = false;
+};
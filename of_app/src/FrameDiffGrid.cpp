@@ -0,0 +1,108 @@
+#include "FrameDiffGrid.h"
+
+#include "FrameDiffKernels.h"
+#include "GestureTypes.h"
+
+#include <algorithm>
+#include <cstring>
+
+void FrameDiffGrid::setup(const Settings& newSettings) {
+    settings = newSettings;
+    settings.cols = std::max(1, std::min(settings.cols, kMaxZoneLanes));
+    settings.rows = std::max(1, std::min(settings.rows, kMaxZoneLanes));
+    while (settings.cols * settings.rows > kMaxZoneCells) {
+        settings.rows = std::max(1, settings.rows - 1);
+    }
+    settings.downsample = std::max(1, settings.downsample);
+    settings.smoothing = std::max(0.01f, std::min(settings.smoothing, 1.0f));
+    sourceWidth = 0;
+    sourceHeight = 0;
+}
+
+bool FrameDiffGrid::process(const uint8_t* pixels, int frameWidth, int frameHeight, int channels, int stride, float* out) {
+    if (frameWidth != sourceWidth || frameHeight != sourceHeight) {
+        sourceWidth = frameWidth;
+        sourceHeight = frameHeight;
+        width = frameWidth / settings.downsample;
+        height = frameHeight / settings.downsample;
+        if (width < settings.cols || height < settings.rows) {
+            width = 0;
+            height = 0;
+            return false;
+        }
+        previous.assign(static_cast<std::size_t>(width * height), 0);
+        current.assign(previous.size(), 0);
+        cellSums.assign(static_cast<std::size_t>(settings.cols * settings.rows), 0);
+        cellPixels.assign(cellSums.size(), 0);
+        for (int y = 0; y < height; ++y) {
+            const int row = y * settings.rows / height;
+            for (int x = 0; x < width; ++x) {
+                ++cellPixels[row * settings.cols + x * settings.cols / width];
+            }
+        }
+        smoothed.assign(cellSums.size(), 0.0f);
+        int rowStride = width;
+        keep(prepare(pixels, channels, stride, rowStride), rowStride);
+        return false;
+    }
+    if (width == 0) {
+        return false;
+    }
+
+    int rowStride = width;
+    const uint8_t* frame = prepare(pixels, channels, stride, rowStride);
+    accumulateFrameDiff(frame, rowStride, previous.data(), width, width, height, settings.cols, settings.rows, cellSums.data());
+    keep(frame, rowStride);
+
+    for (std::size_t cell = 0; cell < cellSums.size(); ++cell) {
+        const float mean = static_cast<float>(cellSums[cell]) / (255.0f * static_cast<float>(std::max<uint32_t>(1, cellPixels[cell])));
+        smoothed[cell] += settings.smoothing * (std::min(1.0f, mean * settings.gain) - smoothed[cell]);
+        out[cell] = smoothed[cell];
+    }
+    return true;
+}
+
+const uint8_t* FrameDiffGrid::prepare(const uint8_t* pixels, int channels, int stride, int& rowStride) {
+    if (channels == 1 && settings.downsample == 1) {
+        rowStride = stride; // diff the grabber's own bytes, no copy
+        return pixels;
+    }
+    rowStride = width;
+    if (channels == 1 && settings.downsample == 2) {
+        halveGray(pixels, stride, width, height, current.data());
+    } else {
+        shrink(pixels, channels, stride, current.data());
+    }
+    return current.data();
+}
+
+void FrameDiffGrid::keep(const uint8_t* frame, int rowStride) {
+    if (frame == current.data()) {
+        std::swap(previous, current);
+        return;
+    }
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(previous.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width),
+                    frame + static_cast<std::size_t>(y) * static_cast<std::size_t>(rowStride), static_cast<std::size_t>(width));
+    }
+}
+
+void FrameDiffGrid::shrink(const uint8_t* pixels, int channels, int stride, uint8_t* into) const {
+    const int step = settings.downsample;
+    const uint32_t samples = static_cast<uint32_t>(step * step);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* line = into + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+        for (int x = 0; x < width; ++x) {
+            uint32_t sum = 0;
+            for (int sy = 0; sy < step; ++sy) {
+                const uint8_t* source = pixels + static_cast<std::size_t>(y * step + sy) * static_cast<std::size_t>(stride)
+                                        + static_cast<std::size_t>(x * step * channels);
+                for (int sx = 0; sx < step; ++sx, source += channels) {
+                    // Integer Rec. 601 luma; gray frames just take the byte.
+                    sum += channels >= 3 ? (77u * source[0] + 150u * source[1] + 29u * source[2]) >> 8 : source[0];
+                }
+            }
+            line[x] = static_cast<uint8_t>(sum / samples);
+        }
+    }
+}
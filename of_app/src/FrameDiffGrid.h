@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * FrameDiffGrid is the webcam half of the capture stage: how much did each
+ * patch of the picture change since the last frame? Each frame is shrunk to
+ * grayscale by averaging `downsample`×`downsample` blocks (which doubles as
+ * the blur that keeps sensor noise out), differenced against the previous
+ * shrunken frame, and the differences are summed per grid cell. Cell means
+ * are smoothed over time, giving one 0..1 value per cell, row-major – exactly
+ * what ZoneGestureDetector::updateCamera() and /room/camera/zones expect.
+ *
+ * Gray frames take the fast route (see FrameDiffKernels.h): a vector 2×2
+ * average, or none at all with `downsample` 1, then one fused pass that
+ * differences and sums per cell without writing a difference image. Colour
+ * frames and other downsample factors are shrunk by the plain loop first.
+ */
+class FrameDiffGrid {
+public:
+    struct Settings {
+        int cols = 4;
+        int rows = 4;
+        int downsample = 2;  ///< Source pixels per side averaged into one.
+        float gain = 4.0f;   ///< Mean difference (0..1) × gain, clamped, is the cell value.
+        float smoothing = 0.5f; ///< EMA weight of the newest frame per cell; 1 = no smoothing.
+    };
+
+    void setup(const Settings& settings);
+    const Settings& getSettings() const { return settings; }
+
+    /**
+     * Reduce one frame (`channels` = 1 gray, 3 RGB or 4 RGBA, rows `stride`
+     * bytes apart) into `out`, cols × rows values. Returns false – and leaves
+     * `out` alone – on the first frame and whenever the size changes, since
+     * there is nothing to compare against yet.
+     */
+    bool process(const uint8_t* pixels, int width, int height, int channels, int stride, float* out);
+
+private:
+    /// The frame at working size, in `current` or (gray, no downsampling) the source itself.
+    const uint8_t* prepare(const uint8_t* pixels, int channels, int stride, int& rowStride);
+    /// Make `frame` the one the next call compares against.
+    void keep(const uint8_t* frame, int rowStride);
+    void shrink(const uint8_t* pixels, int channels, int stride, uint8_t* into) const;
+
+    Settings settings;
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    int width = 0;  // shrunken frame size.
+    int height = 0;
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> current;
+    std::vector<uint32_t> cellSums;
+    std::vector<uint32_t> cellPixels;   // shrunken pixels per cell, for the mean.
+    std::vector<float> smoothed;        // the EMA handed out.
+};
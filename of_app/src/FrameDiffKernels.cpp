@@ -0,0 +1,184 @@
+#include "FrameDiffKernels.h"
+
+#include "GestureTypes.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(CROWD_ORGAN_DIFF_AVX2)
+#include <immintrin.h>
+#elif defined(CROWD_ORGAN_ZONE_SSE2)
+#include <emmintrin.h>
+#elif defined(CROWD_ORGAN_ZONE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+inline uint8_t roundedAverage(uint8_t a, uint8_t b) {
+    return static_cast<uint8_t>((a + b + 1) >> 1);
+}
+
+#if defined(CROWD_ORGAN_ZONE_SSE2) || defined(CROWD_ORGAN_ZONE_NEON)
+
+/// First index of each of `parts` equal slices of [0, length): i belongs to slice i·parts/length.
+void sliceEdges(int length, int parts, int* edges) {
+    for (int i = 0; i <= parts; ++i) {
+        edges[i] = (i * length + parts - 1) / parts;
+    }
+}
+
+// A running sum of absolute byte differences, kStep bytes a step. The
+// backends only differ in these wrappers; the grid walk below is shared.
+// The x86 paths use the sum-of-absolute-differences instruction, which does
+// the subtract, the abs and the horizontal add in one go.
+#if defined(CROWD_ORGAN_DIFF_AVX2)
+constexpr int kStep = 32;
+using DiffSum = __m256i;
+
+inline DiffSum zeroSum() { return _mm256_setzero_si256(); }
+inline DiffSum addDiff(DiffSum sum, const uint8_t* a, const uint8_t* b) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+}
+inline uint32_t total(DiffSum sum) {
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi64(half, _mm_unpackhi_epi64(half, half));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(half));
+}
+#elif defined(CROWD_ORGAN_ZONE_SSE2)
+constexpr int kStep = 16;
+using DiffSum = __m128i;
+
+inline DiffSum zeroSum() { return _mm_setzero_si128(); }
+inline DiffSum addDiff(DiffSum sum, const uint8_t* a, const uint8_t* b) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    return _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+}
+inline uint32_t total(DiffSum sum) {
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum))));
+}
+#else
+constexpr int kStep = 16;
+using DiffSum = uint32x4_t;
+
+inline DiffSum zeroSum() { return vdupq_n_u32(0); }
+inline DiffSum addDiff(DiffSum sum, const uint8_t* a, const uint8_t* b) {
+    return vpadalq_u16(sum, vpaddlq_u8(vabdq_u8(vld1q_u8(a), vld1q_u8(b))));
+}
+inline uint32_t total(DiffSum sum) {
+#if defined(__aarch64__)
+    return vaddvq_u32(sum);
+#else
+    return vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1) + vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+}
+#endif
+
+#endif
+
+} // namespace
+
+void accumulateFrameDiffScalar(const uint8_t* current, int currentStride, const uint8_t* previous, int previousStride,
+                               int width, int height, int cols, int rows, uint32_t* cellSums) {
+    std::fill(cellSums, cellSums + cols * rows, 0u);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* a = current + static_cast<std::size_t>(y) * static_cast<std::size_t>(currentStride);
+        const uint8_t* b = previous + static_cast<std::size_t>(y) * static_cast<std::size_t>(previousStride);
+        uint32_t* sums = cellSums + (y * rows / height) * cols;
+        for (int x = 0; x < width; ++x) {
+            sums[x * cols / width] += static_cast<uint32_t>(std::abs(a[x] - b[x]));
+        }
+    }
+}
+
+void accumulateFrameDiff(const uint8_t* current, int currentStride, const uint8_t* previous, int previousStride, int width,
+                         int height, int cols, int rows, uint32_t* cellSums) {
+#if defined(CROWD_ORGAN_ZONE_SSE2) || defined(CROWD_ORGAN_ZONE_NEON)
+    int columnEdges[kMaxZoneLanes + 1];
+    int rowEdges[kMaxZoneLanes + 1];
+    sliceEdges(width, cols, columnEdges);
+    sliceEdges(height, rows, rowEdges);
+
+    // Each cell keeps a vector sum for the whole band of rows it covers and
+    // is reduced once at the end of the band; only the few bytes left over
+    // at a cell's right edge go through the scalar tail.
+    DiffSum sums[kMaxZoneLanes];
+    uint32_t tails[kMaxZoneLanes];
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            sums[col] = zeroSum();
+            tails[col] = 0;
+        }
+        for (int y = rowEdges[row]; y < rowEdges[row + 1]; ++y) {
+            const uint8_t* a = current + static_cast<std::size_t>(y) * static_cast<std::size_t>(currentStride);
+            const uint8_t* b = previous + static_cast<std::size_t>(y) * static_cast<std::size_t>(previousStride);
+            for (int col = 0; col < cols; ++col) {
+                int x = columnEdges[col];
+                const int end = columnEdges[col + 1];
+                for (; x + kStep <= end; x += kStep) {
+                    sums[col] = addDiff(sums[col], a + x, b + x);
+                }
+                for (; x < end; ++x) {
+                    tails[col] += static_cast<uint32_t>(std::abs(a[x] - b[x]));
+                }
+            }
+        }
+        for (int col = 0; col < cols; ++col) {
+            cellSums[row * cols + col] = total(sums[col]) + tails[col];
+        }
+    }
+#else
+    accumulateFrameDiffScalar(current, currentStride, previous, previousStride, width, height, cols, rows, cellSums);
+#endif
+}
+
+void halveGrayScalar(const uint8_t* source, int stride, int width, int height, uint8_t* out) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* top = source + static_cast<std::size_t>(2 * y) * static_cast<std::size_t>(stride);
+        const uint8_t* bottom = top + stride;
+        uint8_t* line = out + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+        for (int x = 0; x < width; ++x) {
+            line[x] = roundedAverage(roundedAverage(top[2 * x], bottom[2 * x]), roundedAverage(top[2 * x + 1], bottom[2 * x + 1]));
+        }
+    }
+}
+
+void halveGray(const uint8_t* source, int stride, int width, int height, uint8_t* out) {
+#if defined(CROWD_ORGAN_ZONE_SSE2) || defined(CROWD_ORGAN_ZONE_NEON)
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* top = source + static_cast<std::size_t>(2 * y) * static_cast<std::size_t>(stride);
+        const uint8_t* bottom = top + stride;
+        uint8_t* line = out + static_cast<std::size_t>(y) * static_cast<std::size_t>(width);
+        int x = 0;
+        // 16 output bytes from 32 source bytes of each row.
+        for (; x + 16 <= width; x += 16) {
+#if defined(CROWD_ORGAN_ZONE_SSE2)
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+            const __m128i left = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x)));
+            const __m128i right = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x + 16)),
+                                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x + 16)));
+            // Even and odd bytes side by side as 16-bit lanes, averaged, packed back.
+            const __m128i leftPairs = _mm_avg_epu16(_mm_and_si128(left, lowBytes), _mm_srli_epi16(left, 8));
+            const __m128i rightPairs = _mm_avg_epu16(_mm_and_si128(right, lowBytes), _mm_srli_epi16(right, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x), _mm_packus_epi16(leftPairs, rightPairs));
+#else
+            // vld2 splits even and odd bytes for us.
+            const uint8x16x2_t upper = vld2q_u8(top + 2 * x);
+            const uint8x16x2_t lower = vld2q_u8(bottom + 2 * x);
+            const uint8x16_t even = vrhaddq_u8(upper.val[0], lower.val[0]);
+            const uint8x16_t odd = vrhaddq_u8(upper.val[1], lower.val[1]);
+            vst1q_u8(line + x, vrhaddq_u8(even, odd));
+#endif
+        }
+        for (; x < width; ++x) {
+            line[x] = roundedAverage(roundedAverage(top[2 * x], bottom[2 * x]), roundedAverage(top[2 * x + 1], bottom[2 * x + 1]));
+        }
+    }
+#else
+    halveGrayScalar(source, stride, width, height, out);
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Same compile-time choice as the zone reductions (CROWD_ORGAN_NO_SIMD forces
+// the plain loops here too). On x86 an -mavx2 build widens the difference
+// pass to 32 bytes a step.
+#include "ZoneGridKernels.h"
+
+#if defined(CROWD_ORGAN_ZONE_SSE2) && defined(__AVX2__)
+#define CROWD_ORGAN_DIFF_AVX2 1
+#endif
+
+#include <cstdint>
+
+/**
+ * Sum |current - previous| over each cell of a `cols` × `rows` grid laid over
+ * two `width` × `height` gray frames, in one pass: every difference lands
+ * straight in its cell's running sum, so no difference image is ever written.
+ * Pixel x belongs to column x·cols/width and pixel y to row y·rows/height
+ * (the same split FrameDiffGrid counts cell sizes with). Rows are `stride`
+ * bytes apart; `cellSums` receives cols × rows totals, row-major.
+ */
+void accumulateFrameDiff(const uint8_t* current, int currentStride, const uint8_t* previous, int previousStride, int width,
+                         int height, int cols, int rows, uint32_t* cellSums);
+
+/// Straightforward per-pixel loop, kept as the reference the fast paths must match.
+void accumulateFrameDiffScalar(const uint8_t* current, int currentStride, const uint8_t* previous, int previousStride,
+                               int width, int height, int cols, int rows, uint32_t* cellSums);
+
+/**
+ * Average 2×2 blocks of a gray frame into a `width` × `height` one (the
+ * source is at least twice that on each side, rows `stride` bytes apart).
+ * Each block is rounded the way a rounding-average instruction does it – the
+ * two rows first, then the two columns – so every path gives identical bytes.
+ */
+void halveGray(const uint8_t* source, int stride, int width, int height, uint8_t* out);
+
+/// Scalar reference for halveGray().
+void halveGrayScalar(const uint8_t* source, int stride, int width, int height, uint8_t* out);
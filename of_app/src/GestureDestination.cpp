@@ -0,0 +1,303 @@
+#include "GestureDestination.h"
+
+#include "ofLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+/// Predictive begin/confirm/cancel: worth something only if they go straight out.
+bool isOnset(const VoiceGestureEvent& event) {
+    return event.phase != VoiceGesturePhase::Complete;
+}
+} // namespace
+
+GestureDestination::~GestureDestination() {
+    stop();
+}
+
+bool GestureDestination::start(const Settings& newSettings, LatencyStats* latencyStats) {
+    stop();
+    settings = newSettings;
+    queue.reset(settings.queueCapacity);
+    dropped.store(0);
+    datagramsSent.store(0);
+    governor.setup(settings.governor);
+    held.clear();
+    held.reserve(settings.queueCapacity); // never more than the queue can hand over
+    openOnsets.clear();
+
+    if (!sender.setup(settings.host, settings.port, settings.output)) {
+        return false;
+    }
+    sender.setLatencyStats(latencyStats);
+
+    running.store(true);
+    thread = std::thread([this]() { run(); });
+    ofLogNotice("GestureDestination") << settings.name << " -> " << settings.host << ":" << settings.port
+                                      << (settings.output.bundle ? " (bundled)" : "")
+                                      << (settings.governor.isActive() ? " (governed)" : "");
+    return true;
+}
+
+void GestureDestination::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wake.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void GestureDestination::push(const VoiceGestureEvent& event) {
+    if (settings.filter & kFilterVoice) {
+        Item item;
+        item.kind = Item::Kind::Voice;
+        item.voice = event;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::push(const ZoneGestureEvent& event) {
+    if (settings.filter & kFilterZone) {
+        Item item;
+        item.kind = Item::Kind::Zone;
+        item.zone = event;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::push(const GlobalGestureEvent& event) {
+    if (settings.filter & kFilterGlobal) {
+        Item item;
+        item.kind = Item::Kind::Global;
+        item.global = event;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::push(const EnsembleGestureEvent& event) {
+    if (settings.filter & kFilterEnsemble) {
+        Item item;
+        item.kind = Item::Kind::Ensemble;
+        item.ensemble = event;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::push(const LatencySummary& summary) {
+    if (settings.filter & kFilterStats) {
+        Item item;
+        item.kind = Item::Kind::Stats;
+        item.stats = summary;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::adoptOnset(const VoiceGestureEvent& resolution) {
+    if (settings.filter & kFilterVoice) {
+        Item item;
+        item.kind = Item::Kind::AdoptOnset;
+        item.voice = resolution;
+        enqueue(item);
+    }
+}
+
+void GestureDestination::flush() {
+    if (!running.load(std::memory_order_relaxed) || queue.size() == 0) {
+        return;
+    }
+    enqueue(Item());
+    // Taking the mutex for an instant closes the gap between the send thread
+    // checking the queue and going to sleep, so the wake-up cannot be lost.
+    // It is never held across a send, so this never waits on the network.
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wake.notify_one();
+}
+
+void GestureDestination::enqueue(const Item& item) {
+    if (!running.load(std::memory_order_relaxed) || !queue.push(item)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void GestureDestination::run() {
+    Item item;
+    while (running.load()) {
+        {
+            // The timeout is only a safety net; flush() normally wakes us. If
+            // events are being held it is also when the oldest window closes.
+            std::chrono::microseconds timeout = std::chrono::milliseconds(100);
+            if (!held.empty()) {
+                const uint64_t now = monotonicMicros();
+                const uint64_t due = held.front().deadlineMicros;
+                timeout = std::min(timeout, std::chrono::microseconds(due > now ? due - now : 0));
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, timeout, [this]() { return queue.size() > 0 || !running.load(); });
+        }
+
+        while (queue.pop(item)) {
+            switch (item.kind) {
+            case Item::Kind::Stats:
+                sender.send(item.stats);
+                break;
+            case Item::Kind::Flush:
+                releaseHeld(monotonicMicros());
+                sender.flush();
+                break;
+            case Item::Kind::AdoptOnset:
+                rememberOnset(item.voice);
+                break;
+            default:
+                offer(item, monotonicMicros());
+                break;
+            }
+        }
+        // Windows that closed between batches go out in a bundle of their own.
+        // Flushing after every drain also covers a batch we woke for on the
+        // timeout before its Flush marker was queued: without it those events
+        // would sit in the bundle until some later batch. (An empty bundle
+        // sends nothing.)
+        releaseHeld(monotonicMicros());
+        sender.flush();
+        datagramsSent.store(sender.getDatagramsSent(), std::memory_order_relaxed);
+    }
+    releaseHeld(std::numeric_limits<uint64_t>::max());
+    sender.flush();
+}
+
+void GestureDestination::offer(const Item& item, uint64_t nowMicros) {
+    const uint64_t windowMs = settings.governor.mergeWindowMs;
+    if (windowMs == 0 || item.kind == Item::Kind::Global || (item.kind == Item::Kind::Voice && isOnset(item.voice))) {
+        deliver(item, nowMicros);
+        return;
+    }
+    // A handful of events are in flight at once, so a linear scan beats
+    // anything cleverer.
+    for (HeldItem& waiting : held) {
+        if (sameKey(waiting.item, item)) {
+            if (strengthOf(item) > strengthOf(waiting.item)) {
+                waiting.item = item;
+            }
+            governor.noteMerged();
+            return;
+        }
+    }
+    HeldItem waiting;
+    waiting.item = item;
+    waiting.deadlineMicros = nowMicros + windowMs * 1000;
+    held.push_back(waiting);
+}
+
+void GestureDestination::deliver(const Item& item, uint64_t nowMicros) {
+    // A begin that got out has to be resolved, so its confirm or cancel
+    // never waits for a token; one whose begin was refused has nothing to
+    // resolve and is dropped with it.
+    if (item.kind == Item::Kind::Voice && isOnset(item.voice) && item.voice.phase != VoiceGesturePhase::Begin) {
+        auto open = std::find_if(openOnsets.begin(), openOnsets.end(), [&item](const OpenOnset& onset) {
+            return onset.voiceId == item.voice.voiceId && onset.type == item.voice.type;
+        });
+        if (open == openOnsets.end()) {
+            return;
+        }
+        openOnsets.erase(open);
+    } else if (!governor.admit(familyOf(item), nowMicros)) {
+        return;
+    } else if (item.kind == Item::Kind::Voice && item.voice.phase == VoiceGesturePhase::Begin) {
+        rememberOnset(item.voice);
+    }
+    switch (item.kind) {
+    case Item::Kind::Voice:
+        sender.send(item.voice);
+        break;
+    case Item::Kind::Zone:
+        sender.send(item.zone);
+        break;
+    case Item::Kind::Global:
+        sender.send(item.global);
+        break;
+    case Item::Kind::Ensemble:
+        sender.send(item.ensemble);
+        break;
+    case Item::Kind::Stats:
+    case Item::Kind::Flush:
+    case Item::Kind::AdoptOnset:
+        break;
+    }
+}
+
+void GestureDestination::rememberOnset(const VoiceGestureEvent& begin) {
+    const bool known = std::any_of(openOnsets.begin(), openOnsets.end(), [&begin](const OpenOnset& onset) {
+        return onset.voiceId == begin.voiceId && onset.type == begin.type;
+    });
+    if (!known) {
+        OpenOnset onset;
+        onset.voiceId = begin.voiceId;
+        onset.type = begin.type;
+        openOnsets.push_back(onset);
+    }
+}
+
+bool GestureDestination::releaseHeld(uint64_t nowMicros) {
+    // Deadlines rise with arrival order, so the due ones are a prefix.
+    std::size_t due = 0;
+    while (due < held.size() && held[due].deadlineMicros <= nowMicros) {
+        deliver(held[due].item, nowMicros);
+        ++due;
+    }
+    held.erase(held.begin(), held.begin() + static_cast<std::ptrdiff_t>(due));
+    return due > 0;
+}
+
+OutputGovernor::Family GestureDestination::familyOf(const Item& item) {
+    switch (item.kind) {
+    case Item::Kind::Zone:
+        return OutputGovernor::Family::Zone;
+    case Item::Kind::Global:
+        return OutputGovernor::Family::Global;
+    case Item::Kind::Ensemble:
+        return OutputGovernor::Family::Ensemble;
+    default:
+        return OutputGovernor::Family::Voice;
+    }
+}
+
+bool GestureDestination::sameKey(const Item& a, const Item& b) {
+    if (a.kind != b.kind) {
+        return false;
+    }
+    switch (a.kind) {
+    case Item::Kind::Voice:
+        return a.voice.voiceId == b.voice.voiceId && a.voice.type == b.voice.type && a.voice.phase == b.voice.phase;
+    case Item::Kind::Zone:
+        // A wall of pulses from one camera becomes its strongest cell.
+        return a.zone.camId == b.zone.camId && a.zone.type == b.zone.type && a.zone.lane == b.zone.lane;
+    case Item::Kind::Ensemble:
+        return a.ensemble.type == b.ensemble.type && a.ensemble.voiceType == b.ensemble.voiceType;
+    default:
+        return false;
+    }
+}
+
+float GestureDestination::strengthOf(const Item& item) {
+    switch (item.kind) {
+    case Item::Kind::Voice:
+        return item.voice.strength;
+    case Item::Kind::Zone:
+        return item.zone.strength;
+    case Item::Kind::Global:
+        return item.global.strength;
+    case Item::Kind::Ensemble:
+        return item.ensemble.strength;
+    default:
+        return 0.0f;
+    }
+}
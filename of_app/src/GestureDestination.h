@@ -0,0 +1,137 @@
+#pragma once
+
+#include "GestureEvents.h"
+#include "GestureOscSender.h"
+#include "OutputGovernor.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * One place gestures get delivered to – the synth, the dashboard, a
+ * lighting desk. Each destination owns its own queue, send thread and
+ * GestureOscSender, so a laptop that drops off the Wi-Fi or a socket buffer
+ * that fills up can only ever stall its own thread. The detection side just
+ * drops events into the queue (never waiting) and calls flush() at the end of
+ * each batch; if the queue is full the event is counted and discarded.
+ *
+ * On its way out every gesture passes the destination's OutputGovernor (rate
+ * caps per family and overall). With a merge window set, the send thread also
+ * holds each event for that long and folds later ones with the same key into
+ * it – same voice and gesture, same camera and pulse/sweep lane, same ensemble
+ * type – keeping whichever was strongest. Global gestures and predictive
+ * voice onsets (begin/confirm/cancel) are never held. A confirm or cancel is
+ * never throttled when the begin it resolves went out, and is dropped when
+ * that begin was refused, so a listener never hears the end of an onset it
+ * never saw start.
+ */
+class GestureDestination {
+public:
+    /// Which /room/gesture/* families this destination wants.
+    enum Filter : uint8_t {
+        kFilterVoice = 1 << 0,
+        kFilterZone = 1 << 1,
+        kFilterGlobal = 1 << 2,
+        kFilterStats = 1 << 3, ///< /room/host/stats
+        kFilterEnsemble = 1 << 4,
+        kFilterAll = kFilterVoice | kFilterZone | kFilterGlobal | kFilterStats | kFilterEnsemble
+    };
+
+    struct Settings {
+        std::string name = "default";
+        std::string host = "127.0.0.1";
+        int port = 9001;
+        uint8_t filter = kFilterAll;
+        std::size_t queueCapacity = 1024;
+        GestureOscSender::Settings output;
+        OutputGovernor::Settings governor;
+    };
+
+    GestureDestination() = default;
+    ~GestureDestination();
+
+    GestureDestination(const GestureDestination&) = delete;
+    GestureDestination& operator=(const GestureDestination&) = delete;
+
+    /// `latencyStats` (optional) receives emit.* timings from this send thread.
+    bool start(const Settings& settings, LatencyStats* latencyStats = nullptr);
+    void stop();
+
+    void push(const VoiceGestureEvent& event);
+    void push(const ZoneGestureEvent& event);
+    void push(const GlobalGestureEvent& event);
+    void push(const EnsembleGestureEvent& event);
+    void push(const LatencySummary& summary);
+    /**
+     * The begin `resolution` confirms or cancels went out before a restart.
+     * Call just before pushing it, so the send thread lets it through
+     * instead of dropping it as the end of an onset nobody heard start.
+     */
+    void adoptOnset(const VoiceGestureEvent& resolution);
+    /// Mark the end of a batch: the send thread wakes and ships a bundle.
+    void flush();
+
+    const Settings& getSettings() const { return settings; }
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t getDatagramsSent() const { return datagramsSent.load(std::memory_order_relaxed); }
+    /// Refused by the governor's token buckets.
+    uint64_t getThrottledCount() const { return governor.getThrottledCount(); }
+    /// Folded into a stronger event of the same key.
+    uint64_t getMergedCount() const { return governor.getMergedCount(); }
+
+private:
+    /// Queue entry; only the member matching `kind` is meaningful.
+    struct Item {
+        enum class Kind : uint8_t { Voice, Zone, Global, Ensemble, Stats, Flush, AdoptOnset };
+        Kind kind = Kind::Flush;
+        VoiceGestureEvent voice;
+        ZoneGestureEvent zone;
+        GlobalGestureEvent global;
+        EnsembleGestureEvent ensemble;
+        LatencySummary stats;
+    };
+
+    /// A begin that got past the governor and still waits for its confirm or cancel.
+    struct OpenOnset {
+        int voiceId = -1;
+        VoiceGestureType type = VoiceGestureType::Raise;
+    };
+
+    /// An event waiting out its merge window.
+    struct HeldItem {
+        Item item;
+        uint64_t deadlineMicros = 0;
+    };
+
+    void enqueue(const Item& item);
+    void run();
+    void offer(const Item& item, uint64_t nowMicros);
+    void deliver(const Item& item, uint64_t nowMicros);
+    /// Record a begin that went out, once per voice and gesture.
+    void rememberOnset(const VoiceGestureEvent& begin);
+    /// Send every held event whose window has closed by `nowMicros`; true if any went.
+    bool releaseHeld(uint64_t nowMicros);
+
+    static OutputGovernor::Family familyOf(const Item& item);
+    static bool sameKey(const Item& a, const Item& b);
+    static float strengthOf(const Item& item);
+
+    Settings settings;
+    SpscQueue<Item> queue;
+    GestureOscSender sender;  // only ever touched by the send thread after start().
+    OutputGovernor governor;  // likewise, apart from its counters.
+    std::vector<HeldItem> held; // send thread: events inside their merge window, oldest first.
+    std::vector<OpenOnset> openOnsets; // send thread: at most one per voice and gesture.
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> datagramsSent{0};
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+};
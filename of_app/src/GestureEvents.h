@@ -1,31 +1,67 @@
 #pragma once
 
 #include "ofMain.h"
-#include <string>
+
+#include "GestureTypes.h"
 
 /**
  * The detectors all report their findings through these light-weight structs.
  * They are intentionally plain so that both OSC emitters and unit tests can
  * serialize them without needing to pull in half the project. Treat them as
- * postcards from the analysis layer.
+ * postcards from the analysis layer. Types are interned IDs (see
+ * GestureTypes.h); call gestureTypeName() when you need the wire string.
  */
+/// Where a voice gesture stands. Everything is Complete unless predictive onset is on.
+enum class VoiceGesturePhase : uint8_t {
+    Complete, ///< The full rule fired: /room/gesture/voice.
+    Begin,    ///< A trajectory is on course for the rule: /room/gesture/voice/begin.
+    Confirm,  ///< ...and the rule then fired: /room/gesture/voice/confirm.
+    Cancel,   ///< ...or it never did: /room/gesture/voice/cancel.
+};
+
 struct VoiceGestureEvent {
     int voiceId = -1;          ///< Which performer triggered the gesture.
-    std::string type;          ///< raise / lower / swipe_* / shake / burst / hold
-    float strength = 0.0f;     ///< Normalized 0-1 intensity for musical mapping.
-    float extra = 0.0f;        ///< Optional payload (e.g., hold duration fraction).
+    VoiceGestureType type = VoiceGestureType::Raise; ///< raise / lower / swipe_* / shake / burst / hold
+    VoiceGesturePhase phase = VoiceGesturePhase::Complete;
+    float strength = 0.0f;     ///< Normalized 0-1 intensity for musical mapping (Begin: confidence).
+    float extra = 0.0f;        ///< Optional payload (e.g., hold duration fraction; Confirm/Cancel: seconds since Begin).
+    uint64_t sourceMicros = 0; ///< Arrival (monotonicMicros) of the packet behind it; 0 = unknown.
 };
 
 struct ZoneGestureEvent {
     int camId = -1;            ///< Camera that observed the crowd motion.
-    std::string type;          ///< sweep_lr_top / sweep_tb_left / pulse / ...
+    ZoneGestureType type = ZoneGestureType::PulseZone; ///< sweep direction or pulse.
+    int lane = -1;             ///< Row (lr/rl) or column (tb/bt) a sweep travelled along.
+    int laneCount = kZoneSweepLanes; ///< Rows (lr/rl) or columns (tb/bt) in that camera's grid.
     float strength = 0.0f;     ///< How confidently the detector felt about it.
-    int zoneIndex = -1;        ///< Optional index into the 4x4 grid.
+    int zoneIndex = -1;        ///< Optional row-major index into the camera grid.
     bool hasZoneIndex = false; ///< Flag so receivers can branch without magic numbers.
+    uint64_t sourceMicros = 0; ///< Arrival of the zone packet behind it; 0 = unknown.
 };
 
 struct GlobalGestureEvent {
-    std::string type;          ///< eruption / stillness / custom future additions.
+    GlobalGestureType type = GlobalGestureType::Eruption; ///< eruption / stillness / custom future additions.
     float strength = 0.0f;     ///< Usually tied to crowd intensity or quietness.
+    uint64_t sourceMicros = 0; ///< Arrival of the latest global motion packet; 0 = unknown.
 };
 
+struct EnsembleGestureEvent {
+    EnsembleGestureType type = EnsembleGestureType::Cluster; ///< sync / cluster / ring.
+    VoiceGestureType voiceType = VoiceGestureType::Raise;    ///< What the group did together (sync only).
+    float strength = 0.0f;     ///< 0-1: how tight / how unanimous the group was.
+    int voiceCount = 0;        ///< Voices taking part.
+    float x = 0.0f;            ///< Floor-plane centroid of the group (voice x).
+    float z = 0.0f;            ///< ...and depth (voice z).
+    float radius = 0.0f;       ///< Mean distance of the members from that centroid.
+    uint64_t sourceMicros = 0; ///< Arrival of the newest voice packet behind it; 0 = unknown.
+};
+
+/// Wire name for a zone event, e.g. "sweep_lr_top" or "pulse_zone".
+inline const char* gestureTypeName(const ZoneGestureEvent& event) {
+    return gestureTypeName(event.type, event.lane, event.laneCount);
+}
+
+/// Wire name for an ensemble event, e.g. "sync_raise" or "ring".
+inline const char* gestureTypeName(const EnsembleGestureEvent& event) {
+    return gestureTypeName(event.type, event.voiceType);
+}
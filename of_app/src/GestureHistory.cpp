@@ -2,66 +2,192 @@
 
 #include <algorithm>
 
+GestureHistory::Sample GestureHistory::View::operator[](std::size_t i) const {
+    Sample sample;
+    sample.timestampMicros = timestampLane[i];
+    sample.position = glm::vec3(lanes[kLaneX][i], lanes[kLaneY][i], lanes[kLaneZ][i]);
+    sample.velocity = glm::vec3(lanes[kLaneVX][i], lanes[kLaneVY][i], lanes[kLaneVZ][i]);
+    sample.motion = lanes[kLaneMotion][i];
+    sample.energy = lanes[kLaneEnergy][i];
+    return sample;
+}
+
+void GestureHistory::Ring::allocate(std::size_t capacityFrames) {
+    lanes.assign(kLaneCount * 2 * capacityFrames, 0.0f);
+    timestamps.assign(2 * capacityFrames, 0);
+    head = 0;
+    count = 0;
+    written = 0;
+}
+
+void GestureHistory::Ring::writeRow(std::size_t row, const float* values, uint64_t timestampMicros, std::size_t capacityFrames) {
+    // Mirror every row `capacity` slots ahead so [head, head + count) is
+    // always contiguous no matter where the ring has wrapped to.
+    const std::size_t mirror = row + capacityFrames;
+    for (int laneIndex = 0; laneIndex < kLaneCount; ++laneIndex) {
+        float* laneData = lane(laneIndex, capacityFrames);
+        laneData[row] = values[laneIndex];
+        laneData[mirror] = values[laneIndex];
+    }
+    timestamps[row] = timestampMicros;
+    timestamps[mirror] = timestampMicros;
+}
+
 void GestureHistory::setCapacity(std::size_t capacityFrames) {
     // Keep at least one frame so consumers never divide by zero, even if
     // somebody sets capacityFrames to 0 in a rogue config experiment.
-    capacity = std::max<std::size_t>(1, capacityFrames);
-
-    // Trim any existing buffers that are now oversized. This keeps the history
-    // immediately in sync when we tweak settings from the UI or config file.
-    for (auto& kv : histories) {
-        auto& history = kv.second;
-        while (history.size() > capacity) {
-            history.pop_front();
+    std::size_t newCapacity = std::max<std::size_t>(1, capacityFrames);
+    if (newCapacity == capacity) {
+        return;
+    }
+
+    // Re-lay every ring at the new size, keeping the newest samples so the
+    // history stays in sync when we tweak settings from the UI or config file.
+    for (auto& ring : rings) {
+        Ring resized;
+        resized.allocate(newCapacity);
+        std::size_t keep = std::min(ring.count, newCapacity);
+        std::size_t first = ring.head + ring.count - keep;
+        float row[kLaneCount];
+        for (std::size_t i = 0; i < keep; ++i) {
+            for (int laneIndex = 0; laneIndex < kLaneCount; ++laneIndex) {
+                row[laneIndex] = ring.lane(laneIndex, capacity)[first + i];
+            }
+            resized.writeRow(i, row, ring.timestamps[first + i], newCapacity);
         }
+        resized.count = keep;
+        resized.written = ring.written;
+        ring = std::move(resized);
     }
+    capacity = newCapacity;
 }
 
-void GestureHistory::addSample(int voiceId, const glm::vec3& position, float motion, float energy, uint64_t timestampMs) {
-    auto& history = histories[voiceId];
+void GestureHistory::addSample(int voiceId, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros) {
+    addSample(acquireRing(voiceId), position, motion, energy, timestampMicros);
+}
 
+void GestureHistory::addSample(Handle handle, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros) {
+    addSample(rings[handle.ring], position, motion, energy, timestampMicros);
+}
+
+void GestureHistory::addSample(Ring& ring, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros) {
     // Velocity is the most error-prone thing for students to recompute, so we
-    // derive it once here. The timestamps come in milliseconds, so we convert to
-    // seconds before dividing to avoid cartoonishly large speeds.
+    // derive it once here. The timestamps come in microseconds, so we convert
+    // to seconds before dividing to avoid cartoonishly large speeds.
+    // A packet that overtook its predecessor on the network is filed at the
+    // previous row's time, so readers can count on time never going backwards.
     glm::vec3 velocity(0.0f);
-    if (!history.empty()) {
-        const auto& prev = history.back();
-        float dt = static_cast<float>(timestampMs > prev.timestamp ? timestampMs - prev.timestamp : 0) / 1000.0f;
+    if (ring.count > 0) {
+        std::size_t last = ring.head + ring.count - 1;
+        uint64_t prevTimestamp = ring.timestamps[last];
+        timestampMicros = std::max(timestampMicros, prevTimestamp);
+        float dt = static_cast<float>(timestampMicros - prevTimestamp) / 1000000.0f;
         if (dt > 0.0f) {
-            velocity = (position - prev.position) / dt;
+            glm::vec3 prevPosition(ring.lane(kLaneX, capacity)[last], ring.lane(kLaneY, capacity)[last], ring.lane(kLaneZ, capacity)[last]);
+            velocity = (position - prevPosition) / dt;
         }
     }
 
-    GestureHistory::Sample sample;
-    sample.timestamp = timestampMs;
-    sample.position = position;
-    sample.velocity = velocity;
-    sample.motion = motion;
-    sample.energy = energy;
+    const float row[kLaneCount] = {position.x, position.y, position.z, velocity.x, velocity.y, velocity.z, motion, energy};
+    pushRow(ring, row, timestampMicros);
+}
 
-    history.push_back(sample);
+void GestureHistory::restoreSample(Handle handle, const Sample& sample) {
+    Ring& ring = rings[handle.ring];
+    uint64_t timestampMicros = sample.timestampMicros;
+    if (ring.count > 0) {
+        timestampMicros = std::max(timestampMicros, ring.timestamps[ring.head + ring.count - 1]);
+    }
+    const float row[kLaneCount] = {sample.position.x, sample.position.y, sample.position.z, sample.velocity.x,
+                                   sample.velocity.y, sample.velocity.z, sample.motion, sample.energy};
+    pushRow(ring, row, timestampMicros);
+}
 
-    // Clamp the buffer so it never grows without bound during long sets.
-    while (history.size() > capacity) {
-        history.pop_front();
+void GestureHistory::pushRow(Ring& ring, const float* row, uint64_t timestampMicros) {
+    // Clamp the ring so it never grows during long sets: once full, the oldest
+    // slot is simply overwritten and the window slides forward by one.
+    if (ring.count == capacity) {
+        ring.writeRow(ring.head, row, timestampMicros, capacity);
+        ring.head = (ring.head + 1) % capacity;
+    } else {
+        ring.writeRow((ring.head + ring.count) % capacity, row, timestampMicros, capacity);
+        ++ring.count;
     }
+    ++ring.written;
 }
 
 void GestureHistory::removeVoice(int voiceId) {
     // Forget voices the moment tracking says they are gone. The detectors rely
-    // on this to reset cooldowns the next time a dancer re-enters.
-    histories.erase(voiceId);
+    // on this to reset cooldowns the next time a dancer re-enters. The ring
+    // itself is parked for the next newcomer rather than freed.
+    auto it = slots.find(voiceId);
+    if (it == slots.end()) {
+        return;
+    }
+    Handle handle;
+    handle.ring = static_cast<uint32_t>(it->second);
+    release(handle);
+    slots.erase(it);
+}
+
+GestureHistory::View GestureHistory::getHistory(int voiceId) const {
+    auto it = slots.find(voiceId);
+    return it == slots.end() ? View() : viewOf(rings[it->second]);
 }
 
-const std::deque<GestureHistory::Sample>* GestureHistory::getHistory(int voiceId) const {
-    auto it = histories.find(voiceId);
-    if (it == histories.end()) {
-        return nullptr;
+GestureHistory::View GestureHistory::getHistory(Handle handle) const {
+    return handle.valid() ? viewOf(rings[handle.ring]) : View();
+}
+
+GestureHistory::View GestureHistory::viewOf(const Ring& ring) const {
+    View view;
+    view.count = ring.count;
+    view.ringCapacity = capacity;
+    view.sequence = ring.written - ring.count;
+    view.timestampLane = ring.timestamps.data() + ring.head;
+    for (int laneIndex = 0; laneIndex < kLaneCount; ++laneIndex) {
+        view.lanes[laneIndex] = ring.lane(laneIndex, capacity) + ring.head;
     }
-    return &it->second;
+    return view;
 }
 
 bool GestureHistory::hasVoice(int voiceId) const {
-    return histories.find(voiceId) != histories.end();
+    return slots.find(voiceId) != slots.end();
+}
+
+GestureHistory::Ring& GestureHistory::acquireRing(int voiceId) {
+    auto it = slots.find(voiceId);
+    if (it != slots.end()) {
+        return rings[it->second];
+    }
+    Handle handle = acquire();
+    slots.emplace(voiceId, handle.ring);
+    return rings[handle.ring];
 }
 
+GestureHistory::Handle GestureHistory::acquire() {
+    // New voice: recycle a parked ring if we have one, otherwise grow the pool.
+    Handle handle;
+    if (!freeRings.empty()) {
+        handle.ring = static_cast<uint32_t>(freeRings.back());
+        freeRings.pop_back();
+    } else {
+        handle.ring = static_cast<uint32_t>(rings.size());
+        rings.emplace_back();
+        rings.back().allocate(capacity);
+        // Room to park every ring we own, so a release never allocates.
+        freeRings.reserve(rings.capacity());
+    }
+    return handle;
+}
+
+void GestureHistory::release(Handle handle) {
+    if (!handle.valid()) {
+        return;
+    }
+    Ring& ring = rings[handle.ring];
+    ring.head = 0;
+    ring.count = 0;
+    ring.written = 0;
+    freeRings.push_back(handle.ring);
+}
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "ofMain.h"
-#include <deque>
 #include <unordered_map>
+#include <vector>
 
 /**
  * GestureHistory is the lowest-level diary we keep for each tracked voice.
@@ -12,27 +12,83 @@
  * the system focused on reading history instead of worrying about how to
  * archive it. The API is intentionally tiny so students can read it in one
  * sip and then trace how the detectors consume the data.
+ *
+ * Under the hood every voice owns a fixed-size ring laid out as a structure
+ * of arrays: one contiguous lane per field (x, y, z, vx, vy, vz, motion,
+ * energy, timestamp). Each sample is written twice, `capacity` slots apart,
+ * so the live window is always one unbroken run in every lane and readers can
+ * walk it with plain pointer arithmetic. Rings are recycled when voices leave,
+ * so once the room has warmed up a new frame never touches the allocator.
  */
 class GestureHistory {
+    enum Lane { kLaneX, kLaneY, kLaneZ, kLaneVX, kLaneVY, kLaneVZ, kLaneMotion, kLaneEnergy, kLaneCount };
+
 public:
     /**
      * A single sample that mirrors one frame coming off of the host. We log
      * the timestamp alongside position, derived velocity, and the raw
      * motion/energy feeds. Velocity is cached here so the detectors do not
-     * have to recompute finite differences every frame.
+     * have to recompute finite differences every frame. Storage is SoA; this
+     * struct is just the friendly, assembled view of one row.
      */
     struct Sample {
-        uint64_t timestamp = 0; // milliseconds since boot
+        uint64_t timestampMicros = 0; // host monotonic clock
         glm::vec3 position = glm::vec3(0.0f);
         glm::vec3 velocity = glm::vec3(0.0f);
         float motion = 0.0f;
         float energy = 0.0f;
     };
 
+    /**
+     * Read-only, span-style window over one voice's ring, oldest sample first.
+     * Each lane pointer addresses `size()` contiguous values, so detectors can
+     * run tight loops over just the fields they care about. A view stays valid
+     * until the next addSample/removeVoice/setCapacity call for that voice.
+     */
+    class View {
+    public:
+        View() = default;
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        /// Ring capacity the view was cut from; an upper bound on size().
+        std::size_t capacity() const { return ringCapacity; }
+        /**
+         * Running sample number of element 0. Every addSample for a voice bumps
+         * the counter by one, so incremental consumers can tell which rows are
+         * new since they last looked. Restarts at 0 when the voice is removed.
+         */
+        uint64_t firstSequence() const { return sequence; }
+
+        /// Sample times in microseconds, on the monotonicMicros() timeline.
+        const uint64_t* timestampsMicros() const { return timestampLane; }
+        const float* x() const { return lanes[kLaneX]; }
+        const float* y() const { return lanes[kLaneY]; }
+        const float* z() const { return lanes[kLaneZ]; }
+        const float* vx() const { return lanes[kLaneVX]; }
+        const float* vy() const { return lanes[kLaneVY]; }
+        const float* vz() const { return lanes[kLaneVZ]; }
+        const float* motion() const { return lanes[kLaneMotion]; }
+        const float* energy() const { return lanes[kLaneEnergy]; }
+
+        /// Assemble one row back into a Sample for code that prefers AoS.
+        Sample operator[](std::size_t i) const;
+        Sample back() const { return (*this)[count - 1]; }
+
+    private:
+        friend class GestureHistory;
+        const uint64_t* timestampLane = nullptr;
+        const float* lanes[kLaneCount] = {};
+        std::size_t count = 0;
+        std::size_t ringCapacity = 0;
+        uint64_t sequence = 0;
+    };
+
     /**
      * Adjust the number of frames we keep per voice. Detectors only peek at a
-     * sliding window, so capping the deque keeps memory predictable while still
-     * letting us experiment with different gesture horizons.
+     * sliding window, so capping each ring keeps memory predictable while still
+     * letting us experiment with different gesture horizons. Resizing is the
+     * one operation that reallocates, so do it at setup rather than mid-show.
      */
     void setCapacity(std::size_t capacityFrames);
     std::size_t getCapacity() const { return capacity; }
@@ -40,21 +96,64 @@ public:
     /**
      * Push a fresh sample for a voice. The history doubles as a rolling
      * velocity calculator, so we derive the delta from the previous sample
-     * before stashing the new one.
+     * before stashing the new one. Timestamps are microseconds: two samples
+     * that arrive within the same millisecond still get a real velocity.
      */
-    void addSample(int voiceId, const glm::vec3& position, float motion, float energy, uint64_t timestampMs);
+    void addSample(int voiceId, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros);
 
-    /// Drop a voice when it disappears from tracking so we do not leak memory.
+    /// Drop a voice when it disappears from tracking; its ring goes back to the pool.
     void removeVoice(int voiceId);
 
-    /// Expose the stored deque for read-only gesture analysis.
-    const std::deque<Sample>* getHistory(int voiceId) const;
+    /// Expose the stored samples for read-only gesture analysis (empty if unknown).
+    View getHistory(int voiceId) const;
     bool hasVoice(int voiceId) const;
 
+    /**
+     * Callers that already keep their own per-voice record (the host's voice
+     * slot table) can skip the id lookup entirely: acquire a ring once when a
+     * voice appears, keep the handle next to the rest of that voice's state,
+     * and hand it back when the voice leaves. Handles and voice ids are two
+     * separate worlds; don't mix them for the same voice.
+     */
+    struct Handle {
+        uint32_t ring = ~uint32_t(0);
+        bool valid() const { return ring != ~uint32_t(0); }
+    };
+
+    Handle acquire();
+    void release(Handle handle);
+    void addSample(Handle handle, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros);
+    View getHistory(Handle handle) const;
+    /**
+     * Put a row back exactly as it was, stored velocity included, instead of
+     * deriving it again (snapshot restore). Rows must still come oldest first.
+     */
+    void restoreSample(Handle handle, const Sample& sample);
+
 private:
-    /// One deque per voice id. We lean on STL to handle all the bookkeeping.
-    std::unordered_map<int, std::deque<Sample>> histories;
+    /// One voice worth of mirrored SoA storage.
+    struct Ring {
+        std::vector<float> lanes;          // kLaneCount lanes of 2 * capacity floats each.
+        std::vector<uint64_t> timestamps;  // 2 * capacity entries.
+        std::size_t head = 0;              // index of the oldest sample, always < capacity.
+        std::size_t count = 0;
+        uint64_t written = 0;              // samples ever pushed since the voice appeared.
+
+        void allocate(std::size_t capacityFrames);
+        void writeRow(std::size_t row, const float* values, uint64_t timestampMicros, std::size_t capacityFrames);
+        float* lane(int laneIndex, std::size_t capacityFrames) { return lanes.data() + laneIndex * 2 * capacityFrames; }
+        const float* lane(int laneIndex, std::size_t capacityFrames) const { return lanes.data() + laneIndex * 2 * capacityFrames; }
+    };
+
+    Ring& acquireRing(int voiceId);
+    void addSample(Ring& ring, const glm::vec3& position, float motion, float energy, uint64_t timestampMicros);
+    void pushRow(Ring& ring, const float* row, uint64_t timestampMicros);
+    View viewOf(const Ring& ring) const;
+
+    /// Voice id -> index into rings. Only touched when voices join or leave.
+    std::unordered_map<int, std::size_t> slots;
+    std::vector<Ring> rings;
+    std::vector<std::size_t> freeRings;
     /// Default buffer length: 45 frames ≈ 0.75 seconds at 60 FPS.
     std::size_t capacity = 45;
 };
-
@@ -0,0 +1,193 @@
+#include "GestureOscSender.h"
+
+#include "ofLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+
+namespace {
+const char* kVoiceAddress = "/room/gesture/voice";
+const char* kVoiceBeginAddress = "/room/gesture/voice/begin";
+const char* kVoiceConfirmAddress = "/room/gesture/voice/confirm";
+const char* kVoiceCancelAddress = "/room/gesture/voice/cancel";
+const char* kZoneAddress = "/room/gesture/zone";
+const char* kGlobalAddress = "/room/gesture/global";
+const char* kEnsembleAddress = "/room/gesture/ensemble";
+const char* kStatsAddress = "/room/host/stats";
+
+// Each bundle element is prefixed with its int32 size.
+constexpr std::size_t kBundleElementPrefixBytes = 4;
+// Enough for the biggest single message even if someone configures a tiny MTU.
+constexpr std::size_t kMinBufferBytes = 256;
+
+std::size_t paddedStringBytes(const char* text) {
+    return (std::strlen(text) + 1 + 3) & ~std::size_t(3);
+}
+
+/**
+ * Exact encoded size of a message whose arguments are all 32-bit numbers
+ * except for at most one string. Counting up front lets us decide to flush
+ * before oscpack would throw halfway through writing a message.
+ */
+std::size_t messageBytes(const char* address, const char* typeTags, const char* stringArg) {
+    std::size_t tagCount = std::strlen(typeTags);
+    std::size_t bytes = paddedStringBytes(address) + ((tagCount + 2 + 3) & ~std::size_t(3));
+    for (std::size_t i = 0; i < tagCount; ++i) {
+        bytes += (typeTags[i] == 's') ? paddedStringBytes(stringArg) : 4;
+    }
+    return bytes;
+}
+
+/// Wall-clock "now" as an NTP time tag, which is what OSC bundles carry.
+uint64_t ntpNow() {
+    using namespace std::chrono;
+    const uint64_t kUnixToNtpSeconds = 2208988800ull;
+    auto sinceEpoch = system_clock::now().time_since_epoch();
+    uint64_t seconds = static_cast<uint64_t>(duration_cast<std::chrono::seconds>(sinceEpoch).count());
+    uint64_t nanos = static_cast<uint64_t>(duration_cast<nanoseconds>(sinceEpoch).count()) % 1000000000ull;
+    uint64_t fraction = (nanos << 32) / 1000000000ull;
+    return ((seconds + kUnixToNtpSeconds) << 32) | fraction;
+}
+} // namespace
+
+bool GestureOscSender::setup(const std::string& host, int port, const Settings& newSettings) {
+    settings = newSettings;
+    settings.maxBundleEvents = std::max<std::size_t>(1, settings.maxBundleEvents);
+    buffer.assign(std::max(settings.mtu, kMinBufferBytes), 0);
+    stream.reset(new osc::OutboundPacketStream(buffer.data(), buffer.size()));
+    pendingEvents = 0;
+    pendingLatency.clear();
+    pendingLatency.reserve(settings.bundle ? settings.maxBundleEvents : 1);
+
+    try {
+        socket.reset(new UdpTransmitSocket(IpEndpointName(host.c_str(), port)));
+    } catch (const std::exception& e) {
+        ofLogError("GestureOscSender") << "could not open " << host << ":" << port << ": " << e.what();
+        socket.reset();
+        return false;
+    }
+    return true;
+}
+
+void GestureOscSender::send(const VoiceGestureEvent& event) {
+    const char* type = gestureTypeName(event.type);
+    const char* address = kVoiceAddress;
+    switch (event.phase) {
+    case VoiceGesturePhase::Begin:
+        address = kVoiceBeginAddress;
+        break;
+    case VoiceGesturePhase::Confirm:
+        address = kVoiceConfirmAddress;
+        break;
+    case VoiceGesturePhase::Cancel:
+        address = kVoiceCancelAddress;
+        break;
+    case VoiceGesturePhase::Complete:
+        break;
+    }
+    beginEvent(messageBytes(address, "isff", type));
+    *stream << osc::BeginMessage(address) << static_cast<osc::int32>(event.voiceId) << type << event.strength
+            << event.extra << osc::EndMessage;
+    trackLatency(LatencyStream::EmitVoice, event.sourceMicros);
+    endEvent();
+}
+
+void GestureOscSender::send(const ZoneGestureEvent& event) {
+    const char* type = gestureTypeName(event);
+    beginEvent(messageBytes(kZoneAddress, event.hasZoneIndex ? "isfi" : "isf", type));
+    *stream << osc::BeginMessage(kZoneAddress) << static_cast<osc::int32>(event.camId) << type << event.strength;
+    if (event.hasZoneIndex) {
+        *stream << static_cast<osc::int32>(event.zoneIndex);
+    }
+    *stream << osc::EndMessage;
+    trackLatency(LatencyStream::EmitZone, event.sourceMicros);
+    endEvent();
+}
+
+void GestureOscSender::send(const GlobalGestureEvent& event) {
+    const char* type = gestureTypeName(event.type);
+    beginEvent(messageBytes(kGlobalAddress, "sf", type));
+    *stream << osc::BeginMessage(kGlobalAddress) << type << event.strength << osc::EndMessage;
+    trackLatency(LatencyStream::EmitGlobal, event.sourceMicros);
+    endEvent();
+}
+
+void GestureOscSender::send(const EnsembleGestureEvent& event) {
+    const char* type = gestureTypeName(event);
+    beginEvent(messageBytes(kEnsembleAddress, "sfifff", type));
+    *stream << osc::BeginMessage(kEnsembleAddress) << type << event.strength << static_cast<osc::int32>(event.voiceCount)
+            << event.x << event.z << event.radius << osc::EndMessage;
+    trackLatency(LatencyStream::EmitEnsemble, event.sourceMicros);
+    endEvent();
+}
+
+void GestureOscSender::send(const LatencySummary& summary) {
+    beginEvent(messageBytes(kStatsAddress, "sifff", summary.name));
+    *stream << osc::BeginMessage(kStatsAddress) << summary.name << static_cast<osc::int32>(summary.count) << summary.p50Ms
+            << summary.p99Ms << summary.maxMs << osc::EndMessage;
+    endEvent();
+}
+
+void GestureOscSender::flush() {
+    if (!settings.bundle || pendingEvents == 0) {
+        return;
+    }
+    *stream << osc::EndBundle;
+    sendDatagram();
+}
+
+void GestureOscSender::beginEvent(std::size_t bytes) {
+    if (!settings.bundle) {
+        stream->Clear();
+        return;
+    }
+    // Would this message spill past the MTU or the event cap? Ship what we
+    // have first so every datagram stays a single, unfragmented packet.
+    if (pendingEvents > 0
+        && (pendingEvents >= settings.maxBundleEvents || stream->Size() + kBundleElementPrefixBytes + bytes > buffer.size())) {
+        flush();
+    }
+    if (pendingEvents == 0) {
+        stream->Clear();
+        *stream << osc::BeginBundle(ntpNow());
+    }
+}
+
+void GestureOscSender::endEvent() {
+    ++eventsSent;
+    if (!settings.bundle) {
+        sendDatagram();
+        return;
+    }
+    ++pendingEvents;
+}
+
+void GestureOscSender::trackLatency(LatencyStream stream, uint64_t sourceMicros) {
+    if (latencyStats && sourceMicros != 0) {
+        pendingLatency.push_back(PendingLatency{stream, sourceMicros});
+    }
+}
+
+void GestureOscSender::sendDatagram() {
+    if (socket) {
+        try {
+            socket->Send(stream->Data(), stream->Size());
+            ++datagramsSent;
+            if (!pendingLatency.empty()) {
+                uint64_t now = monotonicMicros();
+                for (const auto& pending : pendingLatency) {
+                    latencyStats->record(pending.stream, now > pending.sourceMicros ? now - pending.sourceMicros : 0);
+                }
+            }
+        } catch (const std::exception& e) {
+            // UDP sends only fail on local trouble (no route, buffer full);
+            // losing one gesture beats taking down the detection thread.
+            ofLogWarning("GestureOscSender") << "send failed: " << e.what();
+        }
+    }
+    stream->Clear();
+    pendingEvents = 0;
+    pendingLatency.clear();
+}
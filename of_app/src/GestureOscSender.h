@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GestureEvents.h"
+#include "LatencyStats.h"
+
+#include "OscOutboundPacketStream.h"
+#include "UdpSocket.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * GestureOscSender turns gesture events into OSC datagrams without building
+ * an ofxOscMessage per event. Everything is serialized straight into one
+ * preallocated buffer sized to the link MTU.
+ *
+ * In the default mode each event goes out as its own message, exactly like
+ * before. In bundled mode events accumulate into a single timestamped OSC
+ * bundle until flush() is called (once per update() or ingest batch), or until
+ * the next event would push the bundle past the MTU or the event cap – then
+ * the full bundle is sent and a fresh one starts. A crowd eruption that used
+ * to cost dozens of datagrams now costs one or two.
+ */
+class GestureOscSender {
+public:
+    struct Settings {
+        bool bundle = false;             ///< Batch events into one bundle per flush().
+        std::size_t maxBundleEvents = 64; ///< Start a new bundle after this many messages.
+        std::size_t mtu = 1472;          ///< Max datagram bytes (1500 Ethernet - IP/UDP headers).
+    };
+
+    GestureOscSender() = default;
+
+    bool setup(const std::string& host, int port, const Settings& settings);
+    bool isReady() const { return socket != nullptr; }
+
+    /**
+     * Record packet-to-socket latency for every event that carries a
+     * sourceMicros stamp, measured when its datagram actually leaves (so
+     * bundled events include the time they waited for the flush). Pass
+     * nullptr – the default – to skip the clock reads entirely.
+     */
+    void setLatencyStats(LatencyStats* stats) { latencyStats = stats; }
+
+    void send(const VoiceGestureEvent& event);
+    void send(const ZoneGestureEvent& event);
+    void send(const GlobalGestureEvent& event);
+    void send(const EnsembleGestureEvent& event);
+    void send(const LatencySummary& summary);
+
+    /// Ship whatever the current bundle holds. A no-op in unbundled mode.
+    void flush();
+
+    uint64_t getDatagramsSent() const { return datagramsSent; }
+    uint64_t getEventsSent() const { return eventsSent; }
+
+private:
+    /// Make room for a message of `messageBytes`, flushing the bundle if needed.
+    void beginEvent(std::size_t messageBytes);
+    void endEvent();
+    void sendDatagram();
+    void trackLatency(LatencyStream stream, uint64_t sourceMicros);
+
+    struct PendingLatency {
+        LatencyStream stream;
+        uint64_t sourceMicros;
+    };
+
+    Settings settings;
+    std::vector<char> buffer;
+    std::unique_ptr<osc::OutboundPacketStream> stream;
+    std::unique_ptr<UdpTransmitSocket> socket;
+    LatencyStats* latencyStats = nullptr;
+    std::vector<PendingLatency> pendingLatency; // events in the datagram being built.
+    std::size_t pendingEvents = 0;
+    uint64_t datagramsSent = 0;
+    uint64_t eventsSent = 0;
+};
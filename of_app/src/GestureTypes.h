@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * The gesture vocabulary as compile-time IDs. Detectors and events pass these
+ * small enums around so the per-frame path never hashes or allocates a
+ * string; the human-readable names that go out over OSC are looked up from
+ * the static tables below only at the serialization edge.
+ *
+ * Adding a gesture? Append it before `Count` and add its name to the matching
+ * table – the static_asserts keep the two in lockstep.
+ */
+enum class VoiceGestureType : uint8_t {
+    Raise,
+    Lower,
+    SwipeLeft,
+    SwipeRight,
+    Shake,
+    Burst,
+    Hold,
+    Count
+};
+
+/// Sweeps are direction + lane (row or column); pulses carry a zone index.
+enum class ZoneGestureType : uint8_t {
+    SweepLeftRight,  ///< along a row, lane = row index
+    SweepRightLeft,
+    SweepTopBottom,  ///< along a column, lane = column index
+    SweepBottomTop,
+    PulseZone,
+    Count
+};
+
+enum class GlobalGestureType : uint8_t {
+    Eruption,
+    Stillness,
+    Count
+};
+
+/// Group gestures across neighbouring voices; Sync carries the voice gesture they shared.
+enum class EnsembleGestureType : uint8_t {
+    Sync,     ///< several neighbours fired the same voice gesture together
+    Cluster,  ///< a dense knot of voices formed
+    Ring,     ///< voices stand in a circle around an empty middle
+    Count
+};
+
+constexpr std::size_t kVoiceGestureTypeCount = static_cast<std::size_t>(VoiceGestureType::Count);
+constexpr std::size_t kZoneGestureTypeCount = static_cast<std::size_t>(ZoneGestureType::Count);
+constexpr std::size_t kGlobalGestureTypeCount = static_cast<std::size_t>(GlobalGestureType::Count);
+constexpr std::size_t kEnsembleGestureTypeCount = static_cast<std::size_t>(EnsembleGestureType::Count);
+
+/// Lanes per sweep direction on the classic 4x4 grid, which keeps friendly names.
+constexpr int kZoneSweepLanes = 4;
+/// Largest grid side and cell count a camera may send.
+constexpr int kMaxZoneLanes = 32;
+constexpr int kMaxZoneCells = 256;
+
+namespace gesture_names {
+constexpr const char* kVoice[] = {"raise", "lower", "swipe_left", "swipe_right", "shake", "burst", "hold"};
+constexpr const char* kGlobal[] = {"eruption", "stillness"};
+constexpr const char* kEnsemble[] = {"sync", "cluster", "ring"};
+// Sync names follow the voice table: "sync_" + the shared gesture.
+constexpr const char* kEnsembleSync[] = {"sync_raise", "sync_lower", "sync_swipe_left", "sync_swipe_right",
+                                         "sync_shake", "sync_burst", "sync_hold"};
+
+// Friendly names for composing sweep strings. Keeping them here makes it easy
+// to update copywriting without diving into detector logic.
+constexpr const char* kSweep[4][kZoneSweepLanes] = {
+    {"sweep_lr_top", "sweep_lr_upper_mid", "sweep_lr_lower_mid", "sweep_lr_bottom"},
+    {"sweep_rl_top", "sweep_rl_upper_mid", "sweep_rl_lower_mid", "sweep_rl_bottom"},
+    {"sweep_tb_left", "sweep_tb_mid_left", "sweep_tb_mid_right", "sweep_tb_right"},
+    {"sweep_bt_left", "sweep_bt_mid_left", "sweep_bt_mid_right", "sweep_bt_right"},
+};
+constexpr const char* kPulse = "pulse_zone";
+
+static_assert(sizeof(kVoice) / sizeof(kVoice[0]) == kVoiceGestureTypeCount, "voice gesture name table out of sync");
+static_assert(sizeof(kGlobal) / sizeof(kGlobal[0]) == kGlobalGestureTypeCount, "global gesture name table out of sync");
+static_assert(sizeof(kEnsemble) / sizeof(kEnsemble[0]) == kEnsembleGestureTypeCount, "ensemble gesture name table out of sync");
+static_assert(sizeof(kEnsembleSync) / sizeof(kEnsembleSync[0]) == kVoiceGestureTypeCount, "ensemble sync name table out of sync");
+static_assert(sizeof(kSweep) / sizeof(kSweep[0]) + 1 == kZoneGestureTypeCount, "zone gesture name table out of sync");
+} // namespace gesture_names
+
+inline const char* gestureTypeName(VoiceGestureType type) {
+    return gesture_names::kVoice[static_cast<std::size_t>(type)];
+}
+
+inline const char* gestureTypeName(GlobalGestureType type) {
+    return gesture_names::kGlobal[static_cast<std::size_t>(type)];
+}
+
+/// "sync_raise", "cluster", "ring", ... – `voiceType` only matters for Sync.
+inline const char* gestureTypeName(EnsembleGestureType type, VoiceGestureType voiceType) {
+    if (type == EnsembleGestureType::Sync) {
+        return gesture_names::kEnsembleSync[static_cast<std::size_t>(voiceType)];
+    }
+    return gesture_names::kEnsemble[static_cast<std::size_t>(type)];
+}
+
+namespace gesture_names {
+/**
+ * Grids other than 4 lanes deep get numbered names ("sweep_lr_row5",
+ * "sweep_tb_col12"). They are printed once into a static table the first time
+ * anyone asks, so the send path still only hands out pointers.
+ */
+inline const char* numberedSweep(ZoneGestureType type, int lane) {
+    using Name = std::array<char, 24>;
+    struct Table {
+        Table() {
+            const char* prefixes[4] = {"sweep_lr_row", "sweep_rl_row", "sweep_tb_col", "sweep_bt_col"};
+            for (int direction = 0; direction < 4; ++direction) {
+                for (int index = 0; index < kMaxZoneLanes; ++index) {
+                    std::snprintf(names[direction][index].data(), names[direction][index].size(), "%s%d", prefixes[direction], index);
+                }
+            }
+        }
+        std::array<std::array<Name, kMaxZoneLanes>, 4> names;
+    };
+    static const Table table;
+    return table.names[static_cast<std::size_t>(type)][lane].data();
+}
+} // namespace gesture_names
+
+/**
+ * Sweep names depend on which row/column moved and how many rows/columns the
+ * grid has; 4-lane grids keep the friendly top/mid/bottom names. Pulses
+ * ignore `lane`.
+ */
+inline const char* gestureTypeName(ZoneGestureType type, int lane, int laneCount = kZoneSweepLanes) {
+    if (type == ZoneGestureType::PulseZone) {
+        return gesture_names::kPulse;
+    }
+    if (lane < 0 || lane >= laneCount || lane >= kMaxZoneLanes) {
+        return "sweep_unknown";
+    }
+    if (laneCount == kZoneSweepLanes) {
+        return gesture_names::kSweep[static_cast<std::size_t>(type)][lane];
+    }
+    return gesture_names::numberedSweep(type, lane);
+}
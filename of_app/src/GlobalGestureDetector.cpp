@@ -1,6 +1,6 @@
 #include "GlobalGestureDetector.h"
 
-#include "ofLog.h"
+#include "AsyncLogger.h"
 
 #include <algorithm>
 
@@ -14,58 +14,66 @@ GlobalGestureDetector::GlobalGestureDetector() = default;
 
 void GlobalGestureDetector::setConfig(const Config& newConfig) {
     config = newConfig;
+    // The eruption window may have moved: put everything back in "recent"
+    // and let the next update age samples across the new boundary.
+    previousCount = 0;
+    previousSum = 0.0;
+    recentSum = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        recentSum += historyAt(i).globalMotion;
+    }
 }
 
 void GlobalGestureDetector::update(float globalMotion, int activeVoices, uint64_t timestampMs, std::vector<GlobalGestureEvent>& outEvents) {
+    if (count > 0 && timestampMs < historyAt(count - 1).timestamp) {
+        // The clock went backwards (a replay restarted, say); the windows
+        // only make sense in time order, so start them over.
+        clearHistory();
+    }
+
     Sample sample;
     sample.timestamp = timestampMs;
     sample.globalMotion = globalMotion;
     sample.activeVoices = activeVoices;
-    history.push_back(sample);
+    pushSample(sample);
+    recentSum += globalMotion;
+
+    // Split the history into "recent" and "previous" windows so we can detect
+    // a crowd suddenly ramping up compared to its immediate past. Samples
+    // cross the boundary once, in time order, moving their motion between
+    // the two sums.
+    uint64_t eruptionWindowStart = (timestampMs > config.eruptionWindowMs) ? timestampMs - config.eruptionWindowMs : 0;
+    while (previousCount < count && historyAt(previousCount).timestamp < eruptionWindowStart) {
+        const double motion = historyAt(previousCount).globalMotion;
+        recentSum -= motion;
+        previousSum += motion;
+        ++previousCount;
+    }
 
     // Keep only the recent history. The windowed averages below depend on the
     // buffers not growing forever, otherwise older calm sections would drown
     // out new hype.
     uint64_t minTimestamp = (timestampMs > config.historyMs) ? timestampMs - config.historyMs : 0;
-    while (!history.empty() && history.front().timestamp < minTimestamp) {
-        history.pop_front();
+    while (count > 0 && historyAt(0).timestamp < minTimestamp) {
+        popOldest();
     }
 
-    // Split the history into "recent" and "previous" windows so we can detect
-    // a crowd suddenly ramping up compared to its immediate past.
-    uint64_t eruptionWindowStart = (timestampMs > config.eruptionWindowMs) ? timestampMs - config.eruptionWindowMs : 0;
-    float previousAvg = 0.0f;
-    int previousCount = 0;
-    float recentAvg = 0.0f;
-    int recentCount = 0;
-
-    for (const auto& s : history) {
-        if (s.timestamp < eruptionWindowStart) {
-            previousAvg += s.globalMotion;
-            ++previousCount;
-        } else {
-            recentAvg += s.globalMotion;
-            ++recentCount;
-        }
-    }
-
-    if (previousCount > 0) {
-        previousAvg /= static_cast<float>(previousCount);
-    }
-    if (recentCount > 0) {
-        recentAvg /= static_cast<float>(recentCount);
-    }
+    const std::size_t recentCount = count - previousCount;
+    const float previousAvg = previousCount > 0 ? static_cast<float>(previousSum / static_cast<double>(previousCount)) : 0.0f;
+    const float recentAvg = recentCount > 0 ? static_cast<float>(recentSum / static_cast<double>(recentCount)) : 0.0f;
 
     // Eruption is hysteretic: the crowd must have been chill, then cross the
     // high threshold. This avoids a single rowdy group spamming the scene.
     if (recentCount > 0 && previousCount > 0 && recentAvg >= config.eruptionHigh && previousAvg <= config.eruptionLow) {
         if (timestampMs >= lastEruption + config.eruptionCooldownMs) {
             GlobalGestureEvent event;
-            event.type = "eruption";
+            event.type = GlobalGestureType::Eruption;
             event.strength = clamp01((recentAvg - config.eruptionHigh) / std::max(0.01f, 1.0f - config.eruptionHigh));
             outEvents.push_back(event);
             lastEruption = timestampMs;
-            ofLogNotice("GlobalGestureDetector") << "eruption strength " << event.strength << " (recent " << recentAvg << ", prev " << previousAvg << ")";
+            if (config.logGestures) {
+                AsyncLogNotice("GlobalGestureDetector") << "eruption strength " << event.strength << " (recent " << recentAvg << ", prev " << previousAvg << ")";
+            }
         }
     }
 
@@ -84,21 +92,118 @@ void GlobalGestureDetector::update(float globalMotion, int activeVoices, uint64_
         if (stillnessDuration >= config.stillnessDurationMs) {
             if (timestampMs >= lastStillness + config.stillnessCooldownMs) {
                 GlobalGestureEvent event;
-                event.type = "stillness";
+                event.type = GlobalGestureType::Stillness;
                 float motionStrength = clamp01(1.0f - (recentAvg / std::max(0.01f, config.stillnessMotionThreshold)));
                 float voiceStrength = clamp01(static_cast<float>(activeVoices - config.stillnessMinVoices) / std::max(1.0f, static_cast<float>(config.stillnessMinVoices)));
                 event.strength = clamp01(0.6f * motionStrength + 0.4f * voiceStrength);
                 outEvents.push_back(event);
                 lastStillness = timestampMs;
-                ofLogNotice("GlobalGestureDetector") << "stillness strength " << event.strength << " duration " << stillnessDuration;
+                if (config.logGestures) {
+                    AsyncLogNotice("GlobalGestureDetector") << "stillness strength " << event.strength << " duration " << stillnessDuration;
+                }
                 stillnessStart = timestampMs; // maintain hysteresis
             }
         }
     }
 }
 
+void GlobalGestureDetector::pushSample(const Sample& sample) {
+    if (count == history.size()) {
+        // Grow by doubling, oldest first; a steady frame rate settles on one
+        // size and never allocates again.
+        std::vector<Sample> grown(std::max<std::size_t>(64, history.size() * 2));
+        for (std::size_t i = 0; i < count; ++i) {
+            grown[i] = historyAt(i);
+        }
+        history.swap(grown);
+        head = 0;
+    }
+    history[(head + count) & (history.size() - 1)] = sample;
+    ++count;
+}
+
+void GlobalGestureDetector::popOldest() {
+    const double motion = historyAt(0).globalMotion;
+    if (previousCount > 0) {
+        previousSum -= motion;
+        --previousCount;
+    } else {
+        recentSum -= motion;
+    }
+    head = (head + 1) & (history.size() - 1);
+    --count;
+    // Empty buckets snap back to exactly zero so rounding never accumulates
+    // across a long show.
+    if (previousCount == 0) {
+        previousSum = 0.0;
+    }
+    if (count == previousCount) {
+        recentSum = 0.0;
+    }
+}
+
+void GlobalGestureDetector::clearHistory() {
+    head = 0;
+    count = 0;
+    previousCount = 0;
+    previousSum = 0.0;
+    recentSum = 0.0;
+}
+
+void GlobalGestureDetector::saveState(SnapshotBuffer& out) const {
+    out.put(static_cast<uint64_t>(count));
+    out.put(static_cast<uint64_t>(previousCount));
+    out.put(previousSum);
+    out.put(recentSum);
+    out.put(lastEruption);
+    out.put(lastStillness);
+    out.put(stillnessStart);
+    for (std::size_t i = 0; i < count; ++i) {
+        out.put(history[(head + i) & (history.size() - 1)]);
+    }
+}
+
+bool GlobalGestureDetector::loadState(SnapshotCursor& in) {
+    uint64_t savedCount = 0;
+    uint64_t savedPrevious = 0;
+    double savedPreviousSum = 0.0;
+    double savedRecentSum = 0.0;
+    uint64_t savedEruption = 0;
+    uint64_t savedStillness = 0;
+    uint64_t savedStillnessStart = 0;
+    in.get(savedCount);
+    in.get(savedPrevious);
+    in.get(savedPreviousSum);
+    in.get(savedRecentSum);
+    in.get(savedEruption);
+    in.get(savedStillness);
+    in.get(savedStillnessStart);
+    if (!in.ok() || savedPrevious > savedCount || !in.fits(savedCount, sizeof(Sample))) {
+        return false;
+    }
+    std::vector<Sample> samples(static_cast<std::size_t>(savedCount));
+    if (!in.getArray(samples.data(), samples.size())) {
+        return false;
+    }
+
+    clearHistory();
+    for (Sample& sample : samples) {
+        sample.timestamp = in.rebaseMs(sample.timestamp);
+        pushSample(sample);
+    }
+    // The sums come back exactly as they were rather than re-added, so the
+    // averages carry on bit for bit.
+    previousCount = static_cast<std::size_t>(savedPrevious);
+    previousSum = savedPreviousSum;
+    recentSum = savedRecentSum;
+    lastEruption = in.rebaseMs(savedEruption);
+    lastStillness = in.rebaseMs(savedStillness);
+    stillnessStart = in.rebaseMs(savedStillnessStart);
+    return true;
+}
+
 void GlobalGestureDetector::reset() {
-    history.clear();
+    clearHistory();
     lastEruption = 0;
     lastStillness = 0;
     stillnessStart = 0;
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "GestureEvents.h"
-#include <deque>
+#include "SnapshotBuffer.h"
+
+#include <cstddef>
+#include <vector>
 
 /**
  * GlobalGestureDetector watches the room-wide motion metrics and decides when
@@ -9,6 +12,10 @@
  * steer master scenes, so the class keeps hysteresis and cooldowns front and
  * center. If you ever wanted to teach a workshop on crowd sensing, this file is
  * a great conversation starter.
+ *
+ * The eruption averages come from two running sums – "previous" and
+ * "recent" – that samples slide between as they age, so an update costs the
+ * same whether historyMs is five seconds or a minute-long swell.
  */
 class GlobalGestureDetector {
 public:
@@ -22,6 +29,7 @@ public:
         uint64_t stillnessDurationMs = 3000;
         int stillnessMinVoices = 3;
         uint64_t stillnessCooldownMs = 6000;
+        bool logGestures = true; ///< Log each gesture (through AsyncLogger).
     };
 
     GlobalGestureDetector();
@@ -32,6 +40,11 @@ public:
     void update(float globalMotion, int activeVoices, uint64_t timestampMs, std::vector<GlobalGestureEvent>& outEvents);
     void reset();
 
+    /// Append the motion history, both running sums and the stillness/eruption clocks to a snapshot.
+    void saveState(SnapshotBuffer& out) const;
+    /// Replace them with a snapshot's. False, leaving ours alone, if it doesn't parse.
+    bool loadState(SnapshotCursor& in);
+
 private:
     struct Sample {
         uint64_t timestamp = 0;
@@ -39,8 +52,21 @@ private:
         int activeVoices = 0;
     };
 
+    std::size_t historySize() const { return count; }
+    Sample& historyAt(std::size_t i) { return history[(head + i) & (history.size() - 1)]; }
+    void pushSample(const Sample& sample);
+    void popOldest();
+    void clearHistory();
+
     Config config;
-    std::deque<Sample> history;
+    // Oldest-first ring (power-of-two size) split at `previousCount`:
+    // everything before it is older than eruptionWindowMs.
+    std::vector<Sample> history;
+    std::size_t head = 0;
+    std::size_t count = 0;
+    std::size_t previousCount = 0;
+    double previousSum = 0.0;
+    double recentSum = 0.0;
     uint64_t lastEruption = 0;
     uint64_t lastStillness = 0;
     uint64_t stillnessStart = 0;
@@ -0,0 +1,315 @@
+#include "IngestPacket.h"
+
+#include <cstring>
+
+namespace {
+const char kVoiceState[] = "/room/voice/state";
+const char kVoiceDisconnect[] = "/room/voice/disconnect";
+const char kCameraZones[] = "/room/camera/zones";
+const char kGlobalMotion[] = "/room/global/motion";
+
+template <std::size_t N>
+bool addressIs(const char* address, std::size_t length, const char (&expected)[N]) {
+    return length == N - 1 && std::memcmp(address, expected, N - 1) == 0;
+}
+
+bool isOurAddress(const char* address, std::size_t length) {
+    return addressIs(address, length, kVoiceState) || addressIs(address, length, kVoiceDisconnect)
+           || addressIs(address, length, kCameraZones) || addressIs(address, length, kGlobalMotion);
+}
+
+/// Length of a NUL-terminated OSC string including its padding to 4 bytes.
+std::size_t paddedLength(std::size_t characters) {
+    return (characters + 4) & ~std::size_t(3);
+}
+
+uint32_t readBigEndian32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__GNUC__) || defined(__clang__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+#else
+    value = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+#endif
+    return value;
+}
+
+uint64_t readBigEndian64(const unsigned char* p) {
+    return (uint64_t(readBigEndian32(p)) << 32) | readBigEndian32(p + 4);
+}
+
+/**
+ * Walks the type tags and argument bytes side by side. Conversions mirror
+ * the forgiving argAsFloat/argAsInt helpers on the generic path, so a
+ * tracker that sends ints where floats belong decodes the same either way.
+ */
+class ArgumentReader {
+public:
+    ArgumentReader(const char* typeTags, const char* typeTagsEnd, const unsigned char* args, const unsigned char* argsEnd)
+        : tag(typeTags), tagEnd(typeTagsEnd), cursor(args), end(argsEnd) {}
+
+    std::size_t remaining() const { return static_cast<std::size_t>(tagEnd - tag); }
+    /// A tag promised an argument the datagram does not have.
+    bool isTruncated() const { return truncated; }
+
+    bool readFloat(float& out) {
+        switch (nextTag()) {
+        case 'f': {
+            if (!have(4)) {
+                return false;
+            }
+            uint32_t bits = readBigEndian32(cursor);
+            std::memcpy(&out, &bits, sizeof(out));
+            cursor += 4;
+            return true;
+        }
+        case 'i':
+            if (!have(4)) {
+                return false;
+            }
+            out = static_cast<float>(static_cast<int32_t>(readBigEndian32(cursor)));
+            cursor += 4;
+            return true;
+        case 'h':
+            if (!have(8)) {
+                return false;
+            }
+            out = static_cast<float>(static_cast<int64_t>(readBigEndian64(cursor)));
+            cursor += 8;
+            return true;
+        case 'd': {
+            if (!have(8)) {
+                return false;
+            }
+            uint64_t bits = readBigEndian64(cursor);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            out = static_cast<float>(value);
+            cursor += 8;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool readInt(int& out) {
+        switch (nextTag()) {
+        case 'i':
+            if (!have(4)) {
+                return false;
+            }
+            out = static_cast<int32_t>(readBigEndian32(cursor));
+            cursor += 4;
+            return true;
+        case 'f': {
+            if (!have(4)) {
+                return false;
+            }
+            uint32_t bits = readBigEndian32(cursor);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            out = static_cast<int>(value);
+            cursor += 4;
+            return true;
+        }
+        case 'h':
+            if (!have(8)) {
+                return false;
+            }
+            out = static_cast<int>(static_cast<int64_t>(readBigEndian64(cursor)));
+            cursor += 8;
+            return true;
+        case 'd': {
+            if (!have(8)) {
+                return false;
+            }
+            uint64_t bits = readBigEndian64(cursor);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            out = static_cast<int>(value);
+            cursor += 8;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * An optional tracker timestamp: int64 microseconds, double seconds or an
+     * OSC timetag, all on whatever clock the sender keeps. False for any
+     * other tag (or the timetag meaning "immediately") – the message is still
+     * good, it just has no stamp of its own.
+     */
+    bool readTime(int64_t& micros) {
+        switch (nextTag()) {
+        case 'h':
+            if (!have(8)) {
+                return false;
+            }
+            micros = static_cast<int64_t>(readBigEndian64(cursor));
+            cursor += 8;
+            return true;
+        case 'd': {
+            if (!have(8)) {
+                return false;
+            }
+            uint64_t bits = readBigEndian64(cursor);
+            double seconds;
+            std::memcpy(&seconds, &bits, sizeof(seconds));
+            micros = static_cast<int64_t>(seconds * 1e6);
+            cursor += 8;
+            return true;
+        }
+        case 't': {
+            if (!have(8)) {
+                return false;
+            }
+            const uint64_t timetag = readBigEndian64(cursor);
+            cursor += 8;
+            if (timetag <= 1) {
+                return false;
+            }
+            micros = timetagMicros(timetag);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    /// The common zone case: `count` plain floats in a row, byte-swapped in one tight loop.
+    bool readFloats(float* out, std::size_t count) {
+        if (remaining() < count) {
+            return false;
+        }
+        bool allFloats = static_cast<std::size_t>(end - cursor) >= count * 4;
+        for (std::size_t i = 0; allFloats && i < count; ++i) {
+            allFloats = tag[i] == 'f';
+        }
+        if (allFloats) {
+            for (std::size_t i = 0; i < count; ++i) {
+                uint32_t bits = readBigEndian32(cursor + 4 * i);
+                std::memcpy(&out[i], &bits, sizeof(float));
+            }
+            tag += count;
+            cursor += 4 * count;
+            return true;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!readFloat(out[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    char nextTag() { return tag < tagEnd ? *tag++ : '\0'; }
+    bool have(std::size_t bytes) {
+        truncated = truncated || static_cast<std::size_t>(end - cursor) < bytes;
+        return !truncated;
+    }
+
+    const char* tag;
+    const char* tagEnd;
+    const unsigned char* cursor;
+    const unsigned char* end;
+    bool truncated = false;
+};
+
+/// The arguments of one of our four addresses; false for any other address.
+bool decodeArguments(const char* address, std::size_t addressLength, ArgumentReader& args, IngestPacket& packet) {
+    if (addressIs(address, addressLength, kVoiceState)) {
+        if (args.remaining() < 7) {
+            return false;
+        }
+        packet.kind = IngestPacket::Kind::VoiceState;
+        if (!args.readInt(packet.id) || !args.readFloat(packet.position.x) || !args.readFloat(packet.position.y)
+            || !args.readFloat(packet.position.z) || !args.readFloat(packet.size) || !args.readFloat(packet.motion)
+            || !args.readFloat(packet.energy)) {
+            return false;
+        }
+        packet.hasTrackerTime = args.remaining() > 0 && args.readTime(packet.trackerMicros);
+        return true;
+    }
+    if (addressIs(address, addressLength, kCameraZones)) {
+        if (args.remaining() < 3) {
+            return false;
+        }
+        packet.kind = IngestPacket::Kind::CameraZones;
+        if (!args.readInt(packet.id) || !args.readInt(packet.cols) || !args.readInt(packet.rows)) {
+            return false;
+        }
+        if (packet.rows < 1 || packet.cols < 1 || packet.rows > kMaxZoneLanes || packet.cols > kMaxZoneLanes
+            || packet.rows * packet.cols > kMaxZoneCells) {
+            return false;
+        }
+        if (!args.readFloats(packet.zones.data(), static_cast<std::size_t>(packet.rows * packet.cols))) {
+            return false;
+        }
+        packet.hasTrackerTime = args.remaining() > 0 && args.readTime(packet.trackerMicros);
+        return true;
+    }
+    packet.hasTrackerTime = false;
+    if (addressIs(address, addressLength, kGlobalMotion)) {
+        packet.kind = IngestPacket::Kind::GlobalMotion;
+        return args.remaining() >= 1 && args.readFloat(packet.globalMotion);
+    }
+    if (addressIs(address, addressLength, kVoiceDisconnect)) {
+        packet.kind = IngestPacket::Kind::VoiceDisconnect;
+        return args.remaining() >= 1 && args.readInt(packet.id);
+    }
+    return false;
+}
+} // namespace
+
+int64_t timetagMicros(uint64_t timetag) {
+    const uint64_t seconds = timetag >> 32;
+    const uint64_t fraction = timetag & 0xFFFFFFFFull;
+    return static_cast<int64_t>(seconds * 1000000 + ((fraction * 1000000) >> 32));
+}
+
+bool decodeIngestPacket(const char* data, std::size_t size, IngestPacket& packet, bool* malformed) {
+    if (malformed) {
+        *malformed = false;
+    }
+    // Messages only (bundles start with '#'), and OSC sizes are always whole words.
+    if (size < 8 || (size & 3) != 0 || data[0] != '/') {
+        return false;
+    }
+    const char* addressEnd = static_cast<const char*>(std::memchr(data, '\0', size));
+    if (!addressEnd) {
+        return false;
+    }
+    const std::size_t addressLength = static_cast<std::size_t>(addressEnd - data);
+    const std::size_t tagOffset = paddedLength(addressLength);
+    if (tagOffset >= size || data[tagOffset] != ',') {
+        return false; // no type tags: let the generic parser decide
+    }
+    const char* tags = data + tagOffset + 1;
+    const char* tagsEnd = static_cast<const char*>(std::memchr(tags, '\0', size - tagOffset - 1));
+    const std::size_t argOffset = tagsEnd ? tagOffset + paddedLength(static_cast<std::size_t>(tagsEnd - data) - tagOffset) : size + 1;
+    if (argOffset > size) {
+        // Type tags that never end, or run into the end of the datagram.
+        if (malformed) {
+            *malformed = isOurAddress(data, addressLength);
+        }
+        return false;
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    ArgumentReader args(tags, tagsEnd, bytes + argOffset, bytes + size);
+
+    const bool decoded = decodeArguments(data, addressLength, args, packet);
+    if (args.isTruncated()) {
+        // One of ours, cut short: oscpack would only throw on it.
+        if (malformed) {
+            *malformed = true;
+        }
+        return false;
+    }
+    return decoded;
+}
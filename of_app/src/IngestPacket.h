@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "GestureTypes.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Everything the detectors need from one incoming OSC message, flattened into
+ * a plain struct the receive thread can decode straight into a ring slot
+ * without touching the heap. One packet describes exactly one message; `kind`
+ * tells you which of the payload fields are meaningful – slots are recycled,
+ * so the others may hold leftovers from an earlier message.
+ */
+struct IngestPacket {
+    enum class Kind : uint8_t {
+        VoiceState,      ///< /room/voice/state
+        VoiceDisconnect, ///< /room/voice/disconnect
+        CameraZones,     ///< /room/camera/zones (any grid up to kMaxZoneCells)
+        GlobalMotion     ///< /room/global/motion
+    };
+
+    Kind kind = Kind::VoiceState;
+    uint64_t timestampMicros = 0;          ///< When the sample was taken, on the monotonicMicros() timeline.
+    uint64_t arrivalMicros = 0;            ///< When the receive thread got it, for latency stats.
+    bool hasTrackerTime = false;           ///< The message ended in the tracker's own timestamp...
+    int64_t trackerMicros = 0;             ///< ...in µs on the sender's clock, before mapping.
+    int id = -1;                           ///< voiceId or camId depending on kind.
+    glm::vec3 position = glm::vec3(0.0f);  ///< Voice state payload.
+    float size = 0.0f;
+    float motion = 0.0f;
+    float energy = 0.0f;
+    float globalMotion = 0.0f;             ///< Global motion payload.
+    int rows = 0;                          ///< Zone payload dimensions.
+    int cols = 0;
+    std::array<float, kMaxZoneCells> zones{}; ///< rows * cols values, row-major.
+};
+
+/**
+ * The receive thread's fast path: decode one raw OSC message straight from
+ * the datagram into `packet`, reading type tags and big-endian payloads in
+ * place. Only the four addresses above with int/float/int64/double arguments
+ * are handled; anything else – bundles, unknown addresses, odd tags, bad grid
+ * sizes, truncated data – returns false so the caller can hand the datagram
+ * to oscpack's generic parser, which decides exactly as it always did.
+ * The exception is one of our addresses whose type tags or arguments run past the end of
+ * the datagram: oscpack would only throw on it, so `malformed` (if given) is
+ * set and the caller should drop it.
+ * An optional trailing tracker timestamp on voice state and zones (int64 µs,
+ * double seconds or an OSC timetag) lands in `trackerMicros`; host stamps are
+ * left for the caller.
+ */
+bool decodeIngestPacket(const char* data, std::size_t size, IngestPacket& packet, bool* malformed = nullptr);
+
+/// An OSC timetag (NTP seconds in the high word, binary fraction in the low) as microseconds.
+int64_t timetagMicros(uint64_t timetag);
@@ -0,0 +1,132 @@
+#include "LatencyStats.h"
+
+#include <chrono>
+
+namespace {
+const char* kStreamNames[] = {
+    "ingest.voice", "ingest.zones", "ingest.global",
+    "detect.voice", "detect.zone", "detect.global", "detect.ensemble",
+    "emit.voice", "emit.zone", "emit.global", "emit.ensemble",
+};
+static_assert(sizeof(kStreamNames) / sizeof(kStreamNames[0]) == kLatencyStreamCount, "latency stream names out of sync");
+
+int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+float toMillis(uint64_t micros) {
+    return static_cast<float>(micros) / 1000.0f;
+}
+} // namespace
+
+uint64_t monotonicMicros() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t monotonicNanos() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kBucketCount;
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = maxMicros.load(std::memory_order_relaxed);
+    while (micros > seen && !maxMicros.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::drain() {
+    // Buckets are swapped out one at a time while writers may still be adding;
+    // a sample landing mid-drain simply counts toward the next interval.
+    std::array<uint32_t, kBucketCount> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary summary;
+    summary.count = static_cast<uint32_t>(total);
+    summary.maxMicros = maxMicros.exchange(0, std::memory_order_relaxed);
+    if (total == 0) {
+        return summary;
+    }
+
+    const uint64_t p50Rank = (total + 1) / 2;
+    const uint64_t p99Rank = (total * 99 + 99) / 100;
+    uint64_t seen = 0;
+    bool haveP50 = false;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += counts[i];
+        if (!haveP50 && seen >= p50Rank) {
+            summary.p50Micros = bucketMidpoint(i);
+            haveP50 = true;
+        }
+        if (seen >= p99Rank) {
+            summary.p99Micros = bucketMidpoint(i);
+            break;
+        }
+    }
+    // Bucket midpoints can overshoot the true max by a few percent.
+    if (summary.p50Micros > summary.maxMicros) {
+        summary.p50Micros = summary.maxMicros;
+    }
+    if (summary.p99Micros > summary.maxMicros) {
+        summary.p99Micros = summary.maxMicros;
+    }
+    return summary;
+}
+
+int LatencyHistogram::bucketFor(uint64_t micros) {
+    if (micros < static_cast<uint64_t>(kSubBuckets)) {
+        return static_cast<int>(micros);
+    }
+    int octave = highestBit(micros) - kSubBucketBits;
+    if (octave >= kOctaves) {
+        return kBucketCount - 1;
+    }
+    int sub = static_cast<int>((micros >> octave) & (kSubBuckets - 1));
+    return kSubBuckets + octave * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(int bucket) {
+    if (bucket < kSubBuckets) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int octave = (bucket - kSubBuckets) / kSubBuckets;
+    uint64_t sub = static_cast<uint64_t>((bucket - kSubBuckets) % kSubBuckets);
+    uint64_t lower = (static_cast<uint64_t>(kSubBuckets) + sub) << octave;
+    return lower + ((uint64_t(1) << octave) >> 1);
+}
+
+void LatencyStats::recordSince(LatencyStream stream, uint64_t sinceMicros) {
+    uint64_t now = monotonicMicros();
+    record(stream, now > sinceMicros ? now - sinceMicros : 0);
+}
+
+void LatencyStats::drain(std::array<LatencySummary, kLatencyStreamCount>& out) {
+    for (std::size_t i = 0; i < kLatencyStreamCount; ++i) {
+        LatencyHistogram::Summary summary = histograms[i].drain();
+        out[i].name = kStreamNames[i];
+        out[i].count = summary.count;
+        out[i].p50Ms = toMillis(summary.p50Micros);
+        out[i].p99Ms = toMillis(summary.p99Micros);
+        out[i].maxMs = toMillis(summary.maxMicros);
+    }
+}
+
+const char* LatencyStats::streamName(LatencyStream stream) {
+    return kStreamNames[static_cast<std::size_t>(stream)];
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Microseconds on a steady clock – the one timebase all latency stamps share.
+uint64_t monotonicMicros();
+/// The same clock in nanoseconds, for timings too short for microseconds (StageProfiler).
+uint64_t monotonicNanos();
+
+/**
+ * A fixed-size, lock-free latency histogram in the spirit of HdrHistogram.
+ * Values under 16 µs get their own bucket; above that every power of two is
+ * split into 16 linear sub-buckets, so any reading is within ~6% of the real
+ * value from 1 µs up to more than a day. record() is one relaxed atomic add
+ * (plus a compare-exchange when a new max shows up), so detector threads,
+ * send threads and the receive thread can all write at once.
+ */
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint32_t count = 0;
+        uint64_t p50Micros = 0;
+        uint64_t p99Micros = 0;
+        uint64_t maxMicros = 0;
+    };
+
+    void record(uint64_t micros);
+
+    /// Summarize everything recorded since the last drain and start over.
+    Summary drain();
+
+private:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kOctaves = 33; // 2^4 .. 2^36 µs
+    static constexpr int kBucketCount = kSubBuckets + kOctaves * kSubBuckets;
+
+    static int bucketFor(uint64_t micros);
+    static uint64_t bucketMidpoint(int bucket);
+
+    std::array<std::atomic<uint32_t>, kBucketCount> buckets{};
+    std::atomic<uint64_t> maxMicros{0};
+};
+
+/**
+ * The named latency streams the host keeps: how long packets wait before
+ * they are handled (ingest.*), how long each detector call takes (detect.*),
+ * and the full trip from a packet landing to the resulting gesture datagram
+ * leaving the socket (emit.*) – the number sound designers actually feel.
+ */
+enum class LatencyStream : uint8_t {
+    IngestVoice,
+    IngestZones,
+    IngestGlobal,
+    DetectVoice,
+    DetectZone,
+    DetectGlobal,
+    DetectEnsemble,
+    EmitVoice,
+    EmitZone,
+    EmitGlobal,
+    EmitEnsemble,
+    Count
+};
+
+constexpr std::size_t kLatencyStreamCount = static_cast<std::size_t>(LatencyStream::Count);
+
+/// One published line of stats, as sent on /room/host/stats.
+struct LatencySummary {
+    const char* name = "";
+    uint32_t count = 0;
+    float p50Ms = 0.0f;
+    float p99Ms = 0.0f;
+    float maxMs = 0.0f;
+};
+
+class LatencyStats {
+public:
+    void record(LatencyStream stream, uint64_t micros) {
+        histograms[static_cast<std::size_t>(stream)].record(micros);
+    }
+    /// Convenience for the emit/ingest streams: time since `sinceMicros`.
+    void recordSince(LatencyStream stream, uint64_t sinceMicros);
+
+    /// Drain every stream into `out` (indexed by LatencyStream).
+    void drain(std::array<LatencySummary, kLatencyStreamCount>& out);
+
+    static const char* streamName(LatencyStream stream);
+
+private:
+    std::array<LatencyHistogram, kLatencyStreamCount> histograms;
+};
+
+/**
+ * Times the enclosing scope into `stream`. With a null LatencyStats it never
+ * touches the clock, which is how the host stays overhead-free when stats
+ * are switched off.
+ */
+class ScopedLatency {
+public:
+    ScopedLatency(LatencyStats* sink, LatencyStream timed)
+        : stats(sink), stream(timed), start(sink ? monotonicMicros() : 0) {}
+    ~ScopedLatency() {
+        if (stats) {
+            stats->recordSince(stream, start);
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyStats* stats;
+    LatencyStream stream;
+    uint64_t start;
+};
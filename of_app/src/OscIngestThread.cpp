@@ -0,0 +1,270 @@
+#include "OscIngestThread.h"
+
+#include "ofLog.h"
+
+#include "LatencyStats.h"
+#include "StageProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+namespace {
+// Trackers are not always strict about int vs float, so mirror ofxOsc's
+// forgiving getArgAs* helpers instead of throwing on the first odd tag.
+float argAsFloat(const osc::ReceivedMessageArgument& arg) {
+    if (arg.IsFloat()) {
+        return arg.AsFloatUnchecked();
+    }
+    if (arg.IsInt32()) {
+        return static_cast<float>(arg.AsInt32Unchecked());
+    }
+    if (arg.IsDouble()) {
+        return static_cast<float>(arg.AsDouble());
+    }
+    if (arg.IsInt64()) {
+        return static_cast<float>(arg.AsInt64());
+    }
+    return 0.0f;
+}
+
+int argAsInt(const osc::ReceivedMessageArgument& arg) {
+    if (arg.IsInt32()) {
+        return arg.AsInt32Unchecked();
+    }
+    if (arg.IsFloat()) {
+        return static_cast<int>(arg.AsFloatUnchecked());
+    }
+    if (arg.IsInt64()) {
+        return static_cast<int>(arg.AsInt64());
+    }
+    if (arg.IsDouble()) {
+        return static_cast<int>(arg.AsDouble());
+    }
+    return 0;
+}
+
+/// The optional trailing tracker timestamp, in any of the forms decodeIngestPacket() accepts.
+bool argAsTrackerTime(const osc::ReceivedMessageArgument& arg, int64_t& micros) {
+    if (arg.IsInt64()) {
+        micros = arg.AsInt64();
+        return true;
+    }
+    if (arg.IsDouble()) {
+        micros = static_cast<int64_t>(arg.AsDouble() * 1e6);
+        return true;
+    }
+    if (arg.IsTimeTag() && arg.AsTimeTag() > 1) {
+        micros = timetagMicros(arg.AsTimeTag());
+        return true;
+    }
+    return false;
+}
+} // namespace
+
+OscIngestThread::~OscIngestThread() {
+    stop();
+}
+
+void OscIngestThread::setInlineHandlers(PacketHandler onPacket, TickHandler onTick, int tickMs) {
+    inlinePacketHandler = std::move(onPacket);
+    inlineTickHandler = std::move(onTick);
+    inlineTickMs = std::max(1, tickMs);
+}
+
+bool OscIngestThread::start(int port, std::size_t queueCapacity) {
+    stop();
+    queue.reset(queueCapacity);
+    dropped.store(0);
+    ignored.store(0);
+    senders = {};
+
+    try {
+        socket.reset(new UdpReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, port)));
+    } catch (const std::exception& e) {
+        ofLogError("OscIngestThread") << "could not bind port " << port << ": " << e.what();
+        socket.reset();
+        return false;
+    }
+
+    multiplexer.reset(new SocketReceiveMultiplexer());
+    multiplexer->AttachSocketListener(socket.get(), this);
+    if (inlineTickHandler) {
+        multiplexer->AttachPeriodicTimerListener(inlineTickMs, this);
+    }
+
+    running.store(true);
+    thread = std::thread([this]() {
+        StageProfiler::nameThisThread("osc ingest");
+        // Run() blocks until AsynchronousBreak() from stop(). All parsing and,
+        // in inline mode, all detection happens inside these callbacks. Like
+        // ofxOscReceiver, anything that escapes them restarts the loop rather
+        // than taking the host down.
+        while (running.load()) {
+            try {
+                multiplexer->Run();
+            } catch (const std::exception& e) {
+                ofLogWarning("OscIngestThread") << "receive loop: " << e.what();
+            }
+        }
+    });
+    return true;
+}
+
+void OscIngestThread::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    multiplexer->AsynchronousBreak();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    multiplexer->DetachSocketListener(socket.get(), this);
+    if (inlineTickHandler) {
+        multiplexer->DetachPeriodicTimerListener(this);
+    }
+    multiplexer.reset();
+    socket.reset();
+}
+
+void OscIngestThread::ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) {
+    // Fast path: our own addresses decode straight from the datagram into the
+    // ring slot the consumer will read, with no oscpack objects and no copies.
+    // One of ours cut short is dropped here; anything else it does not
+    // recognise goes through oscpack exactly as before.
+    IngestPacket* slot = inlinePacketHandler ? nullptr : queue.prepare();
+    IngestPacket& target = slot ? *slot : scratch;
+    bool malformed = false;
+    if (size > 0 && decodeIngestPacket(data, static_cast<std::size_t>(size), target, &malformed)) {
+        stamp(target, remoteEndpoint);
+        if (inlinePacketHandler) {
+            inlinePacketHandler(target);
+        } else if (slot) {
+            queue.commit();
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (malformed) {
+        ignored.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    try {
+        osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+    } catch (const osc::Exception&) {
+        // oscpack throws on malformed or truncated datagrams before
+        // ProcessMessage() ever sees them; anyone on the network can send one.
+        ignored.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void OscIngestThread::ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) {
+    IngestPacket packet;
+    try {
+        if (!parseMessage(message, packet)) {
+            ignored.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } catch (const osc::Exception&) {
+        // A malformed datagram should never take the receive thread down.
+        ignored.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    stamp(packet, remoteEndpoint);
+    dispatch(packet);
+}
+
+void OscIngestThread::TimerExpired() {
+    if (inlineTickHandler) {
+        inlineTickHandler();
+    }
+}
+
+bool OscIngestThread::parseMessage(const osc::ReceivedMessage& message, IngestPacket& packet) const {
+    const char* address = message.AddressPattern();
+    const uint32_t argCount = message.ArgumentCount();
+    auto arg = message.ArgumentsBegin();
+    packet.hasTrackerTime = false;
+
+    if (std::strcmp(address, "/room/voice/state") == 0 && argCount >= 7) {
+        // Voice payload mirrors the OSC schema: id, xyz, size, motion, energy.
+        packet.kind = IngestPacket::Kind::VoiceState;
+        packet.id = argAsInt(*arg++);
+        packet.position.x = argAsFloat(*arg++);
+        packet.position.y = argAsFloat(*arg++);
+        packet.position.z = argAsFloat(*arg++);
+        packet.size = argAsFloat(*arg++);
+        packet.motion = argAsFloat(*arg++);
+        packet.energy = argAsFloat(*arg++);
+        packet.hasTrackerTime = argCount >= 8 && argAsTrackerTime(*arg, packet.trackerMicros);
+        return true;
+    }
+    if (std::strcmp(address, "/room/voice/disconnect") == 0 && argCount >= 1) {
+        packet.kind = IngestPacket::Kind::VoiceDisconnect;
+        packet.id = argAsInt(*arg);
+        return true;
+    }
+    if (std::strcmp(address, "/room/camera/zones") == 0 && argCount >= 3) {
+        // Zone messages carry their grid size as (cols, rows), per the schema.
+        packet.kind = IngestPacket::Kind::CameraZones;
+        packet.id = argAsInt(*arg++);
+        packet.cols = argAsInt(*arg++);
+        packet.rows = argAsInt(*arg++);
+        if (packet.rows < 1 || packet.cols < 1 || packet.rows > kMaxZoneLanes || packet.cols > kMaxZoneLanes) {
+            return false;
+        }
+        const int cellCount = packet.rows * packet.cols;
+        if (cellCount > kMaxZoneCells || argCount < static_cast<std::size_t>(3 + cellCount)) {
+            return false;
+        }
+        for (int i = 0; i < cellCount; ++i) {
+            packet.zones[i] = argAsFloat(*arg++);
+        }
+        packet.hasTrackerTime = argCount >= static_cast<std::size_t>(4 + cellCount) && argAsTrackerTime(*arg, packet.trackerMicros);
+        return true;
+    }
+    if (std::strcmp(address, "/room/global/motion") == 0 && argCount >= 1) {
+        packet.kind = IngestPacket::Kind::GlobalMotion;
+        packet.globalMotion = argAsFloat(*arg);
+        return true;
+    }
+    return false;
+}
+
+void OscIngestThread::stamp(IngestPacket& packet, const IpEndpointName& sender) {
+    packet.arrivalMicros = monotonicMicros();
+    packet.timestampMicros = packet.hasTrackerTime ? clockFor(sender, packet.arrivalMicros).map(packet.trackerMicros, packet.arrivalMicros)
+                                                  : packet.arrivalMicros;
+}
+
+SourceClock& OscIngestThread::clockFor(const IpEndpointName& sender, uint64_t nowMicros) {
+    // A handful of trackers at most, so a linear scan; a newcomer takes over
+    // whichever sender has been quiet longest.
+    Sender* oldest = &senders[0];
+    for (Sender& candidate : senders) {
+        if (candidate.port == sender.port && candidate.address == sender.address) {
+            candidate.lastSeenMicros = nowMicros;
+            return candidate.clock;
+        }
+        if (candidate.lastSeenMicros < oldest->lastSeenMicros) {
+            oldest = &candidate;
+        }
+    }
+    oldest->address = sender.address;
+    oldest->port = sender.port;
+    oldest->lastSeenMicros = nowMicros;
+    oldest->clock.reset();
+    return oldest->clock;
+}
+
+void OscIngestThread::dispatch(const IngestPacket& packet) {
+    if (inlinePacketHandler) {
+        inlinePacketHandler(packet);
+        return;
+    }
+    if (!queue.push(packet)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
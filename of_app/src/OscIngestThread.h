@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "OscPacketListener.h"
+#include "UdpSocket.h"
+
+#include "IngestPacket.h"
+#include "SourceClock.h"
+#include "SpscQueue.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+/**
+ * OscIngestThread owns the listening UDP socket and a dedicated thread that
+ * blocks on it. Messages are parsed straight out of the datagram into
+ * IngestPackets the moment they land, so a slow frame in draw() can no longer
+ * delay when we notice a performer moving.
+ *
+ * Two ways to consume the result:
+ *  - queued (default): packets go into a lock-free SPSC ring that the render
+ *    thread drains in ofApp::update();
+ *  - inline: a handler runs on the receive thread for every packet, plus a
+ *    periodic tick for housekeeping, so detection latency no longer depends on
+ *    the frame rate at all.
+ *
+ * The four addresses we understand are decoded by hand (decodeIngestPacket)
+ * directly into the ring slot; oscpack's parser only sees everything else.
+ *
+ * Every packet is stamped here, on arrival, with monotonicMicros(). When a
+ * tracker also sends its own capture time, that stamp is carried over onto
+ * our timeline through a SourceClock per sending endpoint, so the samples
+ * keep the spacing they were taken with however the network bunched them up.
+ */
+class OscIngestThread : private osc::OscPacketListener, private TimerListener {
+public:
+    using PacketHandler = std::function<void(const IngestPacket&)>;
+    using TickHandler = std::function<void()>;
+
+    OscIngestThread() = default;
+    ~OscIngestThread();
+
+    OscIngestThread(const OscIngestThread&) = delete;
+    OscIngestThread& operator=(const OscIngestThread&) = delete;
+
+    /**
+     * Run handlers on the receive thread instead of queueing. Must be called
+     * before start(). `tickMs` sets how often onTick fires while packets are
+     * flowing or not.
+     */
+    void setInlineHandlers(PacketHandler onPacket, TickHandler onTick, int tickMs);
+
+    /// Bind the socket and spin up the thread. Returns false if the bind fails.
+    bool start(int port, std::size_t queueCapacity);
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    /// Consumer side of the queued mode. Call from exactly one thread.
+    bool pop(IngestPacket& out) { return queue.pop(out); }
+    /// Zero-copy variant: the oldest packet in place, or null. Valid until popFront().
+    const IngestPacket* front() const { return queue.front(); }
+    void popFront() { queue.popFront(); }
+
+    /// Packets we refused because the consumer fell behind and the ring was full.
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    /// Messages that arrived but did not match any address we understand.
+    uint64_t getIgnoredCount() const { return ignored.load(std::memory_order_relaxed); }
+
+private:
+    void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override;
+    void ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) override;
+    void TimerExpired() override;
+
+    bool parseMessage(const osc::ReceivedMessage& message, IngestPacket& packet) const;
+    void dispatch(const IngestPacket& packet);
+    void stamp(IngestPacket& packet, const IpEndpointName& sender);
+
+    /// One tracker's clock, keyed by where its packets come from.
+    struct Sender {
+        unsigned long address = 0;
+        int port = -1;
+        uint64_t lastSeenMicros = 0;
+        SourceClock clock;
+    };
+    static constexpr std::size_t kMaxSenders = 8;
+    SourceClock& clockFor(const IpEndpointName& sender, uint64_t nowMicros);
+
+    SpscQueue<IngestPacket> queue;
+    std::unique_ptr<UdpReceiveSocket> socket;
+    std::unique_ptr<SocketReceiveMultiplexer> multiplexer;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> ignored{0};
+
+    IngestPacket scratch; // fast-path target in inline mode or when the ring is full.
+    std::array<Sender, kMaxSenders> senders{}; // receive thread only.
+
+    PacketHandler inlinePacketHandler;
+    TickHandler inlineTickHandler;
+    int inlineTickMs = 16;
+};
@@ -0,0 +1,61 @@
+#include "OutputGovernor.h"
+
+#include <algorithm>
+
+void OutputGovernor::TokenBucket::configure(float ratePerSec, uint64_t burstMs) {
+    rate = std::max(0.0f, ratePerSec);
+    // Always room for at least one event, or a low rate could never send.
+    depth = std::max(1.0f, rate * static_cast<float>(burstMs) / 1000.0f);
+    tokens = depth;
+    lastMicros = 0;
+}
+
+void OutputGovernor::TokenBucket::refill(uint64_t nowMicros) {
+    if (lastMicros != 0 && nowMicros > lastMicros) {
+        tokens = std::min(depth, tokens + rate * static_cast<float>(nowMicros - lastMicros) / 1.0e6f);
+    }
+    lastMicros = nowMicros;
+}
+
+void OutputGovernor::setup(const Settings& newSettings) {
+    settings = newSettings;
+    total.configure(settings.maxEventsPerSec, settings.burstMs);
+    families[static_cast<std::size_t>(Family::Voice)].configure(settings.maxVoicePerSec, settings.burstMs);
+    families[static_cast<std::size_t>(Family::Zone)].configure(settings.maxZonePerSec, settings.burstMs);
+    families[static_cast<std::size_t>(Family::Global)].configure(0.0f, settings.burstMs);
+    families[static_cast<std::size_t>(Family::Ensemble)].configure(settings.maxEnsemblePerSec, settings.burstMs);
+    throttled.store(0);
+    merged.store(0);
+}
+
+bool OutputGovernor::admit(Family family, uint64_t nowMicros) {
+    TokenBucket& own = families[static_cast<std::size_t>(family)];
+    if (!total.unlimited()) {
+        total.refill(nowMicros);
+    }
+    if (family == Family::Global) {
+        // Priority: take a shared token if there is one, so the rest of the
+        // traffic yields, but never refuse a scene change.
+        if (!total.unlimited() && total.tokens >= 1.0f) {
+            total.tokens -= 1.0f;
+        }
+        return true;
+    }
+    if (!own.unlimited()) {
+        own.refill(nowMicros);
+    }
+    // Only spend when both buckets can pay, so a refusal costs nothing.
+    const bool ownHasToken = own.unlimited() || own.tokens >= 1.0f;
+    const bool totalHasToken = total.unlimited() || total.tokens >= 1.0f;
+    if (!ownHasToken || !totalHasToken) {
+        throttled.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!own.unlimited()) {
+        own.tokens -= 1.0f;
+    }
+    if (!total.unlimited()) {
+        total.tokens -= 1.0f;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * OutputGovernor is the bouncer at a destination's door. When the whole
+ * room erupts, the detectors can hand over dozens of raises and a wall of
+ * zone pulses in a single frame; sent as-is they swamp the synth and the
+ * socket buffers drop whatever they like. The governor caps the rate with
+ * token buckets – one per address family and one for the destination as a
+ * whole – so what gets dropped is decided here, on purpose, and counted.
+ *
+ * Global gestures (eruption, stillness) are the scene changes everything else
+ * hangs off, so they always get through: they take a token when there is one
+ * but are never refused.
+ *
+ * Merging same-type events is done by GestureDestination, which holds the
+ * events; the governor only keeps its count. Everything here is used from the
+ * destination's send thread; the counters can be read from anywhere.
+ */
+class OutputGovernor {
+public:
+    /// Address families with their own bucket, in GestureDestination's filter order.
+    enum class Family : uint8_t { Voice, Zone, Global, Ensemble, Count };
+
+    struct Settings {
+        /// Same-type events (see GestureDestination) within this long fold into the strongest; 0 = off.
+        uint64_t mergeWindowMs = 0;
+        float maxEventsPerSec = 0.0f;         ///< Whole destination; 0 = unlimited.
+        float maxVoicePerSec = 0.0f;          ///< /room/gesture/voice; 0 = unlimited.
+        float maxZonePerSec = 0.0f;           ///< /room/gesture/zone; 0 = unlimited.
+        float maxEnsemblePerSec = 0.0f;       ///< /room/gesture/ensemble; 0 = unlimited.
+        uint64_t burstMs = 250;               ///< Bucket depth: this many ms worth of tokens.
+
+        bool isActive() const {
+            return mergeWindowMs > 0 || maxEventsPerSec > 0.0f || maxVoicePerSec > 0.0f || maxZonePerSec > 0.0f
+                   || maxEnsemblePerSec > 0.0f;
+        }
+    };
+
+    void setup(const Settings& settings);
+    const Settings& getSettings() const { return settings; }
+
+    /// Take the tokens an event of `family` needs at `nowMicros`; false = drop it.
+    bool admit(Family family, uint64_t nowMicros);
+    void noteMerged() { merged.fetch_add(1, std::memory_order_relaxed); }
+
+    uint64_t getThrottledCount() const { return throttled.load(std::memory_order_relaxed); }
+    uint64_t getMergedCount() const { return merged.load(std::memory_order_relaxed); }
+
+private:
+    /// Refills continuously at `rate` per second up to `depth`; rate 0 never runs dry.
+    struct TokenBucket {
+        float rate = 0.0f;
+        float depth = 0.0f;
+        float tokens = 0.0f;
+        uint64_t lastMicros = 0;
+
+        void configure(float ratePerSec, uint64_t burstMs);
+        bool unlimited() const { return rate <= 0.0f; }
+        void refill(uint64_t nowMicros);
+    };
+
+    Settings settings;
+    TokenBucket total;
+    std::array<TokenBucket, static_cast<std::size_t>(Family::Count)> families;
+    std::atomic<uint64_t> throttled{0};
+    std::atomic<uint64_t> merged{0};
+};
@@ -0,0 +1,304 @@
+#include "SessionLog.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr std::size_t kWriteBufferBytes = 1 << 20;
+constexpr uint64_t kIndexIntervalMicros = 1000000;
+} // namespace
+
+SessionLogWriter::~SessionLogWriter() {
+    close();
+}
+
+bool SessionLogWriter::open(const std::string& path, uint32_t flags) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    // A big stdio buffer turns tens of thousands of 64-byte appends into a
+    // handful of writes; the page cache does the rest.
+    buffer.resize(kWriteBufferBytes);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    header = SessionLogHeader();
+    header.flags = flags;
+    header.startUnixMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                       std::chrono::system_clock::now().time_since_epoch())
+                                                       .count());
+    recordCount = 0;
+    index.clear();
+    nextIndexMicros = 0;
+    std::fwrite(&header, sizeof(header), 1, file);
+    return true;
+}
+
+void SessionLogWriter::close() {
+    if (!file) {
+        return;
+    }
+    header.recordCount = recordCount;
+    header.indexCount = index.size();
+    header.indexOffset = index.empty() ? 0 : sizeof(SessionLogHeader) + recordCount * sizeof(SessionRecord);
+    if (!index.empty()) {
+        std::fwrite(index.data(), sizeof(SessionIndexEntry), index.size(), file);
+    }
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+    file = nullptr;
+    buffer.clear();
+    buffer.shrink_to_fit();
+}
+
+void SessionLogWriter::appendVoice(uint64_t timestampMicros, int voiceId, float x, float y, float z, float size, float motion,
+                                   float energy) {
+    SessionRecord record;
+    record.kind = static_cast<uint8_t>(SessionRecordKind::Voice);
+    record.id = voiceId;
+    record.timestampMicros = timestampMicros;
+    record.payload[0] = x;
+    record.payload[1] = y;
+    record.payload[2] = z;
+    record.payload[3] = size;
+    record.payload[4] = motion;
+    record.payload[5] = energy;
+    append(record);
+}
+
+void SessionLogWriter::appendDisconnect(uint64_t timestampMicros, int voiceId) {
+    SessionRecord record;
+    record.kind = static_cast<uint8_t>(SessionRecordKind::Disconnect);
+    record.id = voiceId;
+    record.timestampMicros = timestampMicros;
+    append(record);
+}
+
+void SessionLogWriter::appendZones(uint64_t timestampMicros, int camId, int cols, int rows, const float* cells) {
+    if (!file) {
+        return;
+    }
+    const int cellCount = cols * rows;
+    const std::size_t recordTotal = sessionZoneRecordCount(cellCount);
+
+    // Head record plus zero-padded continuations, written as one contiguous
+    // run so the reader can hand out a pointer to the cells in place.
+    SessionRecord head;
+    head.kind = static_cast<uint8_t>(SessionRecordKind::Zones);
+    head.cols = static_cast<uint8_t>(cols);
+    head.rows = static_cast<uint8_t>(rows);
+    head.id = camId;
+    head.timestampMicros = timestampMicros;
+    noteIndex(timestampMicros);
+
+    const std::size_t headerBytes = offsetof(SessionRecord, payload);
+    const std::size_t cellBytes = static_cast<std::size_t>(cellCount) * sizeof(float);
+    const std::size_t padBytes = recordTotal * sizeof(SessionRecord) - headerBytes - cellBytes;
+    static const char zeros[sizeof(SessionRecord)] = {};
+
+    std::fwrite(&head, headerBytes, 1, file);
+    if (cellBytes > 0) {
+        std::fwrite(cells, cellBytes, 1, file);
+    }
+    if (padBytes > 0) {
+        std::fwrite(zeros, padBytes, 1, file);
+    }
+    recordCount += recordTotal;
+}
+
+void SessionLogWriter::appendGlobal(uint64_t timestampMicros, float globalMotion) {
+    SessionRecord record;
+    record.kind = static_cast<uint8_t>(SessionRecordKind::Global);
+    record.timestampMicros = timestampMicros;
+    record.payload[0] = globalMotion;
+    append(record);
+}
+
+void SessionLogWriter::appendTick(uint64_t timestampMicros) {
+    SessionRecord record;
+    record.kind = static_cast<uint8_t>(SessionRecordKind::Tick);
+    record.timestampMicros = timestampMicros;
+    append(record);
+}
+
+void SessionLogWriter::append(const SessionRecord& record) {
+    if (!file) {
+        return;
+    }
+    noteIndex(record.timestampMicros);
+    std::fwrite(&record, sizeof(record), 1, file);
+    ++recordCount;
+}
+
+void SessionLogWriter::noteIndex(uint64_t timestampMicros) {
+    if (index.empty() || timestampMicros >= nextIndexMicros) {
+        SessionIndexEntry entry;
+        entry.timestampMicros = timestampMicros;
+        entry.recordNumber = recordCount;
+        index.push_back(entry);
+        nextIndexMicros = timestampMicros + kIndexIntervalMicros;
+    }
+}
+
+SessionLogReader::~SessionLogReader() {
+    close();
+}
+
+bool SessionLogReader::open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SessionLogHeader))) {
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(handle);
+        return false;
+    }
+    fileHandle = handle;
+    mappingHandle = mapping;
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SessionLogHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* view = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (view == MAP_FAILED) {
+        return false;
+    }
+#if defined(POSIX_MADV_SEQUENTIAL)
+    ::posix_madvise(view, static_cast<std::size_t>(info.st_size), POSIX_MADV_SEQUENTIAL);
+#endif
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<std::size_t>(info.st_size);
+#endif
+
+    const SessionLogHeader& header = getHeader();
+    const SessionLogHeader expected;
+    if (std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0 ||
+        (header.version != SessionLogHeader::kVersion && header.version != SessionLogHeader::kVersionMillis) ||
+        header.recordBytes != sizeof(SessionRecord) ||
+        header.byteOrder != expected.byteOrder) {
+        close();
+        return false;
+    }
+
+    // A log from a host that never closed it has recordCount 0: trust the
+    // file size instead and drop any half-written trailing record.
+    const uint64_t available = (size - sizeof(SessionLogHeader)) / sizeof(SessionRecord);
+    recordCount = header.recordCount > 0 && header.recordCount <= available ? header.recordCount : available;
+    cursor = 0;
+    timeScale = header.version == SessionLogHeader::kVersionMillis ? 1000 : 1;
+    return true;
+}
+
+void SessionLogReader::close() {
+    if (!data) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    ::munmap(const_cast<unsigned char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    recordCount = 0;
+    cursor = 0;
+}
+
+bool SessionLogReader::next(SessionSample& out) {
+    while (cursor < recordCount) {
+        const SessionRecord& record = records()[cursor];
+        out.kind = static_cast<SessionRecordKind>(record.kind);
+        out.timestampMicros = record.timestampMicros * timeScale;
+        out.id = record.id;
+        out.values = record.payload;
+        out.cols = 0;
+        out.rows = 0;
+        out.cells = nullptr;
+
+        switch (out.kind) {
+        case SessionRecordKind::Voice:
+        case SessionRecordKind::Disconnect:
+        case SessionRecordKind::Global:
+        case SessionRecordKind::Tick:
+            ++cursor;
+            return true;
+        case SessionRecordKind::Zones: {
+            const uint64_t span = sessionZoneRecordCount(record.cols * record.rows);
+            if (cursor + span > recordCount) {
+                cursor = recordCount; // truncated tail
+                return false;
+            }
+            out.cols = record.cols;
+            out.rows = record.rows;
+            out.cells = record.payload;
+            cursor += span;
+            return true;
+        }
+        }
+        ++cursor; // unknown kind from a newer writer: skip it
+    }
+    return false;
+}
+
+bool SessionLogReader::peekTimestamp(uint64_t& timestampMicros) const {
+    if (cursor >= recordCount) {
+        return false;
+    }
+    timestampMicros = recordMicros(cursor);
+    return true;
+}
+
+void SessionLogReader::seek(uint64_t timestampMicros) {
+    const SessionLogHeader& header = getHeader();
+    cursor = 0;
+    if (header.indexOffset > 0 && header.indexOffset + header.indexCount * sizeof(SessionIndexEntry) <= size) {
+        const SessionIndexEntry* entries = reinterpret_cast<const SessionIndexEntry*>(data + header.indexOffset);
+        for (uint64_t i = 0; i < header.indexCount && entries[i].timestampMicros * timeScale <= timestampMicros; ++i) {
+            cursor = entries[i].recordNumber;
+        }
+    }
+    // Walk forward a sample at a time from the nearest index point.
+    SessionSample sample;
+    while (cursor < recordCount && recordMicros(cursor) < timestampMicros && next(sample)) {
+    }
+}
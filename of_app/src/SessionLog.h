@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * A show's worth of incoming telemetry in one append-only binary file, so a
+ * missed gesture can be replayed after the fact – deterministically and much
+ * faster than real time.
+ *
+ * Layout (little-endian, everything 64-byte aligned):
+ *
+ *   SessionLogHeader      64 bytes, magic + format + where the index lives
+ *   SessionRecord * N     fixed 64-byte records in arrival order
+ *   SessionIndexEntry * M one entry per second of show time (written on close)
+ *
+ * Besides the samples themselves the log stores Tick records – the moments
+ * the host ran its per-frame detectors – so a replay makes the same
+ * decisions at the same virtual times as the live run. Zone grids bigger than
+ * the 12 floats a record holds spill into continuation records that follow
+ * immediately, which keeps every grid contiguous in the file (and in the
+ * memory map).
+ *
+ * If the host dies mid-show the header simply has no index; the records are
+ * still all there and the reader scans them instead.
+ *
+ * Timestamps are microseconds on the host's monotonic timeline, exactly what
+ * the detectors saw. Version 1 logs stored milliseconds; the reader still
+ * opens them and scales on the fly.
+ */
+
+enum class SessionRecordKind : uint8_t {
+    Voice = 1,      ///< x, y, z, size, motion, energy
+    Disconnect = 2, ///< id only
+    Zones = 3,      ///< cols x rows cells, row-major, may continue past the record
+    Global = 4,     ///< globalMotion
+    Tick = 5        ///< the host ran a detection tick at `timestampMicros`
+};
+
+struct SessionRecord {
+    static constexpr int kPayloadFloats = 12;
+
+    uint8_t kind = 0;
+    uint8_t cols = 0;        ///< Zones only.
+    uint8_t rows = 0;
+    uint8_t reserved = 0;
+    int32_t id = 0;          ///< voiceId or camId.
+    uint64_t timestampMicros = 0;
+    float payload[kPayloadFloats] = {};
+};
+static_assert(sizeof(SessionRecord) == 64, "session records must stay 64 bytes");
+
+struct SessionLogHeader {
+    static constexpr uint32_t kVersion = 2;       ///< 2: timestamps in µs (1 stored milliseconds).
+    static constexpr uint32_t kVersionMillis = 1;
+    static constexpr uint32_t kFlagInlineDetection = 1u << 0; ///< recorded with detect_on_receive_thread
+
+    char magic[8] = {'C', 'R', 'W', 'D', 'L', 'O', 'G', '1'};
+    uint32_t version = kVersion;
+    uint32_t recordBytes = sizeof(SessionRecord);
+    uint32_t flags = 0;
+    uint32_t byteOrder = 0x01020304;
+    uint64_t startUnixMicros = 0; ///< wall clock when recording began, for humans.
+    uint64_t recordCount = 0;     ///< filled in on close; 0 = scan to end of file.
+    uint64_t indexOffset = 0;     ///< byte offset of the index, 0 if none.
+    uint64_t indexCount = 0;
+    uint8_t reserved[8] = {};
+};
+static_assert(sizeof(SessionLogHeader) == 64, "session header must stay 64 bytes");
+
+struct SessionIndexEntry {
+    uint64_t timestampMicros = 0;
+    uint64_t recordNumber = 0; ///< first record at or after timestampMicros.
+};
+
+/// Records a zone grid of `cells` values needs in total, head included.
+inline std::size_t sessionZoneRecordCount(int cells) {
+    const int spill = cells - SessionRecord::kPayloadFloats;
+    const int perRecord = static_cast<int>(sizeof(SessionRecord) / sizeof(float));
+    return 1 + (spill > 0 ? static_cast<std::size_t>((spill + perRecord - 1) / perRecord) : 0);
+}
+
+/**
+ * Appends records through a large stdio buffer, so recording costs a memcpy
+ * per sample and a write() every megabyte. One thread at a time, please –
+ * the host only ever records from whichever thread owns detection.
+ */
+class SessionLogWriter {
+public:
+    SessionLogWriter() = default;
+    ~SessionLogWriter();
+
+    SessionLogWriter(const SessionLogWriter&) = delete;
+    SessionLogWriter& operator=(const SessionLogWriter&) = delete;
+
+    bool open(const std::string& path, uint32_t flags);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    void appendVoice(uint64_t timestampMicros, int voiceId, float x, float y, float z, float size, float motion, float energy);
+    void appendDisconnect(uint64_t timestampMicros, int voiceId);
+    void appendZones(uint64_t timestampMicros, int camId, int cols, int rows, const float* cells);
+    void appendGlobal(uint64_t timestampMicros, float globalMotion);
+    void appendTick(uint64_t timestampMicros);
+
+    uint64_t getRecordCount() const { return recordCount; }
+
+private:
+    void append(const SessionRecord& record);
+    void noteIndex(uint64_t timestampMicros);
+
+    std::FILE* file = nullptr;
+    std::vector<char> buffer;
+    SessionLogHeader header;
+    uint64_t recordCount = 0;
+    std::vector<SessionIndexEntry> index;
+    uint64_t nextIndexMicros = 0;
+};
+
+/// One decoded sample; `cells` points straight into the memory map.
+struct SessionSample {
+    SessionRecordKind kind = SessionRecordKind::Tick;
+    uint64_t timestampMicros = 0;
+    int id = 0;
+    const float* values = nullptr; ///< payload floats (Voice: 6, Global: 1).
+    int cols = 0;
+    int rows = 0;
+    const float* cells = nullptr;  ///< Zones: cols * rows values.
+};
+
+/**
+ * Memory-maps a session log read-only and walks it sample by sample. Nothing
+ * is copied or parsed up front, so opening an hour-long show is instant and
+ * the OS pages records in as the replay reaches them.
+ */
+class SessionLogReader {
+public:
+    SessionLogReader() = default;
+    ~SessionLogReader();
+
+    SessionLogReader(const SessionLogReader&) = delete;
+    SessionLogReader& operator=(const SessionLogReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    const SessionLogHeader& getHeader() const { return *reinterpret_cast<const SessionLogHeader*>(data); }
+    uint64_t getRecordCount() const { return recordCount; }
+    uint64_t getPosition() const { return cursor; }
+    bool isInlineDetection() const { return (getHeader().flags & SessionLogHeader::kFlagInlineDetection) != 0; }
+
+    /// Decode the sample at the cursor and step past it; false at the end.
+    bool next(SessionSample& out);
+    /// Peek at the next sample's timestamp without consuming it.
+    bool peekTimestamp(uint64_t& timestampMicros) const;
+    /// Jump to the first record at or after `timestampMicros` (uses the index when present).
+    void seek(uint64_t timestampMicros);
+    void rewind() { cursor = 0; }
+
+private:
+    const SessionRecord* records() const { return reinterpret_cast<const SessionRecord*>(data + sizeof(SessionLogHeader)); }
+    uint64_t recordMicros(uint64_t record) const { return records()[record].timestampMicros * timeScale; }
+
+    const unsigned char* data = nullptr;
+    std::size_t size = 0;
+    uint64_t recordCount = 0;
+    uint64_t cursor = 0;
+    uint64_t timeScale = 1; // 1000 for a version 1 (milliseconds) log.
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,81 @@
+#include "ShardMap.h"
+
+#include <algorithm>
+
+void ShardMap::setup(const std::vector<Shard>& newShards, float handoffMargin, int maxVoices) {
+    shards = newShards;
+    margin = std::max(0.0f, handoffMargin);
+    // Sized once for every id the slot table accepts, so a handoff mid-show
+    // never allocates.
+    overrides.assign(static_cast<std::size_t>(std::max(1, maxVoices)), -1);
+}
+
+int ShardMap::indexOf(int shard) const {
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+        if (shards[i].shard == shard) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int ShardMap::homeOf(int voiceId) const {
+    if (shards.empty() || voiceId < 0) {
+        return -1;
+    }
+    for (const Shard& shard : shards) {
+        if (voiceId >= shard.firstVoiceId && voiceId <= shard.lastVoiceId) {
+            return shard.shard;
+        }
+    }
+    return shards[static_cast<std::size_t>(voiceId) % shards.size()].shard;
+}
+
+int ShardMap::ownerOf(int voiceId) const {
+    if (voiceId >= 0 && static_cast<std::size_t>(voiceId) < overrides.size() && overrides[voiceId] >= 0) {
+        return overrides[voiceId];
+    }
+    return homeOf(voiceId);
+}
+
+void ShardMap::setOwner(int voiceId, int shard) {
+    if (voiceId >= 0 && static_cast<std::size_t>(voiceId) < overrides.size()) {
+        overrides[voiceId] = shard == homeOf(voiceId) ? -1 : shard;
+    }
+}
+
+void ShardMap::clearOwner(int voiceId) {
+    if (voiceId >= 0 && static_cast<std::size_t>(voiceId) < overrides.size()) {
+        overrides[voiceId] = -1;
+    }
+}
+
+bool ShardMap::isOverridden(int voiceId) const {
+    return voiceId >= 0 && static_cast<std::size_t>(voiceId) < overrides.size() && overrides[voiceId] >= 0;
+}
+
+int ShardMap::cameraOwner(int camId) const {
+    for (const Shard& shard : shards) {
+        if (std::find(shard.cameras.begin(), shard.cameras.end(), camId) != shard.cameras.end()) {
+            return shard.shard;
+        }
+    }
+    return -1;
+}
+
+int ShardMap::regionOwner(int current, float x) const {
+    const int index = indexOf(current);
+    if (index < 0 || !shards[index].hasRegion()) {
+        return current;
+    }
+    const Shard& own = shards[index];
+    if (x >= own.minX - margin && x <= own.maxX + margin) {
+        return current;
+    }
+    for (const Shard& shard : shards) {
+        if (shard.hasRegion() && x >= shard.minX && x <= shard.maxX) {
+            return shard.shard;
+        }
+    }
+    return current; // outside every band: nobody is better placed
+}
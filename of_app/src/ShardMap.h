@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * ShardMap answers "which host is in charge of this?" for a cluster of
+ * edge hosts. Every edge hears every tracker (broadcast, multicast or one
+ * send per edge) but only judges what it owns, so the map must come out the
+ * same on every machine: it is built from the same shard list everywhere and
+ * only changed by ownership messages all of them receive.
+ *
+ * A voice's home shard is the one whose `voice_ids` range holds its id (or
+ * id mod shard count when no range does). A shard with a floor region (an x
+ * band) keeps only the voices standing in it: once a voice walks past the
+ * band's edge by more than the margin, its owner hands it to the shard whose
+ * band it walked into, and records that as an override until the voice
+ * disconnects. Cameras belong to whichever shard lists them; unlisted
+ * cameras are judged by every edge that receives them.
+ */
+class ShardMap {
+public:
+    struct Shard {
+        int shard = 0;
+        std::string host = "127.0.0.1"; ///< Where its cluster port listens.
+        int port = 9101;
+        int firstVoiceId = 0;  ///< Home range, inclusive; empty when last < first.
+        int lastVoiceId = -1;
+        std::vector<int> cameras;
+        float minX = 0.0f;     ///< Floor band it keeps its voices in; none when max <= min.
+        float maxX = 0.0f;
+
+        bool hasRegion() const { return maxX > minX; }
+    };
+
+    void setup(const std::vector<Shard>& shards, float handoffMargin, int maxVoices);
+
+    const std::vector<Shard>& getShards() const { return shards; }
+    /// Position of `shard` in getShards(), or -1.
+    int indexOf(int shard) const;
+
+    int homeOf(int voiceId) const;
+    /// Home shard unless a handoff moved the voice.
+    int ownerOf(int voiceId) const;
+    void setOwner(int voiceId, int shard);
+    /// Back to the home shard (the voice has left the room).
+    void clearOwner(int voiceId);
+    bool isOverridden(int voiceId) const;
+    /// Voice ids the map can track overrides for (0..capacity()-1).
+    int capacity() const { return static_cast<int>(overrides.size()); }
+
+    /// The listing shard, or -1 if nobody lists the camera.
+    int cameraOwner(int camId) const;
+
+    /**
+     * Where a voice standing at `x` belongs when `current` has it now:
+     * `current` while it is inside that band (give or take the margin),
+     * otherwise the first shard whose band holds `x`.
+     */
+    int regionOwner(int current, float x) const;
+
+private:
+    std::vector<Shard> shards;
+    std::vector<int> overrides; // by voice id; -1 = at home.
+    float margin = 0.05f;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * SnapshotBuffer and SnapshotCursor are the byte plumbing behind detector
+ * snapshots (see DetectorSnapshot.h): each detector appends its state with
+ * put()/putArray() and reads it back, in the same order, with get()/getArray().
+ *
+ * Values go in as raw bytes in host order – a snapshot is a warm-restart aid
+ * for the machine that wrote it, not an interchange format – so writing is a
+ * memcpy per field and the buffer keeps its capacity between snapshots.
+ *
+ * Times on the monotonic timeline do not survive a reboot, so the cursor
+ * carries the shift between the writer's clock and ours and rebase*() applies
+ * it. Zero and ~0 are "never" in the detectors and keep that meaning.
+ */
+class SnapshotBuffer {
+public:
+    void clear() { bytes.clear(); }
+    std::size_t size() const { return bytes.size(); }
+    const char* data() const { return bytes.data(); }
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store plain bytes");
+        append(&value, sizeof(T));
+    }
+    template <typename T>
+    void putArray(const T* values, std::size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store plain bytes");
+        append(values, sizeof(T) * count);
+    }
+
+private:
+    void append(const void* source, std::size_t length) {
+        const std::size_t at = bytes.size();
+        bytes.resize(at + length);
+        if (length > 0) {
+            std::memcpy(bytes.data() + at, source, length);
+        }
+    }
+
+    std::vector<char> bytes;
+};
+
+class SnapshotCursor {
+public:
+    /// `offsetMicros` is our clock minus the writer's, added to every rebased time.
+    SnapshotCursor(const char* data, std::size_t size, int64_t offsetMicros = 0)
+        : cursor(data), end(data + size), offset(offsetMicros) {}
+
+    /// False once any read ran past the end; every later read fails too.
+    bool ok() const { return !failed; }
+    bool atEnd() const { return cursor == end; }
+
+    template <typename T>
+    bool get(T& value) {
+        return getArray(&value, 1);
+    }
+    template <typename T>
+    bool getArray(T* values, std::size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshots store plain bytes");
+        const std::size_t length = sizeof(T) * count;
+        if (failed || static_cast<std::size_t>(end - cursor) < length) {
+            failed = true;
+            return false;
+        }
+        if (length > 0) {
+            std::memcpy(values, cursor, length);
+        }
+        cursor += length;
+        return true;
+    }
+    /// Refuse a count the rest of the snapshot could not possibly hold.
+    bool fits(std::size_t count, std::size_t bytesEach) {
+        if (failed || count > static_cast<std::size_t>(end - cursor) / (bytesEach ? bytesEach : 1)) {
+            failed = true;
+        }
+        return !failed;
+    }
+
+    uint64_t rebaseMicros(uint64_t micros) const { return rebase(micros, offset); }
+    uint64_t rebaseMs(uint64_t ms) const { return rebase(ms, offset / 1000); }
+
+private:
+    static uint64_t rebase(uint64_t value, int64_t shift) {
+        if (value == 0 || value == ~uint64_t(0)) {
+            return value;
+        }
+        const int64_t shifted = static_cast<int64_t>(value) + shift;
+        return shifted > 1 ? static_cast<uint64_t>(shifted) : 1;
+    }
+
+    const char* cursor;
+    const char* end;
+    int64_t offset;
+    bool failed = false;
+};
@@ -0,0 +1,24 @@
+#include "SourceClock.h"
+
+constexpr uint64_t SourceClock::kWindowMicros;
+constexpr int64_t SourceClock::kResetMicros;
+
+uint64_t SourceClock::map(int64_t sourceMicros, uint64_t arrivalMicros) {
+    const int64_t guess = static_cast<int64_t>(arrivalMicros) - sourceMicros;
+    if (!primed || guess - best() > kResetMicros) {
+        primed = true;
+        current = guess;
+        previous = guess;
+        windowStart = arrivalMicros;
+    } else if (arrivalMicros - windowStart >= kWindowMicros) {
+        previous = current;
+        current = guess;
+        windowStart = arrivalMicros;
+    } else if (guess < current) {
+        current = guess;
+    }
+
+    // best() <= guess, so the mapped time is at most the arrival.
+    const int64_t mapped = sourceMicros + best();
+    return mapped > 0 ? static_cast<uint64_t>(mapped) : 0;
+}
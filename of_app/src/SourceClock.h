@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * SourceClock carries a tracker's own timestamps over onto the host's
+ * monotonicMicros() timeline. The two clocks share nothing but a rate (give
+ * or take a few ppm), so what we need is the offset between them. Every
+ * packet gives us one guess – arrival minus source time – and each guess is
+ * too large by however long that packet sat in the network, the tracker's
+ * send queue or our socket buffer. The smallest guess is therefore the best
+ * one: the packet that got here fastest says the most about the offset.
+ *
+ * We keep the minimum over the current window and the one before it, so a
+ * burst of late packets never moves the estimate while slow drift between
+ * the clocks is followed within two windows. A guess far above the estimate
+ * means the tracker restarted (its clock jumped back), and we start over.
+ *
+ * Mapped times never land after the packet's own arrival, so a detector is
+ * never handed a sample from the future.
+ */
+class SourceClock {
+public:
+    /// Minimum offsets are kept per window of this length.
+    static constexpr uint64_t kWindowMicros = 2000000;
+    /// A guess this far above the estimate is a clock that jumped, not a late packet.
+    static constexpr int64_t kResetMicros = 1000000;
+
+    /// Map a source stamp that arrived at `arrivalMicros` onto the host timeline.
+    uint64_t map(int64_t sourceMicros, uint64_t arrivalMicros);
+
+    void reset() { primed = false; }
+
+    /// Current estimate of host minus source time, in µs (0 until the first map()).
+    int64_t getOffsetMicros() const { return primed ? best() : 0; }
+
+private:
+    int64_t best() const { return current < previous ? current : previous; }
+
+    bool primed = false;
+    int64_t current = 0;  // smallest guess in the running window.
+    int64_t previous = 0; // smallest guess in the window before.
+    uint64_t windowStart = 0;
+};
@@ -0,0 +1,54 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Keeps the cell maths in int range even if a tracker sends garbage.
+constexpr float kMaxCell = 1.0e6f;
+} // namespace
+
+void SpatialGrid::build(const float* pointXs, const float* pointZs, std::size_t count, float cellSize) {
+    inverseCell = 1.0f / std::max(cellSize, 1.0e-4f);
+    xs.assign(pointXs, pointXs + count);
+    zs.assign(pointZs, pointZs + count);
+
+    // About two buckets per point keeps chains short without a sparse table.
+    uint32_t buckets = 16;
+    while (buckets < 2 * count) {
+        buckets <<= 1;
+    }
+    bucketMask = buckets - 1;
+    bucketStart.assign(buckets + 1, 0);
+    pointBucket.resize(count);
+    order.resize(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint32_t bucket = bucketOf(cellOf(xs[i]), cellOf(zs[i]));
+        pointBucket[i] = bucket;
+        ++bucketStart[bucket + 1];
+    }
+    for (uint32_t b = 0; b < buckets; ++b) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    // Fill each bucket from its end, back to front, so points keep their
+    // index order inside a bucket. Afterwards slot b + 1 holds where bucket b
+    // starts, so shift everything down by one.
+    for (std::size_t i = count; i-- > 0;) {
+        order[--bucketStart[pointBucket[i] + 1]] = static_cast<uint32_t>(i);
+    }
+    for (uint32_t b = 0; b < buckets; ++b) {
+        bucketStart[b] = bucketStart[b + 1];
+    }
+    bucketStart[buckets] = static_cast<uint32_t>(count);
+}
+
+int SpatialGrid::cellOf(float value) const {
+    const float cell = std::floor(value * inverseCell);
+    return static_cast<int>(std::max(-kMaxCell, std::min(kMaxCell, cell)));
+}
+
+uint32_t SpatialGrid::bucketOf(int cellX, int cellZ) const {
+    const uint32_t hash = (static_cast<uint32_t>(cellX) * 73856093u) ^ (static_cast<uint32_t>(cellZ) * 19349663u);
+    return hash & bucketMask;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * SpatialGrid buckets points on the floor plane into square cells one query
+ * radius wide, so "who stands within r of here?" only ever looks at the 3×3
+ * cells around the spot instead of the whole crowd. Cells are hashed into a
+ * power-of-two table, so the room can be any size and empty floor costs
+ * nothing. It is rebuilt from scratch every frame with a counting sort – two
+ * linear passes, and no allocation once the buffers have grown to the crowd.
+ */
+class SpatialGrid {
+public:
+    /// Re-bucket `count` points (parallel x / z arrays) into cells `cellSize` wide.
+    void build(const float* xs, const float* zs, std::size_t count, float cellSize);
+
+    /**
+     * Call `visit(index)` for every point within `radius` of (x, z), the
+     * point sitting there included. `radius` must not exceed the cell size.
+     */
+    template <typename Visit>
+    void forEachNeighbor(float x, float z, float radius, Visit&& visit) const;
+
+    std::size_t size() const { return xs.size(); }
+    float getX(std::size_t index) const { return xs[index]; }
+    float getZ(std::size_t index) const { return zs[index]; }
+
+private:
+    int cellOf(float value) const;
+    uint32_t bucketOf(int cellX, int cellZ) const;
+
+    float inverseCell = 1.0f;
+    uint32_t bucketMask = 0;
+    std::vector<float> xs;
+    std::vector<float> zs;
+    std::vector<uint32_t> pointBucket;  // bucket of each point.
+    std::vector<uint32_t> bucketStart;  // bucketMask + 2 prefix sums into `order`.
+    std::vector<uint32_t> order;        // point indices grouped by bucket.
+};
+
+template <typename Visit>
+void SpatialGrid::forEachNeighbor(float x, float z, float radius, Visit&& visit) const {
+    if (xs.empty()) {
+        return;
+    }
+    const int cellX = cellOf(x);
+    const int cellZ = cellOf(z);
+    const float radiusSq = radius * radius;
+
+    // Two of the nine cells can hash to the same bucket; remember which
+    // buckets were walked so nobody is visited twice.
+    uint32_t walked[9];
+    int walkedCount = 0;
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            const uint32_t bucket = bucketOf(cellX + dx, cellZ + dz);
+            bool seen = false;
+            for (int i = 0; i < walkedCount && !seen; ++i) {
+                seen = walked[i] == bucket;
+            }
+            if (seen) {
+                continue;
+            }
+            walked[walkedCount++] = bucket;
+            for (uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; ++i) {
+                const uint32_t point = order[i];
+                const float ox = xs[point] - x;
+                const float oz = zs[point] - z;
+                if (ox * ox + oz * oz <= radiusSq) {
+                    visit(static_cast<std::size_t>(point));
+                }
+            }
+        }
+    }
+}
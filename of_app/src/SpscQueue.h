@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * SpscQueue is the hand-off tray between exactly one producer thread and
+ * exactly one consumer thread. It is a bounded ring of preallocated slots, so
+ * pushing and popping never touch the allocator and never take a lock: the
+ * producer only writes `tail`, the consumer only writes `head`, and each side
+ * peeks at the other's counter with acquire/release ordering. When the tray is
+ * full we refuse the item instead of blocking, which is exactly what a network
+ * thread wants – better to drop one packet than to stall the socket.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity = 1024) {
+        reset(capacity);
+    }
+
+    /**
+     * Resize and empty the ring. Capacity is rounded up to a power of two so
+     * wrapping is a cheap mask. Only call this while neither thread is using
+     * the queue (e.g. before the receive thread starts).
+     */
+    void reset(std::size_t capacity) {
+        std::size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        slots.assign(rounded, T());
+        mask = rounded - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    /// Producer side. Returns false (and leaves the queue untouched) when full.
+    bool push(const T& item) {
+        const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        slots[currentTail & mask] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Zero-copy producer side: the slot the next push would fill, or null when
+     * full. Write the item in place, then commit(). Nothing is visible to the
+     * consumer until commit(), and a prepared slot may be abandoned freely.
+     * Slots are recycled, so fields you do not write keep stale values.
+     */
+    T* prepare() {
+        const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) > mask) {
+            return nullptr;
+        }
+        return &slots[currentTail & mask];
+    }
+    void commit() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Zero-copy consumer side: the oldest item, or null. Valid until popFront().
+    const T* front() const {
+        const std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[currentHead & mask];
+    }
+    void popFront() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Consumer side. Returns false when there is nothing waiting.
+    bool pop(T& out) {
+        const std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = slots[currentHead & mask];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Approximate fill level; exact only when called from one of the two ends.
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    static constexpr std::size_t kCacheLine = 64;
+
+    std::vector<T> slots;
+    std::size_t mask = 0;
+
+    // Keep the two counters on separate cache lines so the producer and the
+    // consumer do not ping-pong the same line between cores on every packet.
+    char padBeforeHead[kCacheLine];
+    std::atomic<std::size_t> head{0};
+    char padBetween[kCacheLine - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> tail{0};
+    char padAfterTail[kCacheLine - sizeof(std::atomic<std::size_t>)];
+};
@@ -0,0 +1,181 @@
+#include "StageProfiler.h"
+
+#include "ofLog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+const char* kStageNames[] = {
+    "update", "processOscMessages", "handlePacket", "runDetectionTick", "cluster", "pruneVoices", "landCoalescedSamples",
+    "updateVoiceGestures", "voiceWorker", "voiceDetector", "zoneDetector", "updateGlobalGestures", "updateEnsembleGestures",
+    "telemetry", "snapshot", "flushGestures", "advanceReplay",
+};
+static_assert(sizeof(kStageNames) / sizeof(kStageNames[0]) == kProfileStageCount, "profile stage names out of sync");
+
+// Threads are numbered as they first record a zone; names are optional.
+constexpr std::size_t kMaxNamedThreads = 64;
+std::atomic<uint16_t> threadCounter{0};
+std::array<std::atomic<const char*>, kMaxNamedThreads> threadNames{};
+
+uint16_t currentThread() {
+    thread_local const uint16_t index = threadCounter.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void raiseMax(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+} // namespace
+
+StageProfiler::StageProfiler(std::size_t traceCapacity)
+    : events(new TraceEvent[std::max<std::size_t>(1, traceCapacity)]), capacity(std::max<std::size_t>(1, traceCapacity)) {}
+
+StageProfiler::~StageProfiler() {
+    tracing.store(false);
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void StageProfiler::record(ProfileStage stage, uint64_t beginNanos, uint64_t endNanos) {
+    const uint64_t elapsed = endNanos > beginNanos ? endNanos - beginNanos : 0;
+    Counter& counter = counters[static_cast<std::size_t>(stage)];
+    counter.calls.fetch_add(1, std::memory_order_relaxed);
+    counter.totalNanos.fetch_add(elapsed, std::memory_order_relaxed);
+    raiseMax(counter.maxNanos, elapsed);
+
+    if (!tracing.load(std::memory_order_acquire)) {
+        return;
+    }
+    const std::size_t index = traceNext.fetch_add(1, std::memory_order_relaxed);
+    if (index >= capacity) {
+        traceDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent& event = events[index];
+    event.beginNanos = beginNanos;
+    event.durationNanos = static_cast<uint32_t>(std::min<uint64_t>(elapsed, UINT32_MAX));
+    event.thread = currentThread();
+    event.stage = static_cast<uint8_t>(stage);
+    event.ready.store(true, std::memory_order_release);
+}
+
+void StageProfiler::drain(std::array<ProfileSummary, kProfileStageCount>& out) {
+    for (std::size_t i = 0; i < kProfileStageCount; ++i) {
+        ProfileSummary& summary = out[i];
+        summary.name = kStageNames[i];
+        summary.calls = counters[i].calls.exchange(0, std::memory_order_relaxed);
+        summary.totalNanos = counters[i].totalNanos.exchange(0, std::memory_order_relaxed);
+        summary.maxNanos = counters[i].maxNanos.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+bool StageProfiler::startTrace(const std::string& path, uint64_t durationMs) {
+    if (tracing.load() || writing.load()) {
+        return false;
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    for (std::size_t i = 0; i < capacity; ++i) {
+        events[i].ready.store(false, std::memory_order_relaxed);
+    }
+    tracePath = path;
+    traceNext.store(0, std::memory_order_relaxed);
+    traceDropped.store(0, std::memory_order_relaxed);
+    traceStartNanos = monotonicNanos();
+    traceEndNanos = traceStartNanos + std::max<uint64_t>(1, durationMs) * 1000000;
+    tracing.store(true, std::memory_order_release);
+    ofLogNotice("StageProfiler") << "tracing for " << durationMs << " ms into " << path;
+    return true;
+}
+
+void StageProfiler::poll() {
+    if (!tracing.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (monotonicNanos() < traceEndNanos && traceNext.load(std::memory_order_relaxed) < capacity) {
+        return;
+    }
+    stopTrace();
+}
+
+void StageProfiler::stopTrace() {
+    if (!tracing.exchange(false)) {
+        return;
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    writing.store(true);
+    writer = std::thread([this]() {
+        writeTrace();
+        writing.store(false);
+    });
+}
+
+const char* StageProfiler::stageName(ProfileStage stage) {
+    return kStageNames[static_cast<std::size_t>(stage)];
+}
+
+void StageProfiler::nameThisThread(const char* name) {
+    const uint16_t index = currentThread();
+    if (index < kMaxNamedThreads) {
+        threadNames[index].store(name, std::memory_order_relaxed);
+    }
+}
+
+void StageProfiler::writeTrace() {
+    // Chrome's trace event format: complete ("X") events with begin and
+    // duration in microseconds, plus a name per thread. Times start at the
+    // moment the capture began.
+    FILE* file = std::fopen(tracePath.c_str(), "w");
+    if (!file) {
+        ofLogError("StageProfiler") << "could not write trace " << tracePath;
+        return;
+    }
+    const std::size_t count = std::min(traceNext.load(), capacity);
+    std::vector<bool> seenThreads;
+    std::size_t written = 0;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (std::size_t i = 0; i < count; ++i) {
+        const TraceEvent& event = events[i];
+        // A zone that opened before the capture, or one still being written, is left out.
+        if (!event.ready.load(std::memory_order_acquire) || event.beginNanos < traceStartNanos) {
+            continue;
+        }
+        if (event.thread >= seenThreads.size()) {
+            seenThreads.resize(event.thread + 1, false);
+        }
+        seenThreads[event.thread] = true;
+        const uint64_t begin = event.beginNanos - traceStartNanos;
+        std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"host\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%u.%03u}",
+                     written ? ",\n" : "", kStageNames[event.stage], static_cast<unsigned>(event.thread),
+                     static_cast<unsigned long long>(begin / 1000), static_cast<unsigned>(begin % 1000),
+                     static_cast<unsigned>(event.durationNanos / 1000), static_cast<unsigned>(event.durationNanos % 1000));
+        ++written;
+    }
+    const std::size_t zones = written;
+    for (std::size_t thread = 0; thread < seenThreads.size(); ++thread) {
+        if (!seenThreads[thread]) {
+            continue;
+        }
+        const char* name = thread < kMaxNamedThreads ? threadNames[thread].load(std::memory_order_relaxed) : nullptr;
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                     written ? ",\n" : "", static_cast<unsigned>(thread), name ? name : "thread", static_cast<unsigned>(thread));
+        ++written;
+    }
+    std::fprintf(file, "\n]}\n");
+    const bool ok = std::fclose(file) == 0;
+    if (!ok) {
+        ofLogError("StageProfiler") << "could not finish trace " << tracePath;
+        return;
+    }
+    ofLogNotice("StageProfiler") << "wrote " << tracePath << " (" << zones << " zones"
+                                 << (traceDropped.load() ? ", " + std::to_string(traceDropped.load()) + " dropped" : std::string())
+                                 << ")";
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "LatencyStats.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * The stages of the update loop and the detector calls inside them – the
+ * pieces a frame is spent on. Nested zones overlap: Update contains
+ * DetectionTick, which contains the gesture passes, and so on.
+ */
+enum class ProfileStage : uint8_t {
+    Update,
+    ProcessOsc,
+    HandlePacket,
+    DetectionTick,
+    Cluster,
+    Prune,
+    LandSamples,
+    VoiceGestures,
+    VoiceWorker,
+    VoiceDetector,
+    ZoneDetector,
+    GlobalGestures,
+    EnsembleGestures,
+    Telemetry,
+    Snapshot,
+    Flush,
+    Replay,
+    Count
+};
+
+constexpr std::size_t kProfileStageCount = static_cast<std::size_t>(ProfileStage::Count);
+
+/// One stage over the last drain interval.
+struct ProfileSummary {
+    const char* name = "";
+    uint64_t calls = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+};
+
+/**
+ * StageProfiler answers "which stage ate the frame?". Every ScopedProfile
+ * adds its duration to a per-stage counter (calls, total, worst) – a few
+ * relaxed atomic adds, safe from any thread – which the HUD reads once a
+ * second. Zones are timed in nanoseconds, since a single voice's rules
+ * take well under a microsecond.
+ *
+ * On demand it also captures a trace: for `durationMs` every zone is kept
+ * as an event (stage, thread, begin, duration) in a preallocated buffer,
+ * then a background thread writes them as Chrome trace JSON, which
+ * chrome://tracing and ui.perfetto.dev open directly. Threads show up under
+ * the names given to nameThisThread().
+ */
+class StageProfiler {
+public:
+    /// `traceCapacity` events are allocated up front; a capture stops early when they run out.
+    explicit StageProfiler(std::size_t traceCapacity = 1 << 18);
+    ~StageProfiler();
+
+    StageProfiler(const StageProfiler&) = delete;
+    StageProfiler& operator=(const StageProfiler&) = delete;
+
+    /// One finished zone, in monotonicNanos().
+    void record(ProfileStage stage, uint64_t beginNanos, uint64_t endNanos);
+
+    /// Counters since the last drain, indexed by ProfileStage; they start over at zero.
+    void drain(std::array<ProfileSummary, kProfileStageCount>& out);
+
+    /**
+     * Start capturing a trace to `path`. False while a capture is running or
+     * still being written.
+     */
+    bool startTrace(const std::string& path, uint64_t durationMs);
+    /// Ends a capture whose time (or buffer) is up and hands it to the writer. Call once per frame.
+    void poll();
+    /// End a running capture now and write what it has (e.g. on exit).
+    void stopTrace();
+    bool isTracing() const { return tracing.load(std::memory_order_relaxed); }
+    /// Events the last capture could not keep because the buffer was full.
+    uint64_t getTraceDropped() const { return traceDropped.load(std::memory_order_relaxed); }
+
+    static const char* stageName(ProfileStage stage);
+    /// Label the calling thread in traces. `name` must outlive the profiler (a string literal).
+    static void nameThisThread(const char* name);
+
+private:
+    struct Counter {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> totalNanos{0};
+        std::atomic<uint64_t> maxNanos{0};
+    };
+
+    struct TraceEvent {
+        uint64_t beginNanos = 0;
+        uint32_t durationNanos = 0;      // clamped at ~4 s.
+        uint16_t thread = 0;
+        uint8_t stage = 0;
+        std::atomic<bool> ready{false}; ///< Set last, so the writer never reads a half-written event.
+    };
+
+    void writeTrace();
+
+    std::array<Counter, kProfileStageCount> counters;
+
+    std::unique_ptr<TraceEvent[]> events;
+    std::size_t capacity = 0;
+    std::atomic<bool> tracing{false};
+    std::atomic<std::size_t> traceNext{0};
+    std::atomic<uint64_t> traceDropped{0};
+    uint64_t traceStartNanos = 0;
+    uint64_t traceEndNanos = 0;
+    std::string tracePath;
+    std::thread writer;
+    std::atomic<bool> writing{false};
+};
+
+/**
+ * Times the enclosing scope into `stage`. With a null profiler it never
+ * touches the clock, like ScopedLatency.
+ */
+class ScopedProfile {
+public:
+    ScopedProfile(StageProfiler* sink, ProfileStage timed)
+        : profiler(sink), stage(timed), start(sink ? monotonicNanos() : 0) {}
+    ~ScopedProfile() {
+        if (profiler) {
+            profiler->record(stage, start, monotonicNanos());
+        }
+    }
+
+    ScopedProfile(const ScopedProfile&) = delete;
+    ScopedProfile& operator=(const ScopedProfile&) = delete;
+
+private:
+    StageProfiler* profiler;
+    ProfileStage stage;
+    uint64_t start;
+};
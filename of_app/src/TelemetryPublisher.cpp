@@ -0,0 +1,329 @@
+#include "TelemetryPublisher.h"
+
+#include "ofLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+constexpr int TelemetryPublisher::kMaxCameras;
+constexpr std::size_t TelemetryPublisher::kVoiceRecordBytes;
+
+namespace {
+const char* const kFrameAddress = "/room/telemetry/frame";
+const char* const kVoicesAddress = "/room/telemetry/voices";
+const char* const kGoneAddress = "/room/telemetry/gone";
+const char* const kZonesAddress = "/room/telemetry/zones";
+
+// "#bundle" plus its time tag, and the size every element is prefixed with.
+constexpr std::size_t kBundleHeaderBytes = 16;
+constexpr std::size_t kElementPrefixBytes = 4;
+
+template <typename T>
+void readKey(const ofJson& block, const char* key, T& value) {
+    if (block.contains(key)) {
+        value = block[key].get<T>();
+    }
+}
+
+std::size_t paddedBytes(std::size_t bytes) {
+    return (bytes + 3) & ~std::size_t(3);
+}
+
+/// Encoded size of a message with `numbers` 32-bit arguments followed by one blob.
+std::size_t blobMessageBytes(const char* address, std::size_t numbers, std::size_t blobBytes) {
+    // Type tags: ',' + one per argument + NUL.
+    return paddedBytes(std::strlen(address) + 1) + paddedBytes(numbers + 3) + numbers * 4 + 4 + paddedBytes(blobBytes);
+}
+
+/// /room/telemetry/frame i:seq i:voices f:motion i:keyframeMs.
+std::size_t frameMessageBytes() {
+    return paddedBytes(std::strlen(kFrameAddress) + 1) + paddedBytes(6) + 16;
+}
+
+/// The smallest bundle every message fits: the frame message plus a full-size camera grid.
+std::size_t minimumMtu() {
+    return kBundleHeaderBytes + 2 * kElementPrefixBytes + frameMessageBytes() + blobMessageBytes(kZonesAddress, 3, kMaxZoneCells);
+}
+
+float finiteOrZero(float value) {
+    return std::isfinite(value) ? value : 0.0f;
+}
+
+int16_t quantizePosition(float value) {
+    return static_cast<int16_t>(std::lround(ofClamp(finiteOrZero(value), -1.0f, 1.0f) * 32767.0f));
+}
+
+uint8_t quantizeUnit(float value) {
+    return static_cast<uint8_t>(std::lround(ofClamp(finiteOrZero(value), 0.0f, 1.0f) * 255.0f));
+}
+
+// Blobs are big-endian, like every other number in OSC.
+void putUint16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xff));
+}
+
+int gap(int a, int b) {
+    return std::abs(a - b);
+}
+} // namespace
+
+TelemetryPublisher::~TelemetryPublisher() {
+    stop();
+}
+
+bool TelemetryPublisher::start(const Settings& newSettings, std::size_t maxVoices) {
+    stop();
+    settings = newSettings;
+    // Below minimumMtu() a full 256-cell grid would not fit even a fresh bundle and
+    // the stream would throw on the detection thread.
+    settings.mtu = std::max(minimumMtu(), std::min<std::size_t>(settings.mtu, 65507));
+    settings.keyframeMs = std::max(100, settings.keyframeMs);
+    positionEpsilon = static_cast<int>(std::lround(std::max(0.0f, settings.positionEpsilon) * 32767.0f));
+    valueEpsilon = static_cast<int>(std::lround(std::max(0.0f, settings.valueEpsilon) * 255.0f));
+
+    // A voices or gone message must fit a bundle that already holds the frame message.
+    const std::size_t room = settings.mtu - kBundleHeaderBytes - 2 * kElementPrefixBytes - frameMessageBytes() -
+                             blobMessageBytes(kVoicesAddress, 0, 0);
+    recordsPerMessage = std::max<std::size_t>(1, room / kVoiceRecordBytes);
+    gonePerMessage = std::max<std::size_t>(1, room / 2);
+
+    current.assign(maxVoices, QuantizedVoice());
+    grids.assign(kMaxCameras, QuantizedGrid());
+    buffer.assign(settings.mtu, 0);
+    stream.reset(new osc::OutboundPacketStream(buffer.data(), buffer.size()));
+    records.reserve(recordsPerMessage * kVoiceRecordBytes);
+    gone.reserve(gonePerMessage * 2);
+    bytesSent.store(0);
+    datagramsSent.store(0);
+
+    links.reserve(settings.destinations.size());
+    for (const Destination& destination : settings.destinations) {
+        Link link;
+        link.destination = destination;
+        link.periodMicros = static_cast<uint64_t>(1000000.0f / std::max(0.1f, destination.rateHz));
+        try {
+            link.socket.reset(new UdpTransmitSocket(IpEndpointName(destination.host.c_str(), destination.port)));
+        } catch (const std::exception& e) {
+            ofLogError("TelemetryPublisher") << "could not open " << destination.name << " (" << destination.host << ":"
+                                             << destination.port << "): " << e.what();
+            continue;
+        }
+        link.sent.assign(maxVoices, QuantizedVoice());
+        link.sentGrids.assign(kMaxCameras, QuantizedGrid());
+        ofLogNotice("TelemetryPublisher") << "telemetry to " << destination.name << " (" << destination.host << ":"
+                                          << destination.port << ") at " << destination.rateHz << " Hz";
+        links.push_back(std::move(link));
+    }
+    return !links.empty();
+}
+
+void TelemetryPublisher::stop() {
+    links.clear();
+}
+
+void TelemetryPublisher::noteZones(int camId, int cols, int rows, const float* cells) {
+    if (links.empty() || camId < 0 || camId >= kMaxCameras || cols <= 0 || rows <= 0 || cols * rows > kMaxZoneCells) {
+        return;
+    }
+    QuantizedGrid& grid = grids[camId];
+    grid.seen = true;
+    grid.cols = cols;
+    grid.rows = rows;
+    for (int i = 0; i < cols * rows; ++i) {
+        grid.cells[i] = quantizeUnit(cells[i]);
+    }
+}
+
+void TelemetryPublisher::publish(uint64_t nowMicros, const VoiceSlotTable& voices, float globalMotion) {
+    bool due = false;
+    for (const Link& link : links) {
+        due = due || nowMicros >= link.nextMicros;
+    }
+    if (!due) {
+        return;
+    }
+    // Quantize once; every dashboard due this tick compares against the same values.
+    quantizeVoices(voices);
+    for (Link& link : links) {
+        if (nowMicros >= link.nextMicros) {
+            publishTo(link, nowMicros, static_cast<int>(voices.size()), globalMotion);
+        }
+    }
+}
+
+void TelemetryPublisher::quantizeVoices(const VoiceSlotTable& voices) {
+    const std::size_t span = static_cast<std::size_t>(voices.span());
+    if (span > current.size()) {
+        // The table grew past what start() was told; follow it.
+        current.resize(span);
+        for (Link& link : links) {
+            link.sent.resize(span);
+        }
+    }
+    for (std::size_t id = 0; id < current.size(); ++id) {
+        QuantizedVoice& voice = current[id];
+        const VoiceSlot* slot = id < span ? &voices.slot(static_cast<int>(id)) : nullptr;
+        voice.live = slot && slot->live;
+        if (!voice.live) {
+            continue;
+        }
+        voice.x = quantizePosition(slot->position.x);
+        voice.y = quantizePosition(slot->position.y);
+        voice.z = quantizePosition(slot->position.z);
+        voice.size = quantizeUnit(slot->size);
+        voice.motion = quantizeUnit(slot->motion);
+        voice.energy = quantizeUnit(slot->energy);
+    }
+}
+
+void TelemetryPublisher::publishTo(Link& link, uint64_t nowMicros, int activeVoices, float globalMotion) {
+    const bool keyframe = nowMicros >= link.nextKeyframeMicros;
+    if (keyframe) {
+        link.nextKeyframeMicros = nowMicros + static_cast<uint64_t>(settings.keyframeMs) * 1000;
+    }
+    // Keep the cadence, but never try to make up for ticks we were late for.
+    link.nextMicros += link.periodMicros;
+    if (link.nextMicros <= nowMicros) {
+        link.nextMicros = nowMicros + link.periodMicros;
+    }
+    frameSequence = link.sequence++;
+    frameVoices = activeVoices;
+    frameMotion = globalMotion;
+    beginBundle();
+
+    records.clear();
+    gone.clear();
+    for (std::size_t id = 0; id < current.size(); ++id) {
+        const QuantizedVoice& voice = current[id];
+        QuantizedVoice& sent = link.sent[id];
+        if (voice.live) {
+            if (!keyframe && sent.live && !voiceChanged(voice, sent)) {
+                continue;
+            }
+            putUint16(records, static_cast<uint16_t>(id));
+            putUint16(records, static_cast<uint16_t>(voice.x));
+            putUint16(records, static_cast<uint16_t>(voice.y));
+            putUint16(records, static_cast<uint16_t>(voice.z));
+            records.push_back(voice.size);
+            records.push_back(voice.motion);
+            records.push_back(voice.energy);
+            records.push_back(0);
+            sent = voice;
+            if (records.size() >= recordsPerMessage * kVoiceRecordBytes) {
+                flushVoices(link);
+            }
+        } else if (sent.live) {
+            putUint16(gone, static_cast<uint16_t>(id));
+            sent.live = false;
+            if (gone.size() >= gonePerMessage * 2) {
+                flushGone(link);
+            }
+        }
+    }
+    flushVoices(link);
+    flushGone(link);
+
+    for (int camId = 0; camId < kMaxCameras; ++camId) {
+        const QuantizedGrid& grid = grids[camId];
+        QuantizedGrid& sent = link.sentGrids[camId];
+        if (!grid.seen || (!keyframe && !gridChanged(grid, sent))) {
+            continue;
+        }
+        const std::size_t cellCount = static_cast<std::size_t>(grid.cols * grid.rows);
+        reserve(link, blobMessageBytes(kZonesAddress, 3, cellCount));
+        *stream << osc::BeginMessage(kZonesAddress) << static_cast<osc::int32>(camId) << static_cast<osc::int32>(grid.cols)
+                << static_cast<osc::int32>(grid.rows) << osc::Blob(grid.cells.data(), static_cast<osc::uint32>(cellCount))
+                << osc::EndMessage;
+        sent = grid;
+    }
+    sendBundle(link);
+}
+
+bool TelemetryPublisher::voiceChanged(const QuantizedVoice& now, const QuantizedVoice& sent) const {
+    return gap(now.x, sent.x) > positionEpsilon || gap(now.y, sent.y) > positionEpsilon || gap(now.z, sent.z) > positionEpsilon ||
+           gap(now.size, sent.size) > valueEpsilon || gap(now.motion, sent.motion) > valueEpsilon ||
+           gap(now.energy, sent.energy) > valueEpsilon;
+}
+
+bool TelemetryPublisher::gridChanged(const QuantizedGrid& now, const QuantizedGrid& sent) const {
+    if (!sent.seen || now.cols != sent.cols || now.rows != sent.rows) {
+        return true;
+    }
+    for (int i = 0; i < now.cols * now.rows; ++i) {
+        if (gap(now.cells[i], sent.cells[i]) > valueEpsilon) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TelemetryPublisher::beginBundle() {
+    // Every datagram of a tick starts with the same frame message, so each
+    // one makes sense on its own.
+    stream->Clear();
+    *stream << osc::BeginBundleImmediate << osc::BeginMessage(kFrameAddress) << static_cast<osc::int32>(frameSequence)
+            << static_cast<osc::int32>(frameVoices) << frameMotion
+            << static_cast<osc::int32>(settings.keyframeMs) << osc::EndMessage;
+}
+
+void TelemetryPublisher::reserve(Link& link, std::size_t messageBytes) {
+    if (stream->Size() + kElementPrefixBytes + messageBytes > buffer.size()) {
+        sendBundle(link);
+        beginBundle();
+    }
+}
+
+void TelemetryPublisher::flushVoices(Link& link) {
+    if (records.empty()) {
+        return;
+    }
+    reserve(link, blobMessageBytes(kVoicesAddress, 0, records.size()));
+    *stream << osc::BeginMessage(kVoicesAddress) << osc::Blob(records.data(), static_cast<osc::uint32>(records.size()))
+            << osc::EndMessage;
+    records.clear();
+}
+
+void TelemetryPublisher::flushGone(Link& link) {
+    if (gone.empty()) {
+        return;
+    }
+    reserve(link, blobMessageBytes(kGoneAddress, 0, gone.size()));
+    *stream << osc::BeginMessage(kGoneAddress) << osc::Blob(gone.data(), static_cast<osc::uint32>(gone.size()))
+            << osc::EndMessage;
+    gone.clear();
+}
+
+void TelemetryPublisher::sendBundle(Link& link) {
+    *stream << osc::EndBundle;
+    try {
+        link.socket->Send(stream->Data(), stream->Size());
+        bytesSent.fetch_add(stream->Size(), std::memory_order_relaxed);
+        datagramsSent.fetch_add(1, std::memory_order_relaxed);
+    } catch (const std::exception& e) {
+        // A dashboard that went away must not take detection with it.
+        ofLogVerbose("TelemetryPublisher") << "send to " << link.destination.name << " failed: " << e.what();
+    }
+}
+
+void readTelemetrySettings(const ofJson& json, TelemetryPublisher::Settings& settings) {
+    readKey(json, "position_epsilon", settings.positionEpsilon);
+    readKey(json, "value_epsilon", settings.valueEpsilon);
+    readKey(json, "keyframe_ms", settings.keyframeMs);
+    readKey(json, "mtu", settings.mtu);
+    if (json.contains("destinations")) {
+        settings.destinations.clear();
+        for (const auto& entry : json["destinations"]) {
+            TelemetryPublisher::Destination destination;
+            destination.name = "dashboard " + ofToString(settings.destinations.size());
+            readKey(entry, "name", destination.name);
+            readKey(entry, "host", destination.host);
+            readKey(entry, "port", destination.port);
+            readKey(entry, "rate_hz", destination.rateHz);
+            settings.destinations.push_back(destination);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofJson.h"
+
+#include "OscOutboundPacketStream.h"
+#include "UdpSocket.h"
+
+#include "GestureTypes.h"
+#include "VoiceSlotTable.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * TelemetryPublisher feeds dashboards a picture of the room without handing
+ * them the raw tracker firehose. Every voice at 30 Hz as separate float
+ * messages is fine on the show network but wasteful for a laptop on Wi-Fi
+ * that only needs to draw dots, so each destination gets its own, slower
+ * rate (15 Hz by default) and, per tick, only what changed since the last
+ * thing it was sent:
+ *
+ *  - voices whose position moved more than `positionEpsilon` or whose
+ *    size/motion/energy moved more than `valueEpsilon`, packed as 12-byte
+ *    records with 16-bit positions and 8-bit values;
+ *  - the ids of voices that left;
+ *  - camera grids with at least one cell past `valueEpsilon`, as bytes.
+ *
+ * Every `keyframeMs` a destination is sent everything, so a dashboard that
+ * joins late or loses a datagram catches up on its own. A tick is one OSC
+ * bundle, split into more only when it would not fit the MTU. The wire
+ * format is in docs/OSC_SCHEMA.md ("Dashboard telemetry").
+ *
+ * Like ClusterNode's sends, publishing happens inline on whichever thread
+ * runs detection; the work is a walk over the voice table and a few
+ * hundred bytes of copying per destination, and nothing allocates once
+ * start() is done.
+ */
+class TelemetryPublisher {
+public:
+    /// Camera ids at or above this are not forwarded.
+    static constexpr int kMaxCameras = 64;
+    /// One voice record in /room/telemetry/voices.
+    static constexpr std::size_t kVoiceRecordBytes = 12;
+
+    struct Destination {
+        std::string name = "dashboard";
+        std::string host = "127.0.0.1";
+        int port = 9000;
+        float rateHz = 15.0f;                   ///< Ticks per second sent to this dashboard.
+    };
+
+    struct Settings {
+        float positionEpsilon = 0.002f;         ///< Smallest position change worth resending.
+        float valueEpsilon = 0.02f;             ///< Same for size, motion, energy and zone cells.
+        int keyframeMs = 2000;                  ///< Everything is resent this often.
+        std::size_t mtu = 1472;                 ///< Largest datagram; a tick splits into more bundles past this.
+        std::vector<Destination> destinations;
+
+        bool isActive() const { return !destinations.empty(); }
+    };
+
+    TelemetryPublisher() = default;
+    ~TelemetryPublisher();
+
+    TelemetryPublisher(const TelemetryPublisher&) = delete;
+    TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+    /// Open a socket per destination. False if none could be opened.
+    bool start(const Settings& settings, std::size_t maxVoices);
+    void stop();
+    bool isActive() const { return !links.empty(); }
+    std::size_t getDestinationCount() const { return links.size(); }
+
+    /// Remember a camera's newest grid for the next tick. Detection thread.
+    void noteZones(int camId, int cols, int rows, const float* cells);
+    /// Send a tick to every destination whose turn it is. Detection thread.
+    void publish(uint64_t nowMicros, const VoiceSlotTable& voices, float globalMotion);
+
+    uint64_t getBytesSent() const { return bytesSent.load(std::memory_order_relaxed); }
+    uint64_t getDatagramsSent() const { return datagramsSent.load(std::memory_order_relaxed); }
+
+private:
+    /// A voice as it goes on the wire.
+    struct QuantizedVoice {
+        bool live = false;
+        int16_t x = 0;
+        int16_t y = 0;
+        int16_t z = 0;
+        uint8_t size = 0;
+        uint8_t motion = 0;
+        uint8_t energy = 0;
+    };
+
+    /// A camera grid as it goes on the wire.
+    struct QuantizedGrid {
+        bool seen = false;
+        int cols = 0;
+        int rows = 0;
+        std::array<uint8_t, kMaxZoneCells> cells{};
+    };
+
+    /// One dashboard: its socket, its clock and what it has been told so far.
+    struct Link {
+        Destination destination;
+        std::unique_ptr<UdpTransmitSocket> socket;
+        uint64_t periodMicros = 0;
+        uint64_t nextMicros = 0;
+        uint64_t nextKeyframeMicros = 0;
+        int32_t sequence = 0;
+        std::vector<QuantizedVoice> sent;    // by voice id.
+        std::vector<QuantizedGrid> sentGrids; // by camera id.
+    };
+
+    void quantizeVoices(const VoiceSlotTable& voices);
+    void publishTo(Link& link, uint64_t nowMicros, int activeVoices, float globalMotion);
+    bool voiceChanged(const QuantizedVoice& now, const QuantizedVoice& sent) const;
+    bool gridChanged(const QuantizedGrid& now, const QuantizedGrid& sent) const;
+
+    // Bundle plumbing for publishTo().
+    void beginBundle();
+    void reserve(Link& link, std::size_t messageBytes);
+    void flushVoices(Link& link);
+    void flushGone(Link& link);
+    void sendBundle(Link& link);
+
+    Settings settings;
+    std::vector<Link> links;
+    int positionEpsilon = 0;                 // in quantized units.
+    int valueEpsilon = 0;
+    std::size_t recordsPerMessage = 1;       // voice records that fit an otherwise empty bundle.
+    std::size_t gonePerMessage = 1;          // same for departed ids.
+
+    std::vector<QuantizedVoice> current;     // this tick, by voice id; grown, never shrunk.
+    std::vector<QuantizedGrid> grids;        // newest grid per camera.
+
+    // The bundle being built for one link at a time.
+    std::vector<char> buffer;
+    std::unique_ptr<osc::OutboundPacketStream> stream;
+    std::vector<uint8_t> records;            // pending /room/telemetry/voices payload.
+    std::vector<uint8_t> gone;               // pending /room/telemetry/gone payload.
+    int32_t frameSequence = 0;               // the frame message every bundle of a tick starts with.
+    int32_t frameVoices = 0;
+    float frameMotion = 0.0f;
+
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> datagramsSent{0};
+};
+
+/// Parse the "telemetry" block of gesture_settings.json.
+void readTelemetrySettings(const ofJson& json, TelemetryPublisher::Settings& settings);
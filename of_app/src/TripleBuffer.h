@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * TripleBuffer hands the newest result from one producer thread to one
+ * consumer thread without either ever waiting for the other. There are three
+ * slots: the producer fills one, the consumer reads another, and the third
+ * sits in the middle holding the latest published result. Publishing and
+ * taking are each a single atomic exchange of the middle slot's index.
+ *
+ * Unlike SpscQueue nothing queues up: if the producer publishes twice
+ * before the consumer looks, the older result is simply overwritten (and
+ * counted). That is exactly what a camera wants – a detection frame only ever
+ * cares about the freshest picture, and a slow frame must not make the next
+ * one chew through a backlog.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /// Producer side: the slot to fill next. Nobody else touches it until publish().
+    T& writeSlot() { return slots[writeIndex]; }
+
+    /// Producer side: make writeSlot() the newest result.
+    void publish() {
+        const uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | kFresh), std::memory_order_acq_rel);
+        if (previous & kFresh) {
+            overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+        writeIndex = previous & kIndexMask;
+    }
+
+    /**
+     * Consumer side: the newest result if one was published since the last
+     * call, otherwise null. The pointer stays valid until the next consume().
+     */
+    const T* consume() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) {
+            return nullptr;
+        }
+        const uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & kIndexMask;
+        return &slots[readIndex];
+    }
+
+    /// Results the consumer never saw because a newer one replaced them.
+    uint64_t getOverwrittenCount() const { return overwritten.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4; // set in `middle` while it holds an unread result.
+
+    // Touched once per frame, so no cache-line padding: false sharing at
+    // 30–60 Hz costs nothing worth the over-aligned allocation.
+    std::array<T, 3> slots{};
+    std::atomic<uint8_t> middle{1};
+    std::atomic<uint64_t> overwritten{0};
+    uint8_t writeIndex = 0; // producer only.
+    uint8_t readIndex = 2;  // consumer only.
+};
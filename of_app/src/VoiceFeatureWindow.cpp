@@ -0,0 +1,136 @@
+#include "VoiceFeatureWindow.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr uint32_t VoiceFeatureWindow::kExtentX;
+constexpr uint32_t VoiceFeatureWindow::kExtentY;
+constexpr uint32_t VoiceFeatureWindow::kMotion;
+constexpr uint32_t VoiceFeatureWindow::kSpeed;
+constexpr uint32_t VoiceFeatureWindow::kFlips;
+constexpr uint32_t VoiceFeatureWindow::kHold;
+constexpr uint32_t VoiceFeatureWindow::kAllFeatures;
+
+void VoiceFeatureWindow::EntryRing::allocate(std::size_t capacity) {
+    slots.assign(std::max<std::size_t>(1, capacity), Entry());
+    clear();
+}
+
+void VoiceFeatureWindow::EntryRing::pushBack(const Entry& entry) {
+    slots[(head + count) % slots.size()] = entry;
+    ++count;
+}
+
+void VoiceFeatureWindow::EntryRing::popFront() {
+    head = (head + 1) % slots.size();
+    --count;
+}
+
+void VoiceFeatureWindow::EntryRing::popBack() {
+    --count;
+}
+
+void VoiceFeatureWindow::MonotonicMax::push(uint64_t seq, float value) {
+    // Anything at the back that is not bigger than the newcomer can never be
+    // the maximum again, because the newcomer outlives it in the window.
+    while (!ring.empty() && ring.back().value <= value) {
+        ring.popBack();
+    }
+    Entry entry;
+    entry.seq = seq;
+    entry.value = value;
+    ring.pushBack(entry);
+}
+
+void VoiceFeatureWindow::MonotonicMax::evictBefore(uint64_t seq) {
+    while (!ring.empty() && ring.front().seq < seq) {
+        ring.popFront();
+    }
+}
+
+void VoiceFeatureWindow::FlipCounter::clear() {
+    significant.clear();
+    flagSum = 0;
+    hasPrev = false;
+    prevPositive = false;
+}
+
+void VoiceFeatureWindow::FlipCounter::push(uint64_t seq, float velocity, float threshold) {
+    if (std::abs(velocity) <= threshold) {
+        // Microscopic jitters never count as a direction, same as the old scan.
+        return;
+    }
+    bool positive = velocity >= 0.0f;
+    Entry entry;
+    entry.seq = seq;
+    entry.value = (hasPrev && positive != prevPositive) ? 1.0f : 0.0f;
+    significant.pushBack(entry);
+    flagSum += static_cast<int>(entry.value);
+    prevPositive = positive;
+    hasPrev = true;
+}
+
+void VoiceFeatureWindow::FlipCounter::evictThrough(uint64_t seq) {
+    while (!significant.empty() && significant.front().seq <= seq) {
+        flagSum -= static_cast<int>(significant.front().value);
+        significant.popFront();
+    }
+}
+
+int VoiceFeatureWindow::FlipCounter::flips() const {
+    // The first significant row inside the window has nobody inside the
+    // window to flip against, so its flag (earned against an older row) is
+    // not ours to count.
+    if (significant.empty()) {
+        return 0;
+    }
+    return flagSum - static_cast<int>(significant.front().value);
+}
+
+void VoiceFeatureWindow::configure(const Settings& newSettings, std::size_t historyCapacity) {
+    if (newSettings == settings && historyCapacity == capacity) {
+        return;
+    }
+    settings = newSettings;
+    if (historyCapacity != capacity) {
+        capacity = historyCapacity;
+        maxX.ring.allocate(capacity);
+        minX.ring.allocate(capacity);
+        maxY.ring.allocate(capacity);
+        minY.ring.allocate(capacity);
+        maxSpeed.ring.allocate(capacity);
+        flipsX.significant.allocate(capacity);
+        flipsY.significant.allocate(capacity);
+        motionPrefix.assign(capacity + 1, 0.0);
+    }
+    reset();
+}
+
+void VoiceFeatureWindow::reset() {
+    primed = false;
+    nextSeq = 0;
+    startSeq = 0;
+    maxX.ring.clear();
+    minX.ring.clear();
+    maxY.ring.clear();
+    minY.ring.clear();
+    maxSpeed.ring.clear();
+    flipsX.clear();
+    flipsY.clear();
+    hasMoving = false;
+    lastMovingSeq = 0;
+    lastMovingMicros = 0;
+    features = Features();
+}
+
+void VoiceFeatureWindow::primeIfNeeded(uint64_t firstSeq, uint64_t endSeq) {
+    // Start over if the history was reset under us (voice re-entered) or if
+    // more rows arrived than the ring holds and some slipped past unseen.
+    if (!primed || endSeq < nextSeq || nextSeq < firstSeq) {
+        reset();
+        primed = true;
+        nextSeq = firstSeq;
+        startSeq = firstSeq;
+        prefixAt(firstSeq) = 0.0;
+    }
+}
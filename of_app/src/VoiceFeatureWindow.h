@@ -0,0 +1,274 @@
+#pragma once
+
+#include "GestureHistory.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * VoiceFeatureWindow keeps the sliding-window statistics VoiceGestureDetector
+ * needs for one voice – extrema, average motion, peak speed, shake sign flips
+ * and where the current stillness began – up to date as samples arrive,
+ * instead of rescanning the whole window every frame.
+ *
+ * Each call to update() only looks at the rows GestureHistory added since the
+ * previous call (tracked through View::firstSequence()) and at the rows that
+ * slid out of the window, so the cost per sample is O(1) amortized no matter
+ * how long `maxWindowMs` or the history capacity gets. The tricks are the
+ * classic ones: monotonic queues for min/max, prefix sums for motion, a queue
+ * of "significant" velocity samples for sign flips, and a remembered index of
+ * the last sample that moved.
+ *
+ * Timestamps are microseconds and non-decreasing per voice, which
+ * GestureHistory guarantees even when packets arrive out of order.
+ *
+ * Not every show needs every statistic. update() takes a compile-time mask of
+ * feature bits (see VoiceGesturePipeline, which ORs together what its rules
+ * ask for); the queues of features outside the mask are never fed, and the
+ * matching Features fields stay zero.
+ */
+class VoiceFeatureWindow {
+public:
+    // Feature bits. The window start, sample count and duration always come along.
+    static constexpr uint32_t kExtentX = 1u << 0;  ///< minX / maxX
+    static constexpr uint32_t kExtentY = 1u << 1;  ///< minY / maxY
+    static constexpr uint32_t kMotion = 1u << 2;   ///< avgMotion
+    static constexpr uint32_t kSpeed = 1u << 3;    ///< maxSpeed
+    static constexpr uint32_t kFlips = 1u << 4;    ///< signFlips
+    static constexpr uint32_t kHold = 1u << 5;     ///< holdStartMicros
+    static constexpr uint32_t kAllFeatures = kExtentX | kExtentY | kMotion | kSpeed | kFlips | kHold;
+
+    struct Settings {
+        uint64_t maxWindowMs = 1200;
+        float flipVelocityThreshold = 0.02f; ///< |v| below this does not count as a direction.
+        float holdMotionThreshold = 0.05f;   ///< motion above this breaks a hold.
+        uint32_t features = kAllFeatures;    ///< What update() keeps; a change rebuilds the window.
+
+        bool operator==(const Settings& other) const {
+            return maxWindowMs == other.maxWindowMs && flipVelocityThreshold == other.flipVelocityThreshold
+                   && holdMotionThreshold == other.holdMotionThreshold && features == other.features;
+        }
+        bool operator!=(const Settings& other) const { return !(*this == other); }
+    };
+
+    /// Snapshot of the current window, mirroring what the old full scan produced.
+    struct Features {
+        std::size_t startIdx = 0;     ///< Index of the window's first row inside the view.
+        std::size_t sampleCount = 0;  ///< Rows inside the window, start included.
+        uint64_t windowDurationMs = 0;
+        float minX = 0.0f;
+        float maxX = 0.0f;
+        float minY = 0.0f;
+        float maxY = 0.0f;
+        float avgMotion = 0.0f;
+        float maxSpeed = 0.0f;
+        int signFlips = 0;
+        uint64_t holdStartMicros = 0; ///< Timestamp of the last moving row (or the window start).
+    };
+
+    /**
+     * Change thresholds or capacity. Anything that invalidates the cached
+     * state wipes it; the next update() then replays whatever is still in the
+     * history, so the window is rebuilt once rather than drifting.
+     */
+    void configure(const Settings& settings, std::size_t historyCapacity);
+    void reset();
+
+    /**
+     * Fold in every row that is new since the last call, slide the window
+     * forward and report the resulting features. `samples` must be the same
+     * voice's history each time and must not be empty. `Mask` must match the
+     * `features` the window was configured with.
+     */
+    template <uint32_t Mask = kAllFeatures>
+    const Features& update(const GestureHistory::View& samples);
+
+private:
+    /// Fixed-capacity deque of (sequence, value) pairs used for the queues below.
+    struct Entry {
+        uint64_t seq = 0;
+        float value = 0.0f;
+    };
+
+    class EntryRing {
+    public:
+        void allocate(std::size_t capacity);
+        void clear() { head = 0; count = 0; }
+        bool empty() const { return count == 0; }
+        const Entry& front() const { return slots[head]; }
+        const Entry& back() const { return slots[(head + count - 1) % slots.size()]; }
+        void pushBack(const Entry& entry);
+        void popFront();
+        void popBack();
+
+    private:
+        std::vector<Entry> slots;
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+
+    /// Sliding max (or min, by feeding negated values) via a monotonic queue.
+    struct MonotonicMax {
+        EntryRing ring;
+        void push(uint64_t seq, float value);
+        void evictBefore(uint64_t seq);
+        float value() const { return ring.front().value; }
+    };
+
+    /// Sign-flip bookkeeping for one velocity axis.
+    struct FlipCounter {
+        EntryRing significant;  ///< Rows with |v| above threshold; value = 1 if it flipped.
+        int flagSum = 0;
+        bool hasPrev = false;
+        bool prevPositive = false;
+        void clear();
+        void push(uint64_t seq, float velocity, float threshold);
+        void evictThrough(uint64_t seq);
+        int flips() const;
+    };
+
+    double& prefixAt(uint64_t seq) { return motionPrefix[seq % motionPrefix.size()]; }
+    /// Start over from the history's oldest row, if we lost track of it.
+    void primeIfNeeded(uint64_t firstSeq, uint64_t endSeq);
+    template <uint32_t Mask>
+    void evictBefore(uint64_t seq);
+
+    Settings settings;
+    std::size_t capacity = 0;
+
+    uint64_t nextSeq = 0;    ///< First sequence number we have not folded in yet.
+    uint64_t startSeq = 0;   ///< Sequence number of the window's first row.
+    bool primed = false;
+
+    MonotonicMax maxX;
+    MonotonicMax minX;       ///< Stores -x.
+    MonotonicMax maxY;
+    MonotonicMax minY;       ///< Stores -y.
+    MonotonicMax maxSpeed;
+    FlipCounter flipsX;
+    FlipCounter flipsY;
+
+    /// prefixAt(s) = motion summed over every row before s (relative to when we primed).
+    std::vector<double> motionPrefix;
+    bool hasMoving = false;
+    uint64_t lastMovingSeq = 0;
+    uint64_t lastMovingMicros = 0;
+
+    Features features;
+};
+
+template <uint32_t Mask>
+void VoiceFeatureWindow::evictBefore(uint64_t seq) {
+    if (Mask & kExtentX) {
+        maxX.evictBefore(seq);
+        minX.evictBefore(seq);
+    }
+    if (Mask & kExtentY) {
+        maxY.evictBefore(seq);
+        minY.evictBefore(seq);
+    }
+    if (Mask & kSpeed) {
+        maxSpeed.evictBefore(seq);
+    }
+    if (Mask & kFlips) {
+        flipsX.evictThrough(seq);
+        flipsY.evictThrough(seq);
+    }
+}
+
+template <uint32_t Mask>
+const VoiceFeatureWindow::Features& VoiceFeatureWindow::update(const GestureHistory::View& samples) {
+    if (samples.capacity() != capacity) {
+        configure(settings, samples.capacity());
+    }
+
+    const uint64_t firstSeq = samples.firstSequence();
+    const uint64_t endSeq = firstSeq + samples.size();
+    primeIfNeeded(firstSeq, endSeq);
+
+    // Rows the history already overwrote have left our window whether the
+    // clock says so or not. Evict them first so the queues never hold more
+    // than `capacity` entries.
+    if (startSeq < firstSeq) {
+        startSeq = firstSeq;
+    }
+    evictBefore<Mask>(startSeq);
+
+    const uint64_t* timestamps = samples.timestampsMicros();
+    const float* xs = samples.x();
+    const float* ys = samples.y();
+    const float* vxs = samples.vx();
+    const float* vys = samples.vy();
+    const float* vzs = samples.vz();
+    const float* motions = samples.motion();
+
+    // Fold in only what is new since last time. `Mask` is a constant, so each
+    // unused feature drops out of the loop entirely.
+    for (uint64_t seq = nextSeq; seq < endSeq; ++seq) {
+        const std::size_t i = static_cast<std::size_t>(seq - firstSeq);
+        if (Mask & kExtentX) {
+            maxX.push(seq, xs[i]);
+            minX.push(seq, -xs[i]);
+        }
+        if (Mask & kExtentY) {
+            maxY.push(seq, ys[i]);
+            minY.push(seq, -ys[i]);
+        }
+        if (Mask & kSpeed) {
+            maxSpeed.push(seq, std::sqrt(vxs[i] * vxs[i] + vys[i] * vys[i] + vzs[i] * vzs[i]));
+        }
+        if (Mask & kFlips) {
+            flipsX.push(seq, vxs[i], settings.flipVelocityThreshold);
+            flipsY.push(seq, vys[i], settings.flipVelocityThreshold);
+        }
+        if (Mask & kMotion) {
+            double total = prefixAt(seq) + motions[i];
+            prefixAt(seq + 1) = total;
+        }
+        if ((Mask & kHold) && motions[i] > settings.holdMotionThreshold) {
+            hasMoving = true;
+            lastMovingSeq = seq;
+            lastMovingMicros = timestamps[i];
+        }
+    }
+    nextSeq = endSeq;
+
+    // Slide the start forward past anything older than the max window. The
+    // newest row always stays, so the window is never empty.
+    const std::size_t latestIdx = samples.size() - 1;
+    const uint64_t now = timestamps[latestIdx];
+    const uint64_t maxWindowMicros = settings.maxWindowMs * 1000;
+    const uint64_t minTimestamp = (now > maxWindowMicros) ? now - maxWindowMicros : 0;
+    while (startSeq + 1 < endSeq && timestamps[startSeq - firstSeq] < minTimestamp) {
+        ++startSeq;
+    }
+    evictBefore<Mask>(startSeq);
+
+    const std::size_t startIdx = static_cast<std::size_t>(startSeq - firstSeq);
+    features.startIdx = startIdx;
+    features.sampleCount = static_cast<std::size_t>(endSeq - startSeq);
+    features.windowDurationMs = (now - timestamps[startIdx]) / 1000;
+    if (Mask & kExtentX) {
+        features.minX = -minX.value();
+        features.maxX = maxX.value();
+    }
+    if (Mask & kExtentY) {
+        features.minY = -minY.value();
+        features.maxY = maxY.value();
+    }
+    if (Mask & kMotion) {
+        features.avgMotion = static_cast<float>((prefixAt(endSeq) - prefixAt(startSeq)) / static_cast<double>(features.sampleCount));
+    }
+    if (Mask & kSpeed) {
+        features.maxSpeed = maxSpeed.value();
+    }
+    if (Mask & kFlips) {
+        features.signFlips = flipsX.flips() + flipsY.flips();
+    }
+    if (Mask & kHold) {
+        features.holdStartMicros = (hasMoving && lastMovingSeq >= startSeq) ? lastMovingMicros : timestamps[startIdx];
+    }
+    return features;
+}
@@ -1,220 +1,423 @@
 #include "VoiceGestureDetector.h"
 
-#include "ofLog.h"
+#include "AsyncLogger.h"
+#include "VoiceGesturePipeline.h"
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace {
 float clamp01(float value) {
     return ofClamp(value, 0.0f, 1.0f);
 }
+
+float secondsSince(uint64_t startMs, uint64_t now) {
+    return now > startMs ? static_cast<float>(now - startMs) / 1000.0f : 0.0f;
+}
+
+/**
+ * Where a voice is heading right now: a straight line fitted through the
+ * velocity rows of the last `lookbackMs` (the history already stores one per
+ * sample), read off at the newest sample. The slope of that line is the
+ * acceleration. Needs two rows with real velocities; row 0 of the view is
+ * never used, since it may be the voice's first and have no predecessor.
+ */
+struct Trend {
+    bool valid = false;
+    std::size_t first = 0; // oldest row the fit used
+    float vx = 0.0f; // units/s
+    float vy = 0.0f;
+    float ax = 0.0f; // units/s²
+    float ay = 0.0f;
+};
+
+Trend fitTrend(const GestureHistory::View& samples, uint64_t lookbackMs) {
+    Trend trend;
+    const uint64_t* ts = samples.timestampsMicros();
+    const uint64_t lookbackMicros = lookbackMs * 1000;
+    const std::size_t latest = samples.size() - 1;
+    std::size_t first = latest;
+    while (first > 1 && ts[latest] - ts[first - 1] <= lookbackMicros) {
+        --first;
+    }
+    if (first == latest) {
+        return trend;
+    }
+
+    const float* vxs = samples.vx();
+    const float* vys = samples.vy();
+    const float count = static_cast<float>(latest - first + 1);
+    float meanT = 0.0f;
+    float meanX = 0.0f;
+    float meanY = 0.0f;
+    for (std::size_t i = first; i <= latest; ++i) {
+        meanT -= static_cast<float>(ts[latest] - ts[i]) / 1000000.0f; // seconds before the newest row
+        meanX += vxs[i];
+        meanY += vys[i];
+    }
+    meanT /= count;
+    meanX /= count;
+    meanY /= count;
+    float stt = 0.0f;
+    float stx = 0.0f;
+    float sty = 0.0f;
+    for (std::size_t i = first; i <= latest; ++i) {
+        const float dt = -static_cast<float>(ts[latest] - ts[i]) / 1000000.0f - meanT;
+        stt += dt * dt;
+        stx += dt * (vxs[i] - meanX);
+        sty += dt * (vys[i] - meanY);
+    }
+    if (stt <= 0.0f) {
+        return trend;
+    }
+    trend.valid = true;
+    trend.first = first;
+    trend.ax = stx / stt;
+    trend.ay = sty / stt;
+    trend.vx = meanX - trend.ax * meanT;
+    trend.vy = meanY - trend.ay * meanT;
+    return trend;
+}
+
+/// Travel expected `horizon` seconds from now along one direction, if speed and acceleration hold.
+float projectTravel(float covered, float speed, float accel, float horizon) {
+    if (speed > 0.0f && accel < 0.0f && speed + accel * horizon < 0.0f) {
+        return covered + speed * speed / (-2.0f * accel); // comes to a stop before the horizon
+    }
+    return covered + speed * horizon + 0.5f * accel * horizon * horizon;
+}
+
+VoiceGestureEvent onsetEvent(int voiceId, VoiceGestureType type, VoiceGesturePhase phase, float strength, float extra) {
+    VoiceGestureEvent event;
+    event.voiceId = voiceId;
+    event.type = type;
+    event.phase = phase;
+    event.strength = strength;
+    event.extra = extra;
+    return event;
+}
+
+struct RuleSetName {
+    VoiceGestureDetector::RuleSet rules;
+    const char* name;
+};
+const RuleSetName kRuleSetNames[] = {
+    {VoiceGestureDetector::RuleSet::Full, "full"},
+    {VoiceGestureDetector::RuleSet::RaiseHold, "raise_hold"},
+    {VoiceGestureDetector::RuleSet::Directional, "directional"},
+    {VoiceGestureDetector::RuleSet::Energy, "energy"},
+};
 } // namespace
 
-VoiceGestureDetector::VoiceGestureDetector() = default;
+constexpr uint64_t VoiceGestureDetector::kNeverTriggered;
+
+VoiceGestureDetector::VoiceGestureDetector() {
+    setConfig(config);
+}
 
 void VoiceGestureDetector::setConfig(const Config& newConfig) {
     config = newConfig;
+    // Each preset and onset setting is its own instantiation of run(), so the
+    // per-voice pass never asks which rules are on.
+    switch (config.rules) {
+    case RuleSet::RaiseHold:
+        runner = config.predictiveOnset ? &VoiceGestureDetector::run<RaiseHoldVoiceRules, true>
+                                        : &VoiceGestureDetector::run<RaiseHoldVoiceRules, false>;
+        onsetTypes = RaiseHoldVoiceRules::kTypes;
+        break;
+    case RuleSet::Directional:
+        runner = config.predictiveOnset ? &VoiceGestureDetector::run<DirectionalVoiceRules, true>
+                                        : &VoiceGestureDetector::run<DirectionalVoiceRules, false>;
+        onsetTypes = DirectionalVoiceRules::kTypes;
+        break;
+    case RuleSet::Energy:
+        runner = config.predictiveOnset ? &VoiceGestureDetector::run<EnergyVoiceRules, true>
+                                        : &VoiceGestureDetector::run<EnergyVoiceRules, false>;
+        onsetTypes = EnergyVoiceRules::kTypes;
+        break;
+    case RuleSet::Full:
+    default:
+        runner = config.predictiveOnset ? &VoiceGestureDetector::run<FullVoiceRules, true>
+                                        : &VoiceGestureDetector::run<FullVoiceRules, false>;
+        onsetTypes = FullVoiceRules::kTypes;
+        break;
+    }
+    if (!config.predictiveOnset) {
+        onsetTypes = 0;
+    }
 }
 
-void VoiceGestureDetector::updateVoice(int voiceId, const std::deque<GestureHistory::Sample>& samples, std::vector<VoiceGestureEvent>& outEvents) {
+const char* VoiceGestureDetector::ruleSetName(RuleSet rules) {
+    for (const RuleSetName& entry : kRuleSetNames) {
+        if (entry.rules == rules) {
+            return entry.name;
+        }
+    }
+    return "full";
+}
+
+bool VoiceGestureDetector::parseRuleSet(const std::string& name, RuleSet& rules) {
+    for (const RuleSetName& entry : kRuleSetNames) {
+        if (name == entry.name) {
+            rules = entry.rules;
+            return true;
+        }
+    }
+    return false;
+}
+
+void VoiceGestureDetector::updateVoice(int voiceId, const GestureHistory::View& samples, std::vector<VoiceGestureEvent>& outEvents) {
     if (samples.size() < 2) {
         // Not enough breadcrumbs to deduce a pattern yet.
         return;
     }
 
-    const auto& latest = samples.back();
-    uint64_t now = latest.timestamp;
-    uint64_t minTimestamp = (now > config.maxWindowMs) ? now - config.maxWindowMs : 0;
-
-    // Find the first sample that still lives inside our max window. We scan
-    // linearly because the buffers are tiny (< 1 second of frames).
-    std::size_t startIdx = 0;
-    for (std::size_t i = 0; i < samples.size(); ++i) {
-        if (samples[i].timestamp >= minTimestamp) {
-            startIdx = i;
-            break;
-        }
+    // find() rather than operator[] so prepared voices are a pure lookup and
+    // safe to update concurrently; unprepared ones are created here.
+    auto it = tracks.find(voiceId);
+    if (it == tracks.end()) {
+        it = tracks.emplace(voiceId, VoiceTrack()).first;
     }
+    updateVoice(it->second, voiceId, samples, outEvents);
+}
 
-    const auto& startSample = samples[startIdx];
-    uint64_t windowDuration = now - startSample.timestamp;
-    if (windowDuration < config.minWindowMs) {
-        // We bail early to avoid reading tea leaves from too-short windows.
+void VoiceGestureDetector::updateVoice(VoiceTrack& track, int voiceId, const GestureHistory::View& samples,
+                                       std::vector<VoiceGestureEvent>& outEvents) const {
+    if (samples.size() < 2) {
         return;
     }
 
-    float minX = startSample.position.x;
-    float maxX = startSample.position.x;
-    float minY = startSample.position.y;
-    float maxY = startSample.position.y;
-    float cumulativeMotion = 0.0f;
-    float maxSpeed = 0.0f;
-
-    int signFlips = 0;
-    bool hasPrevX = false;
-    bool hasPrevY = false;
-    float prevSignX = 0.0f;
-    float prevSignY = 0.0f;
-
-    // Walk the window, aggregating extrema, motion, and direction changes. Each
-    // metric powers at least one of the gesture rules below.
-    for (std::size_t i = startIdx; i < samples.size(); ++i) {
-        const auto& sample = samples[i];
-        minX = std::min(minX, sample.position.x);
-        maxX = std::max(maxX, sample.position.x);
-        minY = std::min(minY, sample.position.y);
-        maxY = std::max(maxY, sample.position.y);
-        cumulativeMotion += sample.motion;
-        maxSpeed = std::max(maxSpeed, glm::length(sample.velocity));
-
-        if (i > startIdx) {
-            // We do not count microscopic jitters towards shake sign flips, so
-            // there is a soft threshold before we care about direction changes.
-            if (std::abs(sample.velocity.x) > config.shakeMinMotion * 0.25f) {
-                float sign = (sample.velocity.x >= 0.0f) ? 1.0f : -1.0f;
-                if (hasPrevX && sign != prevSignX) {
-                    ++signFlips;
-                }
-                prevSignX = sign;
-                hasPrevX = true;
-            }
-            if (std::abs(sample.velocity.y) > config.shakeMinMotion * 0.25f) {
-                float sign = (sample.velocity.y >= 0.0f) ? 1.0f : -1.0f;
-                if (hasPrevY && sign != prevSignY) {
-                    ++signFlips;
-                }
-                prevSignY = sign;
-                hasPrevY = true;
+    (this->*runner)(track, voiceId, samples, outEvents);
+}
+
+template <typename Pipeline, bool Predictive>
+void VoiceGestureDetector::run(VoiceTrack& track, int voiceId, const GestureHistory::View& samples,
+                               std::vector<VoiceGestureEvent>& outEvents) const {
+    // Onsets judge the raise footprint, so they need the horizontal extent
+    // whether or not the preset's own rules do.
+    constexpr uint32_t kFeatures = Pipeline::kFeatures | (Predictive ? VoiceFeatureWindow::kExtentX : 0u);
+
+    // The per-voice window folds in only the rows that are new since last
+    // frame, so this stays O(1) amortized however long the window gets.
+    track.window.configure(windowSettings(kFeatures), samples.capacity());
+    const VoiceFeatureWindow::Features& features = track.window.update<kFeatures>(samples);
+
+    // The full rules skip too-short windows to avoid reading tea leaves.
+    if (features.windowDurationMs >= config.minWindowMs) {
+        const std::size_t latestIdx = samples.size() - 1;
+        const uint64_t nowMicros = samples.timestampsMicros()[latestIdx];
+        // Windows are cut on the history's microseconds; cooldowns and the
+        // rules' durations are plenty precise in whole milliseconds.
+        RuleContext context{config,
+                            track,
+                            voiceId,
+                            samples,
+                            features,
+                            latestIdx,
+                            nowMicros,
+                            nowMicros / 1000,
+                            samples.x()[latestIdx] - samples.x()[features.startIdx],
+                            samples.y()[latestIdx] - samples.y()[features.startIdx],
+                            outEvents};
+        Pipeline::detect(context);
+    }
+    // Onsets run on short windows too: not waiting for them is the point.
+    if (Predictive) {
+        updateOnset(track, voiceId, samples, features, Pipeline::kTypes, outEvents);
+    }
+}
+
+void VoiceGestureDetector::updateOnset(VoiceTrack& track, int voiceId, const GestureHistory::View& samples,
+                                       const VoiceFeatureWindow::Features& features, uint32_t types,
+                                       std::vector<VoiceGestureEvent>& outEvents) const {
+    const std::size_t latestIdx = samples.size() - 1;
+    const uint64_t now = samples.timestampsMicros()[latestIdx] / 1000;
+    const float latestY = samples.y()[latestIdx];
+    const float coveredX = samples.x()[latestIdx] - samples.x()[features.startIdx];
+    const float coveredY = latestY - samples.y()[features.startIdx];
+    const float horizontalSpan = features.maxX - features.minX;
+    const float horizon = static_cast<float>(config.onsetHorizonMs) / 1000.0f;
+    const Trend trend = fitTrend(samples, config.onsetLookbackMs);
+
+    // How sure are we that `type`'s rule is about to fire: the projected
+    // travel as a share of its threshold, or 0 once the rule's footprint
+    // (narrow raise, flat swipe) rules it out. `speed` is how fast the voice
+    // is moving that way right now, and `steady` whether every row of the
+    // fit was heading that way – a shake's zig-zag never is.
+    auto confidence = [&](VoiceGestureType type, float& speed, bool& steady) {
+        float dx = 0.0f;
+        float dy = 0.0f;
+        float threshold = 1.0f;
+        bool footprint = false;
+        switch (type) {
+        case VoiceGestureType::Raise:
+        case VoiceGestureType::Lower:
+            dy = type == VoiceGestureType::Raise ? -1.0f : 1.0f; // y grows downwards
+            threshold = type == VoiceGestureType::Raise ? config.raiseDeltaY : config.lowerDeltaY;
+            footprint = horizontalSpan <= config.raiseHorizontalLimit;
+            break;
+        case VoiceGestureType::SwipeLeft:
+        case VoiceGestureType::SwipeRight:
+            dx = type == VoiceGestureType::SwipeLeft ? -1.0f : 1.0f;
+            threshold = config.swipeDeltaX;
+            footprint = std::abs(coveredY) <= config.swipeVerticalLimit
+                        && std::abs(trend.vx) > std::abs(trend.vy) * config.swipeOrthogonality;
+            break;
+        default:
+            break;
+        }
+        speed = dx * trend.vx + dy * trend.vy;
+        steady = trend.valid;
+        for (std::size_t i = trend.first; steady && i <= latestIdx; ++i) {
+            steady = dx * samples.vx()[i] + dy * samples.vy()[i] > 0.0f;
+        }
+        if (!footprint) {
+            return 0.0f;
+        }
+        threshold = std::max(0.001f, threshold);
+        const float covered = dx * coveredX + dy * coveredY;
+        if (covered < config.onsetMinProgress * threshold) {
+            return 0.0f; // not enough real travel yet to bet on
+        }
+        return clamp01(projectTravel(covered, speed, dx * trend.ax + dy * trend.ay, horizon) / threshold);
+    };
+
+    float speed = 0.0f;
+    bool steady = false;
+    if (track.onset.pending) {
+        // Stalled, turned back, strayed outside the footprint or simply took
+        // too long: the rule isn't coming, so say so rather than leave an
+        // envelope hanging.
+        const VoiceGestureType type = track.onset.type;
+        const bool timedOut = now >= track.onset.beganMs + config.onsetTimeoutMs;
+        if (timedOut || (trend.valid && confidence(type, speed, steady) < config.onsetConfidence * 0.5f)) {
+            outEvents.push_back(onsetEvent(voiceId, type, VoiceGesturePhase::Cancel, 0.0f, secondsSince(track.onset.beganMs, now)));
+            track.onset.pending = false;
+            if (config.logGestures) {
+                AsyncLogNotice("VoiceGestureDetector") << "voice " << voiceId << " " << gestureTypeName(type) << " cancelled";
             }
         }
+        return;
+    }
+    if (!trend.valid) {
+        return;
     }
 
-    float avgMotion = cumulativeMotion / static_cast<float>(samples.size() - startIdx);
-    glm::vec3 displacement = latest.position - startSample.position;
-    float deltaX = displacement.x;
-    float deltaY = displacement.y;
-    float horizontalSpan = maxX - minX;
-    float verticalSpan = maxY - minY;
-    float radius = std::max(horizontalSpan, verticalSpan);
-
-    // Raise: significant upward travel with a narrow horizontal footprint.
-    if (deltaY <= -config.raiseDeltaY && horizontalSpan <= config.raiseHorizontalLimit) {
-        if (canTrigger(voiceId, "raise", now, config.gestureCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = "raise";
-            event.strength = clamp01((-deltaY) / config.raiseDeltaY);
-            event.extra = latest.position.y; // handy for mapping to register height.
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " raise strength " << event.strength;
+    // One trajectory at a time: the most confident candidate that is moving
+    // fast enough, steadily, and whose rule is in the preset and out of cooldown.
+    const VoiceGestureType candidates[] = {VoiceGestureType::Raise, VoiceGestureType::Lower, VoiceGestureType::SwipeLeft,
+                                           VoiceGestureType::SwipeRight};
+    VoiceGestureType best = VoiceGestureType::Raise;
+    float bestConfidence = 0.0f;
+    for (VoiceGestureType type : candidates) {
+        if ((types & voiceGestureBit(type)) == 0) {
+            continue;
+        }
+        const float value = confidence(type, speed, steady);
+        if (steady && speed >= config.onsetMinSpeed && value > bestConfidence && canTrigger(track, type, now, config.gestureCooldownMs)) {
+            best = type;
+            bestConfidence = value;
         }
     }
+    if (bestConfidence < config.onsetConfidence) {
+        return;
+    }
+    const bool vertical = best == VoiceGestureType::Raise || best == VoiceGestureType::Lower;
+    outEvents.push_back(onsetEvent(voiceId, best, VoiceGesturePhase::Begin, bestConfidence, vertical ? latestY : 0.0f));
+    track.onset.pending = true;
+    track.onset.type = best;
+    track.onset.beganMs = now;
+    if (config.logGestures) {
+        AsyncLogNotice("VoiceGestureDetector") << "voice " << voiceId << " " << gestureTypeName(best) << " begin confidence " << bestConfidence;
+    }
+}
 
-    // Lower: mirror image of raise, rewarding committed downward travel.
-    if (deltaY >= config.lowerDeltaY && horizontalSpan <= config.raiseHorizontalLimit) {
-        if (canTrigger(voiceId, "lower", now, config.gestureCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = "lower";
-            event.strength = clamp01(deltaY / config.lowerDeltaY);
-            event.extra = latest.position.y;
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " lower strength " << event.strength;
-        }
+void VoiceGestureDetector::confirmOnset(VoiceTrack& track, const VoiceGestureEvent& event, uint64_t now,
+                                        std::vector<VoiceGestureEvent>& outEvents) {
+    if (!track.onset.pending || track.onset.type != event.type) {
+        return;
     }
+    VoiceGestureEvent confirm = event;
+    confirm.phase = VoiceGesturePhase::Confirm;
+    confirm.extra = secondsSince(track.onset.beganMs, now);
+    outEvents.push_back(confirm);
+    track.onset.pending = false;
+}
 
-    float absDeltaX = std::abs(deltaX);
-    float absDeltaY = std::abs(deltaY);
-    if (absDeltaX >= config.swipeDeltaX && absDeltaX > absDeltaY * config.swipeOrthogonality && absDeltaY <= config.swipeVerticalLimit) {
-        std::string type = (deltaX < 0.0f) ? "swipe_left" : "swipe_right";
-        if (canTrigger(voiceId, type, now, config.gestureCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = type;
-            event.strength = clamp01(absDeltaX / config.swipeDeltaX);
-            event.extra = 0.0f;
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " " << type << " strength " << event.strength;
-        }
+bool VoiceGestureDetector::cancelOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out) {
+    if (!track.onset.pending) {
+        return false;
     }
+    out = onsetEvent(voiceId, track.onset.type, VoiceGesturePhase::Cancel, 0.0f, secondsSince(track.onset.beganMs, now));
+    track.onset.pending = false;
+    return true;
+}
 
-    // Shake: small physical footprint but with lots of directional whiplash.
-    if (radius <= config.shakeRadius && avgMotion >= config.shakeMinMotion && signFlips >= config.shakeMinSignFlips) {
-        if (canTrigger(voiceId, "shake", now, config.gestureCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = "shake";
-            event.strength = clamp01(avgMotion / (config.shakeMinMotion * 2.0f));
-            event.extra = 0.0f;
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " shake strength " << event.strength;
-        }
+bool VoiceGestureDetector::cancelOrphanedOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out) const {
+    if (!track.onset.pending || (onsetTypes & voiceGestureBit(track.onset.type)) != 0) {
+        return false;
     }
+    return cancelOnset(track, voiceId, now, out);
+}
 
-    // Burst: reward sudden spikes in velocity regardless of direction.
-    if (maxSpeed >= config.burstSpeedThreshold) {
-        if (canTrigger(voiceId, "burst", now, config.burstCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = "burst";
-            float denom = std::max(0.01f, config.burstMaxSpeed - config.burstSpeedThreshold);
-            event.strength = clamp01((maxSpeed - config.burstSpeedThreshold) / denom);
-            event.extra = 0.0f;
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " burst strength " << event.strength;
-        }
+bool VoiceGestureDetector::cancelTimedOutOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out) const {
+    if (!track.onset.pending || now < track.onset.beganMs + config.onsetTimeoutMs) {
+        return false;
+    }
+    if (config.logGestures) {
+        AsyncLogNotice("VoiceGestureDetector") << "voice " << voiceId << " " << gestureTypeName(track.onset.type) << " cancelled";
     }
+    return cancelOnset(track, voiceId, now, out);
+}
 
-    // Hold: detect stillness sustained beyond the configured patience level.
-    uint64_t holdStart = now;
-    for (std::size_t i = samples.size(); i-- > startIdx;) {
-        if (samples[i].motion > config.holdMotionThreshold) {
-            holdStart = samples[i].timestamp;
-            break;
-        }
-        if (i == startIdx) {
-            holdStart = samples[startIdx].timestamp;
+void VoiceGestureDetector::exportCooldowns(const VoiceTrack& track, uint64_t now, int32_t* sinceMs) {
+    for (std::size_t i = 0; i < kVoiceGestureTypeCount; ++i) {
+        const uint64_t last = track.lastTrigger[i];
+        if (last == kNeverTriggered) {
+            sinceMs[i] = -1;
+            continue;
         }
+        // Anything older than the longest cooldown is as good as never, so
+        // the clamp only ever trims values nobody will look at.
+        const uint64_t since = now > last ? now - last : 0;
+        sinceMs[i] = static_cast<int32_t>(std::min<uint64_t>(since, std::numeric_limits<int32_t>::max()));
     }
-    uint64_t holdDuration = now - holdStart;
-    if (avgMotion <= config.holdMotionThreshold && holdDuration >= config.holdDurationMs) {
-        if (canTrigger(voiceId, "hold", now, config.holdCooldownMs)) {
-            VoiceGestureEvent event;
-            event.voiceId = voiceId;
-            event.type = "hold";
-            float denom = std::max(0.01f, config.holdMotionThreshold);
-            event.strength = clamp01(1.0f - (avgMotion / denom));
-            event.extra = clamp01(static_cast<float>(holdDuration) / static_cast<float>(config.holdDurationMs));
-            outEvents.push_back(event);
-            rememberTrigger(voiceId, event.type, now);
-            ofLogNotice("VoiceGestureDetector") << "voice " << voiceId << " hold strength " << event.strength << " duration " << event.extra;
-        }
+}
+
+void VoiceGestureDetector::importCooldowns(VoiceTrack& track, uint64_t now, const int32_t* sinceMs) {
+    for (std::size_t i = 0; i < kVoiceGestureTypeCount; ++i) {
+        const uint64_t since = static_cast<uint64_t>(sinceMs[i]);
+        track.lastTrigger[i] = sinceMs[i] < 0 || since > now ? kNeverTriggered : now - since;
+    }
+}
+
+void VoiceGestureDetector::prepareVoice(int voiceId) {
+    if (tracks.find(voiceId) == tracks.end()) {
+        tracks.emplace(voiceId, VoiceTrack());
     }
 }
 
 void VoiceGestureDetector::removeVoice(int voiceId) {
-    lastTriggerTimes.erase(voiceId);
+    tracks.erase(voiceId);
 }
 
-bool VoiceGestureDetector::canTrigger(int voiceId, const std::string& type, uint64_t timestamp, uint64_t cooldownMs) {
-    auto voiceIt = lastTriggerTimes.find(voiceId);
-    if (voiceIt == lastTriggerTimes.end()) {
-        return true;
-    }
-    auto eventIt = voiceIt->second.find(type);
-    if (eventIt == voiceIt->second.end()) {
-        return true;
-    }
-    return timestamp >= eventIt->second + cooldownMs;
+VoiceFeatureWindow::Settings VoiceGestureDetector::windowSettings(uint32_t features) const {
+    VoiceFeatureWindow::Settings settings;
+    settings.features = features;
+    settings.maxWindowMs = config.maxWindowMs;
+    // We do not count microscopic jitters towards shake sign flips, so there
+    // is a soft threshold before we care about direction changes.
+    settings.flipVelocityThreshold = config.shakeMinMotion * 0.25f;
+    settings.holdMotionThreshold = config.holdMotionThreshold;
+    return settings;
 }
 
-void VoiceGestureDetector::rememberTrigger(int voiceId, const std::string& type, uint64_t timestamp) {
-    lastTriggerTimes[voiceId][type] = timestamp;
+bool VoiceGestureDetector::canTrigger(const VoiceTrack& track, VoiceGestureType type, uint64_t timestamp, uint64_t cooldownMs) {
+    uint64_t last = track.lastTrigger[static_cast<std::size_t>(type)];
+    return last == kNeverTriggered || timestamp >= last + cooldownMs;
 }
 
+void VoiceGestureDetector::rememberTrigger(VoiceTrack& track, VoiceGestureType type, uint64_t timestamp) {
+    track.lastTrigger[static_cast<std::size_t>(type)] = timestamp;
+}
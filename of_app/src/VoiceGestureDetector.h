@@ -2,6 +2,9 @@
 
 #include "GestureEvents.h"
 #include "GestureHistory.h"
+#include "VoiceFeatureWindow.h"
+#include <array>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -11,10 +14,54 @@
  * to the design doc, so if you are teaching or tweaking the vocabulary this
  * is the playground. We aim for clarity over cleverness so newcomers can fork
  * it and build their own signatures.
+ *
+ * The rules themselves live in VoiceGesturePipeline.h as small policy types,
+ * and a show runs one of a few preset line-ups of them (Config::rules). A
+ * preset that leaves rules out also skips the window statistics only those
+ * rules read, so a small vocabulary costs proportionally less per voice.
  */
 class VoiceGestureDetector {
+    static constexpr uint64_t kNeverTriggered = ~uint64_t(0);
+
 public:
+    /**
+     * Everything we remember about one voice between frames: the incremental
+     * window stats and when each gesture last fired. The detector keeps its own
+     * map of these for the voiceId API below; the host keeps one inside each
+     * voice slot instead and uses the track overload of updateVoice().
+     */
+    struct VoiceTrack {
+        VoiceTrack() { lastTrigger.fill(kNeverTriggered); }
+        /// A begin sent ahead of the full rule, waiting for its confirm or cancel.
+        struct Onset {
+            bool pending = false;
+            VoiceGestureType type = VoiceGestureType::Raise;
+            uint64_t beganMs = 0;
+        };
+        /// Forget the previous dancer while keeping the window's buffers.
+        void reset() {
+            window.reset();
+            lastTrigger.fill(kNeverTriggered);
+            onset = Onset();
+        }
+        VoiceFeatureWindow window;                                 // incremental stats.
+        std::array<uint64_t, kVoiceGestureTypeCount> lastTrigger;  // cooldowns by gesture id.
+        Onset onset;                                               // predictive mode only.
+    };
+
+    /// Which rules run: the preset line-ups from VoiceGesturePipeline.h.
+    enum class RuleSet {
+        Full,        ///< raise, lower, swipes, shake, burst, hold (the default).
+        RaiseHold,   ///< raise and hold only.
+        Directional, ///< raise, lower and the swipes – the ones predictive onsets cover.
+        Energy,      ///< shake, burst and hold.
+    };
+    /// The settings-file name of a preset ("full", "raise_hold", …).
+    static const char* ruleSetName(RuleSet rules);
+    static bool parseRuleSet(const std::string& name, RuleSet& rules);
+
     struct Config {
+        RuleSet rules = RuleSet::Full;
         float raiseDeltaY = 0.18f;
         float lowerDeltaY = 0.18f;
         float swipeDeltaX = 0.25f;
@@ -33,6 +80,17 @@ public:
         uint64_t gestureCooldownMs = 900;
         uint64_t burstCooldownMs = 600;
         uint64_t holdCooldownMs = 1800;
+        // Predictive onset: for raise, lower and the swipes, send a provisional
+        // begin as soon as the trajectory is on course – well before the full
+        // window has passed – then a confirm or cancel once the rule settles it.
+        bool predictiveOnset = false;
+        float onsetMinSpeed = 0.2f;     ///< Units/s along the gesture's direction before a trajectory counts.
+        float onsetConfidence = 0.6f;   ///< Projected share of the rule's threshold needed to begin.
+        float onsetMinProgress = 0.3f;  ///< Share of the threshold actually travelled before a begin.
+        uint64_t onsetLookbackMs = 120; ///< Recent samples the velocity/acceleration trend is fitted over.
+        uint64_t onsetHorizonMs = 250;  ///< How far ahead that trend is projected.
+        uint64_t onsetTimeoutMs = 800;  ///< A begin the rule hasn't confirmed by then is cancelled.
+        bool logGestures = true; ///< Log each gesture (through AsyncLogger).
     };
 
     VoiceGestureDetector();
@@ -45,14 +103,102 @@ public:
      * we append a VoiceGestureEvent to outEvents. Multiple rules can trigger
      * within one frame as long as their cooldowns allow it.
      */
-    void updateVoice(int voiceId, const std::deque<GestureHistory::Sample>& samples, std::vector<VoiceGestureEvent>& outEvents);
+    void updateVoice(int voiceId, const GestureHistory::View& samples, std::vector<VoiceGestureEvent>& outEvents);
     void removeVoice(int voiceId);
 
+    /**
+     * Same rules against caller-owned bookkeeping. Nothing inside the detector
+     * is touched except the (read-only) config, so different tracks can be
+     * updated from different threads at once.
+     */
+    void updateVoice(VoiceTrack& track, int voiceId, const GestureHistory::View& samples,
+                     std::vector<VoiceGestureEvent>& outEvents) const;
+
+    /**
+     * Make sure a voice has its bookkeeping allocated. Call this for every
+     * voice, on one thread, before fanning updateVoice() out across workers:
+     * once a track exists, updates for different voices touch disjoint state
+     * and can run side by side.
+     */
+    void prepareVoice(int voiceId);
+
+    /**
+     * The voice is leaving: if a begin is still waiting on it, fill `out`
+     * with the matching cancel and return true. Call before the track resets.
+     */
+    static bool cancelOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out);
+
+    /**
+     * After setConfig(): if the voice has a begin the new config will never
+     * resolve – predictive onsets switched off, or a preset without that
+     * gesture – fill `out` with its cancel and return true.
+     */
+    bool cancelOrphanedOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out) const;
+
+    /**
+     * A begin older than `onsetTimeoutMs` at `now` gets its cancel, whether
+     * or not the voice sent anything since: the onset pass only sees voices
+     * with new rows. Call once per tick for every live voice.
+     */
+    bool cancelTimedOutOnset(VoiceTrack& track, int voiceId, uint64_t now, VoiceGestureEvent& out) const;
+
+    /**
+     * Cooldowns as "ms since each gesture last fired at `now`" (-1 = never),
+     * the form they travel in when a voice moves to another host, whose clock
+     * disagrees with ours about what `now` is. importCooldowns() turns them
+     * back into trigger times against the receiving host's `now`.
+     */
+    static void exportCooldowns(const VoiceTrack& track, uint64_t now, int32_t* sinceMs);
+    static void importCooldowns(VoiceTrack& track, uint64_t now, const int32_t* sinceMs);
+
+    /**
+     * Everything one rule gets to look at for one voice and frame: the
+     * thresholds, the window statistics and travel across the window, and a
+     * way to fire. Built once, then handed to each rule of the pipeline.
+     */
+    struct RuleContext {
+        const Config& config;
+        VoiceTrack& track;
+        int voiceId;
+        const GestureHistory::View& samples;
+        const VoiceFeatureWindow::Features& features;
+        std::size_t latestIdx;
+        uint64_t nowMicros;
+        uint64_t now;  ///< ms: cooldowns and the rules' durations are plenty precise in whole milliseconds.
+        float deltaX;  ///< travel from the window's first row to its newest.
+        float deltaY;
+        std::vector<VoiceGestureEvent>& outEvents;
+
+        bool ready(VoiceGestureType type, uint64_t cooldownMs) const { return canTrigger(track, type, now, cooldownMs); }
+        /// Emit `event`, start its cooldown and confirm the begin that predicted it, if any.
+        void fire(const VoiceGestureEvent& event) {
+            outEvents.push_back(event);
+            rememberTrigger(track, event.type, now);
+            confirmOnset(track, event, now, outEvents);
+        }
+    };
+
 private:
-    bool canTrigger(int voiceId, const std::string& type, uint64_t timestamp, uint64_t cooldownMs);
-    void rememberTrigger(int voiceId, const std::string& type, uint64_t timestamp);
+    using Runner = void (VoiceGestureDetector::*)(VoiceTrack&, int, const GestureHistory::View&,
+                                                  std::vector<VoiceGestureEvent>&) const;
+    /// One preset's whole per-voice pass, window statistics through onsets.
+    template <typename Pipeline, bool Predictive>
+    void run(VoiceTrack& track, int voiceId, const GestureHistory::View& samples, std::vector<VoiceGestureEvent>& outEvents) const;
+    /// Predictive mode: cancel a begin that went off course, or start a new one among `types` (bits by gesture id).
+    void updateOnset(VoiceTrack& track, int voiceId, const GestureHistory::View& samples,
+                     const VoiceFeatureWindow::Features& features, uint32_t types,
+                     std::vector<VoiceGestureEvent>& outEvents) const;
+    /// A rule just fired: confirm the begin that predicted it, if any.
+    static void confirmOnset(VoiceTrack& track, const VoiceGestureEvent& event, uint64_t now,
+                             std::vector<VoiceGestureEvent>& outEvents);
+
+    static bool canTrigger(const VoiceTrack& track, VoiceGestureType type, uint64_t timestamp, uint64_t cooldownMs);
+    static void rememberTrigger(VoiceTrack& track, VoiceGestureType type, uint64_t timestamp);
+    VoiceFeatureWindow::Settings windowSettings(uint32_t features) const;
 
     Config config;
-    std::unordered_map<int, std::unordered_map<std::string, uint64_t>> lastTriggerTimes;
+    Runner runner;
+    uint32_t onsetTypes = 0; // voiceGestureBit()s whose pending begins the current runner resolves.
+    std::unordered_map<int, VoiceTrack> tracks;
 };
 
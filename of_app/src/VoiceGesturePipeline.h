@@ -0,0 +1,217 @@
+#pragma once
+
+#include "AsyncLogger.h"
+#include "VoiceFeatureWindow.h"
+#include "VoiceGestureDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * The per-voice gesture rules, one small policy type each. A rule names the
+ * window statistics it reads (`kFeatures`, VoiceFeatureWindow bits) and the
+ * gestures it can fire (`kTypes`), and `detect()` judges one voice for one
+ * frame through a VoiceGestureDetector::RuleContext.
+ *
+ * VoiceGesturePipeline<Rules...> strings rules together at compile time: it
+ * ORs their feature bits so the window keeps only those, and calls each
+ * rule in order, inlined, with nothing in between. Order matters – it is the
+ * order gestures fire in within one frame.
+ *
+ * To teach the host a new gesture, write a rule like the ones below, add its
+ * type to VoiceGestureType, and put it in a preset (VoiceGestureDetector.cpp
+ * maps preset names to pipelines). Shows whose presets leave it out never
+ * pay for it.
+ */
+
+/// The kTypes bit of one gesture.
+constexpr uint32_t voiceGestureBit(VoiceGestureType type) {
+    return 1u << static_cast<uint32_t>(type);
+}
+
+namespace voice_rules {
+inline float clamp01(float value) {
+    return ofClamp(value, 0.0f, 1.0f);
+}
+
+inline VoiceGestureEvent makeEvent(const VoiceGestureDetector::RuleContext& context, VoiceGestureType type, float strength,
+                                   float extra) {
+    VoiceGestureEvent event;
+    event.voiceId = context.voiceId;
+    event.type = type;
+    event.strength = strength;
+    event.extra = extra;
+    return event;
+}
+} // namespace voice_rules
+
+/// Raise: significant upward travel with a narrow horizontal footprint.
+struct RaiseRule {
+    static constexpr uint32_t kFeatures = VoiceFeatureWindow::kExtentX;
+    static constexpr uint32_t kTypes = voiceGestureBit(VoiceGestureType::Raise);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const float horizontalSpan = context.features.maxX - context.features.minX;
+        if (context.deltaY > -config.raiseDeltaY || horizontalSpan > config.raiseHorizontalLimit ||
+            !context.ready(VoiceGestureType::Raise, config.gestureCooldownMs)) {
+            return;
+        }
+        // extra: the hand's height, handy for mapping to register.
+        const VoiceGestureEvent event = voice_rules::makeEvent(context, VoiceGestureType::Raise,
+                                                               voice_rules::clamp01(-context.deltaY / config.raiseDeltaY),
+                                                               context.samples.y()[context.latestIdx]);
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " raise strength " << event.strength;
+        }
+        context.fire(event);
+    }
+};
+
+/// Lower: mirror image of raise, rewarding committed downward travel.
+struct LowerRule {
+    static constexpr uint32_t kFeatures = VoiceFeatureWindow::kExtentX;
+    static constexpr uint32_t kTypes = voiceGestureBit(VoiceGestureType::Lower);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const float horizontalSpan = context.features.maxX - context.features.minX;
+        if (context.deltaY < config.lowerDeltaY || horizontalSpan > config.raiseHorizontalLimit ||
+            !context.ready(VoiceGestureType::Lower, config.gestureCooldownMs)) {
+            return;
+        }
+        const VoiceGestureEvent event = voice_rules::makeEvent(context, VoiceGestureType::Lower,
+                                                               voice_rules::clamp01(context.deltaY / config.lowerDeltaY),
+                                                               context.samples.y()[context.latestIdx]);
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " lower strength " << event.strength;
+        }
+        context.fire(event);
+    }
+};
+
+/// Swipe left/right: long, flat horizontal travel. Needs nothing but the window's ends.
+struct SwipeRule {
+    static constexpr uint32_t kFeatures = 0;
+    static constexpr uint32_t kTypes =
+        voiceGestureBit(VoiceGestureType::SwipeLeft) | voiceGestureBit(VoiceGestureType::SwipeRight);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const float absDeltaX = std::abs(context.deltaX);
+        const float absDeltaY = std::abs(context.deltaY);
+        if (absDeltaX < config.swipeDeltaX || absDeltaX <= absDeltaY * config.swipeOrthogonality ||
+            absDeltaY > config.swipeVerticalLimit) {
+            return;
+        }
+        const VoiceGestureType type = (context.deltaX < 0.0f) ? VoiceGestureType::SwipeLeft : VoiceGestureType::SwipeRight;
+        if (!context.ready(type, config.gestureCooldownMs)) {
+            return;
+        }
+        const VoiceGestureEvent event =
+            voice_rules::makeEvent(context, type, voice_rules::clamp01(absDeltaX / config.swipeDeltaX), 0.0f);
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " " << gestureTypeName(type) << " strength "
+                                                << event.strength;
+        }
+        context.fire(event);
+    }
+};
+
+/// Shake: small physical footprint but with lots of directional whiplash.
+struct ShakeRule {
+    static constexpr uint32_t kFeatures =
+        VoiceFeatureWindow::kExtentX | VoiceFeatureWindow::kExtentY | VoiceFeatureWindow::kMotion | VoiceFeatureWindow::kFlips;
+    static constexpr uint32_t kTypes = voiceGestureBit(VoiceGestureType::Shake);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const VoiceFeatureWindow::Features& features = context.features;
+        const float radius = std::max(features.maxX - features.minX, features.maxY - features.minY);
+        if (radius > config.shakeRadius || features.avgMotion < config.shakeMinMotion ||
+            features.signFlips < config.shakeMinSignFlips || !context.ready(VoiceGestureType::Shake, config.gestureCooldownMs)) {
+            return;
+        }
+        const VoiceGestureEvent event = voice_rules::makeEvent(
+            context, VoiceGestureType::Shake, voice_rules::clamp01(features.avgMotion / (config.shakeMinMotion * 2.0f)), 0.0f);
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " shake strength " << event.strength;
+        }
+        context.fire(event);
+    }
+};
+
+/// Burst: reward sudden spikes in velocity regardless of direction.
+struct BurstRule {
+    static constexpr uint32_t kFeatures = VoiceFeatureWindow::kSpeed;
+    static constexpr uint32_t kTypes = voiceGestureBit(VoiceGestureType::Burst);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const float maxSpeed = context.features.maxSpeed;
+        if (maxSpeed < config.burstSpeedThreshold || !context.ready(VoiceGestureType::Burst, config.burstCooldownMs)) {
+            return;
+        }
+        const float denom = std::max(0.01f, config.burstMaxSpeed - config.burstSpeedThreshold);
+        const VoiceGestureEvent event = voice_rules::makeEvent(
+            context, VoiceGestureType::Burst, voice_rules::clamp01((maxSpeed - config.burstSpeedThreshold) / denom), 0.0f);
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " burst strength " << event.strength;
+        }
+        context.fire(event);
+    }
+};
+
+/// Hold: stillness sustained beyond the configured patience level. The
+/// window remembers when the last sample with real motion went by.
+struct HoldRule {
+    static constexpr uint32_t kFeatures = VoiceFeatureWindow::kMotion | VoiceFeatureWindow::kHold;
+    static constexpr uint32_t kTypes = voiceGestureBit(VoiceGestureType::Hold);
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        const VoiceGestureDetector::Config& config = context.config;
+        const float avgMotion = context.features.avgMotion;
+        const uint64_t holdDuration = (context.nowMicros - context.features.holdStartMicros) / 1000;
+        if (avgMotion > config.holdMotionThreshold || holdDuration < config.holdDurationMs ||
+            !context.ready(VoiceGestureType::Hold, config.holdCooldownMs)) {
+            return;
+        }
+        const float denom = std::max(0.01f, config.holdMotionThreshold);
+        const VoiceGestureEvent event = voice_rules::makeEvent(
+            context, VoiceGestureType::Hold, voice_rules::clamp01(1.0f - (avgMotion / denom)),
+            voice_rules::clamp01(static_cast<float>(holdDuration) / static_cast<float>(config.holdDurationMs)));
+        if (config.logGestures) {
+            AsyncLogNotice("VoiceGestureDetector") << "voice " << context.voiceId << " hold strength " << event.strength << " duration "
+                                                << event.extra;
+        }
+        context.fire(event);
+    }
+};
+
+template <typename... Rules>
+struct VoiceGesturePipeline;
+
+template <>
+struct VoiceGesturePipeline<> {
+    static constexpr uint32_t kFeatures = 0;
+    static constexpr uint32_t kTypes = 0;
+    static void detect(VoiceGestureDetector::RuleContext&) {}
+};
+
+template <typename Rule, typename... Rest>
+struct VoiceGesturePipeline<Rule, Rest...> {
+    static constexpr uint32_t kFeatures = Rule::kFeatures | VoiceGesturePipeline<Rest...>::kFeatures;
+    static constexpr uint32_t kTypes = Rule::kTypes | VoiceGesturePipeline<Rest...>::kTypes;
+
+    static void detect(VoiceGestureDetector::RuleContext& context) {
+        Rule::detect(context);
+        VoiceGesturePipeline<Rest...>::detect(context);
+    }
+};
+
+// The presets behind VoiceGestureDetector::RuleSet.
+using FullVoiceRules = VoiceGesturePipeline<RaiseRule, LowerRule, SwipeRule, ShakeRule, BurstRule, HoldRule>;
+using RaiseHoldVoiceRules = VoiceGesturePipeline<RaiseRule, HoldRule>;
+using DirectionalVoiceRules = VoiceGesturePipeline<RaiseRule, LowerRule, SwipeRule>;
+using EnergyVoiceRules = VoiceGesturePipeline<ShakeRule, BurstRule, HoldRule>;
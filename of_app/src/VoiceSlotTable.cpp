@@ -0,0 +1,133 @@
+#include "VoiceSlotTable.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+constexpr int VoiceSlotTable::kMaxVoices;
+
+VoiceSlotTable::~VoiceSlotTable() {
+    for (std::size_t i = 0; i < slotCount; ++i) {
+        slots[i].~VoiceSlot();
+    }
+}
+
+void VoiceSlotTable::reserve(std::size_t voiceCount) {
+    voiceCount = std::min<std::size_t>(voiceCount, static_cast<std::size_t>(kMaxVoices));
+    if (voiceCount > slotCount) {
+        grow(voiceCount);
+    }
+}
+
+VoiceSlot* VoiceSlotTable::find(int voiceId) {
+    if (voiceId < 0 || voiceId >= highWater || !slots[voiceId].live) {
+        return nullptr;
+    }
+    return &slots[voiceId];
+}
+
+VoiceSlot* VoiceSlotTable::find(const Ref& ref) {
+    VoiceSlot* slot = find(ref.voiceId);
+    return (slot && slot->generation == ref.generation) ? slot : nullptr;
+}
+
+VoiceSlotTable::Ref VoiceSlotTable::ref(int voiceId) const {
+    Ref result;
+    if (voiceId >= 0 && static_cast<std::size_t>(voiceId) < slotCount) {
+        result.voiceId = voiceId;
+        result.generation = slots[voiceId].generation;
+    }
+    return result;
+}
+
+VoiceSlot* VoiceSlotTable::claim(int voiceId, bool& claimed) {
+    claimed = false;
+    if (voiceId < 0 || voiceId >= kMaxVoices) {
+        return nullptr;
+    }
+    if (static_cast<std::size_t>(voiceId) >= slotCount) {
+        // Somebody's pipe pool is bigger than configured: grow once, generously.
+        grow(std::min<std::size_t>(std::max<std::size_t>(voiceId + 1, slotCount * 2), kMaxVoices));
+    }
+
+    VoiceSlot& slot = slots[voiceId];
+    if (!slot.live) {
+        // Wipe whatever the previous dancer left behind, but keep the
+        // detector window's buffers so re-entry never touches the allocator.
+        ++slot.generation;
+        slot.live = true;
+        slot.position = glm::vec3(0.0f);
+        slot.size = 0.0f;
+        slot.motion = 0.0f;
+        slot.energy = 0.0f;
+        slot.lastUpdateMicros = 0;
+        slot.arrivalMicros = 0;
+        slot.history = GestureHistory::Handle();
+        slot.dirty = false;
+        slot.pendingSamples = 0;
+        slot.pendingMotion = 0.0f;
+        slot.track.reset();
+        ++liveCount;
+        highWater = std::max(highWater, voiceId + 1);
+        claimed = true;
+    }
+    return &slot;
+}
+
+void VoiceSlotTable::release(int voiceId) {
+    VoiceSlot* slot = find(voiceId);
+    if (!slot) {
+        return;
+    }
+    slot->live = false;
+    ++slot->generation;
+    slot->history = GestureHistory::Handle();
+    --liveCount;
+    while (highWater > 0 && !slots[highWater - 1].live) {
+        --highWater;
+    }
+}
+
+void VoiceSlotTable::markDirty(int voiceId) {
+    VoiceSlot* slot = find(voiceId);
+    if (slot && !slot->dirty) {
+        slot->dirty = true;
+        Ref entry;
+        entry.voiceId = voiceId;
+        entry.generation = slot->generation;
+        dirtyList.push_back(entry);
+    }
+}
+
+void VoiceSlotTable::takeDirty(std::vector<int>& out) {
+    out.clear();
+    for (const Ref& entry : dirtyList) {
+        // A voice that left (and maybe came back as someone new) since it was
+        // marked fails the generation check and is skipped.
+        VoiceSlot* slot = find(entry);
+        if (slot && slot->dirty) {
+            slot->dirty = false;
+            out.push_back(entry.voiceId);
+        }
+    }
+    dirtyList.clear();
+    std::sort(out.begin(), out.end());
+}
+
+void VoiceSlotTable::grow(std::size_t newCount) {
+    std::unique_ptr<unsigned char[]> newStorage(new unsigned char[newCount * sizeof(VoiceSlot) + alignof(VoiceSlot)]);
+    void* base = newStorage.get();
+    std::size_t space = newCount * sizeof(VoiceSlot) + alignof(VoiceSlot);
+    VoiceSlot* newSlots = static_cast<VoiceSlot*>(std::align(alignof(VoiceSlot), newCount * sizeof(VoiceSlot), base, space));
+
+    for (std::size_t i = 0; i < slotCount; ++i) {
+        new (&newSlots[i]) VoiceSlot(std::move(slots[i]));
+        slots[i].~VoiceSlot();
+    }
+    for (std::size_t i = slotCount; i < newCount; ++i) {
+        new (&newSlots[i]) VoiceSlot();
+    }
+    storage = std::move(newStorage);
+    slots = newSlots;
+    slotCount = newCount;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "GestureHistory.h"
+#include "VoiceGestureDetector.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Everything the host knows about one voice, in one place: the latest state
+ * from the tracker, the handle of its history ring, and the detector's
+ * cooldowns and window stats. Slots are cache-line aligned so detection
+ * workers chewing on neighbouring voices never fight over the same line.
+ */
+struct alignas(64) VoiceSlot {
+    // Hot: read or written by every packet and every prune pass.
+    uint32_t generation = 0;       ///< Bumped whenever the id is claimed or released.
+    bool live = false;
+    glm::vec3 position = glm::vec3(0.0f);
+    float size = 0.0f;
+    float motion = 0.0f;
+    float energy = 0.0f;
+    uint64_t lastUpdateMicros = 0; ///< Sample time of the latest state (IngestPacket::timestampMicros).
+    uint64_t arrivalMicros = 0;    ///< Receive stamp of the latest packet, for emit latency.
+    GestureHistory::Handle history;
+    bool dirty = false;            ///< Has samples the detector hasn't seen yet.
+    uint32_t pendingSamples = 0;   ///< Coalesced packets waiting for the next frame.
+    float pendingMotion = 0.0f;    ///< Their summed motion, averaged when they land.
+
+    // Only touched when gestures are judged.
+    VoiceGestureDetector::VoiceTrack track;
+};
+
+/**
+ * A dense, preallocated table of VoiceSlots indexed straight by voiceId. The
+ * OSC schema hands out ids 0..N-1 from a fixed pipe pool, so a lookup is an
+ * array index, pruning and per-frame detection are linear walks in id order,
+ * and nothing rehashes when the crowd grows.
+ *
+ * Anything that wants to remember a voice across frames should keep a Ref
+ * rather than a bare id: the generation inside it stops matching the moment
+ * that dancer leaves, so a newcomer who inherits the id is never mistaken
+ * for them.
+ *
+ * The table also keeps the frame's dirty set – voices that received samples
+ * since detection last ran – so idle dancers cost nothing per frame.
+ */
+class VoiceSlotTable {
+public:
+    /// Ids at or above this are refused rather than growing the table without bound.
+    static constexpr int kMaxVoices = 4096;
+
+    struct Ref {
+        int voiceId = -1;
+        uint32_t generation = 0;
+    };
+
+    VoiceSlotTable() = default;
+    ~VoiceSlotTable();
+
+    VoiceSlotTable(const VoiceSlotTable&) = delete;
+    VoiceSlotTable& operator=(const VoiceSlotTable&) = delete;
+
+    /// Preallocate slots for ids 0..voiceCount-1 so the show itself never grows the table.
+    void reserve(std::size_t voiceCount);
+    std::size_t capacity() const { return slotCount; }
+
+    /// Live voices.
+    std::size_t size() const { return liveCount; }
+    /// One past the highest live id – the bound for walks over slot().
+    int span() const { return highWater; }
+
+    /// Unchecked access for walks; check `live` yourself.
+    VoiceSlot& slot(int voiceId) { return slots[voiceId]; }
+    const VoiceSlot& slot(int voiceId) const { return slots[voiceId]; }
+
+    /// The live slot for `voiceId`, or null.
+    VoiceSlot* find(int voiceId);
+    /// The live slot `ref` was taken from, or null if that voice has since left.
+    VoiceSlot* find(const Ref& ref);
+    Ref ref(int voiceId) const;
+
+    /**
+     * The live slot for `voiceId`, claiming a fresh one if the voice is new
+     * (`claimed` tells you which, so you can acquire its history ring). Null
+     * for ids outside 0..kMaxVoices-1.
+     */
+    VoiceSlot* claim(int voiceId, bool& claimed);
+
+    /// Retire a voice. Hand its history ring back before calling this.
+    void release(int voiceId);
+
+    /// Note that a live voice has fresh samples. Cheap per packet; each voice is listed once.
+    void markDirty(int voiceId);
+    /**
+     * Every voice marked since the last call that is still the same dancer,
+     * in ascending id order, into `out`; the set starts over empty.
+     */
+    void takeDirty(std::vector<int>& out);
+
+private:
+    void grow(std::size_t newCount);
+
+    // C++14 allocators ignore alignas beyond max_align_t, so the slots are
+    // laid out by hand inside an over-sized byte buffer.
+    std::unique_ptr<unsigned char[]> storage;
+    VoiceSlot* slots = nullptr;
+    std::size_t slotCount = 0;
+    std::size_t liveCount = 0;
+    int highWater = 0;
+    std::vector<Ref> dirtyList;
+};
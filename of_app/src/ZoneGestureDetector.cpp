@@ -1,142 +1,250 @@
 #include "ZoneGestureDetector.h"
 
-#include "ofLog.h"
+#include "AsyncLogger.h"
 
 #include <algorithm>
+#include <cmath>
 
 namespace {
 float clamp01(float value) {
     return ofClamp(value, 0.0f, 1.0f);
 }
-
-// Friendly names for composing sweep strings. Keeping them here makes it easy
-// to update copywriting without diving into logic below.
-const std::array<std::string, 4> kRowNames = {"top", "upper_mid", "lower_mid", "bottom"};
-const std::array<std::string, 4> kColumnNames = {"left", "mid_left", "mid_right", "right"};
 } // namespace
 
+constexpr uint64_t ZoneGestureDetector::kNeverTriggered;
+
 ZoneGestureDetector::ZoneGestureDetector() = default;
 
 void ZoneGestureDetector::setConfig(const Config& newConfig) {
     config = newConfig;
 }
 
-void ZoneGestureDetector::updateCamera(int camId, const std::array<float, 16>& zones, uint64_t timestampMs, std::vector<ZoneGestureEvent>& outEvents) {
-    auto& history = histories[camId];
-    ZoneSample sample;
-    sample.timestamp = timestampMs;
-    sample.values = zones;
-    history.push_back(sample);
+void ZoneGestureDetector::updateCamera(int camId, int rows, int cols, const float* zones, uint64_t timestampMs,
+                                       std::vector<ZoneGestureEvent>& outEvents) {
+    if (rows < 1 || cols < 1 || rows > kMaxZoneLanes || cols > kMaxZoneLanes || rows * cols > kMaxZoneCells) {
+        return;
+    }
+
+    CameraState& camera = cameras[camId];
+    if (camera.rows != rows || camera.cols != cols) {
+        // A camera switching resolution starts over: old frames, pulse slopes
+        // and cooldowns were measured on a different grid.
+        if (camera.rows != 0) {
+            AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " grid is now " << cols << "x" << rows;
+        }
+        camera.reset(rows, cols);
+    }
+    camera.push(timestampMs, zones);
 
     // Trim the backlog so we only carry the last few seconds of context per
     // camera. The detectors rely on this sliding window to avoid stale ghosts.
     uint64_t minTimestamp = (timestampMs > config.historyMs) ? timestampMs - config.historyMs : 0;
-    while (!history.empty() && history.front().timestamp < minTimestamp) {
-        history.pop_front();
+    while (camera.count > 0 && camera.timestamp(camera.oldestSequence()) < minTimestamp) {
+        camera.popFront();
     }
 
-    detectSweeps(camId, history, outEvents);
-    detectPulses(camId, sample, outEvents);
+    detectSweeps(camId, camera, outEvents);
+    detectPulses(camId, camera, zones, timestampMs, outEvents);
 }
 
 void ZoneGestureDetector::removeCamera(int camId) {
-    histories.erase(camId);
-    pulseTrackers.erase(camId);
-    lastTriggerTimes.erase(camId);
+    cameras.erase(camId);
+}
+
+void ZoneGestureDetector::saveState(SnapshotBuffer& out) const {
+    // Frames go out oldest first, so the ring comes back unrolled and the
+    // sequence numbers the sweep bookkeeping refers to stay valid.
+    out.put(static_cast<uint32_t>(cameras.size()));
+    for (const auto& entry : cameras) {
+        const CameraState& camera = entry.second;
+        out.put(static_cast<int32_t>(entry.first));
+        out.put(static_cast<int32_t>(camera.rows));
+        out.put(static_cast<int32_t>(camera.cols));
+        out.put(static_cast<uint64_t>(camera.count));
+        out.put(camera.written);
+        out.put(camera.windowStart);
+        out.put(camera.risingSince);
+        out.put(camera.fallingSince);
+        out.put(camera.latest);
+        out.put(camera.lastSweep);
+        for (uint64_t sequence = camera.oldestSequence(); sequence < camera.written; ++sequence) {
+            out.put(camera.timestamp(sequence));
+            out.putArray(camera.peaks(sequence), camera.laneCount());
+        }
+        out.putArray(camera.pulses.data(), camera.pulses.size());
+    }
+}
+
+bool ZoneGestureDetector::loadState(SnapshotCursor& in) {
+    uint32_t cameraCount = 0;
+    if (!in.get(cameraCount) || !in.fits(cameraCount, sizeof(int32_t) * 3)) {
+        return false;
+    }
+    std::unordered_map<int, CameraState> restored;
+    for (uint32_t i = 0; i < cameraCount; ++i) {
+        int32_t camId = 0;
+        int32_t rows = 0;
+        int32_t cols = 0;
+        uint64_t count = 0;
+        in.get(camId);
+        in.get(rows);
+        in.get(cols);
+        in.get(count);
+        if (!in.ok() || rows < 1 || cols < 1 || rows > kMaxZoneLanes || cols > kMaxZoneLanes || rows * cols > kMaxZoneCells) {
+            return false;
+        }
+        CameraState& camera = restored[camId];
+        camera.reset(rows, cols);
+        const std::size_t lanes = camera.laneCount();
+        if (!in.fits(count, sizeof(uint64_t) + lanes)) {
+            return false;
+        }
+        in.get(camera.written);
+        in.get(camera.windowStart);
+        in.get(camera.risingSince);
+        in.get(camera.fallingSince);
+        in.get(camera.latest);
+        in.get(camera.lastSweep);
+        if (!in.ok() || count > camera.written) {
+            return false;
+        }
+        for (uint64_t& last : camera.lastSweep) {
+            last = in.rebaseMs(last);
+        }
+        camera.capacity = std::max<std::size_t>(32, static_cast<std::size_t>(count));
+        camera.timestamps.assign(camera.capacity, 0);
+        camera.peakRing.assign(camera.capacity * lanes, 0);
+        camera.count = static_cast<std::size_t>(count);
+        for (std::size_t frame = 0; frame < camera.count; ++frame) {
+            in.get(camera.timestamps[frame]);
+            camera.timestamps[frame] = in.rebaseMs(camera.timestamps[frame]);
+            in.getArray(camera.peakRing.data() + frame * lanes, lanes);
+        }
+        in.getArray(camera.pulses.data(), camera.pulses.size());
+        if (!in.ok()) {
+            return false;
+        }
+        for (PulseTracker& tracker : camera.pulses) {
+            tracker.lastTrigger = in.rebaseMs(tracker.lastTrigger);
+        }
+    }
+    cameras.swap(restored);
+    return true;
 }
 
-bool ZoneGestureDetector::canTrigger(int camId, const std::string& type, uint64_t timestamp, uint64_t cooldownMs) {
-    auto camIt = lastTriggerTimes.find(camId);
-    if (camIt == lastTriggerTimes.end()) {
-        return true;
+void ZoneGestureDetector::CameraState::reset(int newRows, int newCols) {
+    *this = CameraState();
+    rows = newRows;
+    cols = newCols;
+    pulses.resize(cellCount());
+}
+
+void ZoneGestureDetector::CameraState::push(uint64_t timestamp, const float* values) {
+    const std::size_t lanes = laneCount();
+    if (count == capacity) {
+        // Out of room: unroll into a ring twice the size, oldest frame first.
+        std::size_t grown = std::max<std::size_t>(32, capacity * 2);
+        std::vector<uint8_t> grownPeaks(grown * lanes);
+        std::vector<uint64_t> grownTimestamps(grown);
+        for (std::size_t i = 0; i < count; ++i) {
+            uint64_t sequence = oldestSequence() + i;
+            std::copy(peaks(sequence), peaks(sequence) + lanes, grownPeaks.begin() + i * lanes);
+            grownTimestamps[i] = this->timestamp(sequence);
+        }
+        peakRing.swap(grownPeaks);
+        timestamps.swap(grownTimestamps);
+        capacity = grown;
+        head = 0;
     }
-    auto typeIt = camIt->second.find(type);
-    if (typeIt == camIt->second.end()) {
-        return true;
+
+    // The only full pass over the grid this frame gets.
+    reduceZoneGrid(values, rows, cols, latest);
+
+    const uint64_t sequence = written;
+    const uint8_t* previous = count > 0 ? peaks(newestSequence()) : nullptr;
+    std::size_t at = (head + count) % capacity;
+    uint8_t* current = peakRing.data() + at * lanes;
+    std::copy(latest.rowArgMax.begin(), latest.rowArgMax.begin() + rows, current);
+    std::copy(latest.colArgMax.begin(), latest.colArgMax.begin() + cols, current + rows);
+    timestamps[at] = timestamp;
+
+    // A step backwards restarts the rising run here; a step forwards restarts
+    // the falling one. Holding still keeps both alive.
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+        if (!previous) {
+            risingSince[lane] = sequence;
+            fallingSince[lane] = sequence;
+        } else if (current[lane] < previous[lane]) {
+            risingSince[lane] = sequence;
+        } else if (current[lane] > previous[lane]) {
+            fallingSince[lane] = sequence;
+        }
     }
-    return timestamp >= typeIt->second + cooldownMs;
+
+    ++count;
+    ++written;
+}
+
+void ZoneGestureDetector::CameraState::popFront() {
+    head = (head + 1) % capacity;
+    --count;
+}
+
+bool ZoneGestureDetector::canTrigger(const CameraState& camera, ZoneGestureType type, int lane, uint64_t timestamp, uint64_t cooldownMs) {
+    uint64_t last = camera.lastSweep[static_cast<std::size_t>(type) * kMaxZoneLanes + lane];
+    return last == kNeverTriggered || timestamp >= last + cooldownMs;
+}
+
+void ZoneGestureDetector::rememberTrigger(CameraState& camera, ZoneGestureType type, int lane, uint64_t timestamp) {
+    camera.lastSweep[static_cast<std::size_t>(type) * kMaxZoneLanes + lane] = timestamp;
 }
 
-void ZoneGestureDetector::rememberTrigger(int camId, const std::string& type, uint64_t timestamp) {
-    lastTriggerTimes[camId][type] = timestamp;
+int ZoneGestureDetector::minTravel(int laneLength) const {
+    // Half a lane on the classic 4x4 grid is the original "two cells".
+    return std::max(2, static_cast<int>(std::ceil(config.sweepMinTravel * laneLength)));
 }
 
-void ZoneGestureDetector::detectSweeps(int camId, const std::deque<ZoneSample>& history, std::vector<ZoneGestureEvent>& outEvents) {
-    if (history.size() < static_cast<std::size_t>(config.sweepMinSteps)) {
+void ZoneGestureDetector::detectSweeps(int camId, CameraState& camera, std::vector<ZoneGestureEvent>& outEvents) {
+    if (camera.count < static_cast<std::size_t>(config.sweepMinSteps)) {
         return;
     }
 
-    uint64_t now = history.back().timestamp;
+    const uint64_t newest = camera.newestSequence();
+    uint64_t now = camera.timestamp(newest);
     uint64_t minTimestamp = (now > config.sweepWindowMs) ? now - config.sweepWindowMs : 0;
 
     // Each row/column keeps track of where the hottest cell lived for each
     // frame. Watching those indices drift lets us detect coherent sweeps.
-    std::array<std::vector<int>, 4> rowMaxIndices;
-    std::array<std::vector<int>, 4> columnMaxIndices;
-
-    for (const auto& sample : history) {
-        if (sample.timestamp < minTimestamp) {
-            continue;
-        }
-
-        for (int row = 0; row < 4; ++row) {
-            int base = row * 4;
-            int maxIndex = 0;
-            float maxValue = sample.values[base];
-            for (int col = 1; col < 4; ++col) {
-                float value = sample.values[base + col];
-                if (value > maxValue) {
-                    maxValue = value;
-                    maxIndex = col;
-                }
-            }
-            rowMaxIndices[row].push_back(maxIndex);
-        }
+    // The indices were cached on arrival, so all that's left is sliding the
+    // window forward – usually by a single frame.
+    if (camera.windowStart < camera.oldestSequence()
+        || (camera.windowStart > camera.oldestSequence() && camera.timestamp(camera.windowStart - 1) >= minTimestamp)) {
+        // Trimmed past, or the clock stepped back so the window grew again:
+        // start over from the oldest frame we still have.
+        camera.windowStart = camera.oldestSequence();
+    }
+    while (camera.timestamp(camera.windowStart) < minTimestamp) {
+        ++camera.windowStart;
+    }
 
-        for (int col = 0; col < 4; ++col) {
-            int maxIndex = 0;
-            float maxValue = sample.values[col];
-            for (int row = 1; row < 4; ++row) {
-                float value = sample.values[row * 4 + col];
-                if (value > maxValue) {
-                    maxValue = value;
-                    maxIndex = row;
-                }
-            }
-            columnMaxIndices[col].push_back(maxIndex);
-        }
+    const int steps = static_cast<int>(newest - camera.windowStart + 1);
+    if (steps < config.sweepMinSteps) {
+        return;
     }
 
-    const auto& latest = history.back();
+    const int rows = camera.rows;
+    const int cols = camera.cols;
+    const uint8_t* first = camera.peaks(camera.windowStart);
+    const uint8_t* last = camera.peaks(newest);
+    const ZoneGridReduction& reduction = camera.latest;
 
     // Rows: detect left/right motion.
-    for (int row = 0; row < 4; ++row) {
-        const auto& indices = rowMaxIndices[row];
-        if (static_cast<int>(indices.size()) < config.sweepMinSteps) {
-            continue;
-        }
-
-        bool increasing = true;
-        bool decreasing = true;
-        for (std::size_t i = 1; i < indices.size(); ++i) {
-            if (indices[i] < indices[i - 1]) {
-                increasing = false;
-            }
-            if (indices[i] > indices[i - 1]) {
-                decreasing = false;
-            }
-        }
-
-        int delta = indices.back() - indices.front();
-        int base = row * 4;
-        float rowMin = latest.values[base];
-        float rowMax = latest.values[base];
-        for (int col = 1; col < 4; ++col) {
-            float value = latest.values[base + col];
-            rowMin = std::min(rowMin, value);
-            rowMax = std::max(rowMax, value);
-        }
-        float rowRange = rowMax - rowMin;
+    const int rowTravel = minTravel(cols);
+    for (int row = 0; row < rows; ++row) {
+        bool increasing = camera.risingSince[row] <= camera.windowStart;
+        bool decreasing = camera.fallingSince[row] <= camera.windowStart;
+        int delta = last[row] - first[row];
+        float rowRange = reduction.rowMax[row] - reduction.rowMin[row];
         if (rowRange < config.sweepMinStrength) {
             // If the energy band is too flat we skip so noise does not fire sweeps.
             continue;
@@ -145,52 +253,38 @@ void ZoneGestureDetector::detectSweeps(int camId, const std::deque<ZoneSample>&
         ZoneGestureEvent event;
         event.camId = camId;
         event.strength = clamp01(rowRange);
+        event.lane = row;
+        event.laneCount = rows;
         event.hasZoneIndex = false;
 
-        if (increasing && delta >= 2) {
-            event.type = "sweep_lr_" + kRowNames[row];
-            if (canTrigger(camId, event.type, now, config.sweepCooldownMs)) {
+        if (increasing && delta >= rowTravel) {
+            event.type = ZoneGestureType::SweepLeftRight;
+            if (canTrigger(camera, event.type, event.lane, now, config.sweepCooldownMs)) {
                 outEvents.push_back(event);
-                rememberTrigger(camId, event.type, now);
-                ofLogNotice("ZoneGestureDetector") << "cam " << camId << " " << event.type << " strength " << event.strength;
+                rememberTrigger(camera, event.type, event.lane, now);
+                if (config.logGestures) {
+                    AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " " << gestureTypeName(event) << " strength " << event.strength;
+                }
             }
-        } else if (decreasing && delta <= -2) {
-            event.type = "sweep_rl_" + kRowNames[row];
-            if (canTrigger(camId, event.type, now, config.sweepCooldownMs)) {
+        } else if (decreasing && delta <= -rowTravel) {
+            event.type = ZoneGestureType::SweepRightLeft;
+            if (canTrigger(camera, event.type, event.lane, now, config.sweepCooldownMs)) {
                 outEvents.push_back(event);
-                rememberTrigger(camId, event.type, now);
-                ofLogNotice("ZoneGestureDetector") << "cam " << camId << " " << event.type << " strength " << event.strength;
+                rememberTrigger(camera, event.type, event.lane, now);
+                if (config.logGestures) {
+                    AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " " << gestureTypeName(event) << " strength " << event.strength;
+                }
             }
         }
     }
 
     // Columns: mirror the logic for top/bottom waves.
-    for (int col = 0; col < 4; ++col) {
-        const auto& indices = columnMaxIndices[col];
-        if (static_cast<int>(indices.size()) < config.sweepMinSteps) {
-            continue;
-        }
-
-        bool increasing = true;
-        bool decreasing = true;
-        for (std::size_t i = 1; i < indices.size(); ++i) {
-            if (indices[i] < indices[i - 1]) {
-                increasing = false;
-            }
-            if (indices[i] > indices[i - 1]) {
-                decreasing = false;
-            }
-        }
-
-        int delta = indices.back() - indices.front();
-        float colMin = latest.values[col];
-        float colMax = latest.values[col];
-        for (int row = 1; row < 4; ++row) {
-            float value = latest.values[row * 4 + col];
-            colMin = std::min(colMin, value);
-            colMax = std::max(colMax, value);
-        }
-        float colRange = colMax - colMin;
+    const int columnTravel = minTravel(rows);
+    for (int col = 0; col < cols; ++col) {
+        bool increasing = camera.risingSince[rows + col] <= camera.windowStart;
+        bool decreasing = camera.fallingSince[rows + col] <= camera.windowStart;
+        int delta = last[rows + col] - first[rows + col];
+        float colRange = reduction.colMax[col] - reduction.colMin[col];
         if (colRange < config.sweepMinStrength) {
             continue;
         }
@@ -198,33 +292,40 @@ void ZoneGestureDetector::detectSweeps(int camId, const std::deque<ZoneSample>&
         ZoneGestureEvent event;
         event.camId = camId;
         event.strength = clamp01(colRange);
+        event.lane = col;
+        event.laneCount = cols;
         event.hasZoneIndex = false;
 
-        if (increasing && delta >= 2) {
-            event.type = "sweep_tb_" + kColumnNames[col];
-            if (canTrigger(camId, event.type, now, config.sweepCooldownMs)) {
+        if (increasing && delta >= columnTravel) {
+            event.type = ZoneGestureType::SweepTopBottom;
+            if (canTrigger(camera, event.type, event.lane, now, config.sweepCooldownMs)) {
                 outEvents.push_back(event);
-                rememberTrigger(camId, event.type, now);
-                ofLogNotice("ZoneGestureDetector") << "cam " << camId << " " << event.type << " strength " << event.strength;
+                rememberTrigger(camera, event.type, event.lane, now);
+                if (config.logGestures) {
+                    AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " " << gestureTypeName(event) << " strength " << event.strength;
+                }
             }
-        } else if (decreasing && delta <= -2) {
-            event.type = "sweep_bt_" + kColumnNames[col];
-            if (canTrigger(camId, event.type, now, config.sweepCooldownMs)) {
+        } else if (decreasing && delta <= -columnTravel) {
+            event.type = ZoneGestureType::SweepBottomTop;
+            if (canTrigger(camera, event.type, event.lane, now, config.sweepCooldownMs)) {
                 outEvents.push_back(event);
-                rememberTrigger(camId, event.type, now);
-                ofLogNotice("ZoneGestureDetector") << "cam " << camId << " " << event.type << " strength " << event.strength;
+                rememberTrigger(camera, event.type, event.lane, now);
+                if (config.logGestures) {
+                    AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " " << gestureTypeName(event) << " strength " << event.strength;
+                }
             }
         }
     }
 }
 
-void ZoneGestureDetector::detectPulses(int camId, const ZoneSample& sample, std::vector<ZoneGestureEvent>& outEvents) {
-    auto& trackers = pulseTrackers[camId];
-    uint64_t timestamp = sample.timestamp;
+void ZoneGestureDetector::detectPulses(int camId, CameraState& camera, const float* values, uint64_t timestamp,
+                                       std::vector<ZoneGestureEvent>& outEvents) {
+    auto& trackers = camera.pulses;
+    const int cellCount = static_cast<int>(camera.cellCount());
 
-    for (int zoneIndex = 0; zoneIndex < 16; ++zoneIndex) {
+    for (int zoneIndex = 0; zoneIndex < cellCount; ++zoneIndex) {
         auto& tracker = trackers[zoneIndex];
-        float value = sample.values[zoneIndex];
+        float value = values[zoneIndex];
         if (!tracker.initialized) {
             tracker.initialized = true;
             tracker.prevValue = value;
@@ -243,14 +344,15 @@ void ZoneGestureDetector::detectPulses(int camId, const ZoneSample& sample, std:
             if (timestamp >= tracker.lastTrigger + config.pulseCooldownMs) {
                 ZoneGestureEvent event;
                 event.camId = camId;
-                event.type = "pulse_zone";
+                event.type = ZoneGestureType::PulseZone;
                 event.hasZoneIndex = true;
                 event.zoneIndex = zoneIndex;
                 event.strength = clamp01((value - config.pulseThreshold) / std::max(0.01f, 1.0f - config.pulseThreshold));
                 outEvents.push_back(event);
                 tracker.lastTrigger = timestamp;
-                rememberTrigger(camId, event.type + std::to_string(zoneIndex), timestamp);
-                ofLogNotice("ZoneGestureDetector") << "cam " << camId << " pulse zone " << zoneIndex << " strength " << event.strength;
+                if (config.logGestures) {
+                    AsyncLogNotice("ZoneGestureDetector") << "cam " << camId << " pulse zone " << zoneIndex << " strength " << event.strength;
+                }
             }
         }
 
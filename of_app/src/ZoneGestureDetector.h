@@ -1,17 +1,22 @@
 #pragma once
 
 #include "GestureEvents.h"
+#include "SnapshotBuffer.h"
+#include "ZoneGridKernels.h"
 #include <array>
-#include <deque>
 #include <unordered_map>
 #include <vector>
 
 /**
- * ZoneGestureDetector stares at the 4x4 heatmaps coming from each camera and
- * tries to call out sweeps (directional waves of attention) or pulses (sudden
- * localized activity). It is less about individual performers and more about
- * how the crowd leans together. The comments here aim to demystify the state
- * machines so you can riff on them for your own stage layouts.
+ * ZoneGestureDetector stares at the motion heatmaps coming from each camera
+ * and tries to call out sweeps (directional waves of attention) or pulses
+ * (sudden localized activity). It is less about individual performers and
+ * more about how the crowd leans together. The comments here aim to demystify
+ * the state machines so you can riff on them for your own stage layouts.
+ *
+ * Each camera picks its own grid size (4x4, 8x8, 16x9, ... up to
+ * kMaxZoneLanes per side); the detector follows whatever the latest message
+ * says and starts that camera fresh if the size changes.
  */
 class ZoneGestureDetector {
 public:
@@ -20,10 +25,12 @@ public:
         uint64_t sweepWindowMs = 900;
         int sweepMinSteps = 3;
         float sweepMinStrength = 0.25f;
+        float sweepMinTravel = 0.5f; // fraction of a lane the hot spot must cross (at least 2 cells).
         uint64_t sweepCooldownMs = 1600;
         float pulseThreshold = 0.35f;
         float pulseSlopeThreshold = 0.05f;
         uint64_t pulseCooldownMs = 900;
+        bool logGestures = true; ///< Log each gesture (through AsyncLogger).
     };
 
     ZoneGestureDetector();
@@ -31,15 +38,16 @@ public:
     void setConfig(const Config& config);
     const Config& getConfig() const { return config; }
 
-    void updateCamera(int camId, const std::array<float, 16>& zones, uint64_t timestampMs, std::vector<ZoneGestureEvent>& outEvents);
+    /// `zones` holds rows * cols values in row-major order.
+    void updateCamera(int camId, int rows, int cols, const float* zones, uint64_t timestampMs, std::vector<ZoneGestureEvent>& outEvents);
     void removeCamera(int camId);
 
-private:
-    struct ZoneSample {
-        uint64_t timestamp = 0;
-        std::array<float, 16> values{};
-    };
+    /// Append every camera's frames, pulse trackers and cooldowns to a snapshot.
+    void saveState(SnapshotBuffer& out) const;
+    /// Replace all camera state with a snapshot's. False, leaving ours alone, if it doesn't parse.
+    bool loadState(SnapshotCursor& in);
 
+private:
     struct PulseTracker {
         bool initialized = false;
         float prevValue = 0.0f;
@@ -47,14 +55,60 @@ private:
         uint64_t lastTrigger = 0;
     };
 
-    bool canTrigger(int camId, const std::string& type, uint64_t timestamp, uint64_t cooldownMs);
-    void rememberTrigger(int camId, const std::string& type, uint64_t timestamp);
-    void detectSweeps(int camId, const std::deque<ZoneSample>& history, std::vector<ZoneGestureEvent>& outEvents);
-    void detectPulses(int camId, const ZoneSample& sample, std::vector<ZoneGestureEvent>& outEvents);
+    static constexpr uint64_t kNeverTriggered = ~uint64_t(0);
+    static constexpr std::size_t kSweepSlots = 4 * kMaxZoneLanes; // direction x lane.
+
+    /**
+     * Everything we remember about one camera, found with a single lookup.
+     *
+     * A frame's hot spots never change once it has arrived, so push() runs
+     * the grid reduction exactly once and keeps only the answer: one byte per
+     * row and column (the argmax) in a ring, oldest at `head`. Frames are
+     * also numbered by a running sequence so the sweep window and the
+     * monotonic-run bookkeeping can refer to them after the ring wraps.
+     */
+    struct CameraState {
+        CameraState() { lastSweep.fill(kNeverTriggered); }
+
+        void reset(int rows, int cols);
+        void push(uint64_t timestamp, const float* values);
+        void popFront();
+        std::size_t laneCount() const { return static_cast<std::size_t>(rows + cols); }
+        std::size_t cellCount() const { return static_cast<std::size_t>(rows * cols); }
+        uint64_t oldestSequence() const { return written - count; }
+        uint64_t newestSequence() const { return written - 1; }
+        std::size_t slot(uint64_t sequence) const { return (head + static_cast<std::size_t>(sequence - oldestSequence())) % capacity; }
+        uint64_t timestamp(uint64_t sequence) const { return timestamps[slot(sequence)]; }
+        /// Row argmaxes (rows of them) followed by column argmaxes (cols).
+        const uint8_t* peaks(uint64_t sequence) const { return peakRing.data() + slot(sequence) * laneCount(); }
+
+        int rows = 0;
+        int cols = 0;
+        std::vector<uint64_t> timestamps;
+        std::vector<uint8_t> peakRing;   // capacity frames of rows + cols argmax indices.
+        std::size_t capacity = 0;        // frames; grows by doubling, never shrinks.
+        std::size_t head = 0;
+        std::size_t count = 0;
+        uint64_t written = 0;            // frames ever pushed; the newest is written - 1.
+
+        // Per lane (rows first, then columns): the sequence since which the
+        // hot spot never moved backwards / forwards. A window starting at or
+        // after that frame is monotonic without rescanning it.
+        std::array<uint64_t, 2 * kMaxZoneLanes> risingSince{};
+        std::array<uint64_t, 2 * kMaxZoneLanes> fallingSince{};
+        uint64_t windowStart = 0;        // oldest frame inside the sweep window.
+
+        ZoneGridReduction latest;         // full reduction of the newest frame.
+        std::vector<PulseTracker> pulses; // one per cell.
+        std::array<uint64_t, kSweepSlots> lastSweep; // sweep cooldowns by gesture id + lane.
+    };
+
+    static bool canTrigger(const CameraState& camera, ZoneGestureType type, int lane, uint64_t timestamp, uint64_t cooldownMs);
+    static void rememberTrigger(CameraState& camera, ZoneGestureType type, int lane, uint64_t timestamp);
+    int minTravel(int laneLength) const;
+    void detectSweeps(int camId, CameraState& camera, std::vector<ZoneGestureEvent>& outEvents);
+    void detectPulses(int camId, CameraState& camera, const float* values, uint64_t timestamp, std::vector<ZoneGestureEvent>& outEvents);
 
     Config config;
-    std::unordered_map<int, std::deque<ZoneSample>> histories;
-    std::unordered_map<int, std::unordered_map<std::string, uint64_t>> lastTriggerTimes;
-    std::unordered_map<int, std::array<PulseTracker, 16>> pulseTrackers;
+    std::unordered_map<int, CameraState> cameras;
 };
-
@@ -0,0 +1,215 @@
+#include "ZoneGridKernels.h"
+
+#if defined(CROWD_ORGAN_ZONE_SSE2)
+#include <emmintrin.h>
+#elif defined(CROWD_ORGAN_ZONE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+#if defined(CROWD_ORGAN_ZONE_SSE2) || defined(CROWD_ORGAN_ZONE_NEON)
+
+// Four floats and four int32 indices at a time. The two backends only differ
+// in these wrappers; the reduction loops below are shared.
+#if defined(CROWD_ORGAN_ZONE_SSE2)
+using Floats = __m128;
+using Indices = __m128i;
+using Mask = __m128;
+
+inline Floats loadFloats(const float* p) { return _mm_loadu_ps(p); }
+inline void storeFloats(float* p, Floats v) { _mm_storeu_ps(p, v); }
+inline Floats maxFloats(Floats a, Floats b) { return _mm_max_ps(a, b); }
+inline Floats minFloats(Floats a, Floats b) { return _mm_min_ps(a, b); }
+inline Mask greater(Floats a, Floats b) { return _mm_cmpgt_ps(a, b); }
+inline Indices splatIndex(int value) { return _mm_set1_epi32(value); }
+inline Indices laneIndices() { return _mm_setr_epi32(0, 1, 2, 3); }
+inline Indices addIndices(Indices a, Indices b) { return _mm_add_epi32(a, b); }
+inline Indices selectIndices(Mask mask, Indices a, Indices b) {
+    __m128i bits = _mm_castps_si128(mask);
+    return _mm_or_si128(_mm_and_si128(bits, a), _mm_andnot_si128(bits, b));
+}
+inline void storeIndices(int32_t* p, Indices v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+#else
+using Floats = float32x4_t;
+using Indices = int32x4_t;
+using Mask = uint32x4_t;
+
+inline Floats loadFloats(const float* p) { return vld1q_f32(p); }
+inline void storeFloats(float* p, Floats v) { vst1q_f32(p, v); }
+inline Floats maxFloats(Floats a, Floats b) { return vmaxq_f32(a, b); }
+inline Floats minFloats(Floats a, Floats b) { return vminq_f32(a, b); }
+inline Mask greater(Floats a, Floats b) { return vcgtq_f32(a, b); }
+inline Indices splatIndex(int value) { return vdupq_n_s32(value); }
+inline Indices laneIndices() {
+    const int32_t lanes[4] = {0, 1, 2, 3};
+    return vld1q_s32(lanes);
+}
+inline Indices addIndices(Indices a, Indices b) { return vaddq_s32(a, b); }
+inline Indices selectIndices(Mask mask, Indices a, Indices b) { return vbslq_s32(mask, a, b); }
+inline void storeIndices(int32_t* p, Indices v) { vst1q_s32(p, v); }
+#endif
+
+/**
+ * Dimensions come in as template arguments when the grid size is known
+ * (0 = take the runtime value), so the common sizes compile down to fully
+ * unrolled loops with no remainder handling.
+ */
+template <int kRows, int kCols>
+void reduceGrid(const float* cells, int runtimeRows, int runtimeCols, ZoneGridReduction& out) {
+    const int rows = kRows > 0 ? kRows : runtimeRows;
+    const int cols = kCols > 0 ? kCols : runtimeCols;
+    out.rows = rows;
+    out.cols = cols;
+
+    // Columns: walk down the rows four columns at a time. A strict `>` keeps
+    // the first (topmost) row on ties.
+    int col = 0;
+    for (; col + 4 <= cols; col += 4) {
+        Floats best = loadFloats(cells + col);
+        Floats low = best;
+        Indices bestRow = splatIndex(0);
+        for (int row = 1; row < rows; ++row) {
+            Floats value = loadFloats(cells + row * cols + col);
+            bestRow = selectIndices(greater(value, best), splatIndex(row), bestRow);
+            best = maxFloats(best, value);
+            low = minFloats(low, value);
+        }
+        int32_t argMax[4];
+        storeIndices(argMax, bestRow);
+        storeFloats(out.colMax.data() + col, best);
+        storeFloats(out.colMin.data() + col, low);
+        for (int lane = 0; lane < 4; ++lane) {
+            out.colArgMax[col + lane] = static_cast<uint8_t>(argMax[lane]);
+        }
+    }
+    for (; col < cols; ++col) {
+        float best = cells[col];
+        float low = best;
+        int bestRow = 0;
+        for (int row = 1; row < rows; ++row) {
+            float value = cells[row * cols + col];
+            if (value > best) {
+                best = value;
+                bestRow = row;
+            }
+            low = value < low ? value : low;
+        }
+        out.colArgMax[col] = static_cast<uint8_t>(bestRow);
+        out.colMax[col] = best;
+        out.colMin[col] = low;
+    }
+
+    // Rows: each vector lane tracks its own best (first index wins inside the
+    // lane), then the four lanes are folded with ties going to the lower
+    // column, and any leftover columns finish the scan in order.
+    for (int row = 0; row < rows; ++row) {
+        const float* values = cells + row * cols;
+        float best = values[0];
+        float low = values[0];
+        int bestCol = 0;
+        int next = 1;
+        if (cols >= 8) {
+            Floats laneBest = loadFloats(values);
+            Floats laneLow = laneBest;
+            Indices laneCol = laneIndices();
+            Indices candidate = laneCol;
+            int start = 4;
+            for (; start + 4 <= cols; start += 4) {
+                candidate = addIndices(candidate, splatIndex(4));
+                Floats value = loadFloats(values + start);
+                laneCol = selectIndices(greater(value, laneBest), candidate, laneCol);
+                laneBest = maxFloats(laneBest, value);
+                laneLow = minFloats(laneLow, value);
+            }
+            float bests[4];
+            float lows[4];
+            int32_t indices[4];
+            storeFloats(bests, laneBest);
+            storeFloats(lows, laneLow);
+            storeIndices(indices, laneCol);
+            best = bests[0];
+            low = lows[0];
+            bestCol = indices[0];
+            for (int lane = 1; lane < 4; ++lane) {
+                if (bests[lane] > best || (bests[lane] == best && indices[lane] < bestCol)) {
+                    best = bests[lane];
+                    bestCol = indices[lane];
+                }
+                low = lows[lane] < low ? lows[lane] : low;
+            }
+            next = start;
+        }
+        for (int c = next; c < cols; ++c) {
+            float value = values[c];
+            if (value > best) {
+                best = value;
+                bestCol = c;
+            }
+            low = value < low ? value : low;
+        }
+        out.rowArgMax[row] = static_cast<uint8_t>(bestCol);
+        out.rowMax[row] = best;
+        out.rowMin[row] = low;
+    }
+}
+
+#else
+
+template <int kRows, int kCols>
+void reduceGrid(const float* cells, int runtimeRows, int runtimeCols, ZoneGridReduction& out) {
+    reduceZoneGridScalar(cells, kRows > 0 ? kRows : runtimeRows, kCols > 0 ? kCols : runtimeCols, out);
+}
+
+#endif
+
+} // namespace
+
+void reduceZoneGrid(const float* cells, int rows, int cols, ZoneGridReduction& out) {
+    if (rows == 4 && cols == 4) {
+        reduceGrid<4, 4>(cells, rows, cols, out);
+    } else if (rows == 8 && cols == 8) {
+        reduceGrid<8, 8>(cells, rows, cols, out);
+    } else if (rows == 9 && cols == 16) {
+        reduceGrid<9, 16>(cells, rows, cols, out);
+    } else {
+        reduceGrid<0, 0>(cells, rows, cols, out);
+    }
+}
+
+void reduceZoneGridScalar(const float* cells, int rows, int cols, ZoneGridReduction& out) {
+    out.rows = rows;
+    out.cols = cols;
+    for (int row = 0; row < rows; ++row) {
+        const float* values = cells + row * cols;
+        int bestCol = 0;
+        float best = values[0];
+        float low = values[0];
+        for (int col = 1; col < cols; ++col) {
+            if (values[col] > best) {
+                best = values[col];
+                bestCol = col;
+            }
+            low = values[col] < low ? values[col] : low;
+        }
+        out.rowArgMax[row] = static_cast<uint8_t>(bestCol);
+        out.rowMax[row] = best;
+        out.rowMin[row] = low;
+    }
+    for (int col = 0; col < cols; ++col) {
+        int bestRow = 0;
+        float best = cells[col];
+        float low = cells[col];
+        for (int row = 1; row < rows; ++row) {
+            float value = cells[row * cols + col];
+            if (value > best) {
+                best = value;
+                bestRow = row;
+            }
+            low = value < low ? value : low;
+        }
+        out.colArgMax[col] = static_cast<uint8_t>(bestRow);
+        out.colMax[col] = best;
+        out.colMin[col] = low;
+    }
+}
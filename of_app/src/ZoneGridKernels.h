@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GestureTypes.h"
+
+#include <array>
+#include <cstdint>
+
+// Pick a vector path at compile time. Define CROWD_ORGAN_NO_SIMD to force the
+// plain loops (handy when comparing results or chasing a platform quirk).
+#if !defined(CROWD_ORGAN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CROWD_ORGAN_ZONE_SSE2 1
+#elif !defined(CROWD_ORGAN_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define CROWD_ORGAN_ZONE_NEON 1
+#endif
+
+/**
+ * Per-row and per-column summary of one camera grid: where the hottest cell
+ * sits along each lane plus the lane's min/max. Ties go to the lowest index,
+ * exactly like a left-to-right scan with `value > best`, so the vector paths
+ * and the scalar path always agree.
+ */
+struct ZoneGridReduction {
+    int rows = 0;
+    int cols = 0;
+    std::array<uint8_t, kMaxZoneLanes> rowArgMax{}; ///< column of each row's hottest cell.
+    std::array<float, kMaxZoneLanes> rowMin{};
+    std::array<float, kMaxZoneLanes> rowMax{};
+    std::array<uint8_t, kMaxZoneLanes> colArgMax{}; ///< row of each column's hottest cell.
+    std::array<float, kMaxZoneLanes> colMin{};
+    std::array<float, kMaxZoneLanes> colMax{};
+};
+
+/**
+ * Reduce a row-major `rows x cols` grid. 4x4, 8x8 and 16x9 (16 columns, 9
+ * rows) go through versions compiled for those exact sizes; anything else up
+ * to kMaxZoneLanes per side takes the runtime-sized path.
+ */
+void reduceZoneGrid(const float* cells, int rows, int cols, ZoneGridReduction& out);
+
+/// Straightforward nested loops, kept as the reference the fast paths must match.
+void reduceZoneGridScalar(const float* cells, int rows, int cols, ZoneGridReduction& out);
@@ -1,17 +1,55 @@
 #include "ofMain.h"
+#include "ofAppNoWindow.h"
 #include "ofApp.h"
 #include <memory>
+#include <string>
+
+namespace {
+// `--headless` / `--windowed` on the command line win; otherwise the
+// "headless" key in gesture_settings.json decides. It has to be read here,
+// before ofApp exists, because it picks what kind of window we make.
+bool wantsHeadless(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            return true;
+        }
+        if (arg == "--windowed") {
+            return false;
+        }
+    }
+    if (ofFile::doesFileExist("gesture_settings.json")) {
+        const ofJson json = ofLoadJson("gesture_settings.json");
+        if (json.contains("headless")) {
+            return json["headless"].get<bool>();
+        }
+    }
+    return false;
+}
+} // namespace
 
 // The main file is intentionally plain: it mirrors the openFrameworks
 // application template so newcomers can orient themselves fast. We pick a
 // window size large enough for the HUD but small enough to live beside logs.
-int main() {
+// Rack-mounted hosts run headless instead: no window, no GL context, and the
+// loop paced by a timer rather than the display.
+int main(int argc, char* argv[]) {
+    ofInit();
+    const bool headless = wantsHeadless(argc, argv);
+    if (headless) {
+        auto window = std::make_shared<ofAppNoWindow>();
+        window->setup(ofWindowSettings());
+        ofGetMainLoop()->addWindow(window);
+        ofRunApp(window, std::make_shared<ofApp>(true));
+        return ofRunMainLoop();
+    }
+
     ofGLFWWindowSettings settings;
     settings.setSize(1280, 720);
     settings.setPosition(glm::ivec2(100, 60));
     settings.resizable = true;
     ofCreateWindow(settings);
 
-    ofRunApp(std::make_shared<ofApp>());
+    ofRunApp(std::make_shared<ofApp>(false));
     return 0;
 }
@@ -3,61 +3,325 @@
 #include "ofJson.h"
 #include "ofLog.h"
 
-#include <array>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <sstream>
 #include <vector>
 
 namespace {
+// Detection ticks run on the same steady clock the packets are stamped with.
 uint64_t nowMillis() {
-    return static_cast<uint64_t>(ofGetElapsedTimeMillis());
+    return monotonicMicros() / 1000;
+}
+
+// How long a flat-out replay may chew per frame before handing the window back.
+constexpr uint64_t kReplaySliceMicros = 12000;
+
+// Headless there is no window to close, so Ctrl-C / a service stop asks for
+// a clean exit and the next update() takes it (exit() still writes the
+// session log index and joins every thread).
+std::atomic<bool> stopRequested{false};
+
+void requestStop(int) {
+    stopRequested.store(true);
+}
+
+// SIGUSR1 asks a headless host for a trace, the signal's answer to the 't' key.
+std::atomic<bool> traceRequested{false};
+
+void requestTrace(int) {
+    traceRequested.store(true);
+}
+
+// The same keys work at the top level (the default for every destination)
+// and inside a destination entry (its own override).
+void readGovernorSettings(const ofJson& json, OutputGovernor::Settings& governor) {
+    if (json.contains("merge_window_ms")) {
+        governor.mergeWindowMs = json["merge_window_ms"].get<uint64_t>();
+    }
+    if (json.contains("max_events_per_sec")) {
+        governor.maxEventsPerSec = json["max_events_per_sec"].get<float>();
+    }
+    if (json.contains("max_voice_per_sec")) {
+        governor.maxVoicePerSec = json["max_voice_per_sec"].get<float>();
+    }
+    if (json.contains("max_zone_per_sec")) {
+        governor.maxZonePerSec = json["max_zone_per_sec"].get<float>();
+    }
+    if (json.contains("max_ensemble_per_sec")) {
+        governor.maxEnsemblePerSec = json["max_ensemble_per_sec"].get<float>();
+    }
+    if (json.contains("rate_burst_ms")) {
+        governor.burstMs = json["rate_burst_ms"].get<uint64_t>();
+    }
 }
 } // namespace
 
 void ofApp::setup() {
-    // Keep the render loop predictable so gesture windows measured in frames
-    // roughly align with milliseconds in configs.
-    ofSetFrameRate(60);
-    ofSetVerticalSync(true);
-
     loadSettings();
+    // Gesture logs are formatted on the detection path but written from here on.
+    AsyncLogger::shared().start();
+    StageProfiler::nameThisThread("main");
 
-    // One receiver for the raw crowd telemetry, one sender for our gestures.
-    stateReceiver.setup(settings.listenPort);
-    if (settings.enableSending) {
-        gestureSender.setup(settings.gestureHost, settings.gesturePort);
+    // An aggregator hears only its edges, through the cluster socket, so the
+    // frame (or tick_hz timer) has to drive its detection.
+    const bool aggregating = settings.cluster.role == ClusterNode::Role::Aggregator && settings.replayFile.empty();
+    if (aggregating) {
+        settings.detectOnReceiveThread = false;
+    }
+
+    if (headless) {
+        // Nothing is drawn, so pace the loop by the clock alone. Detection
+        // on the receive thread is already event-driven; then the loop only
+        // has to notice a stop request (or feed a replay).
+        const bool eventDriven = settings.detectOnReceiveThread && settings.replayFile.empty();
+        ofSetFrameRate(eventDriven ? 10 : std::max(1, std::min(settings.tickHz, 1000)));
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, requestTrace);
+#endif
+        ofLogNotice() << "running headless, "
+                      << (eventDriven ? std::string("event-driven") : ofToString(settings.tickHz) + " Hz tick");
+    } else {
+        // Keep the render loop predictable so gesture windows measured in frames
+        // roughly align with milliseconds in configs.
+        ofSetFrameRate(60);
+        ofSetVerticalSync(true);
     }
 
     // Let configs tune how far back we remember per-voice history.
     gestureHistory.setCapacity(voiceHistoryCapacity);
+    // One slot per pipe in the pool, allocated now rather than mid-show.
+    voices.reserve(static_cast<std::size_t>(std::max(1, settings.maxVoices)));
+    voiceOrder.reserve(voices.capacity());
+    voiceEvents.reserve(voices.capacity());
+    zoneEvents.reserve(64);
+    globalEvents.reserve(8);
+    ensembleEvents.reserve(voices.capacity());
+
+    // Sharded across hosts: edges judge their share of the voices and
+    // cameras, the aggregator the room as a whole. A replay is one host.
+    if (settings.cluster.isActive() && settings.replayFile.empty()) {
+        cluster.start(settings.cluster, VoiceSlotTable::kMaxVoices);
+        clusterVoices.reserve(voices.capacity());
+    }
+    // Dashboards get their own slow, delta-encoded view of the room.
+    if (settings.telemetry.isActive()) {
+        telemetry.start(settings.telemetry, voices.capacity());
+    }
+
+    // Thresholds from the settings file; later edits arrive through the
+    // watcher and are swapped in at the top of a detection tick.
+    applyDetectorConfigs(settings.detectors);
+    if (settings.watchSettings) {
+        configWatcher.start(ofToDataPath("gesture_settings.json", true), settings.detectors, settings.watchIntervalMs);
+    }
+
+    // Voices are independent, so the per-voice rules can spread across cores.
+    detectionPool.start(static_cast<std::size_t>(std::max(0, settings.detectionThreads)));
+    workerEvents.resize(detectionPool.getWorkerCount());
+
+    if (settings.statsEnabled) {
+        latencyStats.reset(new LatencyStats());
+    }
+    if (settings.profileEnabled) {
+        profiler.reset(new StageProfiler());
+        if (settings.traceAtStart) {
+            startTrace();
+        }
+    }
+
+    // A replay stands in for the room: no socket, and detection runs in the
+    // mode the log was recorded in so every tick lands where it did live.
+    if (!settings.replayFile.empty()) {
+        replaying = startReplay();
+    }
+    if (settings.recordSession && !replaying) {
+        if (settings.recordFile.empty()) {
+            ofDirectory::createDirectory("sessions", true, true);
+            settings.recordFile = "sessions/" + ofGetTimestampString("%Y-%m-%d-%H-%M-%S") + ".crowdlog";
+        }
+        const uint32_t flags = settings.detectOnReceiveThread ? SessionLogHeader::kFlagInlineDetection : 0;
+        if (sessionLog.open(ofToDataPath(settings.recordFile), flags)) {
+            ofLogNotice() << "recording session to " << settings.recordFile;
+        } else {
+            ofLogError() << "could not open " << settings.recordFile << " for recording";
+        }
+    }
+
+    // Each gesture listener gets its own send thread; raw crowd telemetry
+    // arrives on the ingest thread so it never waits for the next frame.
+    if (settings.enableSending) {
+        if (settings.destinations.empty()) {
+            GestureDestination::Settings fallback;
+            fallback.host = settings.gestureHost;
+            fallback.port = settings.gesturePort;
+            fallback.queueCapacity = settings.sendQueueCapacity;
+            fallback.output = settings.output;
+            fallback.governor = settings.governor;
+            settings.destinations.push_back(fallback);
+        }
+        for (const auto& destinationSettings : settings.destinations) {
+            std::unique_ptr<GestureDestination> destination(new GestureDestination());
+            if (destination->start(destinationSettings, latencyStats.get())) {
+                destinations.push_back(std::move(destination));
+            }
+        }
+    }
+    if (replaying) {
+        return;
+    }
+    // Pick up where the last run left off before anything can feed the
+    // detectors, then keep the snapshot fresh from here on.
+    if (settings.snapshotEnabled) {
+        restoreSnapshot();
+        if (!snapshotWriter.start(ofToDataPath(settings.snapshotFile, true))) {
+            ofLogError() << "could not write snapshots to " << settings.snapshotFile;
+        }
+    }
+    if (cluster.isAggregator()) {
+        ofLogNotice() << "CrowdOrganHost aggregating " << settings.cluster.shards.size() << " shard(s), emitting gestures to "
+                      << destinations.size() << " destination(s)";
+        return;
+    }
+    // Local cameras feed the same handlePacket() path the socket does, from
+    // whichever thread owns detection.
+    if (!settings.capture.empty()) {
+        capture.start(settings.capture, [this](const IngestPacket& packet) { handlePacket(packet); });
+    }
+    if (settings.detectOnReceiveThread) {
+        // From here on the detectors belong to the receive thread: packets run
+        // through them as they land and the tick covers pruning + global rules.
+        ingest.setInlineHandlers(
+            [this](const IngestPacket& packet) {
+                handlePacket(packet);
+                flushGestures();
+            },
+            [this]() {
+                capture.drain();
+                runDetectionTick(nowMillis());
+                flushGestures();
+            },
+            settings.receiveTickMs);
+    }
+    if (!ingest.start(settings.listenPort, settings.ingestQueueCapacity)) {
+        ofLogError() << "CrowdOrganHost could not listen for motion on port " << settings.listenPort
+                     << (settings.detectOnReceiveThread ? "; detecting per frame instead" : "");
+        if (settings.detectOnReceiveThread) {
+            // No receive thread means no tick: without this, local capture,
+            // pruning and the crowd-wide rules would quietly stop too.
+            settings.detectOnReceiveThread = false;
+            if (headless) {
+                ofSetFrameRate(std::max(1, std::min(settings.tickHz, 1000)));
+            }
+        }
+        return;
+    }
 
     ofLogNotice() << "CrowdOrganHost listening for motion on port " << settings.listenPort
-                  << ", emitting gestures to " << settings.gestureHost << ":" << settings.gesturePort;
+                  << ", emitting gestures to " << destinations.size() << " destination(s)"
+                  << (settings.detectOnReceiveThread ? " (detecting on receive thread)" : "");
 }
 
 void ofApp::update() {
-    uint64_t now = nowMillis();
-    processOscMessages();      // grab fresh motion samples
-    pruneVoices(now);          // toss stale performers so cooldowns reset
-    updateVoiceGestures();     // per-voice raise/swipe/etc.
-    updateGlobalGestures(now); // crowd-wide eruption/stillness
+    if (stopRequested.load()) {
+        ofExit();
+        return;
+    }
+    if (profiler) {
+        updateProfile();
+    }
+    if (replaying) {
+        advanceReplay();           // the log plays the part of the ingest thread
+        return;
+    }
+    if (settings.detectOnReceiveThread) {
+        // Nothing to do here: the receive thread already owns detection.
+        return;
+    }
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Update);
+    processOscMessages();          // grab fresh motion samples
+    capture.drain();               // ...and the newest local camera results
+    runDetectionTick(nowMillis()); // prune + per-voice + crowd-wide rules
+    flushGestures();               // one bundle per frame in bundled mode
 }
 
 void ofApp::draw() {
+    if (headless || !settings.showHud) {
+        return;
+    }
     // Barebones HUD on purpose: it reminds visiting artists which ports matter.
     ofBackground(12);
     ofSetColor(245);
 
     std::stringstream ss;
     ss << "Crowd Organ Host – gesture pilot" << std::endl;
-    ss << "voices tracked: " << voices.size() << std::endl;
-    ss << "global motion: " << ofToString(lastGlobalMotion, 2) << std::endl;
-    ss << "gesture out: " << settings.gestureHost << ":" << settings.gesturePort;
+    ss << "voices tracked: " << hudVoiceCount.load() << std::endl;
+    ss << "global motion: " << ofToString(hudGlobalMotion.load(), 2) << std::endl;
     if (!settings.enableSending) {
-        ss << " (muted)";
+        ss << "gesture out: (muted)" << std::endl;
+    }
+    for (const auto& destination : destinations) {
+        const GestureDestination::Settings& out = destination->getSettings();
+        ss << "gesture out: " << out.name << " " << out.host << ":" << out.port;
+        if (out.output.bundle) {
+            ss << " (bundled)";
+        }
+        ss << ", dropped " << destination->getDroppedCount();
+        if (out.governor.isActive()) {
+            ss << ", throttled " << destination->getThrottledCount() << ", merged " << destination->getMergedCount();
+        }
+        ss << std::endl;
     }
-    ss << std::endl;
     ss << "history window: " << gestureHistory.getCapacity() << " frames" << std::endl;
+    if (configWatcher.getReloadCount() > 0) {
+        ss << "thresholds reloaded: " << configWatcher.getReloadCount() << "x" << std::endl;
+    }
+    if (capture.isActive()) {
+        ss << capture.describe();
+    }
+    ss << "ingest: " << (settings.detectOnReceiveThread ? "receive thread" : "per frame")
+       << ", dropped " << ingest.getDroppedCount() << std::endl;
+    if (replaying) {
+        ss << "replay: " << settings.replayFile << " " << replay.getPosition() << " / " << replay.getRecordCount()
+           << " records" << (replayDone ? " (finished)" : "") << std::endl;
+    } else if (sessionLog.isOpen()) {
+        ss << "recording: " << settings.recordFile << std::endl;
+    }
+    if (cluster.isEdge()) {
+        ss << "cluster: edge shard " << settings.cluster.shard << " of " << settings.cluster.shards.size() << std::endl;
+    } else if (cluster.isAggregator()) {
+        ss << "cluster: aggregating " << settings.cluster.shards.size() << " shard(s)" << std::endl;
+    }
+    if (telemetry.isActive()) {
+        ss << "telemetry: " << telemetry.getDestinationCount() << " dashboard(s), " << telemetry.getBytesSent() / 1024
+           << " KB in " << telemetry.getDatagramsSent() << " datagrams" << std::endl;
+    }
+    if (latencyStats) {
+        // p50 / p99 / max in ms over the last stats interval.
+        std::lock_guard<std::mutex> lock(hudStatsMutex);
+        for (const auto& stat : hudStats) {
+            if (stat.count > 0) {
+                ss << stat.name << ": " << ofToString(stat.p50Ms, 2) << " / " << ofToString(stat.p99Ms, 2) << " / "
+                   << ofToString(stat.maxMs, 2) << " ms (" << stat.count << ")" << std::endl;
+            }
+        }
+    }
 
+    if (profiler) {
+        // Per stage over the last second: calls, average and worst call in µs, and share of the second.
+        std::lock_guard<std::mutex> lock(hudStatsMutex);
+        for (const auto& stage : hudProfile) {
+            if (stage.calls > 0) {
+                ss << stage.name << ": " << stage.calls << " x " << ofToString(stage.totalNanos / 1000.0 / stage.calls, 1)
+                   << " us, max " << ofToString(stage.maxNanos / 1000.0, 1) << " us, "
+                   << ofToString(stage.totalNanos / 1.0e7, 1) << "%" << std::endl;
+            }
+        }
+        ss << (profiler->isTracing() ? "tracing..." : "[t] trace " + ofToString(settings.traceDurationMs) + " ms") << std::endl;
+    }
     ofDrawBitmapStringHighlight(ss.str(), 20, 24, ofColor(0, 128, 128, 180), ofColor::white);
 
     std::string hint = "watch the console for gesture logs";
@@ -67,9 +331,40 @@ void ofApp::draw() {
 }
 
 void ofApp::exit() {
+    // Stop the producer first so nothing lands in a queue that is shutting down.
+    ingest.stop();
+    capture.stop();
+    cluster.stop();
+    telemetry.stop();
+    configWatcher.stop();
+    // Nothing feeds the detectors any more: one last snapshot, so a
+    // deliberate restart loses nothing. Wait out one still on its way to
+    // disk, or this one would be skipped.
+    if (snapshotWriter.isRunning()) {
+        snapshotWriter.waitUntilIdle();
+        takeSnapshot(nowMillis());
+        snapshotWriter.stop();
+    }
+    sessionLog.close(); // writes the index; a crash just leaves a log without one
+    replay.close();
+    detectionPool.stop();
+    for (auto& destination : destinations) {
+        destination->stop();
+    }
+    if (profiler) {
+        profiler->stopTrace();
+        profiler.reset(); // waits for the trace to reach the disk
+    }
+    AsyncLogger::shared().stop(); // writes out the last queued gesture lines
     ofLogNotice() << "CrowdOrganHost shutting down.";
 }
 
+void ofApp::keyPressed(int key) {
+    if ((key == 't' || key == 'T') && profiler) {
+        startTrace();
+    }
+}
+
 void ofApp::loadSettings() {
     // We keep configuration lightweight: a single JSON file in the app folder
     // so touring rigs can tweak ports without recompiling.
@@ -92,139 +387,850 @@ void ofApp::loadSettings() {
     if (json.contains("enable_sending")) {
         settings.enableSending = json["enable_sending"].get<bool>();
     }
+    if (json.contains("ingest_queue_capacity")) {
+        settings.ingestQueueCapacity = json["ingest_queue_capacity"].get<std::size_t>();
+    }
+    if (json.contains("detect_on_receive_thread")) {
+        settings.detectOnReceiveThread = json["detect_on_receive_thread"].get<bool>();
+    }
+    if (json.contains("receive_tick_ms")) {
+        settings.receiveTickMs = json["receive_tick_ms"].get<int>();
+    }
+    if (json.contains("detection_threads")) {
+        settings.detectionThreads = json["detection_threads"].get<int>();
+    }
+    if (json.contains("max_voices")) {
+        settings.maxVoices = json["max_voices"].get<int>();
+    }
+    if (json.contains("voice_coalescing")) {
+        const std::string policy = json["voice_coalescing"].get<std::string>();
+        if (policy == "latest_per_frame") {
+            settings.voiceCoalescing = VoiceCoalescing::LatestPerFrame;
+        } else if (policy == "every_sample") {
+            settings.voiceCoalescing = VoiceCoalescing::EverySample;
+        } else {
+            ofLogWarning() << "unknown voice_coalescing \"" << policy << "\", keeping every sample";
+        }
+    }
+    if (json.contains("bundle_gestures")) {
+        settings.output.bundle = json["bundle_gestures"].get<bool>();
+    }
+    if (json.contains("bundle_max_events")) {
+        settings.output.maxBundleEvents = json["bundle_max_events"].get<std::size_t>();
+    }
+    if (json.contains("bundle_mtu")) {
+        settings.output.mtu = json["bundle_mtu"].get<std::size_t>();
+    }
+    if (json.contains("send_queue_capacity")) {
+        settings.sendQueueCapacity = json["send_queue_capacity"].get<std::size_t>();
+    }
+    readGovernorSettings(json, settings.governor);
+    if (json.contains("destinations")) {
+        loadDestinations(json["destinations"]);
+    }
+    if (json.contains("stats_enabled")) {
+        settings.statsEnabled = json["stats_enabled"].get<bool>();
+    }
+    if (json.contains("stats_interval_ms")) {
+        settings.statsIntervalMs = json["stats_interval_ms"].get<int>();
+    }
+    if (json.contains("profile_enabled")) {
+        settings.profileEnabled = json["profile_enabled"].get<bool>();
+    }
+    if (json.contains("trace_file")) {
+        settings.traceFile = json["trace_file"].get<std::string>();
+    }
+    if (json.contains("trace_duration_ms")) {
+        settings.traceDurationMs = json["trace_duration_ms"].get<int>();
+    }
+    if (json.contains("trace_at_start")) {
+        settings.traceAtStart = json["trace_at_start"].get<bool>();
+    }
+    if (json.contains("record_session")) {
+        settings.recordSession = json["record_session"].get<bool>();
+    }
+    if (json.contains("record_file")) {
+        settings.recordFile = json["record_file"].get<std::string>();
+    }
+    if (json.contains("replay_file")) {
+        settings.replayFile = json["replay_file"].get<std::string>();
+    }
+    if (json.contains("replay_speed")) {
+        settings.replaySpeed = json["replay_speed"].get<float>();
+    }
+    if (json.contains("snapshot_enabled")) {
+        settings.snapshotEnabled = json["snapshot_enabled"].get<bool>();
+    }
+    if (json.contains("snapshot_file")) {
+        settings.snapshotFile = json["snapshot_file"].get<std::string>();
+    }
+    if (json.contains("snapshot_interval_ms")) {
+        settings.snapshotIntervalMs = json["snapshot_interval_ms"].get<int>();
+    }
+    if (json.contains("snapshot_max_age_ms")) {
+        settings.snapshotMaxAgeMs = json["snapshot_max_age_ms"].get<int>();
+    }
+    if (json.contains("tick_hz")) {
+        settings.tickHz = json["tick_hz"].get<int>();
+    }
+    if (json.contains("show_hud")) {
+        settings.showHud = json["show_hud"].get<bool>();
+    }
+    if (json.contains("watch_settings")) {
+        settings.watchSettings = json["watch_settings"].get<bool>();
+    }
+    if (json.contains("watch_interval_ms")) {
+        settings.watchIntervalMs = json["watch_interval_ms"].get<int>();
+    }
+    readDetectorConfigs(json, settings.detectors);
+    if (json.contains("capture")) {
+        readCaptureSettings(json["capture"], settings.capture);
+    }
+    if (json.contains("cluster")) {
+        readClusterSettings(json["cluster"], settings.cluster);
+    }
+    if (json.contains("telemetry")) {
+        readTelemetrySettings(json["telemetry"], settings.telemetry);
+    }
+}
+
+void ofApp::loadDestinations(const ofJson& list) {
+    // Each entry inherits the top-level bundle/queue settings and can override
+    // them, so the common case is just a name, host, port and address list.
+    for (const auto& entry : list) {
+        GestureDestination::Settings destination;
+        destination.name = "destination " + ofToString(settings.destinations.size());
+        destination.host = settings.gestureHost;
+        destination.port = settings.gesturePort;
+        destination.queueCapacity = settings.sendQueueCapacity;
+        destination.output = settings.output;
+        destination.governor = settings.governor;
+
+        if (entry.contains("name")) {
+            destination.name = entry["name"].get<std::string>();
+        }
+        if (entry.contains("host")) {
+            destination.host = entry["host"].get<std::string>();
+        }
+        if (entry.contains("port")) {
+            destination.port = entry["port"].get<int>();
+        }
+        if (entry.contains("addresses")) {
+            destination.filter = 0;
+            for (const auto& address : entry["addresses"]) {
+                const std::string family = address.get<std::string>();
+                if (family == "voice") {
+                    destination.filter |= GestureDestination::kFilterVoice;
+                } else if (family == "zone") {
+                    destination.filter |= GestureDestination::kFilterZone;
+                } else if (family == "global") {
+                    destination.filter |= GestureDestination::kFilterGlobal;
+                } else if (family == "ensemble") {
+                    destination.filter |= GestureDestination::kFilterEnsemble;
+                } else if (family == "stats") {
+                    destination.filter |= GestureDestination::kFilterStats;
+                } else {
+                    ofLogWarning() << "destination " << destination.name << ": unknown address family '" << family << "'";
+                }
+            }
+        }
+        if (entry.contains("queue_capacity")) {
+            destination.queueCapacity = entry["queue_capacity"].get<std::size_t>();
+        }
+        if (entry.contains("bundle_gestures")) {
+            destination.output.bundle = entry["bundle_gestures"].get<bool>();
+        }
+        if (entry.contains("bundle_max_events")) {
+            destination.output.maxBundleEvents = entry["bundle_max_events"].get<std::size_t>();
+        }
+        if (entry.contains("bundle_mtu")) {
+            destination.output.mtu = entry["bundle_mtu"].get<std::size_t>();
+        }
+        readGovernorSettings(entry, destination.governor);
+        settings.destinations.push_back(destination);
+    }
 }
 
 void ofApp::processOscMessages() {
-    std::vector<ZoneGestureEvent> zoneEvents;
-    ofxOscMessage message;
-    uint64_t now = nowMillis();
-
-    while (stateReceiver.hasWaitingMessages()) {
-        stateReceiver.getNextMessage(message);
-        const std::string& address = message.getAddress();
-
-        if (address == "/room/voice/state" && message.getNumArgs() >= 7) {
-            // Voice payload mirrors the OSC schema: id, xyz, size, motion, energy.
-            int voiceId = message.getArgAsInt(0);
-            glm::vec3 position(message.getArgAsFloat(1), message.getArgAsFloat(2), message.getArgAsFloat(3));
-            float size = message.getArgAsFloat(4);
-            float motion = message.getArgAsFloat(5);
-            float energy = message.getArgAsFloat(6);
-
-            VoiceState& state = voices[voiceId];
-            state.position = position;
-            state.size = size;
-            state.motion = motion;
-            state.energy = energy;
-            state.lastUpdate = now;
-
-            gestureHistory.addSample(voiceId, position, motion, energy, now);
-        } else if (address == "/room/voice/disconnect" && message.getNumArgs() >= 1) {
-            int voiceId = message.getArgAsInt(0);
-            voices.erase(voiceId);
-            gestureHistory.removeVoice(voiceId);
-            voiceDetector.removeVoice(voiceId);
-            ofLogNotice() << "voice " << voiceId << " removed";
-        } else if (address == "/room/camera/zones" && message.getNumArgs() >= 3 + 16) {
-            // Zone messages include grid dimensions. We only listen for 4x4 maps.
-            int camId = message.getArgAsInt(0);
-            int rows = message.getArgAsInt(1);
-            int cols = message.getArgAsInt(2);
-            if (rows == 4 && cols == 4) {
-                std::array<float, 16> zones{};
-                for (int i = 0; i < 16; ++i) {
-                    zones[i] = message.getArgAsFloat(3 + i);
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::ProcessOsc);
+    // Drain everything the receive thread parsed since the last frame. The
+    // packets carry their own arrival timestamps, so samples that landed
+    // mid-frame keep their real spacing. Each one is read in place from the
+    // ring, then released.
+    while (const IngestPacket* packet = ingest.front()) {
+        handlePacket(*packet);
+        ingest.popFront();
+    }
+}
+
+void ofApp::handlePacket(const IngestPacket& packet) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::HandlePacket);
+    const uint64_t now = packet.timestampMicros / 1000;
+    if (sessionLog.isOpen()) {
+        recordPacket(packet);
+    }
+
+    switch (packet.kind) {
+    case IngestPacket::Kind::VoiceState: {
+        if (latencyStats) {
+            latencyStats->recordSince(LatencyStream::IngestVoice, packet.arrivalMicros);
+        }
+        if (!cluster.ownsVoice(packet.id)) {
+            break; // another edge judges this one
+        }
+        bool claimed = false;
+        VoiceSlot* slot = voices.claim(packet.id, claimed);
+        if (!slot) {
+            if (!warnedVoiceRange) {
+                ofLogWarning() << "ignoring voice " << packet.id << ": ids must be 0.." << VoiceSlotTable::kMaxVoices - 1;
+                warnedVoiceRange = true;
+            }
+            break;
+        }
+        if (claimed) {
+            slot->history = gestureHistory.acquire();
+        }
+        slot->position = packet.position;
+        slot->size = packet.size;
+        slot->motion = packet.motion;
+        slot->energy = packet.energy;
+        slot->lastUpdateMicros = packet.timestampMicros;
+        slot->arrivalMicros = packet.arrivalMicros;
+
+        if (!settings.detectOnReceiveThread && settings.voiceCoalescing == VoiceCoalescing::LatestPerFrame) {
+            // Fold it into this frame's row; landCoalescedSamples() writes it.
+            slot->pendingMotion += packet.motion;
+            ++slot->pendingSamples;
+        } else {
+            gestureHistory.addSample(slot->history, packet.position, packet.motion, packet.energy, packet.timestampMicros);
+        }
+
+        if (settings.detectOnReceiveThread) {
+            // Judge this voice right away instead of waiting for a frame tick.
+            GestureHistory::View history = gestureHistory.getHistory(slot->history);
+            if (history.size() >= 2) {
+                voiceEvents.clear();
+                {
+                    ScopedLatency timing(latencyStats.get(), LatencyStream::DetectVoice);
+                    ScopedProfile voiceTiming(profiler.get(), ProfileStage::VoiceDetector);
+                    voiceDetector.updateVoice(slot->track, packet.id, history, voiceEvents);
                 }
-                zoneEvents.clear();
-                zoneDetector.updateCamera(camId, zones, now, zoneEvents);
-                for (const auto& event : zoneEvents) {
-                    sendZoneEvent(event);
+                for (const auto& event : voiceEvents) {
+                    sendVoiceEvent(event);
                 }
-                lastZoneUpdate = now;
             }
-        } else if (address == "/room/global/motion" && message.getNumArgs() >= 1) {
-            lastGlobalMotion = message.getArgAsFloat(0);
-            lastGlobalMotionTimestamp = now;
+        } else {
+            voices.markDirty(packet.id); // judged at the next frame tick
+        }
+        break;
+    }
+    case IngestPacket::Kind::VoiceDisconnect:
+        releaseVoice(packet.id, now);
+        cluster.voiceLeft(packet.id);
+        AsyncLogNotice() << "voice " << packet.id << " removed";
+        break;
+    case IngestPacket::Kind::CameraZones: {
+        if (!cluster.ownsCamera(packet.id)) {
+            break;
+        }
+        zoneEvents.clear();
+        if (latencyStats) {
+            latencyStats->recordSince(LatencyStream::IngestZones, packet.arrivalMicros);
+        }
+        {
+            ScopedLatency timing(latencyStats.get(), LatencyStream::DetectZone);
+            ScopedProfile zoneTiming(profiler.get(), ProfileStage::ZoneDetector);
+            zoneDetector.updateCamera(packet.id, packet.rows, packet.cols, packet.zones.data(), now, zoneEvents);
+        }
+        telemetry.noteZones(packet.id, packet.cols, packet.rows, packet.zones.data());
+        for (auto& event : zoneEvents) {
+            event.sourceMicros = packet.arrivalMicros;
+            sendZoneEvent(event);
+        }
+        lastZoneUpdate = now;
+        break;
+    }
+    case IngestPacket::Kind::GlobalMotion:
+        if (latencyStats) {
+            latencyStats->recordSince(LatencyStream::IngestGlobal, packet.arrivalMicros);
+        }
+        lastGlobalMotion = packet.globalMotion;
+        lastGlobalMotionTimestamp = now;
+        lastGlobalMotionArrivalMicros = packet.arrivalMicros;
+        break;
+    }
+}
+
+void ofApp::applyDetectorConfigs(const DetectorConfigs& configs) {
+    // Each detector keeps its own copy, so the rules never chase a pointer.
+    voiceDetector.setConfig(configs.voice);
+    zoneDetector.setConfig(configs.zone);
+    globalDetector.setConfig(configs.global);
+    ensembleDetector.setConfig(configs.ensemble);
+}
+
+void ofApp::runDetectionTick(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::DetectionTick);
+    // Whichever thread ticks owns the detectors, so a reload lands here,
+    // between passes – never halfway through one.
+    if (configWatcher.poll(settings.detectors)) {
+        applyDetectorConfigs(settings.detectors);
+        // A begin the new rules will never confirm or time out (predictive
+        // onsets off, or its gesture left the preset) is cancelled now, as
+        // releaseVoice() would, so no synth envelope is left hanging.
+        for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+            VoiceSlot& slot = voices.slot(voiceId);
+            VoiceGestureEvent cancel;
+            if (slot.live && voiceDetector.cancelOrphanedOnset(slot.track, voiceId, now, cancel)) {
+                sendVoiceEvent(cancel);
+            }
+        }
+    }
+    if (sessionLog.isOpen()) {
+        sessionLog.appendTick(now * 1000); // replays tick exactly where we did
+    }
+    {
+        ScopedProfile clusterTiming(profiler.get(), ProfileStage::Cluster);
+        cluster.poll([this](const ClusterMessage& message) { handleClusterMessage(message); });
+    }
+    pruneVoices(now);              // toss stale performers so cooldowns reset
+    if (!settings.detectOnReceiveThread) {
+        voices.takeDirty(voiceOrder); // only voices that sent something since last frame
+        landCoalescedSamples();
+        updateVoiceGestures();     // per-voice raise/swipe/etc.
+    }
+    expireOnsets(now);             // begins whose voice went quiet mid-gesture
+    if (cluster.isEdge()) {
+        handOffVoices(now);        // performers who walked onto another shard's floor
+        publishToCluster(now);     // the aggregator runs the crowd-wide rules
+    } else {
+        updateGlobalGestures(now);   // crowd-wide eruption/stillness
+        updateEnsembleGestures(now); // neighbours moving together
+    }
+
+    hudVoiceCount.store(static_cast<int>(voices.size()));
+    hudGlobalMotion.store(lastGlobalMotion);
+    if (telemetry.isActive()) {
+        // Paced on the wall clock: a dashboard wants 15 Hz of real time, even in a flat-out replay.
+        ScopedProfile telemetryTiming(profiler.get(), ProfileStage::Telemetry);
+        telemetry.publish(monotonicMicros(), voices, lastGlobalMotion);
+    }
+
+    if (latencyStats && now >= lastStatsPublish + static_cast<uint64_t>(std::max(1, settings.statsIntervalMs))) {
+        publishStats(now);
+    }
+    if (snapshotWriter.isRunning() && now >= lastSnapshot + static_cast<uint64_t>(std::max(1, settings.snapshotIntervalMs))) {
+        takeSnapshot(now);
+    }
+}
+
+void ofApp::expireOnsets(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Prune);
+    // A tracker that drops out mid-gesture sends no rows for the onset pass
+    // to time the begin out on, so the clock does it here.
+    for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        VoiceGestureEvent cancel;
+        if (slot.live && voiceDetector.cancelTimedOutOnset(slot.track, voiceId, now, cancel)) {
+            sendVoiceEvent(cancel);
         }
     }
 }
 
 void ofApp::pruneVoices(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Prune);
     // If a tracker goes silent for a couple seconds we assume the dancer left
     // view and we clear out their history so they come back fresh later.
     const uint64_t staleMs = 2500;
-    for (auto it = voices.begin(); it != voices.end();) {
-        if (now > it->second.lastUpdate && now - it->second.lastUpdate > staleMs) {
-            int voiceId = it->first;
-            gestureHistory.removeVoice(voiceId);
-            voiceDetector.removeVoice(voiceId);
-            it = voices.erase(it);
-        } else {
-            ++it;
+    for (int voiceId = voices.span() - 1; voiceId >= 0; --voiceId) {
+        const VoiceSlot& slot = voices.slot(voiceId);
+        // A voice brought back from a snapshot gets a full stale window from
+        // the restart to speak up again, however long we were down.
+        const uint64_t lastUpdate = std::max(slot.lastUpdateMicros / 1000, restoredAt);
+        if (slot.live && now > lastUpdate && now - lastUpdate > staleMs) {
+            releaseVoice(voiceId, now);
+        }
+    }
+}
+
+void ofApp::releaseVoice(int voiceId, uint64_t now) {
+    // Cooldowns and window stats go with the slot; the ring goes back to the
+    // history pool for the next newcomer.
+    VoiceSlot* slot = voices.find(voiceId);
+    if (!slot) {
+        return;
+    }
+    // A predictive begin still in the air gets its cancel before the voice goes.
+    VoiceGestureEvent cancel;
+    if (VoiceGestureDetector::cancelOnset(slot->track, voiceId, now, cancel)) {
+        sendVoiceEvent(cancel);
+    }
+    gestureHistory.release(slot->history);
+    voices.release(voiceId);
+}
+
+void ofApp::restoreSnapshot() {
+    const uint64_t startMicros = monotonicMicros();
+    std::vector<char> payload;
+    int64_t offsetMicros = 0;
+    uint64_t ageMs = 0;
+    const SnapshotLoad result = readDetectorSnapshot(ofToDataPath(settings.snapshotFile, true),
+                                                     static_cast<uint64_t>(std::max(0, settings.snapshotMaxAgeMs)), payload,
+                                                     offsetMicros, ageMs);
+    if (result == SnapshotLoad::Missing) {
+        return;
+    }
+    if (result == SnapshotLoad::Stale) {
+        ofLogNotice() << "ignoring " << settings.snapshotFile << ": " << ageMs << " ms old, starting cold";
+        return;
+    }
+    if (result == SnapshotLoad::Corrupt) {
+        ofLogWarning() << settings.snapshotFile << " is damaged or from another build, starting cold";
+        return;
+    }
+    SnapshotCursor cursor(payload.data(), payload.size(), offsetMicros);
+    const DetectorState state{voices, gestureHistory, zoneDetector, globalDetector, ensembleDetector};
+    if (!loadDetectorState(state, cursor)) {
+        ofLogWarning() << settings.snapshotFile << " was only partly readable";
+    }
+    restoredAt = nowMillis();
+    // A begin heard before the restart can't be confirmed by rules that lost
+    // the trajectory in between, so cancel it now. The destinations never saw
+    // it in this run; adoptOnset() tells them it went out so the cancel does.
+    for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        VoiceGestureEvent cancel;
+        if (slot.live && VoiceGestureDetector::cancelOnset(slot.track, voiceId, restoredAt, cancel)) {
+            for (auto& destination : destinations) {
+                destination->adoptOnset(cancel);
+            }
+            sendVoiceEvent(cancel);
         }
     }
+    flushGestures();
+    hudVoiceCount.store(static_cast<int>(voices.size()));
+    ofLogNotice() << "restored " << voices.size() << " voice(s) from a snapshot " << ageMs << " ms old in "
+                  << (monotonicMicros() - startMicros) / 1000.0 << " ms";
+}
+
+void ofApp::takeSnapshot(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Snapshot);
+    lastSnapshot = now;
+    // Null while the last snapshot is still on its way to disk: skip this one.
+    SnapshotBuffer* buffer = snapshotWriter.beginSnapshot();
+    if (!buffer) {
+        return;
+    }
+    const DetectorState state{voices, gestureHistory, zoneDetector, globalDetector, ensembleDetector};
+    saveDetectorState(state, *buffer);
+    snapshotWriter.commitSnapshot(monotonicMicros());
+}
+
+void ofApp::handleClusterMessage(const ClusterMessage& message) {
+    if (message.kind == ClusterMessage::Kind::Handoff) {
+        acceptHandoff(message);
+    } else if (message.kind == ClusterMessage::Kind::Gesture && cluster.isAggregator()) {
+        // Sync needs every edge's gestures on one timeline, and the cluster
+        // socket has already mapped the edge's stamp onto ours.
+        ensembleDetector.noteVoiceGesture(message.gesture, message.timestampMicros / 1000);
+    }
+}
+
+void ofApp::acceptHandoff(const ClusterMessage& message) {
+    // The handed-over history is the longer record, so it replaces anything
+    // we started from packets heard since the ownership note.
+    if (voices.find(message.voiceId)) {
+        releaseVoice(message.voiceId, message.timestampMicros / 1000);
+    }
+    bool claimed = false;
+    VoiceSlot* slot = voices.claim(message.voiceId, claimed);
+    if (!slot) {
+        return;
+    }
+    slot->history = gestureHistory.acquire();
+    for (int i = 0; i < message.rowCount; ++i) {
+        const ClusterHistoryRow& row = message.rows[i];
+        const uint64_t age = static_cast<uint64_t>(std::max(0, row.ageMicros));
+        const uint64_t timestampMicros = message.timestampMicros > age ? message.timestampMicros - age : 0;
+        gestureHistory.addSample(slot->history, glm::vec3(row.x, row.y, row.z), row.motion, row.energy, timestampMicros);
+    }
+    if (message.rowCount > 0) {
+        const ClusterHistoryRow& newest = message.rows[message.rowCount - 1];
+        slot->position = glm::vec3(newest.x, newest.y, newest.z);
+        slot->motion = newest.motion;
+        slot->energy = newest.energy;
+    }
+    slot->lastUpdateMicros = message.timestampMicros;
+    slot->arrivalMicros = message.arrivalMicros;
+    VoiceGestureDetector::importCooldowns(slot->track, message.timestampMicros / 1000, message.sinceTriggerMs.data());
+    if (!settings.detectOnReceiveThread) {
+        voices.markDirty(message.voiceId);
+    }
+    AsyncLogNotice() << "voice " << message.voiceId << " handed over from shard " << message.shard;
+}
+
+void ofApp::handOffVoices(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Cluster);
+    // A voice that walked out of our floor band goes to the edge it walked
+    // into, with the end of its history and its cooldowns, so its next
+    // gesture is judged there as if it had been there all along.
+    for (int voiceId = voices.span() - 1; voiceId >= 0; --voiceId) {
+        const VoiceSlot& slot = voices.slot(voiceId);
+        if (!slot.live) {
+            continue;
+        }
+        const int target = cluster.handoffTarget(slot.position.x);
+        if (target == settings.cluster.shard) {
+            continue;
+        }
+        std::array<int32_t, kVoiceGestureTypeCount> sinceTriggerMs;
+        VoiceGestureDetector::exportCooldowns(slot.track, slot.lastUpdateMicros / 1000, sinceTriggerMs.data());
+        cluster.sendHandoff(target, voiceId, gestureHistory.getHistory(slot.history), sinceTriggerMs.data());
+        releaseVoice(voiceId, now);
+    }
+}
+
+void ofApp::publishToCluster(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Cluster);
+    const uint64_t nowMicros = now * 1000;
+    if (!cluster.summaryDue(nowMicros)) {
+        return;
+    }
+    clusterVoices.clear();
+    for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+        const VoiceSlot& slot = voices.slot(voiceId);
+        if (slot.live) {
+            clusterVoices.push_back(ClusterVoice{voiceId, slot.position.x, slot.position.z});
+        }
+    }
+    const uint64_t motionTimeoutMs = static_cast<uint64_t>(std::max(1, settings.cluster.shardTimeoutMs));
+    const bool hasMotion = lastGlobalMotionTimestamp > 0 && now < lastGlobalMotionTimestamp + motionTimeoutMs;
+    cluster.sendSummary(nowMicros, static_cast<int>(voices.size()), lastGlobalMotion, hasMotion, clusterVoices.data(),
+                        clusterVoices.size());
+    cluster.announceOwnership(nowMicros);
+}
+
+void ofApp::landCoalescedSamples() {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::LandSamples);
+    // Under latest_per_frame each dirty voice gets exactly one row per frame:
+    // where it ended up, how loud it was last, and how much it moved on
+    // average across the packets that arrived.
+    for (int voiceId : voiceOrder) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        if (slot.pendingSamples == 0) {
+            continue;
+        }
+        const float motion = slot.pendingMotion / static_cast<float>(slot.pendingSamples);
+        gestureHistory.addSample(slot.history, slot.position, motion, slot.energy, slot.lastUpdateMicros);
+        slot.pendingSamples = 0;
+        slot.pendingMotion = 0.0f;
+    }
 }
 
 void ofApp::updateVoiceGestures() {
-    std::vector<VoiceGestureEvent> events;
-    events.reserve(voices.size());
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::VoiceGestures);
+    if (detectionPool.getWorkerCount() > 1) {
+        updateVoiceGesturesParallel();
+        return;
+    }
+
+    voiceEvents.clear();
 
-    for (const auto& kv : voices) {
-        int voiceId = kv.first;
-        const auto* history = gestureHistory.getHistory(voiceId);
-        if (!history || history->size() < 2) {
+    // Voices that sent nothing since last frame have nothing new to judge:
+    // their windows and cooldowns would come out exactly the same, so they
+    // are skipped outright. The dirty set comes back sorted, so events still
+    // go out in id order.
+    for (int voiceId : voiceOrder) {
+        VoiceSlot& slot = voices.slot(voiceId);
+        GestureHistory::View history = gestureHistory.getHistory(slot.history);
+        if (history.size() < 2) {
             continue;
         }
-        voiceDetector.updateVoice(voiceId, *history, events);
+        ScopedLatency timing(latencyStats.get(), LatencyStream::DetectVoice);
+        ScopedProfile voiceTiming(profiler.get(), ProfileStage::VoiceDetector);
+        voiceDetector.updateVoice(slot.track, voiceId, history, voiceEvents);
     }
 
-    for (const auto& event : events) {
+    for (const auto& event : voiceEvents) {
         sendVoiceEvent(event);
     }
 }
 
+void ofApp::updateVoiceGesturesParallel() {
+    // Hand each worker a contiguous slice of the dirty voices (already in
+    // id order). Worker k always gets slice k, so reading the buffers back in
+    // worker order replays the events sorted by voiceId no matter which thread
+    // finished first. Each voice's detector state lives in its own aligned
+    // slot, so workers never share anything they write.
+    for (auto& buffer : workerEvents) {
+        buffer.clear();
+    }
+
+    detectionPool.parallelFor(voiceOrder.size(), [this](std::size_t worker, std::size_t begin, std::size_t end) {
+        ScopedProfile workerTiming(profiler.get(), ProfileStage::VoiceWorker);
+        std::vector<VoiceGestureEvent>& events = workerEvents[worker];
+        for (std::size_t i = begin; i < end; ++i) {
+            VoiceSlot& slot = voices.slot(voiceOrder[i]);
+            GestureHistory::View history = gestureHistory.getHistory(slot.history);
+            if (history.size() >= 2) {
+                ScopedLatency timing(latencyStats.get(), LatencyStream::DetectVoice);
+                ScopedProfile voiceTiming(profiler.get(), ProfileStage::VoiceDetector);
+                voiceDetector.updateVoice(slot.track, voiceOrder[i], history, events);
+            }
+        }
+    });
+
+    for (const auto& buffer : workerEvents) {
+        for (const auto& event : buffer) {
+            sendVoiceEvent(event);
+        }
+    }
+}
+
 void ofApp::updateGlobalGestures(uint64_t now) {
-    std::vector<GlobalGestureEvent> events;
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::GlobalGestures);
+    globalEvents.clear();
     int activeVoices = static_cast<int>(voices.size());
-    globalDetector.update(lastGlobalMotion, activeVoices, now, events);
-    for (const auto& event : events) {
+    if (cluster.isAggregator()) {
+        // The room is the sum of the edges; if they all go quiet the last
+        // motion value stands, as it would on a lone host.
+        activeVoices = cluster.getActiveVoices(now * 1000);
+        cluster.getMotion(now * 1000, lastGlobalMotion);
+        lastGlobalMotionArrivalMicros = cluster.getLastSummaryArrival();
+    }
+    {
+        ScopedLatency timing(latencyStats.get(), LatencyStream::DetectGlobal);
+        globalDetector.update(lastGlobalMotion, activeVoices, now, globalEvents);
+    }
+    for (auto& event : globalEvents) {
+        event.sourceMicros = lastGlobalMotionArrivalMicros;
         sendGlobalEvent(event);
     }
 }
 
+void ofApp::updateEnsembleGestures(uint64_t now) {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::EnsembleGestures);
+    ensembleEvents.clear();
+    {
+        ScopedLatency timing(latencyStats.get(), LatencyStream::DetectEnsemble);
+        // Every live voice counts here, not just the dirty ones: standing
+        // still next to someone is still standing next to them.
+        ensembleDetector.beginFrame();
+        if (cluster.isAggregator()) {
+            // Each voice once, from the edge that owns it; neighbours on
+            // either side of a shard boundary are neighbours all the same.
+            cluster.forEachVoice(now * 1000, [this](const ClusterVoice& voice, uint64_t arrivalMicros) {
+                ensembleDetector.addVoice(voice.id, glm::vec3(voice.x, 0.0f, voice.z), arrivalMicros);
+            });
+        }
+        for (int voiceId = 0; voiceId < voices.span(); ++voiceId) {
+            const VoiceSlot& slot = voices.slot(voiceId);
+            if (slot.live) {
+                ensembleDetector.addVoice(voiceId, slot.position, slot.arrivalMicros);
+            }
+        }
+        ensembleDetector.update(now, ensembleEvents);
+    }
+    for (const auto& event : ensembleEvents) {
+        sendEnsembleEvent(event);
+    }
+}
+
 void ofApp::sendVoiceEvent(const VoiceGestureEvent& event) {
-    if (settings.enableSending) {
-        ofxOscMessage message;
-        message.setAddress("/room/gesture/voice");
-        message.addIntArg(event.voiceId);
-        message.addStringArg(event.type);
-        message.addFloatArg(event.strength);
-        message.addFloatArg(event.extra);
-        gestureSender.sendMessage(message, false);
+    VoiceGestureEvent stamped = event;
+    // The "matching" packet is the latest state update for that voice.
+    const VoiceSlot* slot = voices.find(event.voiceId);
+    if (latencyStats) {
+        stamped.sourceMicros = slot ? slot->arrivalMicros : 0;
+    }
+    if (slot && cluster.isEdge()) {
+        // Ensemble sync happens on the aggregator; previews stay local.
+        if (event.phase == VoiceGesturePhase::Complete) {
+            cluster.sendGesture(event, slot->lastUpdateMicros);
+        }
+    } else if (slot) {
+        ensembleDetector.noteVoiceGesture(event, slot->lastUpdateMicros / 1000);
+    }
+    for (auto& destination : destinations) {
+        destination->push(stamped);
     }
 }
 
 void ofApp::sendZoneEvent(const ZoneGestureEvent& event) {
-    if (settings.enableSending) {
-        ofxOscMessage message;
-        message.setAddress("/room/gesture/zone");
-        message.addIntArg(event.camId);
-        message.addStringArg(event.type);
-        message.addFloatArg(event.strength);
-        if (event.hasZoneIndex) {
-            message.addIntArg(event.zoneIndex);
-        }
-        gestureSender.sendMessage(message, false);
+    for (auto& destination : destinations) {
+        destination->push(event);
     }
 }
 
 void ofApp::sendGlobalEvent(const GlobalGestureEvent& event) {
-    if (settings.enableSending) {
-        ofxOscMessage message;
-        message.setAddress("/room/gesture/global");
-        message.addStringArg(event.type);
-        message.addFloatArg(event.strength);
-        gestureSender.sendMessage(message, false);
+    for (auto& destination : destinations) {
+        destination->push(event);
+    }
+}
+
+void ofApp::sendEnsembleEvent(const EnsembleGestureEvent& event) {
+    for (auto& destination : destinations) {
+        destination->push(event);
     }
 }
 
+void ofApp::flushGestures() {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Flush);
+    for (auto& destination : destinations) {
+        destination->flush();
+    }
+}
+
+void ofApp::startTrace() {
+    std::string path = settings.traceFile;
+    if (path.empty()) {
+        ofDirectory::createDirectory("traces", true, true);
+        path = "traces/" + ofGetTimestampString("%Y-%m-%d-%H-%M-%S") + ".json";
+    }
+    if (!profiler->startTrace(ofToDataPath(path, true), static_cast<uint64_t>(std::max(1, settings.traceDurationMs)))) {
+        ofLogWarning() << "a trace is already being captured";
+    }
+}
+
+void ofApp::updateProfile() {
+    // Main thread, once per frame: trace requests, the end of a capture, and
+    // the once-a-second breakdown of where the time went.
+    if (traceRequested.exchange(false)) {
+        startTrace();
+    }
+    profiler->poll();
+    const uint64_t now = nowMillis();
+    if (now < lastProfileDrain + 1000) {
+        return;
+    }
+    lastProfileDrain = now;
+    std::array<ProfileSummary, kProfileStageCount> summaries;
+    profiler->drain(summaries);
+    if (headless) {
+        // No HUD to read it from: one line, between ticks, with every stage that ran.
+        std::stringstream line;
+        for (const auto& summary : summaries) {
+            if (summary.calls > 0) {
+                line << " " << summary.name << " " << summary.totalNanos / 1000;
+            }
+        }
+        ofLogNotice("StageProfiler") << "us in the last second:" << line.str();
+    }
+    std::lock_guard<std::mutex> lock(hudStatsMutex);
+    hudProfile = summaries;
+}
+
+void ofApp::publishStats(uint64_t now) {
+    lastStatsPublish = now;
+    std::array<LatencySummary, kLatencyStreamCount> summaries;
+    latencyStats->drain(summaries);
+    for (const auto& summary : summaries) {
+        for (auto& destination : destinations) {
+            destination->push(summary);
+        }
+    }
+    std::lock_guard<std::mutex> lock(hudStatsMutex);
+    hudStats = summaries;
+}
+
+void ofApp::recordPacket(const IngestPacket& packet) {
+    switch (packet.kind) {
+    case IngestPacket::Kind::VoiceState:
+        sessionLog.appendVoice(packet.timestampMicros, packet.id, packet.position.x, packet.position.y, packet.position.z,
+                               packet.size, packet.motion, packet.energy);
+        break;
+    case IngestPacket::Kind::VoiceDisconnect:
+        sessionLog.appendDisconnect(packet.timestampMicros, packet.id);
+        break;
+    case IngestPacket::Kind::CameraZones:
+        sessionLog.appendZones(packet.timestampMicros, packet.id, packet.cols, packet.rows, packet.zones.data());
+        break;
+    case IngestPacket::Kind::GlobalMotion:
+        sessionLog.appendGlobal(packet.timestampMicros, packet.globalMotion);
+        break;
+    }
+}
+
+bool ofApp::startReplay() {
+    const std::string path = ofToDataPath(settings.replayFile);
+    if (!replay.open(path)) {
+        ofLogError() << "could not open session log " << path << " – listening live instead";
+        return false;
+    }
+    settings.detectOnReceiveThread = replay.isInlineDetection();
+    replay.peekTimestamp(replayOriginMicros);
+    replayWallStart = monotonicMicros();
+    ofLogNotice() << "replaying " << path << ": " << replay.getRecordCount() << " records "
+                  << (settings.replaySpeed > 0.0f ? "at " + ofToString(settings.replaySpeed) + "x" : "as fast as possible");
+    return true;
+}
+
+void ofApp::advanceReplay() {
+    ScopedProfile stageTiming(profiler.get(), ProfileStage::Replay);
+    // Paced: release every sample the virtual clock has passed. Flat out:
+    // chew through the log for a slice of each frame so the window stays
+    // responsive while an hour of show goes by in seconds.
+    const uint64_t frameStart = monotonicMicros();
+    const bool paced = settings.replaySpeed > 0.0f;
+    const uint64_t clockMicros =
+        replayOriginMicros + static_cast<uint64_t>(static_cast<double>(frameStart - replayWallStart) * settings.replaySpeed);
+
+    SessionSample sample;
+    uint64_t nextMicros = 0;
+    for (uint32_t n = 0; replay.peekTimestamp(nextMicros); ++n) {
+        if (paced ? nextMicros > clockMicros : ((n & 255) == 255 && monotonicMicros() - frameStart > kReplaySliceMicros)) {
+            return;
+        }
+        if (replay.next(sample)) {
+            replaySample(sample);
+        }
+    }
+    if (!replayDone) {
+        replayDone = true;
+        ofLogNotice() << "replay finished after " << replay.getRecordCount() << " records";
+    }
+}
+
+void ofApp::replaySample(const SessionSample& sample) {
+    if (sample.kind == SessionRecordKind::Tick) {
+        runDetectionTick(sample.timestampMicros / 1000);
+        flushGestures();
+        return;
+    }
+
+    IngestPacket& packet = replayPacket;
+    packet.timestampMicros = sample.timestampMicros;
+    packet.arrivalMicros = latencyStats ? monotonicMicros() : 0;
+    packet.id = sample.id;
+    switch (sample.kind) {
+    case SessionRecordKind::Voice:
+        packet.kind = IngestPacket::Kind::VoiceState;
+        packet.position = glm::vec3(sample.values[0], sample.values[1], sample.values[2]);
+        packet.size = sample.values[3];
+        packet.motion = sample.values[4];
+        packet.energy = sample.values[5];
+        break;
+    case SessionRecordKind::Disconnect:
+        packet.kind = IngestPacket::Kind::VoiceDisconnect;
+        break;
+    case SessionRecordKind::Zones:
+        if (sample.cols > kMaxZoneLanes || sample.rows > kMaxZoneLanes || sample.cols * sample.rows > kMaxZoneCells) {
+            return;
+        }
+        packet.kind = IngestPacket::Kind::CameraZones;
+        packet.cols = sample.cols;
+        packet.rows = sample.rows;
+        std::copy(sample.cells, sample.cells + sample.cols * sample.rows, packet.zones.begin());
+        break;
+    case SessionRecordKind::Global:
+        packet.kind = IngestPacket::Kind::GlobalMotion;
+        packet.globalMotion = sample.values[0];
+        break;
+    case SessionRecordKind::Tick:
+        return;
+    }
+    handlePacket(packet);
+    if (settings.detectOnReceiveThread) {
+        flushGestures(); // inline mode flushed after every packet live, too
+    }
+}
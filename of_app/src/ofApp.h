@@ -1,14 +1,30 @@
 #pragma once
 
 #include "ofMain.h"
-#include "ofxOsc.h"
 
+#include "AsyncLogger.h"
+#include "CapturePipeline.h"
+#include "ClusterNode.h"
+#include "DetectionWorkerPool.h"
+#include "DetectorConfig.h"
+#include "DetectorSnapshot.h"
+#include "EnsembleGestureDetector.h"
+#include "GestureDestination.h"
 #include "GestureHistory.h"
 #include "GlobalGestureDetector.h"
+#include "LatencyStats.h"
+#include "OscIngestThread.h"
+#include "SessionLog.h"
+#include "StageProfiler.h"
+#include "TelemetryPublisher.h"
 #include "VoiceGestureDetector.h"
+#include "VoiceSlotTable.h"
 #include "ZoneGestureDetector.h"
 
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 /**
  * ofApp is the conductor glue that ties together OSC I/O, gesture detection,
@@ -16,21 +32,26 @@
  * and we wire them up to mirror the architecture doc one-to-one so students can
  * correlate prose to code. Most helper methods below exist purely so each step
  * can be narrated with words and logs.
+ *
+ * Headless (no window, see main.cpp) the same hooks still run; update() is
+ * just paced by a timer at `tick_hz` instead of the display, and draw() has
+ * nothing to draw.
  */
 class ofApp : public ofBaseApp {
 public:
+    explicit ofApp(bool headless = false) : headless(headless) {}
+
     void setup() override;
     void update() override;
     void draw() override;
     void exit() override;
+    void keyPressed(int key) override;
 
 private:
-    struct VoiceState {
-        glm::vec3 position = glm::vec3(0.0f);
-        float size = 0.0f;
-        float motion = 0.0f;
-        float energy = 0.0f;
-        uint64_t lastUpdate = 0;
+    // What happens when one voice sends several samples inside a frame.
+    enum class VoiceCoalescing {
+        EverySample,    // each packet becomes a history row (the default).
+        LatestPerFrame, // one row per frame: latest position/energy, averaged motion.
     };
 
     struct OscSettings {
@@ -38,31 +59,142 @@ private:
         std::string gestureHost = "127.0.0.1";
         int gesturePort = 9001;
         bool enableSending = true;
+        std::size_t ingestQueueCapacity = 1024; // packets buffered between receive and update().
+        bool detectOnReceiveThread = false;     // run detectors as packets land, not per frame.
+        int receiveTickMs = 8;                  // housekeeping cadence in receive-thread mode.
+        int detectionThreads = 1;               // per-voice workers; 1 = serial, 0 = one per core.
+        int maxVoices = 64;                     // voice slots preallocated (ids 0..maxVoices-1).
+        VoiceCoalescing voiceCoalescing = VoiceCoalescing::EverySample; // per-frame mode only.
+        GestureOscSender::Settings output;      // bundling + MTU for outgoing gestures.
+        std::size_t sendQueueCapacity = 1024;   // events buffered per destination.
+        OutputGovernor::Settings governor;      // default rate caps + merge window per destination.
+        bool statsEnabled = false;              // latency histograms + /room/host/stats.
+        int statsIntervalMs = 1000;             // how often stats are published and reset.
+        bool profileEnabled = false;            // per-stage timing zones; HUD breakdown + traces on demand.
+        std::string traceFile;                  // where a trace goes; empty = data/traces/<timestamp>.json.
+        int traceDurationMs = 5000;             // how long one trace capture runs.
+        bool traceAtStart = false;              // capture the first traceDurationMs after startup.
+        bool recordSession = false;             // log every sample + tick to a .crowdlog.
+        std::string recordFile;                 // where; empty = data/sessions/<timestamp>.crowdlog.
+        std::string replayFile;                 // replay this log instead of listening.
+        float replaySpeed = 1.0f;               // 1 = real time, 4 = 4x, 0 = as fast as possible.
+        bool snapshotEnabled = false;           // keep detector state on disk for a warm restart.
+        std::string snapshotFile = "snapshot.crowdsnap"; // in the data folder.
+        int snapshotIntervalMs = 1000;          // how often the state is written.
+        int snapshotMaxAgeMs = 10000;           // older snapshots are ignored at startup.
+        DetectorConfigs detectors;              // thresholds for every detector family.
+        CapturePipeline::Settings capture;      // in-process Kinect/webcam capture; empty = OSC only.
+        ClusterNode::Settings cluster;          // edge/aggregator role when the room spans several hosts.
+        TelemetryPublisher::Settings telemetry; // slow, delta-encoded room state for dashboards.
+        int tickHz = 120;                       // headless: update()/detection rate (no vsync to lean on).
+        bool showHud = true;                    // windowed: draw the diagnostics overlay.
+        bool watchSettings = true;              // pick up threshold edits without a restart.
+        int watchIntervalMs = 500;              // how often the settings file is checked.
+        // Where gestures go. Empty means "just gestureHost:gesturePort".
+        std::vector<GestureDestination::Settings> destinations;
     } settings;
 
     void loadSettings();
+    void loadDestinations(const ofJson& list);
     void processOscMessages();
+    void handlePacket(const IngestPacket& packet);
+    void applyDetectorConfigs(const DetectorConfigs& configs);
+    void runDetectionTick(uint64_t now);
     void pruneVoices(uint64_t now);
+    void expireOnsets(uint64_t now);
+    void releaseVoice(int voiceId, uint64_t now);
+    void landCoalescedSamples();
     void updateVoiceGestures();
+    void updateVoiceGesturesParallel();
     void updateGlobalGestures(uint64_t now);
+    void updateEnsembleGestures(uint64_t now);
+    void handleClusterMessage(const ClusterMessage& message);
+    void acceptHandoff(const ClusterMessage& message);
+    void handOffVoices(uint64_t now);
+    void publishToCluster(uint64_t now);
     void sendVoiceEvent(const VoiceGestureEvent& event);
     void sendZoneEvent(const ZoneGestureEvent& event);
     void sendGlobalEvent(const GlobalGestureEvent& event);
+    void sendEnsembleEvent(const EnsembleGestureEvent& event);
+    void flushGestures();
+    void publishStats(uint64_t now);
+    void recordPacket(const IngestPacket& packet);
+    bool startReplay();
+    void advanceReplay();
+    void replaySample(const SessionSample& sample);
+    void restoreSnapshot();
+    void takeSnapshot(uint64_t now);
+    void startTrace();
+    void updateProfile();
+
+    const bool headless;       // no window: timer-paced loop, no HUD.
 
-    ofxOscReceiver stateReceiver;
-    ofxOscSender gestureSender;
+    OscIngestThread ingest;    // owns the listening socket + receive thread.
+    CapturePipeline capture;   // local devices, one capture thread each; drained like the socket.
+    ClusterNode cluster;       // peers and aggregator when sharded; idle on a standalone host.
+    std::vector<ClusterVoice> clusterVoices; // edge: this summary's voice list, reused.
+    TelemetryPublisher telemetry; // dashboards; sends inline on the detection thread.
+    // One queue + send thread per listener so a slow one cannot stall the rest.
+    std::vector<std::unique_ptr<GestureDestination>> destinations;
 
-    std::unordered_map<int, VoiceState> voices; // live state for each performer.
+    VoiceSlotTable voices;                     // live state + cooldowns per performer, by id.
+    bool warnedVoiceRange = false;             // complained about an out-of-range id yet?
 
     GestureHistory gestureHistory;             // per-voice motion breadcrumbs.
-    VoiceGestureDetector voiceDetector;        // per-voice gesture logic.
-    ZoneGestureDetector zoneDetector;          // 4x4 grid sweep/pulse logic.
+    VoiceGestureDetector voiceDetector;        // per-voice gesture rules (state lives in the slots).
+    DetectionWorkerPool detectionPool;         // shards voices across cores.
+    std::vector<int> voiceOrder;               // this frame's dirty voice ids, ascending.
+    std::vector<std::vector<VoiceGestureEvent>> workerEvents; // one buffer per worker.
+    // Event scratch for whichever thread runs detection: cleared before each
+    // use, never shrunk, so once the show has had its busiest frame nothing
+    // on the detection path asks the allocator for memory again.
+    std::vector<VoiceGestureEvent> voiceEvents;
+    std::vector<ZoneGestureEvent> zoneEvents;
+    std::vector<GlobalGestureEvent> globalEvents;
+    std::vector<EnsembleGestureEvent> ensembleEvents;
+    ZoneGestureDetector zoneDetector;          // camera grid sweep/pulse logic.
     GlobalGestureDetector globalDetector;      // crowd-wide eruption/stillness.
+    EnsembleGestureDetector ensembleDetector;  // neighbours acting together: sync/cluster/ring.
+    DetectorConfigWatcher configWatcher;       // hands over re-read thresholds between ticks.
 
     float lastGlobalMotion = 0.0f;
     uint64_t lastGlobalMotionTimestamp = 0;
+    uint64_t lastGlobalMotionArrivalMicros = 0;
     uint64_t lastZoneUpdate = 0;
 
+    // The HUD may run on a different thread than detection, so it only reads
+    // these mirrors instead of poking at the live maps.
+    std::atomic<int> hudVoiceCount{0};
+    std::atomic<float> hudGlobalMotion{0.0f};
+
+    // Latency instrumentation. Null unless stats_enabled, and every probe
+    // checks the pointer first, so a disabled build pays a branch, not a clock.
+    std::unique_ptr<LatencyStats> latencyStats;
+    uint64_t lastStatsPublish = 0;
+    std::mutex hudStatsMutex;
+    std::array<LatencySummary, kLatencyStreamCount> hudStats; // last published interval.
+
+    // Stage profiling. Null unless profile_enabled, checked like latencyStats.
+    std::unique_ptr<StageProfiler> profiler;
+    uint64_t lastProfileDrain = 0;
+    std::array<ProfileSummary, kProfileStageCount> hudProfile; // guarded by hudStatsMutex.
+
+    // Session logging. The writer belongs to whichever thread runs detection;
+    // in replay mode the reader stands in for the ingest thread entirely.
+    SessionLogWriter sessionLog;
+    SessionLogReader replay;
+    bool replaying = false;
+    bool replayDone = false;
+    uint64_t replayOriginMicros = 0; // first timestamp in the log.
+    uint64_t replayWallStart = 0;    // monotonicMicros() when playback began.
+    IngestPacket replayPacket;       // reused so replay never zeroes a fresh grid per sample.
+
+    // Warm restart. Detection fills a snapshot buffer now and then and the
+    // writer's thread puts it on disk.
+    DetectorSnapshotWriter snapshotWriter;
+    uint64_t lastSnapshot = 0;
+    uint64_t restoredAt = 0;         // nowMillis() when a snapshot was loaded; 0 = started cold.
+
     std::size_t voiceHistoryCapacity = 60;
 };
 
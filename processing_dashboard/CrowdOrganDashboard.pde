@@ -19,6 +19,11 @@ class Voice {
   float energy;
   float note;
   float velocity;
+  // Telemetry arrives at ~15 Hz, so those voices glide toward their latest
+  // position instead of hopping; raw /room/voice/state voices are drawn as is.
+  boolean viaTelemetry = false;
+  int lastTelemetryMillis = 0;
+  float shownX, shownY;
   String lastGestureType = "";
   float lastGestureStrength = 0.0;
   int lastGestureFrame = -999;
@@ -46,6 +51,11 @@ Voice[] voices = new Voice[NUM_VOICES];
 
 float globalMotion = 0.0;
 
+// The host's /room/telemetry/* feed (see docs/OSC_SCHEMA.md). Voices it
+// stops refreshing are dropped after a few keyframes' worth of silence.
+int telemetryKeyframeMs = 2000;
+float telemetryTimeoutKeyframes = 2.5;
+
 int[] camCols = new int[CAMS];
 int[] camRows = new int[CAMS];
 float[][] camZones = new float[CAMS][];  // each is length cols*rows
@@ -77,6 +87,7 @@ void setup() {
 
 void draw() {
   cleanupZoneFlashes();
+  expireTelemetryVoices();
 
   background(8);
 
@@ -128,9 +139,17 @@ void drawVoices() {
     Voice v = voices[i];
     if (!v.active) continue;
 
+    if (v.viaTelemetry) {
+      v.shownX = lerp(v.shownX, v.x, 0.3);
+      v.shownY = lerp(v.shownY, v.y, 0.3);
+    } else {
+      v.shownX = v.x;
+      v.shownY = v.y;
+    }
+
     // Convert normalized coordinates to a simple stage map.
-    float px = v.x * 320.0;
-    float py = (1.0 - v.y) * 320.0;
+    float px = v.shownX * 320.0;
+    float py = (1.0 - v.shownY) * 320.0;
     float radius = map(v.size, 0.0, 1.0, 12.0, 70.0);
 
     int baseCol = color(
@@ -296,6 +315,18 @@ void drawFooter() {
   }
 }
 
+void expireTelemetryVoices() {
+  // A lost /room/telemetry/gone, or a host that went away, must not leave
+  // ghosts on stage: every live voice is resent at least once per keyframe.
+  int timeout = (int)(telemetryKeyframeMs * telemetryTimeoutKeyframes);
+  for (int i = 0; i < NUM_VOICES; i++) {
+    Voice v = voices[i];
+    if (v.active && v.viaTelemetry && millis() - v.lastTelemetryMillis > timeout) {
+      v.active = false;
+    }
+  }
+}
+
 void cleanupZoneFlashes() {
   for (int i = zoneFlashes.size() - 1; i >= 0; i--) {
     ZoneFlash flash = zoneFlashes.get(i);
@@ -358,6 +389,7 @@ void oscEvent(OscMessage msg) {
     int vid = msg.get(0).intValue();
     if (vid >= 0 && vid < NUM_VOICES) {
       Voice v = voices[vid];
+      v.viaTelemetry = false;
       v.x      = msg.get(1).floatValue();
       v.y      = msg.get(2).floatValue();
       v.z      = msg.get(3).floatValue();
@@ -398,6 +430,25 @@ void oscEvent(OscMessage msg) {
       }
     }
 
+  } else if (addr.equals("/room/telemetry/frame")) {
+    globalMotion = msg.get(2).floatValue();
+    telemetryKeyframeMs = max(1, msg.get(3).intValue());
+
+  } else if (addr.equals("/room/telemetry/voices")) {
+    handleTelemetryVoices(msg.get(0).blobValue());
+
+  } else if (addr.equals("/room/telemetry/gone")) {
+    byte[] ids = msg.get(0).blobValue();
+    for (int off = 0; off + 2 <= ids.length; off += 2) {
+      int vid = readUint16(ids, off);
+      if (vid < NUM_VOICES) {
+        voices[vid].active = false;
+      }
+    }
+
+  } else if (addr.equals("/room/telemetry/zones")) {
+    handleTelemetryZones(msg.get(0).intValue(), msg.get(1).intValue(), msg.get(2).intValue(), msg.get(3).blobValue());
+
   } else if (addr.equals("/room/gesture/voice")) {
     int vid = msg.get(0).intValue();
     String type = msg.get(1).stringValue();
@@ -416,6 +467,65 @@ void oscEvent(OscMessage msg) {
     String type = msg.get(0).stringValue();
     float strength = msg.get(1).floatValue();
     handleGlobalGesture(type, strength);
+
+  } else if (addr.equals("/room/gesture/ensemble")) {
+    String type = msg.get(0).stringValue();
+    float strength = msg.get(1).floatValue();
+    int count = msg.get(2).intValue();
+    float x = msg.get(3).floatValue();
+    float z = msg.get(4).floatValue();
+    handleEnsembleGesture(type, strength, count, x, z);
+  }
+}
+
+// Telemetry blobs are big-endian. Each voice record is 12 bytes:
+// id (u16), x/y/z (s16, /32767), size/motion/energy (u8, /255), one spare.
+int readUint16(byte[] b, int off) {
+  return ((b[off] & 0xff) << 8) | (b[off + 1] & 0xff);
+}
+
+float readPosition(byte[] b, int off) {
+  return (short)readUint16(b, off) / 32767.0;
+}
+
+float readUnit(byte[] b, int off) {
+  return (b[off] & 0xff) / 255.0;
+}
+
+void handleTelemetryVoices(byte[] records) {
+  for (int off = 0; off + 12 <= records.length; off += 12) {
+    int vid = readUint16(records, off);
+    if (vid >= NUM_VOICES) continue;
+    Voice v = voices[vid];
+    v.x      = readPosition(records, off + 2);
+    v.y      = readPosition(records, off + 4);
+    v.z      = readPosition(records, off + 6);
+    v.size   = readUnit(records, off + 8);
+    v.motion = readUnit(records, off + 9);
+    v.energy = readUnit(records, off + 10);
+    if (!v.active || !v.viaTelemetry) {
+      // Newcomers appear where they are rather than gliding in from the last spot.
+      v.shownX = v.x;
+      v.shownY = v.y;
+    }
+    v.active = true;
+    v.viaTelemetry = true;
+    v.lastTelemetryMillis = millis();
+  }
+}
+
+void handleTelemetryZones(int camId, int cols, int rows, byte[] cells) {
+  if (camId < 0 || camId >= CAMS || cols <= 0 || rows <= 0 || cells.length < cols * rows) {
+    return;
+  }
+  int numZones = cols * rows;
+  camCols[camId] = cols;
+  camRows[camId] = rows;
+  if (camZones[camId] == null || camZones[camId].length != numZones) {
+    camZones[camId] = new float[numZones];
+  }
+  for (int i = 0; i < numZones; i++) {
+    camZones[camId][i] = readUnit(cells, i);
   }
 }
 
@@ -449,3 +559,7 @@ void handleGlobalGesture(String type, float strength) {
   lastGlobalGestureFrame = frameCount;
   pushGestureLog("global", "room", type, strength, "");
 }
+
+void handleEnsembleGesture(String type, float strength, int count, float x, float z) {
+  pushGestureLog("ensemble", count + " voices", type, strength, "@" + nf(x, 1, 2) + "," + nf(z, 1, 2));
+}